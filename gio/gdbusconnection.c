@@ -456,6 +456,11 @@ struct _GDBusConnection
    */
   GDBusCapabilityFlags capabilities;
 
+  /* Message bodies of at least this size are sent in a memfd, if not 0.
+   * Protected by @lock.
+   */
+  gsize memfd_threshold;
+
   /* Protected by @init_lock */
   GDBusAuthObserver *authentication_observer;
 
@@ -1623,6 +1628,78 @@ g_dbus_connection_get_last_serial (GDBusConnection *connection)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/**
+ * g_dbus_connection_get_memfd_threshold:
+ * @connection: A #GDBusConnection.
+ *
+ * Gets the size from which on message bodies are sent in a memfd, as
+ * set with g_dbus_connection_set_memfd_threshold().
+ *
+ * Returns: The threshold in bytes, or 0 if bodies are never sent in
+ * a memfd.
+ *
+ * Since: 2.38
+ */
+gsize
+g_dbus_connection_get_memfd_threshold (GDBusConnection *connection)
+{
+  gsize ret;
+
+  g_return_val_if_fail (G_IS_DBUS_CONNECTION (connection), 0);
+
+  CONNECTION_LOCK (connection);
+  ret = connection->memfd_threshold;
+  CONNECTION_UNLOCK (connection);
+
+  return ret;
+}
+
+/**
+ * g_dbus_connection_set_memfd_threshold:
+ * @connection: A #GDBusConnection.
+ * @threshold: A size in bytes, or 0 to turn this off.
+ *
+ * Makes @connection send the body of every message that is at least
+ * @threshold bytes big in a sealed memfd, passed along with the
+ * message as a file descriptor, instead of through the stream of
+ * @connection.  The receiving side maps the memfd and uses it as the
+ * message body, so large arrays are neither written to the stream nor
+ * copied on the way.  This is transparent to users of
+ * g_dbus_connection_call() and friends on both sides.
+ *
+ * This only has an effect if @connection supports
+ * %G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING and the operating system
+ * supports memfds.  Since only GDBus knows how to receive such
+ * messages, it can only be turned on for peer-to-peer connections,
+ * not for message bus connections.
+ *
+ * A non-zero @threshold also makes @connection accept message bodies
+ * in a memfd from the other side, so both peers have to call this.
+ * Pass %G_MAXSIZE to accept them without ever sending any.  A received
+ * message whose body cannot be loaded from its memfd is dropped.
+ *
+ * By default, bodies are never sent or accepted in a memfd.
+ *
+ * Since: 2.38
+ */
+void
+g_dbus_connection_set_memfd_threshold (GDBusConnection *connection,
+                                       gsize            threshold)
+{
+  g_return_if_fail (G_IS_DBUS_CONNECTION (connection));
+  g_return_if_fail (threshold == 0 || !(connection->flags & G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION));
+
+  if (!check_initialized (connection))
+    return;
+
+  CONNECTION_LOCK (connection);
+  connection->memfd_threshold = threshold;
+  _g_dbus_worker_set_accept_memfd_bodies (connection->worker, threshold != 0);
+  CONNECTION_UNLOCK (connection);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 /* Can be called by any thread, with the connection lock held */
 static gboolean
 g_dbus_connection_send_message_unlocked (GDBusConnection   *connection,
@@ -1633,6 +1710,7 @@ g_dbus_connection_send_message_unlocked (GDBusConnection   *connection,
 {
   guchar *blob;
   gsize blob_size;
+  GUnixFDList *fd_list;
   guint32 serial_to_use;
   gboolean ret;
 
@@ -1645,6 +1723,7 @@ g_dbus_connection_send_message_unlocked (GDBusConnection   *connection,
 
   ret = FALSE;
   blob = NULL;
+  fd_list = NULL;
 
   if (out_serial != NULL)
     *out_serial = 0;
@@ -1659,10 +1738,12 @@ g_dbus_connection_send_message_unlocked (GDBusConnection   *connection,
                        error))
     goto out;
 
-  blob = g_dbus_message_to_blob (message,
-                                 &blob_size,
-                                 connection->capabilities,
-                                 error);
+  blob = _g_dbus_message_to_blob_with_memfd (message,
+                                             connection->memfd_threshold,
+                                             &blob_size,
+                                             connection->capabilities,
+                                             &fd_list,
+                                             error);
   if (blob == NULL)
     goto out;
 
@@ -1713,12 +1794,15 @@ g_dbus_connection_send_message_unlocked (GDBusConnection   *connection,
   _g_dbus_worker_send_message (connection->worker,
                                message,
                                (gchar*) blob,
-                               blob_size);
+                               blob_size,
+                               fd_list);
   blob = NULL; /* since _g_dbus_worker_send_message() steals the blob */
 
   ret = TRUE;
 
  out:
+  if (fd_list != NULL)
+    g_object_unref (fd_list);
   g_free (blob);
 
   return ret;
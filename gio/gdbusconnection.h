@@ -117,6 +117,12 @@ void             g_dbus_connection_set_exit_on_close          (GDBusConnection
 GLIB_AVAILABLE_IN_ALL
 GDBusCapabilityFlags  g_dbus_connection_get_capabilities      (GDBusConnection    *connection);
 
+GLIB_AVAILABLE_IN_2_38
+gsize            g_dbus_connection_get_memfd_threshold        (GDBusConnection    *connection);
+GLIB_AVAILABLE_IN_2_38
+void             g_dbus_connection_set_memfd_threshold        (GDBusConnection    *connection,
+                                                               gsize               threshold);
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 GLIB_AVAILABLE_IN_ALL
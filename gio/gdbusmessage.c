@@ -52,6 +52,8 @@
 
 #ifdef G_OS_UNIX
 #include "gunixfdlist.h"
+#include <fcntl.h>
+#include <sys/mman.h>
 #endif
 
 #include "glibintl.h"
@@ -63,6 +65,7 @@ struct _GMemoryBuffer
   gsize valid_len;
   gsize pos;
   gchar *data;
+  GBytes *bytes;   /* owner of @data when parsing a received blob, or NULL */
   GDataStreamByteOrder byte_order;
 };
 
@@ -1426,6 +1429,123 @@ read_string (GMemoryBuffer          *mbuf,
   return str;
 }
 
+/* Arrays of fixed-size numbers have the same layout in the D-Bus wire
+ * format and in serialised GVariant, so their bytes can be used as
+ * they are.  Returns the element size, or 0 for other element types.
+ * Booleans are 4 bytes on the wire but 1 byte in GVariant, so they
+ * can't take this path.
+ */
+static gsize
+fixed_array_element_size (const GVariantType *element_type)
+{
+  switch (g_variant_type_peek_string (element_type)[0])
+    {
+    case 'y':
+      return 1;
+    case 'n':
+    case 'q':
+      return 2;
+    case 'i':
+    case 'u':
+    case 'h':
+      return 4;
+    case 'x':
+    case 't':
+    case 'd':
+      return 8;
+    default:
+      return 0;
+    }
+}
+
+/* Returns a floating GVariant of @type for the @array_len bytes at the
+ * current position of @buf.  If @buf is backed by a #GBytes and the
+ * message is in host byte order the value references the blob
+ * directly; byte arrays never need to be swapped.
+ */
+static GVariant *
+parse_fixed_array_from_blob (GMemoryBuffer       *buf,
+                             const GVariantType  *type,
+                             gsize                element_size,
+                             guint32              array_len,
+                             GError             **error)
+{
+  gboolean needs_swap;
+  GBytes *bytes;
+  GVariant *ret;
+
+  if (buf->pos + array_len > buf->valid_len || buf->pos + array_len < buf->pos)
+    {
+      /* G_GSIZE_FORMAT doesn't work with gettext, so we use %lu */
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_ARGUMENT,
+                   g_dngettext (GETTEXT_PACKAGE,
+                                "Wanted to read %lu byte but only got %lu",
+                                "Wanted to read %lu bytes but only got %lu",
+                                (gulong)array_len),
+                                (gulong)array_len,
+                   (gulong)(buf->valid_len - MIN (buf->pos, buf->valid_len)));
+      buf->pos = buf->valid_len;
+      return NULL;
+    }
+
+  if (array_len % element_size != 0)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_ARGUMENT,
+                   _("Array of length %u is not a multiple of its element size %u"),
+                   (guint) array_len,
+                   (guint) element_size);
+      return NULL;
+    }
+
+  if (element_size == 1)
+    needs_swap = FALSE;
+  else if (G_BYTE_ORDER == G_LITTLE_ENDIAN)
+    needs_swap = buf->byte_order != G_DATA_STREAM_BYTE_ORDER_LITTLE_ENDIAN;
+  else
+    needs_swap = buf->byte_order != G_DATA_STREAM_BYTE_ORDER_BIG_ENDIAN;
+
+  if (needs_swap)
+    {
+      gchar *data;
+      gsize n;
+
+      data = g_memdup (buf->data + buf->pos, array_len);
+      for (n = 0; n < array_len; n += element_size)
+        {
+          gpointer element = data + n;
+
+          switch (element_size)
+            {
+            case 2:
+              *(guint16 *) element = GUINT16_SWAP_LE_BE (*(guint16 *) element);
+              break;
+            case 4:
+              *(guint32 *) element = GUINT32_SWAP_LE_BE (*(guint32 *) element);
+              break;
+            case 8:
+              *(guint64 *) element = GUINT64_SWAP_LE_BE (*(guint64 *) element);
+              break;
+            }
+        }
+      bytes = g_bytes_new_take (data, array_len);
+    }
+  else if (buf->bytes != NULL)
+    bytes = g_bytes_new_from_bytes (buf->bytes, buf->pos, array_len);
+  else
+    bytes = g_bytes_new (buf->data + buf->pos, array_len);
+
+  ret = g_variant_new_from_bytes (type, bytes, TRUE);
+  g_bytes_unref (bytes);
+
+  buf->pos += array_len;
+
+  return ret;
+}
+
 /* if just_align==TRUE, don't read a value, just align the input stream wrt padding */
 
 /* returns a non-floating GVariant! */
@@ -1677,6 +1797,7 @@ parse_value_from_blob (GMemoryBuffer          *buf,
           goffset offset;
           goffset target;
           const GVariantType *element_type;
+          gsize element_size;
           GVariantBuilder builder;
 
           array_len = g_memory_buffer_read_uint32 (buf, &local_error);
@@ -1702,8 +1823,23 @@ parse_value_from_blob (GMemoryBuffer          *buf,
               goto fail;
             }
 
-          g_variant_builder_init (&builder, type);
           element_type = g_variant_type_element (type);
+          element_size = fixed_array_element_size (element_type);
+
+          if (array_len > 0 && element_size > 0)
+            {
+              ensure_input_padding (buf, element_size, &local_error);
+              ret = parse_fixed_array_from_blob (buf,
+                                                 type,
+                                                 element_size,
+                                                 array_len,
+                                                 &local_error);
+              if (ret == NULL)
+                goto fail;
+              break;
+            }
+
+          g_variant_builder_init (&builder, type);
 
           if (array_len == 0)
             {
@@ -1717,7 +1853,6 @@ parse_value_from_blob (GMemoryBuffer          *buf,
             }
           else
             {
-              /* TODO: optimize array of primitive types */
               offset = buf->pos;
               target = offset + array_len;
               while (offset < target)
@@ -1997,6 +2132,12 @@ g_dbus_message_bytes_needed (guchar                *blob,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+static GDBusMessage *message_new_from_blob (const guchar          *blob,
+                                            gsize                  blob_len,
+                                            GBytes                *bytes,
+                                            GDBusCapabilityFlags   capabilities,
+                                            GError               **error);
+
 /**
  * g_dbus_message_new_from_blob:
  * @blob: (array length=blob_len) (element-type guint8): A blob represent a binary D-Bus message.
@@ -2018,6 +2159,50 @@ g_dbus_message_new_from_blob (guchar                *blob,
                               gsize                  blob_len,
                               GDBusCapabilityFlags   capabilities,
                               GError               **error)
+{
+  g_return_val_if_fail (blob != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+  g_return_val_if_fail (blob_len >= 12, NULL);
+
+  return message_new_from_blob (blob, blob_len, NULL, capabilities, error);
+}
+
+/*
+ * _g_dbus_message_new_from_bytes:
+ * @blob: A #GBytes holding a binary D-Bus message.
+ * @capabilities: A #GDBusCapabilityFlags describing what protocol features are supported.
+ * @error: Return location for error or %NULL.
+ *
+ * Like g_dbus_message_new_from_blob(), but arrays of fixed-size
+ * numbers in the body (such as `ay`) reference @blob instead of being
+ * copied, so g_variant_get_fixed_array() on them costs nothing.
+ * Used by the #GDBusWorker read path.
+ *
+ * Returns: A new #GDBusMessage or %NULL if @error is set.
+ */
+GDBusMessage *
+_g_dbus_message_new_from_bytes (GBytes                *blob,
+                                GDBusCapabilityFlags   capabilities,
+                                GError               **error)
+{
+  gconstpointer data;
+  gsize size;
+
+  data = g_bytes_get_data (blob, &size);
+
+  g_return_val_if_fail (data != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+  g_return_val_if_fail (size >= 12, NULL);
+
+  return message_new_from_blob (data, size, blob, capabilities, error);
+}
+
+static GDBusMessage *
+message_new_from_blob (const guchar          *blob,
+                       gsize                  blob_len,
+                       GBytes                *bytes,
+                       GDBusCapabilityFlags   capabilities,
+                       GError               **error)
 {
   gboolean ret;
   GMemoryBuffer mbuf;
@@ -2034,15 +2219,12 @@ g_dbus_message_new_from_blob (guchar                *blob,
 
   ret = FALSE;
 
-  g_return_val_if_fail (blob != NULL, NULL);
-  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-  g_return_val_if_fail (blob_len >= 12, NULL);
-
   message = g_dbus_message_new ();
 
   memset (&mbuf, 0, sizeof (mbuf));
   mbuf.data = (gchar *)blob;
   mbuf.len = mbuf.valid_len = blob_len;
+  mbuf.bytes = bytes;
 
   endianness = g_memory_buffer_read_byte (&mbuf, NULL);
   switch (endianness)
@@ -2741,6 +2923,334 @@ g_dbus_message_to_blob (GDBusMessage          *message,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* Bodies that are moved to a memfd are sent as a single handle, with
+ * the real signature of the body in this header field.  Only GDBus
+ * peers know about it, which is why both sending and receiving such
+ * messages have to be enabled explicitly with
+ * g_dbus_connection_set_memfd_threshold().  Elsewhere, it is just an
+ * unknown header field.
+ */
+#define MEMFD_BODY_HEADER_FIELD ((GDBusMessageHeaderField) 'M')
+
+#if defined (G_OS_UNIX) && defined (F_ADD_SEALS)
+/* a receiver only maps a memfd that can no longer change */
+#define MEMFD_BODY_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
+#endif
+
+/*
+ * _g_dbus_message_to_blob_with_memfd:
+ * @message: A #GDBusMessage.
+ * @threshold: The body size from which on the body is sent in a memfd,
+ *   or 0 to never do so.
+ * @out_size: Return location for size of generated blob.
+ * @capabilities: A #GDBusCapabilityFlags describing what protocol features are supported.
+ * @out_fd_list: Return location for the file descriptors to send with
+ *   the blob instead of those of @message.
+ * @error: Return location for error.
+ *
+ * Like g_dbus_message_to_blob(), but if the body of @message is at
+ * least @threshold bytes big and file descriptors can be passed, the
+ * body is written to a sealed memfd that is sent along with the
+ * message.  In that case @out_fd_list is set to the file descriptors
+ * of @message with the memfd appended; otherwise it is set to %NULL.
+ *
+ * Returns: A blob or %NULL if @error is set. Free with g_free().
+ */
+guchar *
+_g_dbus_message_to_blob_with_memfd (GDBusMessage          *message,
+                                    gsize                  threshold,
+                                    gsize                 *out_size,
+                                    GDBusCapabilityFlags   capabilities,
+                                    GUnixFDList          **out_fd_list,
+                                    GError               **error)
+{
+#if defined (HAVE_MEMFD_CREATE) && defined (MEMFD_BODY_SEALS)
+  GMemoryBuffer mbuf;
+  GDBusMessage *wire;
+  GUnixFDList *fd_list;
+  guchar *ret;
+  gsize written;
+  gint handle;
+  gint fd;
+#endif
+
+  *out_fd_list = NULL;
+
+#if defined (HAVE_MEMFD_CREATE) && defined (MEMFD_BODY_SEALS)
+  if (threshold == 0 ||
+      !(capabilities & G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING) ||
+      message->body == NULL ||
+      g_variant_get_size (message->body) < threshold)
+    goto plain;
+
+  fd = memfd_create ("gdbus-message-body", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd == -1)
+    goto plain; /* not supported by the kernel, most likely */
+
+  ret = NULL;
+  wire = NULL;
+  fd_list = NULL;
+
+  memset (&mbuf, 0, sizeof (mbuf));
+  mbuf.len = MIN_ARRAY_SIZE;
+  mbuf.data = g_malloc (mbuf.len);
+  if (message->byte_order == G_DBUS_MESSAGE_BYTE_ORDER_BIG_ENDIAN)
+    mbuf.byte_order = G_DATA_STREAM_BYTE_ORDER_BIG_ENDIAN;
+  else
+    mbuf.byte_order = G_DATA_STREAM_BYTE_ORDER_LITTLE_ENDIAN;
+
+  /* The body starts at an 8-byte boundary in a message, so padding
+   * relative to the start of the memfd is the same.
+   */
+  if (!append_body_to_blob (message->body, &mbuf, error))
+    goto out;
+
+  written = 0;
+  while (written < mbuf.valid_len)
+    {
+      gssize n;
+
+      n = write (fd, mbuf.data + written, mbuf.valid_len - written);
+      if (n == -1)
+        {
+          int errsv = errno;
+
+          if (errsv == EINTR)
+            continue;
+          g_set_error (error,
+                       G_IO_ERROR,
+                       g_io_error_from_errno (errsv),
+                       _("Error writing message body to memfd: %s"),
+                       g_strerror (errsv));
+          goto out;
+        }
+      written += n;
+    }
+
+  if (fcntl (fd, F_ADD_SEALS, MEMFD_BODY_SEALS | F_SEAL_SEAL) != 0)
+    {
+      int errsv = errno;
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errsv),
+                   _("Error sealing memfd: %s"),
+                   g_strerror (errsv));
+      goto out;
+    }
+
+  wire = g_dbus_message_copy (message, error);
+  if (wire == NULL)
+    goto out;
+
+  /* the copy has duplicates of the file descriptors of @message */
+  fd_list = g_dbus_message_get_unix_fd_list (wire);
+  if (fd_list != NULL)
+    g_object_ref (fd_list);
+  else
+    fd_list = g_unix_fd_list_new ();
+  handle = g_unix_fd_list_append (fd_list, fd, error);
+  if (handle == -1)
+    goto out;
+
+  g_dbus_message_set_header (wire,
+                             MEMFD_BODY_HEADER_FIELD,
+                             g_variant_new_signature (g_dbus_message_get_signature (message)));
+  g_dbus_message_set_body (wire, g_variant_new ("(h)", handle));
+  g_dbus_message_set_unix_fd_list (wire, fd_list);
+
+  ret = g_dbus_message_to_blob (wire, out_size, capabilities, error);
+  if (ret != NULL)
+    {
+      *out_fd_list = fd_list;
+      fd_list = NULL;
+    }
+
+ out:
+  if (fd_list != NULL)
+    g_object_unref (fd_list);
+  if (wire != NULL)
+    g_object_unref (wire);
+  g_free (mbuf.data);
+  close (fd);
+  return ret;
+
+ plain:
+#endif
+  return g_dbus_message_to_blob (message, out_size, capabilities, error);
+}
+
+#ifdef MEMFD_BODY_SEALS
+typedef struct
+{
+  gpointer data;
+  gsize    size;
+} MemfdMapping;
+
+static void
+memfd_mapping_free (gpointer user_data)
+{
+  MemfdMapping *mapping = user_data;
+
+  munmap (mapping->data, mapping->size);
+  g_slice_free (MemfdMapping, mapping);
+}
+#endif
+
+/*
+ * _g_dbus_message_load_memfd_body:
+ * @message: A #GDBusMessage that was just received, with its file
+ *   descriptors set.
+ * @error: Return location for error.
+ *
+ * If the body of @message was sent in a memfd by
+ * _g_dbus_message_to_blob_with_memfd(), maps the memfd and replaces
+ * the body with its contents, and removes the memfd from the file
+ * descriptors of @message.  Arrays of fixed-size numbers in the body
+ * reference the mapping rather than being copied.  Does nothing for
+ * other messages.
+ *
+ * Returns: %TRUE unless @error is set.
+ */
+gboolean
+_g_dbus_message_load_memfd_body (GDBusMessage  *message,
+                                 GError       **error)
+{
+#ifdef MEMFD_BODY_SEALS
+  GMemoryBuffer mbuf;
+  MemfdMapping *mapping;
+  GUnixFDList *fd_list;
+  GVariantType *variant_type;
+  GVariant *body;
+  gchar *signature_str;
+  gchar *tupled_signature_str;
+  const gint *fds;
+  gint num_fds;
+  gint handle;
+  gint seals;
+  struct stat statbuf;
+  gint n;
+#endif
+  GVariant *signature;
+
+  signature = g_dbus_message_get_header (message, MEMFD_BODY_HEADER_FIELD);
+  if (signature == NULL)
+    return TRUE;
+
+#ifdef MEMFD_BODY_SEALS
+  if (!g_variant_is_of_type (signature, G_VARIANT_TYPE_SIGNATURE) ||
+      message->body == NULL ||
+      !g_variant_is_of_type (message->body, G_VARIANT_TYPE ("(h)")) ||
+      message->fd_list == NULL)
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_ARGUMENT,
+                           _("Malformed message with body in a memfd"));
+      return FALSE;
+    }
+
+  g_variant_get (message->body, "(h)", &handle);
+  fds = g_unix_fd_list_peek_fds (message->fd_list, &num_fds);
+  if (handle < 0 || handle >= num_fds)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_ARGUMENT,
+                   _("Message body is in file descriptor %d but the message only has %d"),
+                   handle, num_fds);
+      return FALSE;
+    }
+
+  /* the sender must not be able to change the body under our feet */
+  seals = fcntl (fds[handle], F_GET_SEALS);
+  if (seals == -1 || (seals & MEMFD_BODY_SEALS) != MEMFD_BODY_SEALS)
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_ARGUMENT,
+                           _("Message body is in a memfd that is not sealed"));
+      return FALSE;
+    }
+
+  if (fstat (fds[handle], &statbuf) != 0 || statbuf.st_size == 0)
+    {
+      g_set_error_literal (error,
+                           G_IO_ERROR,
+                           G_IO_ERROR_INVALID_ARGUMENT,
+                           _("Message body is in an empty memfd"));
+      return FALSE;
+    }
+
+  mapping = g_slice_new (MemfdMapping);
+  mapping->size = statbuf.st_size;
+  mapping->data = mmap (NULL, mapping->size, PROT_READ, MAP_PRIVATE, fds[handle], 0);
+  if (mapping->data == MAP_FAILED)
+    {
+      int errsv = errno;
+      g_slice_free (MemfdMapping, mapping);
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errsv),
+                   _("Error mapping message body: %s"),
+                   g_strerror (errsv));
+      return FALSE;
+    }
+
+  memset (&mbuf, 0, sizeof (mbuf));
+  mbuf.data = mapping->data;
+  mbuf.len = mbuf.valid_len = mapping->size;
+  mbuf.bytes = g_bytes_new_with_free_func (mapping->data, mapping->size, memfd_mapping_free, mapping);
+  if (message->byte_order == G_DBUS_MESSAGE_BYTE_ORDER_BIG_ENDIAN)
+    mbuf.byte_order = G_DATA_STREAM_BYTE_ORDER_BIG_ENDIAN;
+  else
+    mbuf.byte_order = G_DATA_STREAM_BYTE_ORDER_LITTLE_ENDIAN;
+
+  signature_str = g_variant_dup_string (signature, NULL);
+  tupled_signature_str = g_strdup_printf ("(%s)", signature_str);
+  variant_type = g_variant_type_new (tupled_signature_str);
+  g_free (tupled_signature_str);
+  body = parse_value_from_blob (&mbuf, variant_type, FALSE, 2, error);
+  g_variant_type_free (variant_type);
+  g_bytes_unref (mbuf.bytes);
+  if (body == NULL)
+    {
+      g_free (signature_str);
+      return FALSE;
+    }
+
+  g_variant_unref (message->body);
+  message->body = body;
+  g_dbus_message_set_signature (message, signature_str);
+  g_dbus_message_set_header (message, MEMFD_BODY_HEADER_FIELD, NULL);
+  g_free (signature_str);
+
+  fd_list = NULL;
+  if (num_fds > 1)
+    {
+      fd_list = g_unix_fd_list_new ();
+      for (n = 0; n < num_fds; n++)
+        if (n != handle && g_unix_fd_list_append (fd_list, fds[n], error) == -1)
+          {
+            g_object_unref (fd_list);
+            return FALSE;
+          }
+    }
+  g_dbus_message_set_unix_fd_list (message, fd_list);
+  if (fd_list != NULL)
+    g_object_unref (fd_list);
+
+  return TRUE;
+#else
+  g_set_error_literal (error,
+                       G_IO_ERROR,
+                       G_IO_ERROR_NOT_SUPPORTED,
+                       _("Message bodies in a memfd are not supported on this platform"));
+  return FALSE;
+#endif
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 static guint32
 get_uint32_header (GDBusMessage            *message,
                    GDBusMessageHeaderField  header_field)
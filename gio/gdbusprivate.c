@@ -355,6 +355,8 @@ struct GDBusWorker
    */
   gboolean                            frozen;
   GDBusCapabilityFlags                capabilities;
+  /* really a boolean - whether bodies sent in a memfd are loaded */
+  volatile gint                       accept_memfd_bodies;
   GQueue                             *received_messages_while_frozen;
 
   GIOStream                          *stream;
@@ -565,6 +567,16 @@ _g_dbus_worker_unfreeze (GDBusWorker *worker)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* can be called from any thread */
+void
+_g_dbus_worker_set_accept_memfd_bodies (GDBusWorker *worker,
+                                        gboolean     accept)
+{
+  g_atomic_int_set (&worker->accept_memfd_bodies, !!accept);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 static void _g_dbus_worker_do_read_unlocked (GDBusWorker *worker);
 
 /* called in private thread shared by all GDBusConnection instances (without read-lock held) */
@@ -747,18 +759,26 @@ _g_dbus_worker_do_read_cb (GInputStream  *input_stream,
       else
         {
           GDBusMessage *message;
+          GBytes *blob;
           error = NULL;
 
           /* TODO: use connection->priv->auth to decode the message */
 
-          message = g_dbus_message_new_from_blob ((guchar *) worker->read_buffer,
-                                                  worker->read_buffer_cur_size,
-                                                  worker->capabilities,
-                                                  &error);
+          /* Hand the buffer over to the message so that large arrays in
+           * the body can reference it instead of being copied; the next
+           * message is read into a new buffer.
+           */
+          blob = g_bytes_new_take (worker->read_buffer, worker->read_buffer_cur_size);
+          worker->read_buffer = NULL;
+          worker->read_buffer_allocated_size = 0;
+
+          message = _g_dbus_message_new_from_bytes (blob,
+                                                    worker->capabilities,
+                                                    &error);
           if (message == NULL)
             {
               gchar *s;
-              s = _g_dbus_hexdump (worker->read_buffer, worker->read_buffer_cur_size, 2);
+              s = _g_dbus_hexdump (g_bytes_get_data (blob, NULL), worker->read_buffer_cur_size, 2);
               g_warning ("Error decoding D-Bus message of %" G_GSIZE_FORMAT " bytes\n"
                          "The error is: %s\n"
                          "The payload is as follows:\n"
@@ -767,6 +787,7 @@ _g_dbus_worker_do_read_cb (GInputStream  *input_stream,
                          error->message,
                          s);
               g_free (s);
+              g_bytes_unref (blob);
               _g_dbus_worker_emit_disconnected (worker, FALSE, error);
               g_error_free (error);
               goto out;
@@ -781,7 +802,22 @@ _g_dbus_worker_do_read_cb (GInputStream  *input_stream,
             }
 #endif
 
-          if (G_UNLIKELY (_g_dbus_debug_message ()))
+          /* Only the message is broken, not the stream, so drop it
+           * rather than closing the connection on the other peer's behalf.
+           */
+          if (g_atomic_int_get (&worker->accept_memfd_bodies) &&
+              !_g_dbus_message_load_memfd_body (message, &error))
+            {
+              g_warning ("Dropping D-Bus message of %" G_GSIZE_FORMAT " bytes: %s",
+                         worker->read_buffer_cur_size,
+                         error->message);
+              g_error_free (error);
+              error = NULL;
+              g_object_unref (message);
+              message = NULL;
+            }
+
+          if (message != NULL && G_UNLIKELY (_g_dbus_debug_message ()))
             {
               gchar *s;
               _g_dbus_debug_print_lock ();
@@ -794,15 +830,17 @@ _g_dbus_worker_do_read_cb (GInputStream  *input_stream,
               g_free (s);
               if (G_UNLIKELY (_g_dbus_debug_payload ()))
                 {
-                  s = _g_dbus_hexdump (worker->read_buffer, worker->read_buffer_cur_size, 2);
+                  s = _g_dbus_hexdump (g_bytes_get_data (blob, NULL), worker->read_buffer_cur_size, 2);
                   g_print ("%s\n", s);
                   g_free (s);
                 }
               _g_dbus_debug_print_unlock ();
             }
+          g_bytes_unref (blob);
 
           /* yay, got a message, go deliver it */
-          _g_dbus_worker_queue_or_deliver_received_message (worker, message);
+          if (message != NULL)
+            _g_dbus_worker_queue_or_deliver_received_message (worker, message);
 
           /* start reading another message! */
           worker->read_buffer_bytes_wanted = 0;
@@ -838,11 +876,13 @@ _g_dbus_worker_do_read_unlocked (GDBusWorker *worker)
       worker->read_buffer_bytes_wanted = 16;
     }
 
-  /* ensure we have a (big enough) buffer */
+  /* ensure we have a (big enough) buffer; each message gets its own
+   * buffer of exactly the right size, since it is passed on to the
+   * parsed message afterwards
+   */
   if (worker->read_buffer == NULL || worker->read_buffer_bytes_wanted > worker->read_buffer_allocated_size)
     {
-      /* TODO: 4096 is randomly chosen; might want a better chosen default minimum */
-      worker->read_buffer_allocated_size = MAX (worker->read_buffer_bytes_wanted, 4096);
+      worker->read_buffer_allocated_size = worker->read_buffer_bytes_wanted;
       worker->read_buffer = g_realloc (worker->read_buffer, worker->read_buffer_allocated_size);
     }
 
@@ -889,6 +929,7 @@ struct _MessageToWriteData
   GDBusMessage *message;
   gchar        *blob;
   gsize         blob_size;
+  GUnixFDList  *fd_list;      /* sent instead of those of @message, if set */
 
   gsize               total_written;
   GSimpleAsyncResult *simple;
@@ -901,6 +942,8 @@ message_to_write_data_free (MessageToWriteData *data)
   _g_dbus_worker_unref (data->worker);
   if (data->message)
     g_object_unref (data->message);
+  if (data->fd_list)
+    g_object_unref (data->fd_list);
   g_free (data->blob);
   g_free (data);
 }
@@ -999,7 +1042,10 @@ write_message_continue_writing (MessageToWriteData *data)
 
   ostream = g_io_stream_get_output_stream (data->worker->stream);
 #ifdef G_OS_UNIX
-  fd_list = g_dbus_message_get_unix_fd_list (data->message);
+  if (data->fd_list != NULL)
+    fd_list = data->fd_list;
+  else
+    fd_list = g_dbus_message_get_unix_fd_list (data->message);
 #endif
 
   g_assert (!g_output_stream_has_pending (ostream));
@@ -1530,6 +1576,7 @@ continue_writing (GDBusWorker *worker)
               g_free (data->blob);
               data->blob = (gchar *) new_blob;
               data->blob_size = new_blob_size;
+              g_clear_object (&data->fd_list);
             }
         }
 
@@ -1617,7 +1664,8 @@ void
 _g_dbus_worker_send_message (GDBusWorker    *worker,
                              GDBusMessage   *message,
                              gchar          *blob,
-                             gsize           blob_len)
+                             gsize           blob_len,
+                             GUnixFDList    *fd_list)
 {
   MessageToWriteData *data;
 
@@ -1630,6 +1678,8 @@ _g_dbus_worker_send_message (GDBusWorker    *worker,
   data->message = g_object_ref (message);
   data->blob = blob; /* steal! */
   data->blob_size = blob_len;
+  if (fd_list != NULL)
+    data->fd_list = g_object_ref (fd_list);
 
   g_mutex_lock (&worker->write_lock);
   schedule_writing_unlocked (worker, data, NULL, NULL);
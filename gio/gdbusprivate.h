@@ -59,11 +59,13 @@ GDBusWorker *_g_dbus_worker_new          (GIOStream                          *st
                                           GDBusWorkerDisconnectedCallback     disconnected_callback,
                                           gpointer                            user_data);
 
-/* can be called from any thread - steals blob */
+/* can be called from any thread - steals blob; @fd_list, if not %NULL, is
+ * sent instead of the file descriptors of @message */
 void         _g_dbus_worker_send_message (GDBusWorker    *worker,
                                           GDBusMessage   *message,
                                           gchar          *blob,
-                                          gsize           blob_len);
+                                          gsize           blob_len,
+                                          GUnixFDList    *fd_list);
 
 /* can be called from any thread */
 void         _g_dbus_worker_stop         (GDBusWorker    *worker);
@@ -71,6 +73,10 @@ void         _g_dbus_worker_stop         (GDBusWorker    *worker);
 /* can be called from any thread */
 void         _g_dbus_worker_unfreeze     (GDBusWorker    *worker);
 
+/* can be called from any thread */
+void         _g_dbus_worker_set_accept_memfd_bodies (GDBusWorker *worker,
+                                                     gboolean     accept);
+
 /* can be called from any thread (except the worker thread) */
 gboolean     _g_dbus_worker_flush_sync   (GDBusWorker    *worker,
                                           GCancellable   *cancellable,
@@ -144,6 +150,19 @@ void _g_dbus_object_proxy_add_interface (GDBusObjectProxy *proxy,
 void _g_dbus_object_proxy_remove_interface (GDBusObjectProxy *proxy,
                                             const gchar      *interface_name);
 
+/* Implemented in gdbusmessage.c */
+GDBusMessage *_g_dbus_message_new_from_bytes (GBytes                *blob,
+                                              GDBusCapabilityFlags   capabilities,
+                                              GError               **error);
+guchar       *_g_dbus_message_to_blob_with_memfd (GDBusMessage          *message,
+                                                  gsize                  threshold,
+                                                  gsize                 *out_size,
+                                                  GDBusCapabilityFlags   capabilities,
+                                                  GUnixFDList          **out_fd_list,
+                                                  GError               **error);
+gboolean      _g_dbus_message_load_memfd_body    (GDBusMessage          *message,
+                                                  GError               **error);
+
 /* Implemented in gdbusconnection.c */
 GDBusConnection *_g_bus_get_singleton_if_exists (GBusType bus_type);
 
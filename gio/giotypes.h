@@ -425,6 +425,83 @@ struct _GOutputVector {
   gsize size;
 };
 
+/**
+ * GInputMessage:
+ * @address: (allow-none): return location for a #GSocketAddress, or %NULL
+ * @vectors: (array length=num_vectors): pointer to an array of input vectors
+ * @num_vectors: the number of input vectors pointed to by @vectors
+ * @bytes_received: (out): will be set to the number of bytes that have been
+ *   received
+ * @flags: (out): collection of #GSocketMsgFlags for the received message,
+ *   outputted by the call
+ * @control_messages: (array length=num_control_messages) (allow-none):
+ *   return location for a newly-allocated array of
+ *   #GSocketControlMessage<!-- -->s, or %NULL
+ * @num_control_messages: (out) (allow-none): return location for the
+ *   number of elements in @control_messages
+ *
+ * Structure used for scatter/gather data input when receiving multiple
+ * messages or packets in one go. You generally pass in an array of
+ * empty #GInputVector<!-- -->s and the operation will use all the
+ * buffers as if they were one buffer, and will set @bytes_received to
+ * the total number of bytes received across all #GInputVector<!-- -->s.
+ *
+ * The meaning of @address, @control_messages and
+ * @num_control_messages is the same as that of the corresponding
+ * arguments of g_socket_receive_message().
+ *
+ * Since: 2.38
+ */
+typedef struct _GInputMessage GInputMessage;
+
+struct _GInputMessage {
+  GSocketAddress         **address;
+
+  GInputVector            *vectors;
+  guint                    num_vectors;
+
+  gsize                    bytes_received;
+  gint                     flags;
+
+  GSocketControlMessage ***control_messages;
+  guint                   *num_control_messages;
+};
+
+/**
+ * GOutputMessage:
+ * @address: (allow-none): a #GSocketAddress, or %NULL
+ * @vectors: pointer to an array of output vectors
+ * @num_vectors: the number of output vectors pointed to by @vectors.
+ * @bytes_sent: initialize to 0. Will be set to the number of bytes
+ *     that have been sent
+ * @control_messages: (array length=num_control_messages) (allow-none): a pointer
+ *   to an array of #GSocketControlMessages, or %NULL.
+ * @num_control_messages: number of elements in @control_messages.
+ *
+ * Structure used for scatter/gather data output when sending multiple
+ * messages or packets in one go. You generally pass in an array of
+ * #GOutputVector<!-- -->s and the operation will use all the buffers
+ * as if they were one buffer.
+ *
+ * If @address is %NULL then the message is sent to the default receiver
+ * (as previously set by g_socket_connect()).
+ *
+ * Since: 2.38
+ */
+typedef struct _GOutputMessage GOutputMessage;
+
+struct _GOutputMessage {
+  GSocketAddress         *address;
+
+  GOutputVector          *vectors;
+  guint                   num_vectors;
+
+  guint                   bytes_sent;
+
+  GSocketControlMessage **control_messages;
+  guint                   num_control_messages;
+};
+
 typedef struct _GCredentials                  GCredentials;
 typedef struct _GUnixCredentialsMessage       GUnixCredentialsMessage;
 typedef struct _GUnixFDList                   GUnixFDList;
@@ -3684,83 +3684,65 @@ g_socket_condition_timed_wait (GSocket       *socket,
   #endif
 }
 
-/**
- * g_socket_send_message:
- * @socket: a #GSocket
- * @address: (allow-none): a #GSocketAddress, or %NULL
- * @vectors: (array length=num_vectors): an array of #GOutputVector structs
- * @num_vectors: the number of elements in @vectors, or -1
- * @messages: (array length=num_messages) (allow-none): a pointer to an
- *   array of #GSocketControlMessages, or %NULL.
- * @num_messages: number of elements in @messages, or -1.
- * @flags: an int containing #GSocketMsgFlags flags
- * @cancellable: (allow-none): a %GCancellable or %NULL
- * @error: #GError for error reporting, or %NULL to ignore.
- *
- * Send data to @address on @socket.  This is the most complicated and
- * fully-featured version of this call. For easier use, see
- * g_socket_send() and g_socket_send_to().
- *
- * If @address is %NULL then the message is sent to the default receiver
- * (set by g_socket_connect()).
- *
- * @vectors must point to an array of #GOutputVector structs and
- * @num_vectors must be the length of this array. (If @num_vectors is -1,
- * then @vectors is assumed to be terminated by a #GOutputVector with a
- * %NULL buffer pointer.) The #GOutputVector structs describe the buffers
- * that the sent data will be gathered from. Using multiple
- * #GOutputVector<!-- -->s is more memory-efficient than manually copying
- * data from multiple sources into a single buffer, and more
- * network-efficient than making multiple calls to g_socket_send().
- *
- * @messages, if non-%NULL, is taken to point to an array of @num_messages
- * #GSocketControlMessage instances. These correspond to the control
- * messages to be sent on the socket.
- * If @num_messages is -1 then @messages is treated as a %NULL-terminated
- * array.
- *
- * @flags modify how the message is sent. The commonly available arguments
- * for this are available in the #GSocketMsgFlags enum, but the
- * values there are the same as the system values, and the flags
- * are passed in as-is, so you can pass in system-specific flags too.
- *
- * If the socket is in blocking mode the call will block until there is
- * space for the data in the socket queue. If there is no space available
- * and the socket is in non-blocking mode a %G_IO_ERROR_WOULD_BLOCK error
- * will be returned. To be notified when space is available, wait for the
- * %G_IO_OUT condition. Note though that you may still receive
- * %G_IO_ERROR_WOULD_BLOCK from g_socket_send() even if you were previously
- * notified of a %G_IO_OUT condition. (On Windows in particular, this is
- * very common due to the way the underlying APIs work.)
- *
- * On error -1 is returned and @error is set accordingly.
- *
- * Returns: Number of bytes written (which may be less than @size), or -1
- * on error
- *
- * Since: 2.22
+#ifndef G_OS_WIN32
+static gsize
+control_messages_space (GSocketControlMessage **messages,
+                        gint                    num_messages)
+{
+  gsize space = 0;
+  gint i;
+
+  for (i = 0; i < num_messages; i++)
+    space += CMSG_SPACE (g_socket_control_message_get_size (messages[i]));
+
+  return space;
+}
+
+/* Fills msg->msg_control, which must be control_messages_space()
+ * bytes long.
  */
-gssize
-g_socket_send_message (GSocket                *socket,
-		       GSocketAddress         *address,
-		       GOutputVector          *vectors,
-		       gint                    num_vectors,
-		       GSocketControlMessage **messages,
-		       gint                    num_messages,
-		       gint                    flags,
-		       GCancellable           *cancellable,
-		       GError                **error)
+static void
+serialize_control_messages (struct msghdr          *msg,
+                            GSocketControlMessage **messages,
+                            gint                    num_messages)
 {
-  GOutputVector one_vector;
-  char zero;
+  struct cmsghdr *cmsg;
+  gint i;
 
-  g_return_val_if_fail (G_IS_SOCKET (socket), -1);
+  if (msg->msg_controllen != 0)
+    memset (msg->msg_control, '\0', msg->msg_controllen);
 
-  if (!check_socket (socket, error))
-    return -1;
+  cmsg = CMSG_FIRSTHDR (msg);
+  for (i = 0; i < num_messages; i++)
+    {
+      cmsg->cmsg_level = g_socket_control_message_get_level (messages[i]);
+      cmsg->cmsg_type = g_socket_control_message_get_msg_type (messages[i]);
+      cmsg->cmsg_len = CMSG_LEN (g_socket_control_message_get_size (messages[i]));
+      g_socket_control_message_serialize (messages[i],
+                                          CMSG_DATA (cmsg));
+      cmsg = CMSG_NXTHDR (msg, cmsg);
+    }
+  g_assert (cmsg == NULL);
+}
+#endif
 
-  if (g_cancellable_set_error_if_cancelled (cancellable, error))
-    return -1;
+/* Does the work of g_socket_send_message(), once the socket and the
+ * cancellable have been checked.
+ */
+static gssize
+send_message_with_blocking (GSocket                *socket,
+                            GSocketAddress         *address,
+                            GOutputVector          *vectors,
+                            gint                    num_vectors,
+                            GSocketControlMessage **messages,
+                            gint                    num_messages,
+                            gint                    flags,
+                            gboolean                blocking,
+                            GCancellable           *cancellable,
+                            GError                **error)
+{
+  GOutputVector one_vector;
+  char zero;
 
   if (num_vectors == -1)
     {
@@ -3840,38 +3822,16 @@ g_socket_send_message (GSocket                *socket,
     }
 
     /* control */
-    {
-      struct cmsghdr *cmsg;
-      gint i;
-
-      msg.msg_controllen = 0;
-      for (i = 0; i < num_messages; i++)
-	msg.msg_controllen += CMSG_SPACE (g_socket_control_message_get_size (messages[i]));
-
-      if (msg.msg_controllen == 0)
-        msg.msg_control = NULL;
-      else
-        {
-          msg.msg_control = g_alloca (msg.msg_controllen);
-          memset (msg.msg_control, '\0', msg.msg_controllen);
-        }
-
-      cmsg = CMSG_FIRSTHDR (&msg);
-      for (i = 0; i < num_messages; i++)
-	{
-	  cmsg->cmsg_level = g_socket_control_message_get_level (messages[i]);
-	  cmsg->cmsg_type = g_socket_control_message_get_msg_type (messages[i]);
-	  cmsg->cmsg_len = CMSG_LEN (g_socket_control_message_get_size (messages[i]));
-	  g_socket_control_message_serialize (messages[i],
-					      CMSG_DATA (cmsg));
-	  cmsg = CMSG_NXTHDR (&msg, cmsg);
-	}
-      g_assert (cmsg == NULL);
-    }
+    msg.msg_controllen = control_messages_space (messages, num_messages);
+    if (msg.msg_controllen == 0)
+      msg.msg_control = NULL;
+    else
+      msg.msg_control = g_alloca (msg.msg_controllen);
+    serialize_control_messages (&msg, messages, num_messages);
 
     while (1)
       {
-	if (socket->priv->blocking &&
+	if (blocking &&
 	    !g_socket_condition_wait (socket,
 				      G_IO_OUT, cancellable, error))
 	  return -1;
@@ -3884,7 +3844,7 @@ g_socket_send_message (GSocket                *socket,
 	    if (errsv == EINTR)
 	      continue;
 
-	    if (socket->priv->blocking &&
+	    if (blocking &&
 		(errsv == EWOULDBLOCK ||
 		 errsv == EAGAIN))
 	      continue;
@@ -3939,7 +3899,7 @@ g_socket_send_message (GSocket                *socket,
 
     while (1)
       {
-	if (socket->priv->blocking &&
+	if (blocking &&
 	    !g_socket_condition_wait (socket,
 				      G_IO_OUT, cancellable, error))
 	  return -1;
@@ -3966,7 +3926,7 @@ g_socket_send_message (GSocket                *socket,
 	    if (errsv == WSAEWOULDBLOCK)
 	      win32_unset_event_mask (socket, FD_WRITE);
 
-	    if (socket->priv->blocking &&
+	    if (blocking &&
 		errsv == WSAEWOULDBLOCK)
 	      continue;
 
@@ -3984,6 +3944,88 @@ g_socket_send_message (GSocket                *socket,
 #endif
 }
 
+/**
+ * g_socket_send_message:
+ * @socket: a #GSocket
+ * @address: (allow-none): a #GSocketAddress, or %NULL
+ * @vectors: (array length=num_vectors): an array of #GOutputVector structs
+ * @num_vectors: the number of elements in @vectors, or -1
+ * @messages: (array length=num_messages) (allow-none): a pointer to an
+ *   array of #GSocketControlMessages, or %NULL.
+ * @num_messages: number of elements in @messages, or -1.
+ * @flags: an int containing #GSocketMsgFlags flags
+ * @cancellable: (allow-none): a %GCancellable or %NULL
+ * @error: #GError for error reporting, or %NULL to ignore.
+ *
+ * Send data to @address on @socket.  This is the most complicated and
+ * fully-featured version of this call. For easier use, see
+ * g_socket_send() and g_socket_send_to().
+ *
+ * If @address is %NULL then the message is sent to the default receiver
+ * (set by g_socket_connect()).
+ *
+ * @vectors must point to an array of #GOutputVector structs and
+ * @num_vectors must be the length of this array. (If @num_vectors is -1,
+ * then @vectors is assumed to be terminated by a #GOutputVector with a
+ * %NULL buffer pointer.) The #GOutputVector structs describe the buffers
+ * that the sent data will be gathered from. Using multiple
+ * #GOutputVector<!-- -->s is more memory-efficient than manually copying
+ * data from multiple sources into a single buffer, and more
+ * network-efficient than making multiple calls to g_socket_send().
+ *
+ * @messages, if non-%NULL, is taken to point to an array of @num_messages
+ * #GSocketControlMessage instances. These correspond to the control
+ * messages to be sent on the socket.
+ * If @num_messages is -1 then @messages is treated as a %NULL-terminated
+ * array.
+ *
+ * @flags modify how the message is sent. The commonly available arguments
+ * for this are available in the #GSocketMsgFlags enum, but the
+ * values there are the same as the system values, and the flags
+ * are passed in as-is, so you can pass in system-specific flags too.
+ *
+ * If the socket is in blocking mode the call will block until there is
+ * space for the data in the socket queue. If there is no space available
+ * and the socket is in non-blocking mode a %G_IO_ERROR_WOULD_BLOCK error
+ * will be returned. To be notified when space is available, wait for the
+ * %G_IO_OUT condition. Note though that you may still receive
+ * %G_IO_ERROR_WOULD_BLOCK from g_socket_send() even if you were previously
+ * notified of a %G_IO_OUT condition. (On Windows in particular, this is
+ * very common due to the way the underlying APIs work.)
+ *
+ * On error -1 is returned and @error is set accordingly.
+ *
+ * Returns: Number of bytes written (which may be less than @size), or -1
+ * on error
+ *
+ * Since: 2.22
+ */
+gssize
+g_socket_send_message (GSocket                *socket,
+		       GSocketAddress         *address,
+		       GOutputVector          *vectors,
+		       gint                    num_vectors,
+		       GSocketControlMessage **messages,
+		       gint                    num_messages,
+		       gint                    flags,
+		       GCancellable           *cancellable,
+		       GError                **error)
+{
+  g_return_val_if_fail (G_IS_SOCKET (socket), -1);
+
+  if (!check_socket (socket, error))
+    return -1;
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return -1;
+
+  return send_message_with_blocking (socket, address,
+                                     vectors, num_vectors,
+                                     messages, num_messages,
+                                     flags, socket->priv->blocking,
+                                     cancellable, error);
+}
+
 static GSocketAddress *
 cache_recv_address (GSocket *socket, struct sockaddr *native, int native_len)
 {
@@ -4038,105 +4080,89 @@ cache_recv_address (GSocket *socket, struct sockaddr *native, int native_len)
   return saddr;
 }
 
-/**
- * g_socket_receive_message:
- * @socket: a #GSocket
- * @address: (out) (allow-none): a pointer to a #GSocketAddress
- *     pointer, or %NULL
- * @vectors: (array length=num_vectors): an array of #GInputVector structs
- * @num_vectors: the number of elements in @vectors, or -1
- * @messages: (array length=num_messages) (allow-none): a pointer which
- *    may be filled with an array of #GSocketControlMessages, or %NULL
- * @num_messages: a pointer which will be filled with the number of
- *    elements in @messages, or %NULL
- * @flags: a pointer to an int containing #GSocketMsgFlags flags
- * @cancellable: (allow-none): a %GCancellable or %NULL
- * @error: a #GError pointer, or %NULL
- *
- * Receive data from a socket.  This is the most complicated and
- * fully-featured version of this call. For easier use, see
- * g_socket_receive() and g_socket_receive_from().
- *
- * If @address is non-%NULL then @address will be set equal to the
- * source address of the received packet.
- * @address is owned by the caller.
- *
- * @vector must point to an array of #GInputVector structs and
- * @num_vectors must be the length of this array.  These structs
- * describe the buffers that received data will be scattered into.
- * If @num_vectors is -1, then @vectors is assumed to be terminated
- * by a #GInputVector with a %NULL buffer pointer.
- *
- * As a special case, if @num_vectors is 0 (in which case, @vectors
- * may of course be %NULL), then a single byte is received and
- * discarded. This is to facilitate the common practice of sending a
- * single '\0' byte for the purposes of transferring ancillary data.
- *
- * @messages, if non-%NULL, will be set to point to a newly-allocated
- * array of #GSocketControlMessage instances or %NULL if no such
- * messages was received. These correspond to the control messages
- * received from the kernel, one #GSocketControlMessage per message
- * from the kernel. This array is %NULL-terminated and must be freed
- * by the caller using g_free() after calling g_object_unref() on each
- * element. If @messages is %NULL, any control messages received will
- * be discarded.
- *
- * @num_messages, if non-%NULL, will be set to the number of control
- * messages received.
- *
- * If both @messages and @num_messages are non-%NULL, then
- * @num_messages gives the number of #GSocketControlMessage instances
- * in @messages (ie: not including the %NULL terminator).
- *
- * @flags is an in/out parameter. The commonly available arguments
- * for this are available in the #GSocketMsgFlags enum, but the
- * values there are the same as the system values, and the flags
- * are passed in as-is, so you can pass in system-specific flags too
- * (and g_socket_receive_message() may pass system-specific flags out).
- *
- * As with g_socket_receive(), data may be discarded if @socket is
- * %G_SOCKET_TYPE_DATAGRAM or %G_SOCKET_TYPE_SEQPACKET and you do not
- * provide enough buffer space to read a complete message. You can pass
- * %G_SOCKET_MSG_PEEK in @flags to peek at the current message without
- * removing it from the receive queue, but there is no portable way to find
- * out the length of the message other than by reading it into a
- * sufficiently-large buffer.
- *
- * If the socket is in blocking mode the call will block until there
- * is some data to receive, the connection is closed, or there is an
- * error. If there is no data available and the socket is in
- * non-blocking mode, a %G_IO_ERROR_WOULD_BLOCK error will be
- * returned. To be notified when data is available, wait for the
- * %G_IO_IN condition.
- *
- * On error -1 is returned and @error is set accordingly.
- *
- * Returns: Number of bytes read, or 0 if the connection was closed by
- * the peer, or -1 on error
- *
- * Since: 2.22
+#ifndef G_OS_WIN32
+/* Turns the control data of a received message into
+ * #GSocketControlMessage<!-- -->s, as described for
+ * g_socket_receive_message().
  */
-gssize
-g_socket_receive_message (GSocket                 *socket,
-			  GSocketAddress         **address,
-			  GInputVector            *vectors,
-			  gint                     num_vectors,
-			  GSocketControlMessage ***messages,
-			  gint                    *num_messages,
-			  gint                    *flags,
-			  GCancellable            *cancellable,
-			  GError                 **error)
+static void
+decode_control_messages (struct msghdr           *msg,
+                         GSocketControlMessage ***messages,
+                         gint                    *num_messages)
 {
-  GInputVector one_vector;
-  char one_byte;
+  GPtrArray *my_messages = NULL;
+  struct cmsghdr *cmsg;
 
-  g_return_val_if_fail (G_IS_SOCKET (socket), -1);
+  if (msg->msg_controllen >= sizeof (struct cmsghdr))
+    {
+      for (cmsg = CMSG_FIRSTHDR (msg); cmsg; cmsg = CMSG_NXTHDR (msg, cmsg))
+        {
+          GSocketControlMessage *message;
+
+          message = g_socket_control_message_deserialize (cmsg->cmsg_level,
+                                                          cmsg->cmsg_type,
+                                                          cmsg->cmsg_len - ((char *)CMSG_DATA (cmsg) - (char *)cmsg),
+                                                          CMSG_DATA (cmsg));
+          if (message == NULL)
+            /* We've already spewed about the problem in the
+               deserialization code, so just continue */
+            continue;
+
+          if (messages == NULL)
+            {
+              /* we have to do it this way if the user ignores the
+               * messages so that we will close any received fds.
+               */
+              g_object_unref (message);
+            }
+          else
+            {
+              if (my_messages == NULL)
+                my_messages = g_ptr_array_new ();
+              g_ptr_array_add (my_messages, message);
+            }
+        }
+    }
 
-  if (!check_socket (socket, error))
-    return -1;
+  if (num_messages)
+    *num_messages = my_messages != NULL ? my_messages->len : 0;
 
-  if (g_cancellable_set_error_if_cancelled (cancellable, error))
-    return -1;
+  if (messages)
+    {
+      if (my_messages == NULL)
+        {
+          *messages = NULL;
+        }
+      else
+        {
+          g_ptr_array_add (my_messages, NULL);
+          *messages = (GSocketControlMessage **) g_ptr_array_free (my_messages, FALSE);
+        }
+    }
+  else
+    {
+      g_assert (my_messages == NULL);
+    }
+}
+#endif
+
+/* Does the work of g_socket_receive_message(), once the socket and
+ * the cancellable have been checked.
+ */
+static gssize
+receive_message_with_blocking (GSocket                 *socket,
+                               GSocketAddress         **address,
+                               GInputVector            *vectors,
+                               gint                     num_vectors,
+                               GSocketControlMessage ***messages,
+                               gint                    *num_messages,
+                               gint                    *flags,
+                               gboolean                 blocking,
+                               GCancellable            *cancellable,
+                               GError                 **error)
+{
+  GInputVector one_vector;
+  char one_byte;
 
   if (num_vectors == -1)
     {
@@ -4221,7 +4247,7 @@ g_socket_receive_message (GSocket                 *socket,
     /* do it */
     while (1)
       {
-	if (socket->priv->blocking &&
+	if (blocking &&
 	    !g_socket_condition_wait (socket,
 				      G_IO_IN, cancellable, error))
 	  return -1;
@@ -4243,7 +4269,7 @@ g_socket_receive_message (GSocket                 *socket,
 	    if (errsv == EINTR)
 	      continue;
 
-	    if (socket->priv->blocking &&
+	    if (blocking &&
 		(errsv == EWOULDBLOCK ||
 		 errsv == EAGAIN))
 	      continue;
@@ -4264,61 +4290,7 @@ g_socket_receive_message (GSocket                 *socket,
       }
 
     /* decode control messages */
-    {
-      GPtrArray *my_messages = NULL;
-      struct cmsghdr *cmsg;
-
-      if (msg.msg_controllen >= sizeof (struct cmsghdr))
-        {
-          for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg))
-            {
-              GSocketControlMessage *message;
-
-              message = g_socket_control_message_deserialize (cmsg->cmsg_level,
-                                                              cmsg->cmsg_type,
-                                                              cmsg->cmsg_len - ((char *)CMSG_DATA (cmsg) - (char *)cmsg),
-                                                              CMSG_DATA (cmsg));
-              if (message == NULL)
-                /* We've already spewed about the problem in the
-                   deserialization code, so just continue */
-                continue;
-
-              if (messages == NULL)
-                {
-                  /* we have to do it this way if the user ignores the
-                   * messages so that we will close any received fds.
-                   */
-                  g_object_unref (message);
-                }
-              else
-                {
-                  if (my_messages == NULL)
-                    my_messages = g_ptr_array_new ();
-                  g_ptr_array_add (my_messages, message);
-                }
-            }
-        }
-
-      if (num_messages)
-	*num_messages = my_messages != NULL ? my_messages->len : 0;
-
-      if (messages)
-	{
-	  if (my_messages == NULL)
-	    {
-	      *messages = NULL;
-	    }
-	  else
-	    {
-	      g_ptr_array_add (my_messages, NULL);
-	      *messages = (GSocketControlMessage **) g_ptr_array_free (my_messages, FALSE);
-	    }
-	}
-      else
-	{
-	  g_assert (my_messages == NULL);
-	}
-    }
+    decode_control_messages (&msg, messages, num_messages);
 
     /* capture the flags */
     if (flags != NULL)
@@ -4353,7 +4325,7 @@ g_socket_receive_message (GSocket                 *socket,
     /* do it */
     while (1)
       {
-	if (socket->priv->blocking &&
+	if (blocking &&
 	    !g_socket_condition_wait (socket,
 				      G_IO_IN, cancellable, error))
 	  return -1;
@@ -4379,7 +4351,7 @@ g_socket_receive_message (GSocket                 *socket,
 
 	    win32_unset_event_mask (socket, FD_READ);
 
-	    if (socket->priv->blocking &&
+	    if (blocking &&
 		errsv == WSAEWOULDBLOCK)
 	      continue;
 
@@ -4413,6 +4385,584 @@ g_socket_receive_message (GSocket                 *socket,
 #endif
 }
 
+/**
+ * g_socket_receive_message:
+ * @socket: a #GSocket
+ * @address: (out) (allow-none): a pointer to a #GSocketAddress
+ *     pointer, or %NULL
+ * @vectors: (array length=num_vectors): an array of #GInputVector structs
+ * @num_vectors: the number of elements in @vectors, or -1
+ * @messages: (array length=num_messages) (allow-none): a pointer which
+ *    may be filled with an array of #GSocketControlMessages, or %NULL
+ * @num_messages: a pointer which will be filled with the number of
+ *    elements in @messages, or %NULL
+ * @flags: a pointer to an int containing #GSocketMsgFlags flags
+ * @cancellable: (allow-none): a %GCancellable or %NULL
+ * @error: a #GError pointer, or %NULL
+ *
+ * Receive data from a socket.  This is the most complicated and
+ * fully-featured version of this call. For easier use, see
+ * g_socket_receive() and g_socket_receive_from().
+ *
+ * If @address is non-%NULL then @address will be set equal to the
+ * source address of the received packet.
+ * @address is owned by the caller.
+ *
+ * @vector must point to an array of #GInputVector structs and
+ * @num_vectors must be the length of this array.  These structs
+ * describe the buffers that received data will be scattered into.
+ * If @num_vectors is -1, then @vectors is assumed to be terminated
+ * by a #GInputVector with a %NULL buffer pointer.
+ *
+ * As a special case, if @num_vectors is 0 (in which case, @vectors
+ * may of course be %NULL), then a single byte is received and
+ * discarded. This is to facilitate the common practice of sending a
+ * single '\0' byte for the purposes of transferring ancillary data.
+ *
+ * @messages, if non-%NULL, will be set to point to a newly-allocated
+ * array of #GSocketControlMessage instances or %NULL if no such
+ * messages was received. These correspond to the control messages
+ * received from the kernel, one #GSocketControlMessage per message
+ * from the kernel. This array is %NULL-terminated and must be freed
+ * by the caller using g_free() after calling g_object_unref() on each
+ * element. If @messages is %NULL, any control messages received will
+ * be discarded.
+ *
+ * @num_messages, if non-%NULL, will be set to the number of control
+ * messages received.
+ *
+ * If both @messages and @num_messages are non-%NULL, then
+ * @num_messages gives the number of #GSocketControlMessage instances
+ * in @messages (ie: not including the %NULL terminator).
+ *
+ * @flags is an in/out parameter. The commonly available arguments
+ * for this are available in the #GSocketMsgFlags enum, but the
+ * values there are the same as the system values, and the flags
+ * are passed in as-is, so you can pass in system-specific flags too
+ * (and g_socket_receive_message() may pass system-specific flags out).
+ *
+ * As with g_socket_receive(), data may be discarded if @socket is
+ * %G_SOCKET_TYPE_DATAGRAM or %G_SOCKET_TYPE_SEQPACKET and you do not
+ * provide enough buffer space to read a complete message. You can pass
+ * %G_SOCKET_MSG_PEEK in @flags to peek at the current message without
+ * removing it from the receive queue, but there is no portable way to find
+ * out the length of the message other than by reading it into a
+ * sufficiently-large buffer.
+ *
+ * If the socket is in blocking mode the call will block until there
+ * is some data to receive, the connection is closed, or there is an
+ * error. If there is no data available and the socket is in
+ * non-blocking mode, a %G_IO_ERROR_WOULD_BLOCK error will be
+ * returned. To be notified when data is available, wait for the
+ * %G_IO_IN condition.
+ *
+ * On error -1 is returned and @error is set accordingly.
+ *
+ * Returns: Number of bytes read, or 0 if the connection was closed by
+ * the peer, or -1 on error
+ *
+ * Since: 2.22
+ */
+gssize
+g_socket_receive_message (GSocket                 *socket,
+			  GSocketAddress         **address,
+			  GInputVector            *vectors,
+			  gint                     num_vectors,
+			  GSocketControlMessage ***messages,
+			  gint                    *num_messages,
+			  gint                    *flags,
+			  GCancellable            *cancellable,
+			  GError                 **error)
+{
+  g_return_val_if_fail (G_IS_SOCKET (socket), -1);
+
+  if (!check_socket (socket, error))
+    return -1;
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return -1;
+
+  return receive_message_with_blocking (socket, address,
+                                        vectors, num_vectors,
+                                        messages, num_messages,
+                                        flags, socket->priv->blocking,
+                                        cancellable, error);
+}
+
+/* The kernel handles at most UIO_MAXIOV (1024) messages per call */
+#define MAX_MESSAGES_PER_CALL 1024
+
+#if !defined (G_OS_WIN32) && defined (HAVE_SENDMMSG)
+/* Fills @msg from @message.  Anything that had to be allocated is
+ * released again by output_message_clear().
+ */
+static gboolean
+output_message_to_msghdr (GOutputMessage  *message,
+                          struct msghdr   *msg,
+                          GError         **error)
+{
+  memset (msg, 0, sizeof *msg);
+
+  /* name */
+  if (message->address)
+    {
+      msg->msg_namelen = g_socket_address_get_native_size (message->address);
+      msg->msg_name = g_malloc (msg->msg_namelen);
+      if (!g_socket_address_to_native (message->address, msg->msg_name, msg->msg_namelen, error))
+        return FALSE;
+    }
+
+  /* iov */
+  if (sizeof *msg->msg_iov == sizeof *message->vectors &&
+      sizeof msg->msg_iov->iov_base == sizeof message->vectors->buffer &&
+      G_STRUCT_OFFSET (struct iovec, iov_base) ==
+      G_STRUCT_OFFSET (GOutputVector, buffer) &&
+      sizeof msg->msg_iov->iov_len == sizeof message->vectors->size &&
+      G_STRUCT_OFFSET (struct iovec, iov_len) ==
+      G_STRUCT_OFFSET (GOutputVector, size))
+    /* ABI is compatible */
+    {
+      msg->msg_iov = (struct iovec *) message->vectors;
+    }
+  else
+    /* ABI is incompatible */
+    {
+      guint i;
+
+      msg->msg_iov = g_new (struct iovec, message->num_vectors);
+      for (i = 0; i < message->num_vectors; i++)
+        {
+          msg->msg_iov[i].iov_base = (void *) message->vectors[i].buffer;
+          msg->msg_iov[i].iov_len = message->vectors[i].size;
+        }
+    }
+  msg->msg_iovlen = message->num_vectors;
+
+  /* control */
+  msg->msg_controllen = control_messages_space (message->control_messages,
+                                                message->num_control_messages);
+  if (msg->msg_controllen != 0)
+    {
+      msg->msg_control = g_malloc (msg->msg_controllen);
+      serialize_control_messages (msg, message->control_messages,
+                                  message->num_control_messages);
+    }
+
+  return TRUE;
+}
+
+static void
+output_message_clear (GOutputMessage *message,
+                      struct msghdr  *msg)
+{
+  g_free (msg->msg_name);
+  if ((gpointer) msg->msg_iov != (gpointer) message->vectors)
+    g_free (msg->msg_iov);
+  g_free (msg->msg_control);
+}
+#endif
+
+/**
+ * g_socket_send_messages:
+ * @socket: a #GSocket
+ * @messages: (array length=num_messages): an array of #GOutputMessage structs
+ * @num_messages: the number of elements in @messages
+ * @flags: an int containing #GSocketMsgFlags flags
+ * @cancellable: (allow-none): a %GCancellable or %NULL
+ * @error: #GError for error reporting, or %NULL to ignore.
+ *
+ * Send multiple data messages from @socket in one go.  This is the most
+ * complicated and fully-featured version of this call. For easier use, see
+ * g_socket_send(), g_socket_send_to(), and g_socket_send_message().
+ *
+ * Each #GOutputMessage describes one message in the same way as the
+ * arguments of g_socket_send_message(): an optional destination address,
+ * an array of #GOutputVector<!-- -->s holding the data and an optional
+ * array of #GSocketControlMessage<!-- -->s.  On return, the
+ * @bytes_sent member of each message that was sent is set to the
+ * number of bytes that were written for it.
+ *
+ * @flags modify how all messages are sent, see g_socket_send_message().
+ *
+ * On Linux this uses sendmmsg(), so many datagrams cost a single
+ * system call.  Elsewhere the messages are sent one after the other.
+ *
+ * If the socket is in blocking mode the call will block until at least
+ * one message can be sent; the remaining messages are only sent if that
+ * can be done without blocking.  If no message can be sent and the
+ * socket is in non-blocking mode a %G_IO_ERROR_WOULD_BLOCK error will be
+ * returned.  An error other than that is only reported if it happens
+ * for the first message; otherwise the messages sent up to that point
+ * are counted and the error will be seen by the next call.
+ *
+ * On error -1 is returned and @error is set accordingly.
+ *
+ * Returns: the number of messages sent, which may be less than
+ *     @num_messages, or -1 on error
+ *
+ * Since: 2.38
+ */
+gint
+g_socket_send_messages (GSocket        *socket,
+                        GOutputMessage *messages,
+                        guint           num_messages,
+                        gint            flags,
+                        GCancellable   *cancellable,
+                        GError        **error)
+{
+  guint i;
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), -1);
+  g_return_val_if_fail (num_messages == 0 || messages != NULL, -1);
+
+  if (!check_socket (socket, error))
+    return -1;
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return -1;
+
+  if (num_messages == 0)
+    return 0;
+
+  num_messages = MIN (num_messages, MAX_MESSAGES_PER_CALL);
+
+#if !defined (G_OS_WIN32) && defined (HAVE_SENDMMSG)
+  {
+    struct mmsghdr *msgvec;
+    gint result = -1;
+
+    msgvec = g_new (struct mmsghdr, num_messages);
+
+    for (i = 0; i < num_messages; i++)
+      {
+        msgvec[i].msg_len = 0;
+        if (!output_message_to_msghdr (&messages[i], &msgvec[i].msg_hdr, error))
+          {
+            num_messages = i + 1;
+            goto out;
+          }
+      }
+
+    while (1)
+      {
+        if (socket->priv->blocking &&
+            !g_socket_condition_wait (socket,
+                                      G_IO_OUT, cancellable, error))
+          goto out;
+
+        result = sendmmsg (socket->priv->fd, msgvec, num_messages,
+                           flags | G_SOCKET_DEFAULT_SEND_FLAGS);
+        if (result < 0)
+          {
+            int errsv = get_socket_errno ();
+
+            if (errsv == EINTR)
+              continue;
+
+            if (socket->priv->blocking &&
+                (errsv == EWOULDBLOCK ||
+                 errsv == EAGAIN))
+              continue;
+
+            g_set_error (error, G_IO_ERROR,
+                         socket_io_error_from_errno (errsv),
+                         _("Error sending message: %s"), socket_strerror (errsv));
+          }
+        break;
+      }
+
+    for (i = 0; i < (guint) MAX (result, 0); i++)
+      messages[i].bytes_sent = msgvec[i].msg_len;
+
+  out:
+    for (i = 0; i < num_messages; i++)
+      output_message_clear (&messages[i], &msgvec[i].msg_hdr);
+    g_free (msgvec);
+
+    return result;
+  }
+#else
+  for (i = 0; i < num_messages; i++)
+    {
+      GOutputMessage *message = &messages[i];
+      GError *msg_error = NULL;
+      gssize result;
+
+      /* only the first message may block */
+      result = send_message_with_blocking (socket, message->address,
+                                           message->vectors, message->num_vectors,
+                                           message->control_messages,
+                                           message->num_control_messages,
+                                           flags, i == 0 && socket->priv->blocking,
+                                           cancellable, &msg_error);
+      if (result < 0)
+        {
+          if (i == 0)
+            {
+              g_propagate_error (error, msg_error);
+              return -1;
+            }
+
+          g_error_free (msg_error);
+          break;
+        }
+
+      message->bytes_sent = result;
+    }
+
+  return i;
+#endif
+}
+
+#if !defined (G_OS_WIN32) && defined (HAVE_RECVMMSG)
+static void
+input_message_to_msghdr (GInputMessage *message,
+                         struct msghdr *msg)
+{
+  memset (msg, 0, sizeof *msg);
+
+  /* name */
+  if (message->address)
+    {
+      msg->msg_namelen = sizeof (struct sockaddr_storage);
+      msg->msg_name = g_malloc (msg->msg_namelen);
+    }
+
+  /* iov */
+  if (sizeof *msg->msg_iov == sizeof *message->vectors &&
+      sizeof msg->msg_iov->iov_base == sizeof message->vectors->buffer &&
+      G_STRUCT_OFFSET (struct iovec, iov_base) ==
+      G_STRUCT_OFFSET (GInputVector, buffer) &&
+      sizeof msg->msg_iov->iov_len == sizeof message->vectors->size &&
+      G_STRUCT_OFFSET (struct iovec, iov_len) ==
+      G_STRUCT_OFFSET (GInputVector, size))
+    /* ABI is compatible */
+    {
+      msg->msg_iov = (struct iovec *) message->vectors;
+    }
+  else
+    /* ABI is incompatible */
+    {
+      guint i;
+
+      msg->msg_iov = g_new (struct iovec, message->num_vectors);
+      for (i = 0; i < message->num_vectors; i++)
+        {
+          msg->msg_iov[i].iov_base = message->vectors[i].buffer;
+          msg->msg_iov[i].iov_len = message->vectors[i].size;
+        }
+    }
+  msg->msg_iovlen = message->num_vectors;
+
+  /* control; when the caller does not want control messages, the
+   * kernel discards them, closing any file descriptors they carry
+   */
+  if (message->control_messages)
+    {
+      msg->msg_controllen = 2048;
+      msg->msg_control = g_malloc (msg->msg_controllen);
+    }
+}
+
+static void
+input_message_clear (GInputMessage *message,
+                     struct msghdr *msg)
+{
+  g_free (msg->msg_name);
+  if ((gpointer) msg->msg_iov != (gpointer) message->vectors)
+    g_free (msg->msg_iov);
+  g_free (msg->msg_control);
+}
+#endif
+
+/**
+ * g_socket_receive_messages:
+ * @socket: a #GSocket
+ * @messages: (array length=num_messages): an array of #GInputMessage structs
+ * @num_messages: the number of elements in @messages
+ * @flags: an int containing #GSocketMsgFlags flags for the overall operation
+ * @cancellable: (allow-none): a %GCancellable or %NULL
+ * @error: #GError for error reporting, or %NULL to ignore
+ *
+ * Receive multiple data messages from @socket in one go.  This is the most
+ * complicated and fully-featured version of this call. For easier use, see
+ * g_socket_receive(), g_socket_receive_from(), and g_socket_receive_message().
+ *
+ * Each #GInputMessage describes where one message is received, in the
+ * same way as the arguments of g_socket_receive_message().  The
+ * @vectors of a message must not be empty.  For each message that was
+ * received, @bytes_received is set to the size of the message,
+ * @flags to the flags that came with it, and @address,
+ * @control_messages and @num_control_messages are filled in if they
+ * are non-%NULL.  If @control_messages is %NULL, any control messages
+ * are discarded.
+ *
+ * @flags modify how all messages are received, see
+ * g_socket_receive_message().  Per-message flags are ignored on input.
+ *
+ * On Linux this uses recvmmsg(), so many datagrams cost a single
+ * system call.  Elsewhere the messages are received one after the
+ * other.
+ *
+ * If the socket is in blocking mode the call will block until at
+ * least one message is available; it then returns as many messages
+ * as are queued, up to @num_messages.  If no message is available and
+ * the socket is in non-blocking mode, a %G_IO_ERROR_WOULD_BLOCK error
+ * is returned.
+ *
+ * On error -1 is returned and @error is set accordingly.
+ *
+ * Returns: the number of messages received, which may be less than
+ *     @num_messages, or -1 on error
+ *
+ * Since: 2.38
+ */
+gint
+g_socket_receive_messages (GSocket        *socket,
+                           GInputMessage  *messages,
+                           guint           num_messages,
+                           gint            flags,
+                           GCancellable   *cancellable,
+                           GError        **error)
+{
+  guint i;
+
+  g_return_val_if_fail (G_IS_SOCKET (socket), -1);
+  g_return_val_if_fail (num_messages == 0 || messages != NULL, -1);
+
+  if (!check_socket (socket, error))
+    return -1;
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return -1;
+
+  if (num_messages == 0)
+    return 0;
+
+  num_messages = MIN (num_messages, MAX_MESSAGES_PER_CALL);
+
+#if !defined (G_OS_WIN32) && defined (HAVE_RECVMMSG)
+  {
+    struct mmsghdr *msgvec;
+    gint result;
+
+    msgvec = g_new (struct mmsghdr, num_messages);
+
+    for (i = 0; i < num_messages; i++)
+      {
+        input_message_to_msghdr (&messages[i], &msgvec[i].msg_hdr);
+        msgvec[i].msg_len = 0;
+      }
+
+    /* We always set the close-on-exec flag so we don't leak file
+     * descriptors into child processes, as g_socket_receive_message()
+     * does.
+     */
+#ifdef MSG_CMSG_CLOEXEC
+    flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+    while (1)
+      {
+        if (socket->priv->blocking &&
+            !g_socket_condition_wait (socket,
+                                      G_IO_IN, cancellable, error))
+          {
+            result = -1;
+            break;
+          }
+
+        result = recvmmsg (socket->priv->fd, msgvec, num_messages, flags, NULL);
+#ifdef MSG_CMSG_CLOEXEC
+        if (result < 0 && get_socket_errno () == EINVAL)
+          {
+            /* We must be running on an old kernel.  Call without the flag. */
+            flags &= ~(MSG_CMSG_CLOEXEC);
+            result = recvmmsg (socket->priv->fd, msgvec, num_messages, flags, NULL);
+          }
+#endif
+
+        if (result < 0)
+          {
+            int errsv = get_socket_errno ();
+
+            if (errsv == EINTR)
+              continue;
+
+            if (socket->priv->blocking &&
+                (errsv == EWOULDBLOCK ||
+                 errsv == EAGAIN))
+              continue;
+
+            g_set_error (error, G_IO_ERROR,
+                         socket_io_error_from_errno (errsv),
+                         _("Error receiving message: %s"), socket_strerror (errsv));
+          }
+        break;
+      }
+
+    for (i = 0; i < (guint) MAX (result, 0); i++)
+      {
+        GInputMessage *message = &messages[i];
+        struct msghdr *msg = &msgvec[i].msg_hdr;
+        gint num_control_messages;
+
+        message->bytes_received = msgvec[i].msg_len;
+        message->flags = msg->msg_flags;
+
+        if (message->address != NULL)
+          *message->address = cache_recv_address (socket, msg->msg_name, msg->msg_namelen);
+
+        decode_control_messages (msg, message->control_messages, &num_control_messages);
+        if (message->num_control_messages != NULL)
+          *message->num_control_messages = num_control_messages;
+      }
+
+    for (i = 0; i < num_messages; i++)
+      input_message_clear (&messages[i], &msgvec[i].msg_hdr);
+    g_free (msgvec);
+
+    return result;
+  }
+#else
+  for (i = 0; i < num_messages; i++)
+    {
+      GInputMessage *message = &messages[i];
+      GError *msg_error = NULL;
+      gint num_control_messages;
+      gssize result;
+
+      message->flags = flags;
+
+      /* only the first message may block */
+      result = receive_message_with_blocking (socket, message->address,
+                                              message->vectors, message->num_vectors,
+                                              message->control_messages,
+                                              &num_control_messages,
+                                              &message->flags,
+                                              i == 0 && socket->priv->blocking,
+                                              cancellable, &msg_error);
+      if (result < 0)
+        {
+          if (i == 0)
+            {
+              g_propagate_error (error, msg_error);
+              return -1;
+            }
+
+          g_error_free (msg_error);
+          break;
+        }
+
+      message->bytes_received = result;
+      if (message->num_control_messages != NULL)
+        *message->num_control_messages = num_control_messages;
+    }
+
+  return i;
+#endif
+}
+
 /**
  * g_socket_get_credentials:
  * @socket: a #GSocket.
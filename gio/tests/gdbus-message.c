@@ -22,6 +22,7 @@
 
 #include <locale.h>
 #include <gio/gio.h>
+#include <string.h>
 
 /* ---------------------------------------------------------------------------------------------------- */
 
@@ -143,6 +144,91 @@ message_copy (void)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+static void
+message_parse_fixed_arrays (void)
+{
+  GDBusMessageByteOrder byte_orders[] = {
+    G_DBUS_MESSAGE_BYTE_ORDER_LITTLE_ENDIAN,
+    G_DBUS_MESSAGE_BYTE_ORDER_BIG_ENDIAN
+  };
+  guchar *big;
+  gsize big_len;
+  guint n;
+
+  /* Arrays of fixed-size numbers are taken from the blob in one go
+   * rather than element by element; check that this gets the padding
+   * and the byte order right.
+   */
+  big_len = 1024 * 1024 + 3;
+  big = g_malloc (big_len);
+  for (n = 0; n < big_len; n++)
+    big[n] = n * 7;
+
+  for (n = 0; n < G_N_ELEMENTS (byte_orders); n++)
+    {
+      GDBusMessage *message;
+      GDBusMessage *recovered;
+      GVariant *body;
+      GVariant *bytes;
+      GError *error = NULL;
+      guchar *blob;
+      gsize blob_size;
+      gconstpointer data;
+      gsize len;
+
+      body = g_variant_parse (G_VARIANT_TYPE ("(yaxaqyaiadatyanauabah)"),
+                              "(byte 1, [int64 -1, 0x0102030405060708], [uint16 1, 0xff00],"
+                              " byte 2, [-7, 0x01020304], [3.25, -1e100], [uint64 1],"
+                              " byte 3, [int16 -2], [uint32 0xdeadbeef], [true, false], [handle 5])",
+                              NULL, NULL, &error);
+      g_assert_no_error (error);
+
+      message = g_dbus_message_new_signal ("/org/example/Object", "org.example.Interface", "Signal");
+      g_dbus_message_set_byte_order (message, byte_orders[n]);
+      g_dbus_message_set_body (message, body);
+      blob = g_dbus_message_to_blob (message, &blob_size, G_DBUS_CAPABILITY_FLAGS_NONE, &error);
+      g_assert_no_error (error);
+
+      recovered = g_dbus_message_new_from_blob (blob, blob_size, G_DBUS_CAPABILITY_FLAGS_NONE, &error);
+      g_assert_no_error (error);
+      g_assert (g_variant_equal (g_dbus_message_get_body (recovered), body));
+      g_object_unref (recovered);
+      g_free (blob);
+      g_object_unref (message);
+
+      bytes = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, big, big_len, 1);
+      message = g_dbus_message_new_signal ("/org/example/Object", "org.example.Interface", "Signal");
+      g_dbus_message_set_byte_order (message, byte_orders[n]);
+      g_dbus_message_set_body (message, g_variant_new ("(s@ay)", "big", bytes));
+      blob = g_dbus_message_to_blob (message, &blob_size, G_DBUS_CAPABILITY_FLAGS_NONE, &error);
+      g_assert_no_error (error);
+
+      recovered = g_dbus_message_new_from_blob (blob, blob_size, G_DBUS_CAPABILITY_FLAGS_NONE, &error);
+      g_assert_no_error (error);
+      g_variant_get (g_dbus_message_get_body (recovered), "(s@ay)", NULL, &bytes);
+      data = g_variant_get_fixed_array (bytes, &len, 1);
+      g_assert_cmpuint (len, ==, big_len);
+      g_assert (memcmp (data, big, big_len) == 0);
+      g_variant_unref (bytes);
+      g_object_unref (recovered);
+
+      /* a length that runs past the end of the message */
+      blob_size -= 4;
+      recovered = g_dbus_message_new_from_blob (blob, blob_size, G_DBUS_CAPABILITY_FLAGS_NONE, &error);
+      g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
+      g_assert (recovered == NULL);
+      g_clear_error (&error);
+
+      g_free (blob);
+      g_object_unref (message);
+      g_variant_unref (body);
+    }
+
+  g_free (big);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 int
 main (int   argc,
       char *argv[])
@@ -153,6 +239,7 @@ main (int   argc,
 
   g_test_add_func ("/gdbus/message/lock", message_lock);
   g_test_add_func ("/gdbus/message/copy", message_copy);
+  g_test_add_func ("/gdbus/message/parse-fixed-arrays", message_parse_fixed_arrays);
   return g_test_run();
 }
 
@@ -42,6 +42,7 @@
 #ifdef G_OS_UNIX
 #include <gio/gunixconnection.h>
 #include <errno.h>
+#include <sys/mman.h>
 #endif
 
 #if (defined(__linux__) || \
@@ -1711,6 +1712,378 @@ codegen_test_peer (void)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+#ifdef G_OS_UNIX
+
+#define MEMFD_PAYLOAD_SIZE (4 * 1024 * 1024)
+
+/* Whether message bodies can be sent in a sealed memfd at all; without
+ * that the payload of the test cannot be passed along with fds.
+ */
+static gboolean
+memfd_supported (void)
+{
+#if defined (HAVE_MEMFD_CREATE) && defined (F_ADD_SEALS)
+  gboolean supported;
+  gint fd;
+
+  fd = memfd_create ("gdbus-peer-test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0)
+    return FALSE;
+
+  supported = fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE) == 0;
+  close (fd);
+
+  return supported;
+#else
+  return FALSE;
+#endif
+}
+
+/* Checks that @data is in a mapped memfd rather than on the heap */
+static void
+assert_in_memfd (gconstpointer data)
+{
+#if defined (__linux__) && defined (HAVE_MEMFD_CREATE)
+  gchar *contents;
+  gchar **lines;
+  gboolean found;
+  guint n;
+
+  g_assert (g_file_get_contents ("/proc/self/maps", &contents, NULL, NULL));
+  lines = g_strsplit (contents, "\n", -1);
+  found = FALSE;
+  for (n = 0; lines[n] != NULL; n++)
+    {
+      gulong start, end;
+
+      if (sscanf (lines[n], "%lx-%lx", &start, &end) == 2 &&
+          start <= (gulong) data && (gulong) data < end)
+        {
+          found = strstr (lines[n], "memfd:") != NULL;
+          break;
+        }
+    }
+  g_strfreev (lines);
+  g_free (contents);
+  g_assert (found);
+#endif
+}
+
+static void
+memfd_on_method_call (GDBusConnection       *connection,
+                      const gchar           *sender,
+                      const gchar           *object_path,
+                      const gchar           *interface_name,
+                      const gchar           *method_name,
+                      GVariant              *parameters,
+                      GDBusMethodInvocation *invocation,
+                      gpointer               user_data)
+{
+  GDBusMessage *message;
+  GUnixFDList *fd_list;
+  GVariant *payload;
+  gconstpointer data;
+  gsize len;
+  gint32 handle;
+
+  g_assert_cmpstr (method_name, ==, "Echo");
+
+  /* the memfd carrying the body is not visible, but other fds are */
+  message = g_dbus_method_invocation_get_message (invocation);
+  fd_list = g_dbus_message_get_unix_fd_list (message);
+  g_assert (fd_list != NULL);
+  g_assert_cmpint (g_unix_fd_list_get_length (fd_list), ==, 1);
+  g_assert_cmpint (g_dbus_message_get_num_unix_fds (message), ==, 1);
+  g_assert_cmpstr (g_dbus_message_get_signature (message), ==, "ayh");
+
+  g_variant_get (parameters, "(@ayh)", &payload, &handle);
+  g_assert_cmpint (handle, ==, 0);
+  data = g_variant_get_fixed_array (payload, &len, 1);
+  g_assert_cmpuint (len, ==, MEMFD_PAYLOAD_SIZE);
+  assert_in_memfd (data);
+
+  g_dbus_method_invocation_return_value (invocation, g_variant_new ("(@ay)", payload));
+  g_variant_unref (payload);
+}
+
+static const GDBusInterfaceVTable memfd_interface_vtable =
+{
+  memfd_on_method_call,
+  NULL,
+  NULL
+};
+
+static void
+memfd_on_connection (GObject      *source_object,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+  GDBusConnection **connection = user_data;
+  GError *error = NULL;
+
+  *connection = g_dbus_connection_new_finish (res, &error);
+  g_assert_no_error (error);
+}
+
+static void
+memfd_on_reply (GObject      *source_object,
+                GAsyncResult *res,
+                gpointer      user_data)
+{
+  GVariant **reply = user_data;
+  GError *error = NULL;
+
+  *reply = g_dbus_connection_call_with_unix_fd_list_finish (G_DBUS_CONNECTION (source_object),
+                                                            NULL,
+                                                            res,
+                                                            &error);
+  g_assert_no_error (error);
+  g_main_loop_quit (loop);
+}
+
+static GIOStream *
+memfd_stream_new (gint fd)
+{
+  GSocket *socket;
+  GSocketConnection *connection;
+  GError *error = NULL;
+
+  socket = g_socket_new_from_fd (fd, &error);
+  g_assert_no_error (error);
+  connection = g_socket_connection_factory_create_connection (socket);
+  g_object_unref (socket);
+
+  return G_IO_STREAM (connection);
+}
+
+static void
+memfd_connections_new (GDBusConnection **server_connection,
+                       GDBusConnection **client_connection)
+{
+  GIOStream *stream;
+  GError *error;
+  gchar *guid;
+  gint sv[2];
+
+  g_assert_cmpint (socketpair (AF_UNIX, SOCK_STREAM, 0, sv), ==, 0);
+
+  /* the server side authenticates in a thread while the client side
+   * blocks in the main thread
+   */
+  *server_connection = NULL;
+  guid = g_dbus_generate_guid ();
+  stream = memfd_stream_new (sv[0]);
+  g_dbus_connection_new (stream,
+                         guid,
+                         G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER,
+                         NULL, /* GDBusAuthObserver */
+                         NULL, /* GCancellable */
+                         memfd_on_connection,
+                         server_connection);
+  g_object_unref (stream);
+
+  error = NULL;
+  stream = memfd_stream_new (sv[1]);
+  *client_connection = g_dbus_connection_new_sync (stream,
+                                                   NULL, /* guid */
+                                                   G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                                   NULL, /* GDBusAuthObserver */
+                                                   NULL, /* GCancellable */
+                                                   &error);
+  g_assert_no_error (error);
+  g_object_unref (stream);
+
+  while (*server_connection == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_free (guid);
+}
+
+static void
+test_memfd_body (void)
+{
+  GDBusConnection *server_connection;
+  GDBusConnection *client_connection;
+  GDBusNodeInfo *node;
+  GUnixFDList *fd_list;
+  GVariant *reply;
+  GVariant *payload;
+  GError *error;
+  guchar *data;
+  gconstpointer reply_data;
+  gsize len;
+  guint n;
+
+  if (!memfd_supported ())
+    {
+      g_test_skip ("sealed memfds are not supported");
+      return;
+    }
+
+  memfd_connections_new (&server_connection, &client_connection);
+
+  error = NULL;
+  g_assert (g_dbus_connection_get_capabilities (client_connection) & G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING);
+  g_assert_cmpuint (g_dbus_connection_get_memfd_threshold (client_connection), ==, 0);
+  g_dbus_connection_set_memfd_threshold (client_connection, 64 * 1024);
+  g_dbus_connection_set_memfd_threshold (server_connection, 64 * 1024);
+  g_assert_cmpuint (g_dbus_connection_get_memfd_threshold (client_connection), ==, 64 * 1024);
+
+  node = g_dbus_node_info_new_for_xml ("<node>"
+                                       "  <interface name='org.gtk.GDBus.MemfdInterface'>"
+                                       "    <method name='Echo'>"
+                                       "      <arg type='ay' name='payload' direction='in'/>"
+                                       "      <arg type='h' name='fd' direction='in'/>"
+                                       "      <arg type='ay' name='payload' direction='out'/>"
+                                       "    </method>"
+                                       "  </interface>"
+                                       "</node>",
+                                       &error);
+  g_assert_no_error (error);
+  g_dbus_connection_register_object (server_connection,
+                                     "/memfd/test",
+                                     node->interfaces[0],
+                                     &memfd_interface_vtable,
+                                     NULL,
+                                     NULL,
+                                     &error);
+  g_assert_no_error (error);
+  g_dbus_node_info_unref (node);
+
+  data = g_malloc (MEMFD_PAYLOAD_SIZE);
+  for (n = 0; n < MEMFD_PAYLOAD_SIZE; n++)
+    data[n] = n % 251;
+  payload = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, data, MEMFD_PAYLOAD_SIZE, 1);
+
+  fd_list = g_unix_fd_list_new ();
+  g_unix_fd_list_append (fd_list, 0, &error);
+  g_assert_no_error (error);
+
+  reply = NULL;
+  g_dbus_connection_call_with_unix_fd_list (client_connection,
+                                            NULL, /* bus name */
+                                            "/memfd/test",
+                                            "org.gtk.GDBus.MemfdInterface",
+                                            "Echo",
+                                            g_variant_new ("(@ayh)", payload, 0),
+                                            G_VARIANT_TYPE ("(ay)"),
+                                            G_DBUS_CALL_FLAGS_NONE,
+                                            -1, /* timeout_msec */
+                                            fd_list,
+                                            NULL, /* GCancellable */
+                                            memfd_on_reply,
+                                            &reply);
+  g_object_unref (fd_list);
+  g_main_loop_run (loop);
+
+  g_variant_get (reply, "(@ay)", &payload);
+  reply_data = g_variant_get_fixed_array (payload, &len, 1);
+  g_assert_cmpuint (len, ==, MEMFD_PAYLOAD_SIZE);
+  g_assert (memcmp (reply_data, data, len) == 0);
+  assert_in_memfd (reply_data);
+  g_variant_unref (payload);
+  g_variant_unref (reply);
+
+  g_free (data);
+  g_object_unref (client_connection);
+  g_object_unref (server_connection);
+}
+
+static GDBusMessage *
+memfd_count_filter (GDBusConnection *connection,
+                    GDBusMessage    *message,
+                    gboolean         incoming,
+                    gpointer         user_data)
+{
+  volatile gint *count = user_data;
+
+  if (incoming && g_strcmp0 (g_dbus_message_get_path (message), "/memfd/test") == 0)
+    g_atomic_int_inc (count);
+
+  return message;
+}
+
+/* Sends a message claiming to have its body in a memfd, with an fd
+ * that is not a sealed memfd, followed by a ping to flush it through.
+ */
+static void
+memfd_send_malformed (GDBusConnection *connection)
+{
+  GDBusMessage *message;
+  GUnixFDList *fd_list;
+  GVariant *reply;
+  GError *error;
+
+  error = NULL;
+  message = g_dbus_message_new_method_call (NULL, /* name */
+                                            "/memfd/test",
+                                            "org.gtk.GDBus.MemfdInterface",
+                                            "Echo");
+  g_dbus_message_set_flags (message, G_DBUS_MESSAGE_FLAGS_NO_REPLY_EXPECTED);
+  g_dbus_message_set_body (message, g_variant_new ("(h)", 0));
+  g_dbus_message_set_header (message, (GDBusMessageHeaderField) 'M', g_variant_new_signature ("ayh"));
+  fd_list = g_unix_fd_list_new ();
+  g_unix_fd_list_append (fd_list, 0, &error);
+  g_assert_no_error (error);
+  g_dbus_message_set_unix_fd_list (message, fd_list);
+  g_object_unref (fd_list);
+
+  g_dbus_connection_send_message (connection, message, G_DBUS_SEND_MESSAGE_FLAGS_NONE, NULL, &error);
+  g_assert_no_error (error);
+  g_object_unref (message);
+
+  reply = g_dbus_connection_call_sync (connection,
+                                       NULL, /* bus name */
+                                       "/",
+                                       "org.freedesktop.DBus.Peer",
+                                       "Ping",
+                                       NULL, /* parameters */
+                                       G_VARIANT_TYPE_UNIT,
+                                       G_DBUS_CALL_FLAGS_NONE,
+                                       -1, /* timeout_msec */
+                                       NULL, /* GCancellable */
+                                       &error);
+  g_assert_no_error (error);
+  g_variant_unref (reply);
+}
+
+static void
+test_memfd_body_malformed (void)
+{
+  GDBusConnection *server_connection;
+  GDBusConnection *client_connection;
+  volatile gint count;
+
+  if (!memfd_supported ())
+    {
+      g_test_skip ("sealed memfds are not supported");
+      return;
+    }
+
+  memfd_connections_new (&server_connection, &client_connection);
+  count = 0;
+  g_dbus_connection_add_filter (server_connection, memfd_count_filter, (gpointer) &count, NULL);
+
+  /* a connection that did not ask for memfd bodies passes the message on as it is */
+  memfd_send_malformed (client_connection);
+  g_assert_cmpint (count, ==, 1);
+
+  /* one that did drops it, but stays connected */
+  g_dbus_connection_set_memfd_threshold (server_connection, G_MAXSIZE);
+  g_test_expect_message ("GLib-GIO", G_LOG_LEVEL_WARNING, "Dropping D-Bus message*");
+  memfd_send_malformed (client_connection);
+  g_test_assert_expected_messages ();
+  g_assert_cmpint (count, ==, 1);
+  g_assert (!g_dbus_connection_is_closed (server_connection));
+
+  g_object_unref (client_connection);
+  g_object_unref (server_connection);
+}
+
+#endif /* G_OS_UNIX */
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 
 int
 main (int   argc,
@@ -1751,6 +2124,10 @@ main (int   argc,
   g_test_add_func ("/gdbus/tcp-anonymous", test_tcp_anonymous);
   g_test_add_func ("/gdbus/credentials", test_credentials);
   g_test_add_func ("/gdbus/codegen-peer-to-peer", codegen_test_peer);
+#ifdef G_OS_UNIX
+  g_test_add_func ("/gdbus/peer-to-peer-memfd", test_memfd_body);
+  g_test_add_func ("/gdbus/peer-to-peer-memfd-malformed", test_memfd_body_malformed);
+#endif
 
   ret = g_test_run();
 
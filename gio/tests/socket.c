@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <gio/gnetworking.h>
 #include <gio/gunixconnection.h>
+#include <gio/gunixfdmessage.h>
 #endif
 
 #include "gnetworkingprivate.h"
@@ -972,6 +973,302 @@ test_datagram_get_available (void)
   g_object_unref (client);
 }
 
+static void
+make_udp_pair (GSocket **server, GSocket **client)
+{
+  GError *err = NULL;
+  GInetAddress *iaddr;
+  GSocketAddress *addr;
+
+  *server = g_socket_new (G_SOCKET_FAMILY_IPV4,
+                          G_SOCKET_TYPE_DATAGRAM,
+                          G_SOCKET_PROTOCOL_DEFAULT,
+                          &err);
+  g_assert_no_error (err);
+  *client = g_socket_new (G_SOCKET_FAMILY_IPV4,
+                          G_SOCKET_TYPE_DATAGRAM,
+                          G_SOCKET_PROTOCOL_DEFAULT,
+                          &err);
+  g_assert_no_error (err);
+
+  iaddr = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  addr = g_inet_socket_address_new (iaddr, 0);
+  g_socket_bind (*server, addr, TRUE, &err);
+  g_assert_no_error (err);
+  g_socket_bind (*client, addr, TRUE, &err);
+  g_assert_no_error (err);
+  g_object_unref (addr);
+  g_object_unref (iaddr);
+
+  addr = g_socket_get_local_address (*server, &err);
+  g_assert_no_error (err);
+  g_socket_connect (*client, addr, NULL, &err);
+  g_assert_no_error (err);
+  g_object_unref (addr);
+}
+
+static void
+test_datagram_messages (void)
+{
+  GError *err = NULL;
+  GSocket *server, *client;
+  GSocketAddress *client_addr;
+  GSocketAddress *addresses[16];
+  GOutputMessage out[10];
+  GOutputVector out_vectors[10][2];
+  GInputMessage in[16];
+  GInputVector in_vectors[16];
+  gchar bufs[16][64];
+  GCancellable *cancellable;
+  gint i, n;
+
+  make_udp_pair (&server, &client);
+  client_addr = g_socket_get_local_address (client, &err);
+  g_assert_no_error (err);
+
+  /* message i is "header" followed by i bytes of 'a' + i */
+  for (i = 0; i < 10; i++)
+    {
+      memset (bufs[i], 'a' + i, i);
+      out_vectors[i][0].buffer = "header";
+      out_vectors[i][0].size = 6;
+      out_vectors[i][1].buffer = bufs[i];
+      out_vectors[i][1].size = i;
+      out[i].address = NULL;
+      out[i].vectors = out_vectors[i];
+      out[i].num_vectors = 2;
+      out[i].bytes_sent = 0;
+      out[i].control_messages = NULL;
+      out[i].num_control_messages = 0;
+    }
+
+  n = g_socket_send_messages (client, out, 10, 0, NULL, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (n, ==, 10);
+  for (i = 0; i < 10; i++)
+    g_assert_cmpuint (out[i].bytes_sent, ==, 6 + i);
+
+  for (i = 0; i < 16; i++)
+    {
+      in_vectors[i].buffer = bufs[i];
+      in_vectors[i].size = sizeof bufs[i];
+      addresses[i] = NULL;
+      in[i].address = &addresses[i];
+      in[i].vectors = &in_vectors[i];
+      in[i].num_vectors = 1;
+      in[i].bytes_received = 0;
+      in[i].flags = 0;
+      in[i].control_messages = NULL;
+      in[i].num_control_messages = NULL;
+    }
+
+  /* the server is blocking, so this waits for the first datagram and
+   * then takes whatever else is queued
+   */
+  n = 0;
+  while (n < 10)
+    {
+      gint received;
+
+      received = g_socket_receive_messages (server, in + n, 16 - n, 0, NULL, &err);
+      g_assert_no_error (err);
+      g_assert_cmpint (received, >, 0);
+      n += received;
+    }
+  g_assert_cmpint (n, ==, 10);
+
+  for (i = 0; i < 10; i++)
+    {
+      g_assert_cmpuint (in[i].bytes_received, ==, 6 + i);
+      g_assert (memcmp (bufs[i], "header", 6) == 0);
+      g_assert (i == 0 || bufs[i][6] == 'a' + i);
+      g_assert (G_IS_INET_SOCKET_ADDRESS (addresses[i]));
+      g_assert_cmpint (g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addresses[i])), ==,
+                       g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (client_addr)));
+      g_object_unref (addresses[i]);
+    }
+
+  /* nothing left */
+  g_socket_set_blocking (server, FALSE);
+  n = g_socket_receive_messages (server, in, 16, 0, NULL, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK);
+  g_assert_cmpint (n, ==, -1);
+  g_clear_error (&err);
+
+  cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+  n = g_socket_send_messages (client, out, 10, 0, cancellable, &err);
+  g_assert_error (err, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_cmpint (n, ==, -1);
+  g_clear_error (&err);
+  g_object_unref (cancellable);
+
+  g_assert_cmpint (g_socket_send_messages (client, out, 0, 0, NULL, &err), ==, 0);
+  g_assert_no_error (err);
+
+  g_object_unref (client_addr);
+  g_object_unref (server);
+  g_object_unref (client);
+}
+
+#ifdef G_OS_UNIX
+static void
+test_datagram_messages_fd (void)
+{
+  GError *err = NULL;
+  GSocket *sock[2];
+  GSocketControlMessage *fd_message;
+  GSocketControlMessage **received;
+  GOutputMessage out;
+  GOutputVector out_vector = { "x", 1 };
+  GInputMessage in;
+  GInputVector in_vector;
+  guint num_received;
+  gchar buf[8];
+  gint *fds;
+  gint sv[2], pv[2];
+  gint n, status, len;
+
+  status = socketpair (PF_UNIX, SOCK_DGRAM, 0, sv);
+  g_assert_cmpint (status, ==, 0);
+  status = pipe (pv);
+  g_assert_cmpint (status, ==, 0);
+
+  for (n = 0; n < 2; n++)
+    {
+      sock[n] = g_socket_new_from_fd (sv[n], &err);
+      g_assert_no_error (err);
+    }
+
+  fd_message = g_unix_fd_message_new ();
+  g_unix_fd_message_append_fd (G_UNIX_FD_MESSAGE (fd_message), pv[1], &err);
+  g_assert_no_error (err);
+  close (pv[1]);
+
+  out.address = NULL;
+  out.vectors = &out_vector;
+  out.num_vectors = 1;
+  out.bytes_sent = 0;
+  out.control_messages = &fd_message;
+  out.num_control_messages = 1;
+
+  n = g_socket_send_messages (sock[0], &out, 1, 0, NULL, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (n, ==, 1);
+  g_object_unref (fd_message);
+
+  in_vector.buffer = buf;
+  in_vector.size = sizeof buf;
+  in.address = NULL;
+  in.vectors = &in_vector;
+  in.num_vectors = 1;
+  in.control_messages = &received;
+  in.num_control_messages = &num_received;
+
+  n = g_socket_receive_messages (sock[1], &in, 1, 0, NULL, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (n, ==, 1);
+  g_assert_cmpuint (in.bytes_received, ==, 1);
+  g_assert_cmpuint (num_received, ==, 1);
+  g_assert (G_IS_UNIX_FD_MESSAGE (received[0]));
+  g_assert (received[1] == NULL);
+
+  /* the passed descriptor is the write end of the pipe */
+  fds = g_unix_fd_message_steal_fds (G_UNIX_FD_MESSAGE (received[0]), &len);
+  g_assert_cmpint (len, ==, 1);
+  g_assert_cmpint (write (fds[0], "y", 1), ==, 1);
+  close (fds[0]);
+  g_assert_cmpint (read (pv[0], buf, 1), ==, 1);
+  g_assert_cmpint (buf[0], ==, 'y');
+  close (pv[0]);
+  g_free (fds);
+
+  g_object_unref (received[0]);
+  g_free (received);
+  g_object_unref (sock[0]);
+  g_object_unref (sock[1]);
+}
+#endif
+
+#define N_DATAGRAMS 200000
+#define DATAGRAM_BATCH 64
+
+static void
+test_datagram_throughput (void)
+{
+  GError *err = NULL;
+  GSocket *server, *client;
+  GOutputMessage out[DATAGRAM_BATCH];
+  GOutputVector out_vector;
+  GInputMessage in[DATAGRAM_BATCH];
+  GInputVector in_vectors[DATAGRAM_BATCH];
+  gchar payload[64];
+  gchar bufs[DATAGRAM_BATCH][64];
+  gdouble single_time, batch_time;
+  gint i, j;
+
+  make_udp_pair (&server, &client);
+  memset (payload, 'p', sizeof payload);
+
+  /* one system call per datagram */
+  g_test_timer_start ();
+  for (i = 0; i < N_DATAGRAMS; i += DATAGRAM_BATCH)
+    {
+      for (j = 0; j < DATAGRAM_BATCH; j++)
+        g_socket_send (client, payload, sizeof payload, NULL, &err);
+      for (j = 0; j < DATAGRAM_BATCH; j++)
+        g_socket_receive (server, bufs[j], sizeof bufs[j], NULL, &err);
+    }
+  g_assert_no_error (err);
+  single_time = g_test_timer_elapsed ();
+
+  out_vector.buffer = payload;
+  out_vector.size = sizeof payload;
+  for (j = 0; j < DATAGRAM_BATCH; j++)
+    {
+      out[j].address = NULL;
+      out[j].vectors = &out_vector;
+      out[j].num_vectors = 1;
+      out[j].bytes_sent = 0;
+      out[j].control_messages = NULL;
+      out[j].num_control_messages = 0;
+
+      in_vectors[j].buffer = bufs[j];
+      in_vectors[j].size = sizeof bufs[j];
+      in[j].address = NULL;
+      in[j].vectors = &in_vectors[j];
+      in[j].num_vectors = 1;
+      in[j].control_messages = NULL;
+      in[j].num_control_messages = NULL;
+    }
+
+  /* one system call per batch */
+  g_test_timer_start ();
+  for (i = 0; i < N_DATAGRAMS; i += DATAGRAM_BATCH)
+    {
+      gint sent, received;
+
+      for (sent = 0; sent < DATAGRAM_BATCH; )
+        sent += g_socket_send_messages (client, out + sent, DATAGRAM_BATCH - sent, 0, NULL, &err);
+      for (received = 0; received < DATAGRAM_BATCH; )
+        received += g_socket_receive_messages (server, in + received, DATAGRAM_BATCH - received, 0, NULL, &err);
+    }
+  g_assert_no_error (err);
+  batch_time = g_test_timer_elapsed ();
+
+  g_test_message ("%d datagrams of %d bytes over loopback: "
+                  "%.0f/s one at a time, %.0f/s in batches of %d",
+                  N_DATAGRAMS, (gint) sizeof payload,
+                  N_DATAGRAMS / single_time, N_DATAGRAMS / batch_time,
+                  DATAGRAM_BATCH);
+  g_test_maximized_result (N_DATAGRAMS / batch_time,
+                           "%.0f datagrams/s batched",
+                           N_DATAGRAMS / batch_time);
+
+  g_object_unref (server);
+  g_object_unref (client);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -996,6 +1293,12 @@ main (int   argc,
   g_test_add_func ("/socket/reuse/tcp", test_reuse_tcp);
   g_test_add_func ("/socket/reuse/udp", test_reuse_udp);
   g_test_add_func ("/socket/datagram_get_available", test_datagram_get_available);
+  g_test_add_func ("/socket/datagram_messages", test_datagram_messages);
+#ifdef G_OS_UNIX
+  g_test_add_func ("/socket/datagram_messages_fd", test_datagram_messages_fd);
+#endif
+  if (g_test_perf ())
+    g_test_add_func ("/socket/perf/datagram_throughput", test_datagram_throughput);
 
   return g_test_run();
 }
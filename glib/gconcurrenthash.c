@@ -0,0 +1,252 @@
+/*
+ * Copyright © 2013 GLib contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include "gconcurrenthash.h"
+
+#include "gatomic.h"
+#include "gmem.h"
+#include "gslist.h"
+#include "gtestutils.h"
+
+/*< private >
+ * SECTION:gconcurrenthash
+ * @title: GConcurrentHash
+ * @short_description: read-mostly hash table with lock-free lookups
+ *
+ * #GConcurrentHash is an insert-only hash table for data that is
+ * looked up far more often than it is added to, such as the quark
+ * table.  g_concurrent_hash_lookup() takes no lock and writes no
+ * shared memory, so lookups from any number of threads do not
+ * contend with each other.
+ *
+ * Calls to g_concurrent_hash_insert() must be serialised by the
+ * caller, typically with the same lock that protects the creation of
+ * the values.  They may run concurrently with lookups.  Keys can not
+ * be removed or replaced, and %NULL is not a valid key.
+ *
+ * Nodes are filled in before their key is published, so a reader
+ * that sees a key also sees its value.  When the table grows, a new
+ * node array is filled and then swapped in; readers that are still
+ * walking the old array find the same contents there.  Since there
+ * is no way to know when those readers are done, the old arrays are
+ * only released by g_concurrent_hash_free().  Arrays double in size,
+ * so this never costs more than the current array.
+ */
+
+typedef struct
+{
+  gpointer key;         /* NULL for an empty node, published last */
+  gpointer value;
+  guint    hash;
+} GConcurrentHashNode;
+
+typedef struct
+{
+  guint               mask;
+  GConcurrentHashNode nodes[1];
+} GConcurrentHashArray;
+
+struct _GConcurrentHash
+{
+  GConcurrentHashArray *array;
+
+  GHashFunc             hash_func;
+  GEqualFunc            key_equal_func;
+  guint                 nnodes;
+  GSList               *retired;
+};
+
+#define G_CONCURRENT_HASH_MIN_SIZE 64
+
+/* Loading the key must order the loads of the rest of the node after
+ * it.  g_atomic_pointer_get() does that with a full barrier, which
+ * is far more than needed on every probe.
+ */
+#if defined (__ATOMIC_ACQUIRE)
+#define node_get_key(node) (__atomic_load_n (&(node)->key, __ATOMIC_ACQUIRE))
+#else
+#define node_get_key(node) (g_atomic_pointer_get (&(node)->key))
+#endif
+
+static GConcurrentHashArray *
+g_concurrent_hash_array_new (guint size)
+{
+  GConcurrentHashArray *array;
+
+  array = g_malloc0 (sizeof (GConcurrentHashArray) +
+                     (size - 1) * sizeof (GConcurrentHashNode));
+  array->mask = size - 1;
+
+  return array;
+}
+
+static GConcurrentHashNode *
+g_concurrent_hash_array_find_empty (GConcurrentHashArray *array,
+                                    guint                 hash)
+{
+  guint i;
+
+  for (i = hash & array->mask; array->nodes[i].key; i = (i + 1) & array->mask)
+    ;
+
+  return &array->nodes[i];
+}
+
+/**
+ * g_concurrent_hash_new:
+ * @hash_func: a function to create a hash value from a key
+ * @key_equal_func: a function to check two keys for equality
+ *
+ * Creates a new, empty #GConcurrentHash.
+ *
+ * Returns: a new #GConcurrentHash
+ */
+GConcurrentHash *
+g_concurrent_hash_new (GHashFunc  hash_func,
+                       GEqualFunc key_equal_func)
+{
+  GConcurrentHash *hash;
+
+  g_return_val_if_fail (hash_func != NULL, NULL);
+  g_return_val_if_fail (key_equal_func != NULL, NULL);
+
+  hash = g_new0 (GConcurrentHash, 1);
+  hash->array = g_concurrent_hash_array_new (G_CONCURRENT_HASH_MIN_SIZE);
+  hash->hash_func = hash_func;
+  hash->key_equal_func = key_equal_func;
+
+  return hash;
+}
+
+/**
+ * g_concurrent_hash_free:
+ * @hash: a #GConcurrentHash
+ *
+ * Frees @hash.  No other thread may be using it any longer.  The keys
+ * and values are not freed.
+ */
+void
+g_concurrent_hash_free (GConcurrentHash *hash)
+{
+  g_slist_free_full (hash->retired, g_free);
+  g_free (hash->array);
+  g_free (hash);
+}
+
+/**
+ * g_concurrent_hash_lookup:
+ * @hash: a #GConcurrentHash
+ * @key: the key to look up
+ *
+ * Looks up @key in @hash.  This never blocks and may be called from
+ * any thread at any time, including while another thread is inserting.
+ *
+ * Returns: the value for @key, or %NULL if it is not in the table
+ */
+gpointer
+g_concurrent_hash_lookup (GConcurrentHash *hash,
+                          gconstpointer    key)
+{
+  GConcurrentHashArray *array;
+  guint hash_value;
+  guint i;
+
+  hash_value = hash->hash_func (key);
+  array = g_atomic_pointer_get (&hash->array);
+
+  for (i = hash_value & array->mask; ; i = (i + 1) & array->mask)
+    {
+      GConcurrentHashNode *node = &array->nodes[i];
+      gpointer node_key;
+
+      node_key = node_get_key (node);
+
+      /* the table is never more than half full */
+      if (node_key == NULL)
+        return NULL;
+
+      if (node->hash == hash_value && hash->key_equal_func (node_key, key))
+        return node->value;
+    }
+}
+
+/**
+ * g_concurrent_hash_insert:
+ * @hash: a #GConcurrentHash
+ * @key: a key that is not in @hash yet
+ * @value: the value to associate with @key
+ *
+ * Adds @key to @hash.  Callers must make sure that no two inserts
+ * happen at the same time and that @key is not present already;
+ * concurrent lookups are fine.
+ */
+void
+g_concurrent_hash_insert (GConcurrentHash *hash,
+                          gpointer         key,
+                          gpointer         value)
+{
+  GConcurrentHashArray *array = hash->array;
+  GConcurrentHashNode *node;
+  guint hash_value;
+
+  g_return_if_fail (key != NULL);
+
+  if ((hash->nnodes + 1) * 2 > array->mask + 1)
+    {
+      GConcurrentHashArray *new_array;
+      guint i;
+
+      /* the new array is private until it is published, so it can be
+       * filled without any care
+       */
+      new_array = g_concurrent_hash_array_new ((array->mask + 1) * 2);
+      for (i = 0; i <= array->mask; i++)
+        if (array->nodes[i].key)
+          *g_concurrent_hash_array_find_empty (new_array, array->nodes[i].hash) = array->nodes[i];
+
+      g_atomic_pointer_set (&hash->array, new_array);
+      hash->retired = g_slist_prepend (hash->retired, array);
+      array = new_array;
+    }
+
+  hash_value = hash->hash_func (key);
+  node = g_concurrent_hash_array_find_empty (array, hash_value);
+  node->hash = hash_value;
+  node->value = value;
+  g_atomic_pointer_set (&node->key, key);
+
+  hash->nnodes++;
+}
+
+/**
+ * g_concurrent_hash_size:
+ * @hash: a #GConcurrentHash
+ *
+ * Gets the number of keys in @hash.  The result is only exact when
+ * no insert is in progress.
+ *
+ * Returns: the number of keys in @hash
+ */
+guint
+g_concurrent_hash_size (GConcurrentHash *hash)
+{
+  return g_atomic_int_get (&hash->nnodes);
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright © 2013 GLib contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the licence, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __G_CONCURRENT_HASH_H__
+#define __G_CONCURRENT_HASH_H__
+
+#include <glib/ghash.h>
+
+typedef struct _GConcurrentHash GConcurrentHash;
+
+GConcurrentHash *       g_concurrent_hash_new           (GHashFunc        hash_func,
+                                                         GEqualFunc       key_equal_func);
+void                    g_concurrent_hash_free          (GConcurrentHash *hash);
+
+gpointer                g_concurrent_hash_lookup        (GConcurrentHash *hash,
+                                                         gconstpointer    key);
+void                    g_concurrent_hash_insert        (GConcurrentHash *hash,
+                                                         gpointer         key,
+                                                         gpointer         value);
+guint                   g_concurrent_hash_size          (GConcurrentHash *hash);
+
+#endif
@@ -166,8 +166,16 @@ struct _GData
   guint32  len;     /* Number of elements */
   guint32  alloc;   /* Number of allocated elements */
   GDataElt data[1]; /* Flexible array */
+  /* followed by the index, if alloc >= DATALIST_INDEX_MIN_ALLOC */
 };
 
+/* Short datalists are searched linearly.  Once they grow beyond that,
+ * an open addressing index of 2 * alloc slots is kept after the
+ * elements.  Slots hold the position of an element plus one, and zero
+ * for an empty slot.  alloc is always a power of two.
+ */
+#define DATALIST_INDEX_MIN_ALLOC 16
+
 struct _GDataset
 {
   gconstpointer location;
@@ -207,6 +215,154 @@ static GDataset     *g_dataset_cached = NULL; /* should this be
 
 #define DATALIST_LOCK_BIT 2
 
+static inline gsize
+datalist_size (guint32 alloc)
+{
+  gsize size = sizeof (GData) + (alloc - 1) * sizeof (GDataElt);
+
+  if (alloc >= DATALIST_INDEX_MIN_ALLOC)
+    size += 2 * alloc * sizeof (guint32);
+
+  return size;
+}
+
+static inline guint32 *
+datalist_index (GData *d)
+{
+  if (d->alloc < DATALIST_INDEX_MIN_ALLOC)
+    return NULL;
+
+  return (guint32 *) (d->data + d->alloc);
+}
+
+static inline guint32
+datalist_index_home (GData  *d,
+                     GQuark  key_id)
+{
+  return (key_id * 2654435769U) & (2 * d->alloc - 1);
+}
+
+/* returns the slot of @key_id, or the empty slot where it would go */
+static inline guint32
+datalist_index_lookup (GData  *d,
+                       GQuark  key_id)
+{
+  guint32 *index = datalist_index (d);
+  guint32 mask = 2 * d->alloc - 1;
+  guint32 i;
+
+  for (i = datalist_index_home (d, key_id); index[i]; i = (i + 1) & mask)
+    if (d->data[index[i] - 1].key == key_id)
+      break;
+
+  return i;
+}
+
+static void
+datalist_index_rebuild (GData *d)
+{
+  guint32 *index = datalist_index (d);
+  guint32 i;
+
+  memset (index, 0, 2 * d->alloc * sizeof (guint32));
+  for (i = 0; i < d->len; i++)
+    index[datalist_index_lookup (d, d->data[i].key)] = i + 1;
+}
+
+static inline GDataElt *
+datalist_find (GData  *d,
+               GQuark  key_id)
+{
+  GDataElt *data, *data_end;
+
+  if (datalist_index (d))
+    {
+      guint32 pos = datalist_index (d)[datalist_index_lookup (d, key_id)];
+
+      return pos ? &d->data[pos - 1] : NULL;
+    }
+
+  data_end = d->data + d->len;
+  for (data = d->data; data < data_end; data++)
+    if (data->key == key_id)
+      return data;
+
+  return NULL;
+}
+
+/* Appends an element for @key_id, which must not be present yet.
+ * Returns the new location of the datalist, which is not published.
+ */
+static GData *
+datalist_append (GData          *d,
+                 GQuark          key_id,
+                 gpointer        data,
+                 GDestroyNotify  destroy)
+{
+  if (d == NULL)
+    {
+      d = g_malloc (datalist_size (1));
+      d->len = 0;
+      d->alloc = 1;
+    }
+  else if (d->len == d->alloc)
+    {
+      d->alloc = d->alloc * 2;
+      d = g_realloc (d, datalist_size (d->alloc));
+      if (datalist_index (d))
+        datalist_index_rebuild (d);
+    }
+
+  d->data[d->len].key = key_id;
+  d->data[d->len].data = data;
+  d->data[d->len].destroy = destroy;
+  d->len++;
+
+  if (datalist_index (d))
+    datalist_index (d)[datalist_index_lookup (d, key_id)] = d->len;
+
+  return d;
+}
+
+/* Removes @elt by moving the last element into its place */
+static void
+datalist_remove (GData    *d,
+                 GDataElt *elt)
+{
+  guint32 *index = datalist_index (d);
+  guint32 pos = elt - d->data;
+  guint32 last = d->len - 1;
+
+  if (index)
+    {
+      guint32 mask = 2 * d->alloc - 1;
+      guint32 i, j;
+
+      /* backward shift deletion keeps the probe sequences intact
+       * without leaving tombstones behind
+       */
+      i = datalist_index_lookup (d, elt->key);
+      for (j = (i + 1) & mask; index[j]; j = (j + 1) & mask)
+        {
+          guint32 home = datalist_index_home (d, d->data[index[j] - 1].key);
+
+          if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+
+          index[i] = index[j];
+          i = j;
+        }
+      index[i] = 0;
+
+      if (pos != last)
+        index[datalist_index_lookup (d, d->data[last].key)] = pos + 1;
+    }
+
+  if (pos != last)
+    *elt = d->data[last];
+  d->len--;
+}
+
 static void
 g_datalist_lock (GData **datalist)
 {
@@ -353,7 +509,7 @@ g_data_set_internal (GData	  **datalist,
 		     GDataset	   *dataset)
 {
   GData *d, *old_d;
-  GDataElt old, *data, *data_last, *data_end;
+  GDataElt old, *data;
 
   g_datalist_lock (datalist);
 
@@ -363,60 +519,53 @@ g_data_set_internal (GData	  **datalist,
     {
       if (d)
 	{
-	  data = d->data;
-	  data_last = data + d->len - 1;
-	  while (data <= data_last)
+	  data = datalist_find (d, key_id);
+	  if (data)
 	    {
-	      if (data->key == key_id)
+	      old = *data;
+	      datalist_remove (d, data);
+
+	      /* We don't bother to shrink, but if all data are now gone
+	       * we at least free the memory
+	       */
+	      if (d->len == 0)
 		{
-		  old = *data;
-		  if (data != data_last)
-		    *data = *data_last;
-		  d->len--;
-
-		  /* We don't bother to shrink, but if all data are now gone
-		   * we at least free the memory
-                   */
-		  if (d->len == 0)
-		    {
-		      G_DATALIST_SET_POINTER (datalist, NULL);
-		      g_free (d);
-		      /* datalist may be situated in dataset, so must not be
-		       * unlocked after we free it
-		       */
-		      g_datalist_unlock (datalist);
-
-		      /* the dataset destruction *must* be done
-		       * prior to invocation of the data destroy function
-		       */
-		      if (dataset)
-			g_dataset_destroy_internal (dataset);
-		    }
-		  else
-		    {
-		      g_datalist_unlock (datalist);
-		    }
-
-		  /* We found and removed an old value
-		   * the GData struct *must* already be unlinked
-		   * when invoking the destroy function.
-		   * we use (new_data==NULL && new_destroy_func!=NULL) as
-		   * a special hint combination to "steal"
-		   * data without destroy notification
+		  G_DATALIST_SET_POINTER (datalist, NULL);
+		  g_free (d);
+		  /* datalist may be situated in dataset, so must not be
+		   * unlocked after we free it
+		   */
+		  g_datalist_unlock (datalist);
+
+		  /* the dataset destruction *must* be done
+		   * prior to invocation of the data destroy function
 		   */
-		  if (old.destroy && !new_destroy_func)
-		    {
-		      if (dataset)
-			G_UNLOCK (g_dataset_global);
-		      old.destroy (old.data);
-		      if (dataset)
-			G_LOCK (g_dataset_global);
-		      old.data = NULL;
-		    }
-
-		  return old.data;
+		  if (dataset)
+		    g_dataset_destroy_internal (dataset);
 		}
-	      data++;
+	      else
+		{
+		  g_datalist_unlock (datalist);
+		}
+
+	      /* We found and removed an old value
+	       * the GData struct *must* already be unlinked
+	       * when invoking the destroy function.
+	       * we use (new_data==NULL && new_destroy_func!=NULL) as
+	       * a special hint combination to "steal"
+	       * data without destroy notification
+	       */
+	      if (old.destroy && !new_destroy_func)
+		{
+		  if (dataset)
+		    G_UNLOCK (g_dataset_global);
+		  old.destroy (old.data);
+		  if (dataset)
+		    G_LOCK (g_dataset_global);
+		  old.data = NULL;
+		}
+
+	      return old.data;
 	    }
 	}
     }
@@ -425,62 +574,42 @@ g_data_set_internal (GData	  **datalist,
       old.data = NULL;
       if (d)
 	{
-	  data = d->data;
-	  data_end = data + d->len;
-	  while (data < data_end)
+	  data = datalist_find (d, key_id);
+	  if (data)
 	    {
-	      if (data->key == key_id)
+	      if (!data->destroy)
 		{
-		  if (!data->destroy)
-		    {
-		      data->data = new_data;
-		      data->destroy = new_destroy_func;
-		      g_datalist_unlock (datalist);
-		    }
-		  else
-		    {
-		      old = *data;
-		      data->data = new_data;
-		      data->destroy = new_destroy_func;
-
-		      g_datalist_unlock (datalist);
-
-		      /* We found and replaced an old value
-		       * the GData struct *must* already be unlinked
-		       * when invoking the destroy function.
-		       */
-		      if (dataset)
-			G_UNLOCK (g_dataset_global);
-		      old.destroy (old.data);
-		      if (dataset)
-			G_LOCK (g_dataset_global);
-		    }
-		  return NULL;
+		  data->data = new_data;
+		  data->destroy = new_destroy_func;
+		  g_datalist_unlock (datalist);
 		}
-	      data++;
+	      else
+		{
+		  old = *data;
+		  data->data = new_data;
+		  data->destroy = new_destroy_func;
+
+		  g_datalist_unlock (datalist);
+
+		  /* We found and replaced an old value
+		   * the GData struct *must* already be unlinked
+		   * when invoking the destroy function.
+		   */
+		  if (dataset)
+		    G_UNLOCK (g_dataset_global);
+		  old.destroy (old.data);
+		  if (dataset)
+		    G_LOCK (g_dataset_global);
+		}
+	      return NULL;
 	    }
 	}
 
       /* The key was not found, insert it */
       old_d = d;
-      if (d == NULL)
-	{
-	  d = g_malloc (sizeof (GData));
-	  d->len = 0;
-	  d->alloc = 1;
-	}
-      else if (d->len == d->alloc)
-	{
-	  d->alloc = d->alloc * 2;
-	  d = g_realloc (d, sizeof (GData) + (d->alloc - 1) * sizeof (GDataElt));
-	}
+      d = datalist_append (d, key_id, new_data, new_destroy_func);
       if (old_d != d)
 	G_DATALIST_SET_POINTER (datalist, d);
-
-      d->data[d->len].key = key_id;
-      d->data[d->len].data = new_data;
-      d->data[d->len].destroy = new_destroy_func;
-      d->len++;
     }
 
   g_datalist_unlock (datalist);
@@ -851,7 +980,7 @@ g_datalist_id_dup_data (GData          **datalist,
   gpointer val = NULL;
   gpointer retval = NULL;
   GData *d;
-  GDataElt *data, *data_end;
+  GDataElt *data;
 
   g_return_val_if_fail (datalist != NULL, NULL);
   g_return_val_if_fail (key_id != 0, NULL);
@@ -861,17 +990,9 @@ g_datalist_id_dup_data (GData          **datalist,
   d = G_DATALIST_GET_POINTER (datalist);
   if (d)
     {
-      data = d->data;
-      data_end = data + d->len - 1;
-      while (data <= data_end)
-        {
-          if (data->key == key_id)
-            {
-              val = data->data;
-              break;
-            }
-          data++;
-        }
+      data = datalist_find (d, key_id);
+      if (data)
+        val = data->data;
     }
 
   if (dup_func)
@@ -922,7 +1043,7 @@ g_datalist_id_replace_data (GData          **datalist,
 {
   gpointer val = NULL;
   GData *d;
-  GDataElt *data, *data_end;
+  GDataElt *data;
 
   g_return_val_if_fail (datalist != NULL, FALSE);
   g_return_val_if_fail (key_id != 0, FALSE);
@@ -933,43 +1054,32 @@ g_datalist_id_replace_data (GData          **datalist,
   g_datalist_lock (datalist);
 
   d = G_DATALIST_GET_POINTER (datalist);
-  if (d)
+  data = d ? datalist_find (d, key_id) : NULL;
+  if (data)
     {
-      data = d->data;
-      data_end = data + d->len - 1;
-      while (data <= data_end)
+      val = data->data;
+      if (val == oldval)
         {
-          if (data->key == key_id)
+          if (old_destroy)
+            *old_destroy = data->destroy;
+          if (newval != NULL)
+            {
+              data->data = newval;
+              data->destroy = destroy;
+            }
+          else
             {
-              val = data->data;
-              if (val == oldval)
+              datalist_remove (d, data);
+
+              /* We don't bother to shrink, but if all data are now gone
+               * we at least free the memory
+               */
+              if (d->len == 0)
                 {
-                  if (old_destroy)
-                    *old_destroy = data->destroy;
-                  if (newval != NULL)
-                    {
-                      data->data = newval;
-                      data->destroy = destroy;
-                    }
-                  else
-                   {
-                     if (data != data_end)
-                       *data = *data_end;
-                     d->len--;
-
-                     /* We don't bother to shrink, but if all data are now gone
-                      * we at least free the memory
-                      */
-                     if (d->len == 0)
-                       {
-                         G_DATALIST_SET_POINTER (datalist, NULL);
-                         g_free (d);
-                       }
-                   }
+                  G_DATALIST_SET_POINTER (datalist, NULL);
+                  g_free (d);
                 }
-              break;
             }
-          data++;
         }
     }
 
@@ -979,24 +1089,9 @@ g_datalist_id_replace_data (GData          **datalist,
 
       /* insert newval */
       old_d = d;
-      if (d == NULL)
-	{
-          d = g_malloc (sizeof (GData));
-          d->len = 0;
-          d->alloc = 1;
-        }
-      else if (d->len == d->alloc)
-        {
-          d->alloc = d->alloc * 2;
-          d = g_realloc (d, sizeof (GData) + (d->alloc - 1) * sizeof (GDataElt));
-        }
+      d = datalist_append (d, key_id, newval, destroy);
       if (old_d != d)
         G_DATALIST_SET_POINTER (datalist, d);
-
-      d->data[d->len].key = key_id;
-      d->data[d->len].data = newval;
-      d->data[d->len].destroy = destroy;
-      d->len++;
     }
 
   g_datalist_unlock (datalist);
@@ -1112,7 +1207,8 @@ g_datalist_foreach (GData	   **datalist,
 		    gpointer         user_data)
 {
   GData *d;
-  int i, j, len;
+  GDataElt *data;
+  int i, len;
   GQuark *keys;
 
   g_return_if_fail (datalist != NULL);
@@ -1137,13 +1233,9 @@ g_datalist_foreach (GData	   **datalist,
       
       if (d == NULL)
 	break;
-      for (j = 0; j < d->len; j++)
-	{
-	  if (d->data[j].key == keys[i]) {
-	    func (d->data[i].key, d->data[i].data, user_data);
-	    break;
-	  }
-	}
+      data = datalist_find (d, keys[i]);
+      if (data)
+	func (data->key, data->data, user_data);
     }
   g_free (keys);
 }
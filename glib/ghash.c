@@ -32,6 +32,10 @@
 
 #include <string.h>  /* memset */
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "ghash.h"
 
 #include "gstrfuncs.h"
@@ -209,6 +213,48 @@
 #define HASH_IS_TOMBSTONE(h_) ((h_) == TOMBSTONE_HASH_VALUE)
 #define HASH_IS_REAL(h_) ((h_) >= 2)
 
+/* Besides the full hash values, the table keeps one control byte per
+ * node, in the style of the "SwissTable" design: 7 bits of the hash
+ * for nodes in use, or one of two special values for unused nodes and
+ * tombstones. Lookups scan the control bytes of CTRL_GROUP_WIDTH
+ * consecutive nodes at once, and only look at the hash values (and
+ * keys) of the nodes whose 7 bits match.
+ *
+ * The control bytes of the first CTRL_GROUP_WIDTH - 1 nodes are
+ * mirrored after the end of the array, so that a group starting at
+ * any node can be loaded without wrapping around.
+ */
+#define CTRL_GROUP_WIDTH 16
+#define CTRL_EMPTY       ((guint8) 0x80)
+#define CTRL_DELETED     ((guint8) 0xfe)
+#define CTRL_H2(h_)      ((guint8) (((h_) * 0x9e3779b1u) >> 25))
+#define CTRL_SIZE(s_)    ((s_) + CTRL_GROUP_WIDTH - 1)
+#define CTRL_IS_FULL(c_) ((c_) < 0x80)
+
+/* Same as HASH_IS_REAL (hashes[i]), but the control byte is usually
+ * in cache already after a lookup.
+ */
+#define NODE_IS_REAL(ht_, i_) (CTRL_IS_FULL ((ht_)->ctrl[i_]))
+
+/* Tables created with g_hash_table_new_int() and friends store the
+ * integer itself in the keys array instead of a pointer to it; the
+ * key handed out to the caller is then the address of that slot.
+ */
+#define KEY_IS_INLINE(ht_) ((ht_)->key_size != 0 && (ht_)->key_size <= GLIB_SIZEOF_VOID_P)
+#define NODE_KEY(ht_, i_)  (KEY_IS_INLINE (ht_) ? (gpointer) &(ht_)->keys[i_] : (ht_)->keys[i_])
+
+/* Integer keys that do not fit into a pointer are copied instead.
+ * The copy belongs to the table, so it is freed even when the entry
+ * is stolen.
+ */
+#define KEY_IS_COPIED(ht_) ((ht_)->key_size > GLIB_SIZEOF_VOID_P)
+
+#if defined (__GNUC__) && (__GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 4))
+#define CTRL_LOWEST_BIT(m_) ((guint) __builtin_ctz (m_))
+#else
+#define CTRL_LOWEST_BIT(m_) ((guint) g_bit_nth_lsf ((m_), -1))
+#endif
+
 struct _GHashTable
 {
   gint             size;
@@ -220,6 +266,7 @@ struct _GHashTable
   gpointer        *keys;
   guint           *hashes;
   gpointer        *values;
+  guint8          *ctrl;
 
   GHashFunc        hash_func;
   GEqualFunc       key_equal_func;
@@ -234,6 +281,7 @@ struct _GHashTable
 #endif
   GDestroyNotify   key_destroy_func;
   GDestroyNotify   value_destroy_func;
+  guint8           key_size;   /* size of copied integer keys, or 0 */
 };
 
 typedef struct
@@ -327,6 +375,161 @@ g_hash_table_set_shift_from_size (GHashTable *hash_table, gint size)
   g_hash_table_set_shift (hash_table, shift);
 }
 
+/* The group functions return a bitmask with bit n set if the control
+ * byte of node n of the group matches.
+ */
+#ifdef __SSE2__
+
+static inline guint
+ctrl_group_match (const guint8 *group,
+                  guint8        h2)
+{
+  __m128i ctrl = _mm_loadu_si128 ((const __m128i *) group);
+
+  return _mm_movemask_epi8 (_mm_cmpeq_epi8 (ctrl, _mm_set1_epi8 (h2)));
+}
+
+static inline guint
+ctrl_group_match_empty (const guint8 *group)
+{
+  __m128i ctrl = _mm_loadu_si128 ((const __m128i *) group);
+
+  return _mm_movemask_epi8 (_mm_cmpeq_epi8 (ctrl, _mm_set1_epi8 ((gchar) CTRL_EMPTY)));
+}
+
+/* empty or tombstone, the only control bytes with the high bit set */
+static inline guint
+ctrl_group_match_available (const guint8 *group)
+{
+  return _mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i *) group));
+}
+
+#else /* !__SSE2__ */
+
+/* Portable version, working on 8 control bytes per 64-bit word. The
+ * match may report false positives, which is harmless because the
+ * full hash values are compared afterwards.
+ */
+#define CTRL_LSBS G_GUINT64_CONSTANT (0x0101010101010101)
+#define CTRL_MSBS G_GUINT64_CONSTANT (0x8080808080808080)
+
+static inline guint64
+ctrl_load_word (const guint8 *p)
+{
+  guint64 word;
+
+  memcpy (&word, p, sizeof word);
+
+  return GUINT64_FROM_LE (word);
+}
+
+/* gathers the high bits of the 8 bytes of @word into one byte */
+static inline guint
+ctrl_word_to_mask (guint64 word)
+{
+  return (guint) (((word >> 7) * G_GUINT64_CONSTANT (0x0102040810204080)) >> 56);
+}
+
+static inline guint
+ctrl_word_match (guint64 word,
+                 guint8  h2)
+{
+  guint64 x = word ^ (CTRL_LSBS * h2);
+
+  return ctrl_word_to_mask ((x - CTRL_LSBS) & ~x & CTRL_MSBS);
+}
+
+static inline guint
+ctrl_group_match (const guint8 *group,
+                  guint8        h2)
+{
+  return ctrl_word_match (ctrl_load_word (group), h2) |
+         ctrl_word_match (ctrl_load_word (group + 8), h2) << 8;
+}
+
+static inline guint
+ctrl_word_match_empty (guint64 word)
+{
+  return ctrl_word_to_mask (word & (~word << 6) & CTRL_MSBS);
+}
+
+static inline guint
+ctrl_group_match_empty (const guint8 *group)
+{
+  return ctrl_word_match_empty (ctrl_load_word (group)) |
+         ctrl_word_match_empty (ctrl_load_word (group + 8)) << 8;
+}
+
+static inline guint
+ctrl_group_match_available (const guint8 *group)
+{
+  return ctrl_word_to_mask (ctrl_load_word (group) & CTRL_MSBS) |
+         ctrl_word_to_mask (ctrl_load_word (group + 8) & CTRL_MSBS) << 8;
+}
+
+#endif /* !__SSE2__ */
+
+static guint8 *
+g_hash_table_new_ctrl (gint size)
+{
+  guint8 *ctrl;
+
+  ctrl = g_malloc (CTRL_SIZE (size));
+  memset (ctrl, CTRL_EMPTY, CTRL_SIZE (size));
+
+  return ctrl;
+}
+
+static inline void
+g_hash_table_set_ctrl (GHashTable *hash_table,
+                       guint       node_index,
+                       guint8      value)
+{
+  hash_table->ctrl[node_index] = value;
+
+  /* keep the mirrored bytes after the end in sync */
+  if (G_UNLIKELY (node_index < CTRL_GROUP_WIDTH - 1))
+    {
+      guint i;
+
+      for (i = node_index + hash_table->size; i < CTRL_SIZE (hash_table->size); i += hash_table->size)
+        hash_table->ctrl[i] = value;
+    }
+}
+
+/* Turns a pointer to an integer key into the value stored in the
+ * keys array of a table with inline keys.
+ */
+static inline gconstpointer
+g_hash_table_inline_key (GHashTable    *hash_table,
+                         gconstpointer  key)
+{
+  gpointer ikey = NULL;
+
+  memcpy (&ikey, key, hash_table->key_size);
+
+  return ikey;
+}
+
+/* Tables with inline keys keep no hashes array; the hash is cheap to
+ * compute again from the integer itself.
+ */
+static inline guint
+g_hash_table_node_hash (GHashTable *hash_table,
+                        gint        i)
+{
+  guint hash_value;
+
+  if (hash_table->hashes)
+    return hash_table->hashes[i];
+
+  hash_value = hash_table->hash_func (&hash_table->keys[i]);
+  if (G_UNLIKELY (!HASH_IS_REAL (hash_value)))
+    hash_value = 2;
+
+  return hash_value;
+}
+
 /*
  * g_hash_table_lookup_node:
  * @hash_table: our #GHashTable
@@ -356,11 +559,11 @@ g_hash_table_lookup_node (GHashTable    *hash_table,
                           guint         *hash_return)
 {
   guint node_index;
-  guint node_hash;
   guint hash_value;
-  guint first_tombstone = 0;
-  gboolean have_tombstone = FALSE;
+  guint first_available = 0;
+  gboolean have_available = FALSE;
   guint step = 0;
+  guint8 h2;
 
   hash_value = hash_table->hash_func (key);
   if (G_UNLIKELY (!HASH_IS_REAL (hash_value)))
@@ -368,45 +571,93 @@ g_hash_table_lookup_node (GHashTable    *hash_table,
 
   *hash_return = hash_value;
 
+  if (KEY_IS_INLINE (hash_table))
+    key = g_hash_table_inline_key (hash_table, key);
+
+  h2 = CTRL_H2 (hash_value);
   node_index = hash_value % hash_table->mod;
-  node_hash = hash_table->hashes[node_index];
 
-  while (!HASH_IS_UNUSED (node_hash))
+  /* The probe sequence visits groups of nodes at triangular offsets,
+   * which covers the whole table since its size is a power of two.
+   * There is always at least one unused node, so this terminates.
+   */
+  while (TRUE)
     {
-      /* We first check if our full hash values
-       * are equal so we can avoid calling the full-blown
-       * key equality function in most cases.
-       */
-      if (node_hash == hash_value)
-        {
-          gpointer node_key = hash_table->keys[node_index];
+      const guint8 *group = hash_table->ctrl + node_index;
+      guint match;
 
+      for (match = ctrl_group_match (group, h2); match; match &= match - 1)
+        {
+          guint i = (node_index + CTRL_LOWEST_BIT (match)) & hash_table->mask;
+          gpointer node_key = hash_table->keys[i];
+
+          /* Matches by chance are rare, but comparing the full hash
+           * value first is cheaper than calling the key equal
+           * function on them.  Tables with inline keys keep no
+           * hashes, and their keys are cheap to compare anyway.
+           */
           if (hash_table->key_equal_func)
             {
-              if (hash_table->key_equal_func (node_key, key))
-                return node_index;
+              if ((hash_table->hashes == NULL || hash_table->hashes[i] == hash_value) &&
+                  hash_table->key_equal_func (node_key, key))
+                return i;
             }
           else if (node_key == key)
             {
-              return node_index;
+              return i;
             }
         }
-      else if (HASH_IS_TOMBSTONE (node_hash) && !have_tombstone)
+
+      if (!have_available)
         {
-          first_tombstone = node_index;
-          have_tombstone = TRUE;
+          match = ctrl_group_match_available (group);
+          if (match)
+            {
+              first_available = (node_index + CTRL_LOWEST_BIT (match)) & hash_table->mask;
+              have_available = TRUE;
+            }
         }
 
-      step++;
+      if (ctrl_group_match_empty (group))
+        break;
+
+      step += CTRL_GROUP_WIDTH;
       node_index += step;
       node_index &= hash_table->mask;
-      node_hash = hash_table->hashes[node_index];
     }
 
-  if (have_tombstone)
-    return first_tombstone;
+  return first_available;
+}
+
+/*
+ * g_hash_table_find_empty_node:
+ * @hash_table: our #GHashTable
+ * @hash_value: a hash value
+ *
+ * Returns the index of the first unused node in the probe sequence of
+ * @hash_value. Only used to rebuild the table, so there are no
+ * tombstones to consider.
+ */
+static inline guint
+g_hash_table_find_empty_node (GHashTable *hash_table,
+                              guint       hash_value)
+{
+  guint node_index;
+  guint step = 0;
 
-  return node_index;
+  node_index = hash_value % hash_table->mod;
+
+  while (TRUE)
+    {
+      guint match = ctrl_group_match_empty (hash_table->ctrl + node_index);
+
+      if (match)
+        return (node_index + CTRL_LOWEST_BIT (match)) & hash_table->mask;
+
+      step += CTRL_GROUP_WIDTH;
+      node_index += step;
+      node_index &= hash_table->mask;
+    }
 }
 
 /*
@@ -419,7 +670,8 @@ g_hash_table_lookup_node (GHashTable    *hash_table,
  * The node is replaced by a tombstone. No table resize is performed.
  *
  * If @notify is %TRUE then the destroy notify functions are called
- * for the key and value of the hash node.
+ * for the key and value of the hash node.  Keys copied by the table
+ * are freed either way.
  */
 static void
 g_hash_table_remove_node (GHashTable   *hash_table,
@@ -433,7 +685,9 @@ g_hash_table_remove_node (GHashTable   *hash_table,
   value = hash_table->values[i];
 
   /* Erect tombstone */
-  hash_table->hashes[i] = TOMBSTONE_HASH_VALUE;
+  if (hash_table->hashes)
+    hash_table->hashes[i] = TOMBSTONE_HASH_VALUE;
+  g_hash_table_set_ctrl (hash_table, i, CTRL_DELETED);
 
   /* Be GC friendly */
   hash_table->keys[i] = NULL;
@@ -441,7 +695,7 @@ g_hash_table_remove_node (GHashTable   *hash_table,
 
   hash_table->nnodes--;
 
-  if (notify && hash_table->key_destroy_func)
+  if ((notify || KEY_IS_COPIED (hash_table)) && hash_table->key_destroy_func)
     hash_table->key_destroy_func (key);
 
   if (notify && hash_table->value_destroy_func)
@@ -458,7 +712,8 @@ g_hash_table_remove_node (GHashTable   *hash_table,
  * freeing the table entirely, no resize is performed.
  *
  * If @notify is %TRUE then the destroy notify functions are called
- * for the key and value of the hash node.
+ * for the key and value of the hash node.  Keys copied by the table
+ * are freed either way.
  */
 static void
 g_hash_table_remove_all_nodes (GHashTable *hash_table,
@@ -471,11 +726,13 @@ g_hash_table_remove_all_nodes (GHashTable *hash_table,
   hash_table->nnodes = 0;
   hash_table->noccupied = 0;
 
-  if (!notify ||
+  if ((!notify && !KEY_IS_COPIED (hash_table)) ||
       (hash_table->key_destroy_func == NULL &&
        hash_table->value_destroy_func == NULL))
     {
-      memset (hash_table->hashes, 0, hash_table->size * sizeof (guint));
+      if (hash_table->hashes)
+        memset (hash_table->hashes, 0, hash_table->size * sizeof (guint));
+      memset (hash_table->ctrl, CTRL_EMPTY, CTRL_SIZE (hash_table->size));
       memset (hash_table->keys, 0, hash_table->size * sizeof (gpointer));
       memset (hash_table->values, 0, hash_table->size * sizeof (gpointer));
 
@@ -484,24 +741,29 @@ g_hash_table_remove_all_nodes (GHashTable *hash_table,
 
   for (i = 0; i < hash_table->size; i++)
     {
-      if (HASH_IS_REAL (hash_table->hashes[i]))
+      if (NODE_IS_REAL (hash_table, i))
         {
           key = hash_table->keys[i];
           value = hash_table->values[i];
 
-          hash_table->hashes[i] = UNUSED_HASH_VALUE;
+          if (hash_table->hashes)
+            hash_table->hashes[i] = UNUSED_HASH_VALUE;
+          g_hash_table_set_ctrl (hash_table, i, CTRL_EMPTY);
           hash_table->keys[i] = NULL;
           hash_table->values[i] = NULL;
 
-          if (hash_table->key_destroy_func != NULL)
+          if ((notify || KEY_IS_COPIED (hash_table)) &&
+              hash_table->key_destroy_func != NULL)
             hash_table->key_destroy_func (key);
 
-          if (hash_table->value_destroy_func != NULL)
+          if (notify && hash_table->value_destroy_func != NULL)
             hash_table->value_destroy_func (value);
         }
-      else if (HASH_IS_TOMBSTONE (hash_table->hashes[i]))
+      else if (hash_table->ctrl[i] == CTRL_DELETED)
         {
-          hash_table->hashes[i] = UNUSED_HASH_VALUE;
+          if (hash_table->hashes)
+            hash_table->hashes[i] = UNUSED_HASH_VALUE;
+          g_hash_table_set_ctrl (hash_table, i, CTRL_EMPTY);
         }
     }
 }
@@ -525,38 +787,37 @@ g_hash_table_resize (GHashTable *hash_table)
   gpointer *new_keys;
   gpointer *new_values;
   guint *new_hashes;
+  guint8 *old_ctrl;
   gint old_size;
   gint i;
 
   old_size = hash_table->size;
   g_hash_table_set_shift_from_size (hash_table, hash_table->nnodes * 2);
 
+  old_ctrl = hash_table->ctrl;
+  hash_table->ctrl = g_hash_table_new_ctrl (hash_table->size);
+
   new_keys = g_new0 (gpointer, hash_table->size);
   if (hash_table->keys == hash_table->values)
     new_values = new_keys;
   else
     new_values = g_new0 (gpointer, hash_table->size);
-  new_hashes = g_new0 (guint, hash_table->size);
+  new_hashes = hash_table->hashes ? g_new0 (guint, hash_table->size) : NULL;
 
   for (i = 0; i < old_size; i++)
     {
-      guint node_hash = hash_table->hashes[i];
+      guint node_hash;
       guint hash_val;
-      guint step = 0;
 
-      if (!HASH_IS_REAL (node_hash))
+      if (!CTRL_IS_FULL (old_ctrl[i]))
         continue;
 
-      hash_val = node_hash % hash_table->mod;
+      node_hash = g_hash_table_node_hash (hash_table, i);
+      hash_val = g_hash_table_find_empty_node (hash_table, node_hash);
+      g_hash_table_set_ctrl (hash_table, hash_val, CTRL_H2 (node_hash));
 
-      while (!HASH_IS_UNUSED (new_hashes[hash_val]))
-        {
-          step++;
-          hash_val += step;
-          hash_val &= hash_table->mask;
-        }
-
-      new_hashes[hash_val] = hash_table->hashes[i];
+      if (new_hashes)
+        new_hashes[hash_val] = node_hash;
       new_keys[hash_val] = hash_table->keys[i];
       new_values[hash_val] = hash_table->values[i];
     }
@@ -566,6 +827,7 @@ g_hash_table_resize (GHashTable *hash_table)
 
   g_free (hash_table->keys);
   g_free (hash_table->hashes);
+  g_free (old_ctrl);
 
   hash_table->keys = new_keys;
   hash_table->values = new_values;
@@ -662,13 +924,101 @@ g_hash_table_new_full (GHashFunc      hash_func,
 #endif
   hash_table->key_destroy_func   = key_destroy_func;
   hash_table->value_destroy_func = value_destroy_func;
+  hash_table->key_size           = 0;
   hash_table->keys               = g_new0 (gpointer, hash_table->size);
   hash_table->values             = hash_table->keys;
   hash_table->hashes             = g_new0 (guint, hash_table->size);
+  hash_table->ctrl               = g_hash_table_new_ctrl (hash_table->size);
+
+  return hash_table;
+}
+
+static GHashTable *
+g_hash_table_new_integer (GHashFunc      hash_func,
+                          GEqualFunc     key_equal_func,
+                          guint8         key_size,
+                          GDestroyNotify value_destroy_func)
+{
+  GHashTable *hash_table;
+
+  if (key_size > GLIB_SIZEOF_VOID_P)
+    {
+      /* No room in a pointer; store a private copy instead */
+      hash_table = g_hash_table_new_full (hash_func, key_equal_func, g_free, value_destroy_func);
+      hash_table->key_size = key_size;
+
+      return hash_table;
+    }
+
+  hash_table = g_hash_table_new_full (hash_func, NULL, NULL, value_destroy_func);
+  hash_table->key_size = key_size;
+
+  /* The integers in the keys array never look like the values, so
+   * start out with separate arrays, and drop the hashes.
+   */
+  hash_table->values = g_new0 (gpointer, hash_table->size);
+  g_free (hash_table->hashes);
+  hash_table->hashes = NULL;
 
   return hash_table;
 }
 
+/**
+ * g_hash_table_new_int:
+ * @value_destroy_func: (allow-none): a function to free the memory allocated
+ *     for the value used when removing the entry from the #GHashTable, or
+ *     %NULL if you don't want to supply such a function.
+ *
+ * Creates a new #GHashTable with a reference count of 1, for keys
+ * that are #gint values.
+ *
+ * The table behaves like one created with g_int_hash() and
+ * g_int_equal(): keys are passed in as pointers to a #gint. Unlike
+ * with those functions, however, the integer is copied into the
+ * table when a key is inserted, so it need not stay around, and
+ * the table does not need to store a hash value for each key. A
+ * table of this kind needs about half as much memory as one holding
+ * separately allocated keys.
+ *
+ * The keys returned by the hash table (for instance from
+ * g_hash_table_iter_next() or g_hash_table_get_keys()) point into
+ * the table itself and are only valid until it is modified.
+ *
+ * Return value: a new #GHashTable
+ *
+ * Since: 2.38
+ */
+GHashTable *
+g_hash_table_new_int (GDestroyNotify value_destroy_func)
+{
+  return g_hash_table_new_integer (g_int_hash, g_int_equal, sizeof (gint), value_destroy_func);
+}
+
+/**
+ * g_hash_table_new_int64:
+ * @value_destroy_func: (allow-none): a function to free the memory allocated
+ *     for the value used when removing the entry from the #GHashTable, or
+ *     %NULL if you don't want to supply such a function.
+ *
+ * Creates a new #GHashTable with a reference count of 1, for keys
+ * that are #gint64 values.
+ *
+ * This is the same as g_hash_table_new_int(), with the semantics of
+ * g_int64_hash() and g_int64_equal(). On platforms where pointers
+ * are smaller than 64 bits the keys are still copied, but they are
+ * allocated separately. Those copies are freed by the table, also
+ * when an entry is stolen with g_hash_table_steal() and friends.
+ *
+ * Return value: a new #GHashTable
+ *
+ * Since: 2.38
+ */
+GHashTable *
+g_hash_table_new_int64 (GDestroyNotify value_destroy_func)
+{
+  return g_hash_table_new_integer (g_int64_hash, g_int64_equal, sizeof (gint64), value_destroy_func);
+}
+
 /**
  * g_hash_table_iter_init:
  * @iter: an uninitialized #GHashTableIter
@@ -745,10 +1095,10 @@ g_hash_table_iter_next (GHashTableIter *iter,
           return FALSE;
         }
     }
-  while (!HASH_IS_REAL (ri->hash_table->hashes[position]));
+  while (!NODE_IS_REAL (ri->hash_table, position));
 
   if (key != NULL)
-    *key = ri->hash_table->keys[position];
+    *key = NODE_KEY (ri->hash_table, position);
   if (value != NULL)
     *value = ri->hash_table->values[position];
 
@@ -840,12 +1190,12 @@ g_hash_table_insert_node (GHashTable *hash_table,
                           gboolean    reusing_key)
 {
   gboolean already_exists;
-  guint old_hash;
+  guint8 old_ctrl;
   gpointer key_to_free = NULL;
   gpointer value_to_free = NULL;
 
-  old_hash = hash_table->hashes[node_index];
-  already_exists = HASH_IS_REAL (old_hash);
+  old_ctrl = hash_table->ctrl[node_index];
+  already_exists = CTRL_IS_FULL (old_ctrl);
 
   /* Proceed in three steps.  First, deal with the key because it is the
    * most complicated.  Then consider if we need to split the table in
@@ -883,7 +1233,9 @@ g_hash_table_insert_node (GHashTable *hash_table,
     }
   else
     {
-      hash_table->hashes[node_index] = key_hash;
+      if (hash_table->hashes)
+        hash_table->hashes[node_index] = key_hash;
+      g_hash_table_set_ctrl (hash_table, node_index, CTRL_H2 (key_hash));
       hash_table->keys[node_index] = new_key;
     }
 
@@ -902,7 +1254,7 @@ g_hash_table_insert_node (GHashTable *hash_table,
     {
       hash_table->nnodes++;
 
-      if (HASH_IS_UNUSED (old_hash))
+      if (old_ctrl == CTRL_EMPTY)
         {
           /* We replaced an empty node, and not a tombstone */
           hash_table->noccupied++;
@@ -954,7 +1306,7 @@ g_hash_table_iter_replace (GHashTableIter *iter,
   g_return_if_fail (ri->position >= 0);
   g_return_if_fail (ri->position < ri->hash_table->size);
 
-  node_hash = ri->hash_table->hashes[ri->position];
+  node_hash = g_hash_table_node_hash (ri->hash_table, ri->position);
   key = ri->hash_table->keys[ri->position];
 
   g_hash_table_insert_node (ri->hash_table, ri->position, node_hash, key, value, TRUE, TRUE);
@@ -1028,6 +1380,7 @@ g_hash_table_unref (GHashTable *hash_table)
         g_free (hash_table->values);
       g_free (hash_table->keys);
       g_free (hash_table->hashes);
+      g_free (hash_table->ctrl);
       g_slice_free (GHashTable, hash_table);
     }
 }
@@ -1075,7 +1428,7 @@ g_hash_table_lookup (GHashTable    *hash_table,
 
   node_index = g_hash_table_lookup_node (hash_table, key, &node_hash);
 
-  return HASH_IS_REAL (hash_table->hashes[node_index])
+  return NODE_IS_REAL (hash_table, node_index)
     ? hash_table->values[node_index]
     : NULL;
 }
@@ -1111,11 +1464,11 @@ g_hash_table_lookup_extended (GHashTable    *hash_table,
 
   node_index = g_hash_table_lookup_node (hash_table, lookup_key, &node_hash);
 
-  if (!HASH_IS_REAL (hash_table->hashes[node_index]))
+  if (!NODE_IS_REAL (hash_table, node_index))
     return FALSE;
 
   if (orig_key)
-    *orig_key = hash_table->keys[node_index];
+    *orig_key = NODE_KEY (hash_table, node_index);
 
   if (value)
     *value = hash_table->values[node_index];
@@ -1152,6 +1505,14 @@ g_hash_table_insert_internal (GHashTable *hash_table,
 
   node_index = g_hash_table_lookup_node (hash_table, key, &key_hash);
 
+  /* Integer keys are copied; if the copy ends up unused it is
+   * released by the key destroy function like any other key.
+   */
+  if (KEY_IS_INLINE (hash_table))
+    key = (gpointer) g_hash_table_inline_key (hash_table, key);
+  else if (hash_table->key_size != 0)
+    key = g_memdup (key, hash_table->key_size);
+
   g_hash_table_insert_node (hash_table, node_index, key_hash, key, value, keep_new_key, FALSE);
 }
 
@@ -1213,13 +1574,17 @@ g_hash_table_replace (GHashTable *hash_table,
  * corresponding value it is able to be stored more efficiently.  See
  * the discussion in the section description.
  *
+ * For tables created with g_hash_table_new_int() or
+ * g_hash_table_new_int64() the key is copied, and %NULL is stored as
+ * the value; use g_hash_table_contains() to test for membership.
+ *
  * Since: 2.32
  **/
 void
 g_hash_table_add (GHashTable *hash_table,
                   gpointer    key)
 {
-  g_hash_table_insert_internal (hash_table, key, key, TRUE);
+  g_hash_table_insert_internal (hash_table, key, hash_table->key_size ? NULL : key, TRUE);
 }
 
 /**
@@ -1242,7 +1607,7 @@ g_hash_table_contains (GHashTable    *hash_table,
 
   node_index = g_hash_table_lookup_node (hash_table, key, &node_hash);
 
-  return HASH_IS_REAL (hash_table->hashes[node_index]);
+  return NODE_IS_REAL (hash_table, node_index);
 }
 
 /*
@@ -1270,7 +1635,7 @@ g_hash_table_remove_internal (GHashTable    *hash_table,
 
   node_index = g_hash_table_lookup_node (hash_table, key, &node_hash);
 
-  if (!HASH_IS_REAL (hash_table->hashes[node_index]))
+  if (!NODE_IS_REAL (hash_table, node_index))
     return FALSE;
 
   g_hash_table_remove_node (hash_table, node_index, notify);
@@ -1402,11 +1767,10 @@ g_hash_table_foreach_remove_or_steal (GHashTable *hash_table,
 
   for (i = 0; i < hash_table->size; i++)
     {
-      guint node_hash = hash_table->hashes[i];
-      gpointer node_key = hash_table->keys[i];
+      gpointer node_key = NODE_KEY (hash_table, i);
       gpointer node_value = hash_table->values[i];
 
-      if (HASH_IS_REAL (node_hash) &&
+      if (NODE_IS_REAL (hash_table, i) &&
           (* func) (node_key, node_value, user_data))
         {
           g_hash_table_remove_node (hash_table, i, notify);
@@ -1518,11 +1882,10 @@ g_hash_table_foreach (GHashTable *hash_table,
 
   for (i = 0; i < hash_table->size; i++)
     {
-      guint node_hash = hash_table->hashes[i];
-      gpointer node_key = hash_table->keys[i];
+      gpointer node_key = NODE_KEY (hash_table, i);
       gpointer node_value = hash_table->values[i];
 
-      if (HASH_IS_REAL (node_hash))
+      if (NODE_IS_REAL (hash_table, i))
         (* func) (node_key, node_value, user_data);
 
 #ifndef G_DISABLE_ASSERT
@@ -1579,11 +1942,10 @@ g_hash_table_find (GHashTable *hash_table,
 
   for (i = 0; i < hash_table->size; i++)
     {
-      guint node_hash = hash_table->hashes[i];
-      gpointer node_key = hash_table->keys[i];
+      gpointer node_key = NODE_KEY (hash_table, i);
       gpointer node_value = hash_table->values[i];
 
-      if (HASH_IS_REAL (node_hash))
+      if (NODE_IS_REAL (hash_table, i))
         match = predicate (node_key, node_value, user_data);
 
 #ifndef G_DISABLE_ASSERT
@@ -1638,8 +2000,8 @@ g_hash_table_get_keys (GHashTable *hash_table)
   retval = NULL;
   for (i = 0; i < hash_table->size; i++)
     {
-      if (HASH_IS_REAL (hash_table->hashes[i]))
-        retval = g_list_prepend (retval, hash_table->keys[i]);
+      if (NODE_IS_REAL (hash_table, i))
+        retval = g_list_prepend (retval, NODE_KEY (hash_table, i));
     }
 
   return retval;
@@ -1670,7 +2032,7 @@ g_hash_table_get_values (GHashTable *hash_table)
   retval = NULL;
   for (i = 0; i < hash_table->size; i++)
     {
-      if (HASH_IS_REAL (hash_table->hashes[i]))
+      if (NODE_IS_REAL (hash_table, i))
         retval = g_list_prepend (retval, hash_table->values[i]);
     }
 
@@ -63,6 +63,10 @@ GHashTable* g_hash_table_new_full          (GHashFunc       hash_func,
                                             GEqualFunc      key_equal_func,
                                             GDestroyNotify  key_destroy_func,
                                             GDestroyNotify  value_destroy_func);
+GLIB_AVAILABLE_IN_2_38
+GHashTable* g_hash_table_new_int           (GDestroyNotify  value_destroy_func);
+GLIB_AVAILABLE_IN_2_38
+GHashTable* g_hash_table_new_int64         (GDestroyNotify  value_destroy_func);
 GLIB_AVAILABLE_IN_ALL
 void        g_hash_table_destroy           (GHashTable     *hash_table);
 GLIB_AVAILABLE_IN_ALL
@@ -43,7 +43,8 @@ glib__private__ (void)
     g_get_worker_context,
 
     g_check_setuid,
-    g_main_context_new_with_next_id
+    g_main_context_new_with_next_id,
+    g_main_context_new_with_epoll
   };
 
   return &table;
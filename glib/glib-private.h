@@ -26,6 +26,7 @@
 GMainContext *          g_get_worker_context            (void);
 gboolean                g_check_setuid                  (void);
 GMainContext *          g_main_context_new_with_next_id (guint next_id);
+GMainContext *          g_main_context_new_with_epoll   (gboolean use_epoll);
 
 #ifdef G_OS_WIN32
 gchar *_glib_get_dll_directory (void);
@@ -49,6 +50,7 @@ typedef struct {
 
   gboolean              (* g_check_setuid)              (void);
   GMainContext *        (* g_main_context_new_with_next_id) (guint next_id);
+  GMainContext *        (* g_main_context_new_with_epoll) (gboolean use_epoll);
   /* Add other private functions here, initialize them in glib-private.c */
 } GLibPrivateVTable;
 
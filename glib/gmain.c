@@ -53,6 +53,9 @@
 #ifdef HAVE_EVENTFD
 #include <sys/eventfd.h>
 #endif
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 #endif
 
 #include <signal.h>
@@ -202,6 +205,11 @@ struct _GSourceList
 {
   GSource *head, *tail;
   gint priority;
+
+  /* The subset of sources that g_main_context_prepare() and
+   * g_main_context_check() have to look at; see source_is_timer().
+   */
+  GSource *polled_head, *polled_tail;
 };
 
 typedef struct _GMainWaiter GMainWaiter;
@@ -245,6 +253,8 @@ struct _GMainContext
   GList *source_lists;
   gint in_check_or_prepare;
 
+  GPtrArray *timers;            /* min-heap on ready_time, see source_is_timer() */
+
   GPollRec *poll_records, *poll_records_tail;
   guint n_poll_records;
   GPollFD *cached_poll_array;
@@ -261,6 +271,14 @@ struct _GMainContext
 
   gint64   time;
   gboolean time_is_fresh;
+
+  /* State of the epoll backend (see g_main_context_epoll()).  The
+   * epoll set mirrors poll_records; epoll_fds is %NULL if the backend
+   * is not in use for this context.
+   */
+  gint epoll_fd;
+  GHashTable *epoll_fds;        /* fd -> GPollRec chain */
+  GPtrArray *epoll_ready;       /* GPollRecs with revents set by epoll */
 };
 
 struct _GSourceCallback
@@ -310,6 +328,10 @@ struct _GPollRec
   GPollRec *prev;
   GPollRec *next;
   gint priority;
+
+  /* Other records for the same fd, if the epoll backend is in use */
+  GPollRec *epoll_next;
+  gboolean epoll_ready;
 };
 
 struct _GSourcePrivate
@@ -323,12 +345,21 @@ struct _GSourcePrivate
    * let it remain empty on Windows) to avoid #ifdef all over the place.
    */
   GSList *fds;
+
+  /* Links in the list of polled sources of the GSourceList */
+  GSource *polled_prev;
+  GSource *polled_next;
+  gboolean is_polled;
+
+  gboolean is_timer;
+  guint timer_index;            /* position in context->timers + 1, or 0 */
 };
 
 typedef struct _GSourceIter
 {
   GMainContext *context;
   gboolean may_modify;
+  gboolean polled_only;
   GList *current_list;
   GSource *source;
 } GSourceIter;
@@ -362,6 +393,14 @@ static void g_source_set_priority_unlocked      (GSource      *source,
 						 gint          priority);
 static void g_child_source_remove_internal      (GSource      *child_source,
                                                  GMainContext *context);
+static void g_source_make_polled                (GSource      *source,
+                                                 GMainContext *context);
+static void timer_heap_insert                   (GMainContext *context,
+                                                 GSource      *source);
+static void timer_heap_remove                   (GMainContext *context,
+                                                 GSource      *source);
+static void timer_heap_update                   (GMainContext *context,
+                                                 GSource      *source);
 
 static void g_main_context_poll                 (GMainContext *context,
 						 gint          timeout,
@@ -373,10 +412,25 @@ static void g_main_context_add_poll_unlocked    (GMainContext *context,
 						 GPollFD      *fd);
 static void g_main_context_remove_poll_unlocked (GMainContext *context,
 						 GPollFD      *fd);
+#ifdef HAVE_EPOLL
+static void g_main_context_epoll_init           (GMainContext *context);
+static void g_main_context_epoll_free           (GMainContext *context);
+static void g_main_context_epoll_add            (GMainContext *context,
+						 GPollRec     *pollrec);
+static gboolean g_main_context_epoll_remove     (GMainContext *context,
+						 GPollFD      *fd);
+static void g_main_context_epoll_update         (GMainContext *context,
+						 gint          fd);
+static void g_main_context_epoll                (GMainContext *context,
+						 gint          timeout,
+						 gint          priority);
+#endif
 
 static void     g_source_iter_init  (GSourceIter   *iter,
 				     GMainContext  *context,
 				     gboolean       may_modify);
+static void     g_source_iter_init_polled (GSourceIter  *iter,
+                                           GMainContext *context);
 static gboolean g_source_iter_next  (GSourceIter   *iter,
 				     GSource      **source);
 static void     g_source_iter_clear (GSourceIter   *iter);
@@ -415,6 +469,10 @@ static GMainContext *glib_worker_context;
 G_LOCK_DEFINE_STATIC (main_loop);
 static GMainContext *default_main_context;
 
+#ifdef HAVE_EPOLL
+static gboolean g_main_use_epoll = FALSE;
+#endif
+
 #ifndef G_OS_WIN32
 
 
@@ -544,8 +602,15 @@ g_main_context_unref (GMainContext *context)
   g_mutex_clear (&context->mutex);
 
   g_ptr_array_free (context->pending_dispatches, TRUE);
+  g_ptr_array_free (context->timers, TRUE);
   g_free (context->cached_poll_array);
 
+#ifdef HAVE_EPOLL
+  g_main_context_epoll_free (context);
+  if (context->epoll_fd >= 0)
+    close (context->epoll_fd);
+#endif
+
   poll_rec_list_free (context, context->poll_records);
 
   g_wakeup_free (context->wakeup);
@@ -566,10 +631,39 @@ g_main_context_new_with_next_id (guint next_id)
   return ret;
 }
 
+/* Helper function used by the mainloop tests to compare the poll()
+ * and epoll backends independently of G_MAIN_POLL_BACKEND.
+ */
+GMainContext *
+g_main_context_new_with_epoll (gboolean use_epoll)
+{
+  GMainContext *ret = g_main_context_new ();
+
+#ifdef HAVE_EPOLL
+  LOCK_CONTEXT (ret);
+  if (use_epoll && ret->epoll_fds == NULL)
+    g_main_context_epoll_init (ret);
+  else if (!use_epoll && ret->epoll_fds != NULL)
+    {
+      g_main_context_epoll_free (ret);
+      close (ret->epoll_fd);
+      ret->epoll_fd = -1;
+    }
+  UNLOCK_CONTEXT (ret);
+#endif
+
+  return ret;
+}
+
 /**
  * g_main_context_new:
  * 
  * Creates a new #GMainContext structure.
+ *
+ * On Linux, the file descriptors of the new context can be watched
+ * with epoll instead of poll() by setting the
+ * <envar>G_MAIN_POLL_BACKEND</envar> environment variable to
+ * <literal>epoll</literal>.
  * 
  * Return value: the new #GMainContext
  **/
@@ -585,6 +679,14 @@ g_main_context_new (void)
       if (getenv ("G_MAIN_POLL_DEBUG") != NULL)
         _g_main_poll_debug = TRUE;
 #endif
+#ifdef HAVE_EPOLL
+      {
+        const gchar *backend = getenv ("G_MAIN_POLL_BACKEND");
+
+        if (backend != NULL && strcmp (backend, "epoll") == 0)
+          g_main_use_epoll = TRUE;
+      }
+#endif
 
       g_once_init_leave (&initialised, TRUE);
     }
@@ -609,8 +711,15 @@ g_main_context_new (void)
   context->cached_poll_array_size = 0;
   
   context->pending_dispatches = g_ptr_array_new ();
+  context->timers = g_ptr_array_new ();
   
   context->time_is_fresh = FALSE;
+
+  context->epoll_fd = -1;
+#ifdef HAVE_EPOLL
+  if (g_main_use_epoll)
+    g_main_context_epoll_init (context);
+#endif
   
   context->wakeup = g_wakeup_new ();
   g_wakeup_get_pollfd (context->wakeup, &context->wake_up_rec);
@@ -878,6 +987,18 @@ g_source_iter_init (GSourceIter  *iter,
   iter->current_list = NULL;
   iter->source = NULL;
   iter->may_modify = may_modify;
+  iter->polled_only = FALSE;
+}
+
+/* Like g_source_iter_init() with @may_modify, but only visits the
+ * sources that have to be prepared and checked on each iteration.
+ */
+static void
+g_source_iter_init_polled (GSourceIter  *iter,
+                           GMainContext *context)
+{
+  g_source_iter_init (iter, context, TRUE);
+  iter->polled_only = TRUE;
 }
 
 /* Holds context's lock */
@@ -886,23 +1007,33 @@ g_source_iter_next (GSourceIter *iter, GSource **source)
 {
   GSource *next_source;
 
-  if (iter->source)
-    next_source = iter->source->next;
-  else
+  if (!iter->source)
     next_source = NULL;
+  else if (iter->polled_only)
+    next_source = iter->source->priv->polled_next;
+  else
+    next_source = iter->source->next;
 
-  if (!next_source)
+  /* A GSourceList always has a head, but its list of polled sources
+   * may be empty.
+   */
+  while (!next_source)
     {
       if (iter->current_list)
 	iter->current_list = iter->current_list->next;
       else
 	iter->current_list = iter->context->source_lists;
 
-      if (iter->current_list)
+      if (!iter->current_list)
+        break;
+      else
 	{
 	  GSourceList *source_list = iter->current_list->data;
 
-	  next_source = source_list->head;
+	  if (iter->polled_only)
+	    next_source = source_list->polled_head;
+	  else
+	    next_source = source_list->head;
 	}
     }
 
@@ -985,6 +1116,86 @@ find_source_list_for_priority (GMainContext *context,
   return source_list;
 }
 
+/* A timer source is one that can only become ready through its ready
+ * time: it has no prepare or check function, no fds and is not part of
+ * a parent/child relationship.  GTimeoutSource is the typical example.
+ *
+ * Instead of being looked at on every iteration, timer sources are kept
+ * in a min-heap on their ready time, so finding the ones that are due,
+ * and the timeout for the next poll, doesn't depend on how many there
+ * are.  Once due, a timer source is flagged as ready and added to the
+ * list of polled sources of its priority, where it stays until it is
+ * dispatched.
+ */
+static gboolean
+source_is_timer (GSource *source)
+{
+  return source->source_funcs->prepare == NULL &&
+         source->source_funcs->check == NULL &&
+         source->poll_fds == NULL &&
+         source->priv->fds == NULL &&
+         source->priv->child_sources == NULL &&
+         source->priv->parent_source == NULL;
+}
+
+/* Holds context's lock
+ */
+static void
+source_link_polled (GSource     *source,
+                    GSourceList *source_list)
+{
+  GSource *prev, *next;
+
+  if (source->priv->parent_source)
+    {
+      /* Put the source immediately before its parent, which is always
+       * polled itself.
+       */
+      next = source->priv->parent_source;
+      prev = next->priv->polled_prev;
+    }
+  else
+    {
+      prev = source_list->polled_tail;
+      next = NULL;
+    }
+
+  source->priv->polled_next = next;
+  if (next)
+    next->priv->polled_prev = source;
+  else
+    source_list->polled_tail = source;
+
+  source->priv->polled_prev = prev;
+  if (prev)
+    prev->priv->polled_next = source;
+  else
+    source_list->polled_head = source;
+
+  source->priv->is_polled = TRUE;
+}
+
+/* Holds context's lock
+ */
+static void
+source_unlink_polled (GSource     *source,
+                      GSourceList *source_list)
+{
+  if (source->priv->polled_prev)
+    source->priv->polled_prev->priv->polled_next = source->priv->polled_next;
+  else
+    source_list->polled_head = source->priv->polled_next;
+
+  if (source->priv->polled_next)
+    source->priv->polled_next->priv->polled_prev = source->priv->polled_prev;
+  else
+    source_list->polled_tail = source->priv->polled_prev;
+
+  source->priv->polled_prev = NULL;
+  source->priv->polled_next = NULL;
+  source->priv->is_polled = FALSE;
+}
+
 /* Holds context's lock
  */
 static void
@@ -1021,6 +1232,15 @@ source_add_to_context (GSource      *source,
     prev->next = source;
   else
     source_list->head = source;
+
+  source->priv->is_timer = source_is_timer (source);
+
+  if (!source->priv->is_timer || (source->flags & G_SOURCE_READY))
+    source_link_polled (source, source_list);
+
+  if (source->priv->is_timer && source->priv->ready_time != -1 &&
+      !SOURCE_BLOCKED (source) && !SOURCE_DESTROYED (source))
+    timer_heap_insert (context, source);
 }
 
 /* Holds context's lock
@@ -1034,6 +1254,12 @@ source_remove_from_context (GSource      *source,
   source_list = find_source_list_for_priority (context, source->priority, FALSE);
   g_return_if_fail (source_list != NULL);
 
+  if (source->priv->is_polled)
+    source_unlink_polled (source, source_list);
+
+  if (source->priv->timer_index)
+    timer_heap_remove (context, source);
+
   if (source->prev)
     source->prev->next = source->next;
   else
@@ -1059,6 +1285,209 @@ source_remove_from_context (GSource      *source,
   
 }
 
+/* Holds context's lock
+ *
+ * Called when something is about to be done to @source that makes it
+ * stop qualifying as a timer source (see source_is_timer()).
+ */
+static void
+g_source_make_polled (GSource      *source,
+                      GMainContext *context)
+{
+  GSourceList *source_list;
+
+  if (!source->priv->is_timer)
+    return;
+
+  source->priv->is_timer = FALSE;
+
+  if (source->priv->timer_index)
+    timer_heap_remove (context, source);
+
+  if (!source->priv->is_polled)
+    {
+      source_list = find_source_list_for_priority (context, source->priority, FALSE);
+      source_link_polled (source, source_list);
+    }
+}
+
+/* The timer heap.  Each source in context->timers knows its own
+ * position (plus one) so that it can be removed or moved around when
+ * its ready time changes without searching for it.
+ */
+
+#define TIMER_HEAP_SOURCE(context, i) ((GSource *) (context)->timers->pdata[i])
+
+static inline void
+timer_heap_set (GMainContext *context,
+                guint         i,
+                GSource      *source)
+{
+  context->timers->pdata[i] = source;
+  source->priv->timer_index = i + 1;
+}
+
+/* Holds context's lock */
+static void
+timer_heap_sift_up (GMainContext *context,
+                    guint         i)
+{
+  GSource *source = TIMER_HEAP_SOURCE (context, i);
+
+  while (i > 0)
+    {
+      guint parent = (i - 1) / 2;
+
+      if (TIMER_HEAP_SOURCE (context, parent)->priv->ready_time <= source->priv->ready_time)
+        break;
+
+      timer_heap_set (context, i, TIMER_HEAP_SOURCE (context, parent));
+      i = parent;
+    }
+
+  timer_heap_set (context, i, source);
+}
+
+/* Holds context's lock */
+static void
+timer_heap_sift_down (GMainContext *context,
+                      guint         i)
+{
+  GSource *source = TIMER_HEAP_SOURCE (context, i);
+  guint n = context->timers->len;
+
+  while (2 * i + 1 < n)
+    {
+      guint child = 2 * i + 1;
+
+      if (child + 1 < n &&
+          TIMER_HEAP_SOURCE (context, child + 1)->priv->ready_time <
+          TIMER_HEAP_SOURCE (context, child)->priv->ready_time)
+        child++;
+
+      if (source->priv->ready_time <= TIMER_HEAP_SOURCE (context, child)->priv->ready_time)
+        break;
+
+      timer_heap_set (context, i, TIMER_HEAP_SOURCE (context, child));
+      i = child;
+    }
+
+  timer_heap_set (context, i, source);
+}
+
+/* Holds context's lock */
+static void
+timer_heap_insert (GMainContext *context,
+                   GSource      *source)
+{
+  if (source->priv->timer_index)
+    return;
+
+  g_ptr_array_add (context->timers, source);
+  timer_heap_sift_up (context, context->timers->len - 1);
+}
+
+/* Holds context's lock */
+static void
+timer_heap_remove (GMainContext *context,
+                   GSource      *source)
+{
+  GSource *last;
+  guint i;
+
+  if (!source->priv->timer_index)
+    return;
+
+  i = source->priv->timer_index - 1;
+  source->priv->timer_index = 0;
+
+  last = g_ptr_array_remove_index (context->timers, context->timers->len - 1);
+  if (last == source)
+    return;
+
+  timer_heap_set (context, i, last);
+  timer_heap_update (context, last);
+}
+
+/* Holds context's lock */
+static void
+timer_heap_update (GMainContext *context,
+                   GSource      *source)
+{
+  guint i = source->priv->timer_index - 1;
+
+  if (i > 0 && TIMER_HEAP_SOURCE (context, (i - 1) / 2)->priv->ready_time > source->priv->ready_time)
+    timer_heap_sift_up (context, i);
+  else
+    timer_heap_sift_down (context, i);
+}
+
+/* Holds context's lock
+ *
+ * Flags all timer sources whose ready time has passed as ready, which
+ * puts them on the list of polled sources, and returns the earliest
+ * ready time of the remaining ones (or -1).  Only the part of the heap
+ * that is due is visited.
+ */
+static gint64
+timer_heap_collect (GMainContext *context,
+                    guint         i)
+{
+  GSource *source;
+  gint64 next, child_next;
+
+  if (i >= context->timers->len)
+    return -1;
+
+  source = TIMER_HEAP_SOURCE (context, i);
+
+  if (source->priv->ready_time > context->time)
+    return source->priv->ready_time;
+
+  if (!(source->flags & G_SOURCE_READY))
+    {
+      source->flags |= G_SOURCE_READY;
+
+      if (!source->priv->is_polled)
+        source_link_polled (source,
+                            find_source_list_for_priority (context, source->priority, FALSE));
+    }
+
+  next = timer_heap_collect (context, 2 * i + 1);
+  child_next = timer_heap_collect (context, 2 * i + 2);
+
+  if (next < 0 || (child_next >= 0 && child_next < next))
+    next = child_next;
+
+  return next;
+}
+
+/* Holds context's lock
+ *
+ * Returns the timeout until the next timer source is due, or -1.
+ */
+static gint
+g_main_context_check_timers (GMainContext *context)
+{
+  gint64 next;
+
+  if (context->timers->len == 0)
+    return -1;
+
+  if (!context->time_is_fresh)
+    {
+      context->time = g_get_monotonic_time ();
+      context->time_is_fresh = TRUE;
+    }
+
+  next = timer_heap_collect (context, 0);
+  if (next < 0)
+    return -1;
+
+  /* rounding down will lead to spinning, so always round up */
+  return MIN ((next - context->time + 999) / 1000, G_MAXINT);
+}
+
 static void
 assign_source_id_unlocked (GMainContext   *context,
                            GSource        *source)
@@ -1196,6 +1625,9 @@ g_source_destroy_internal (GSource      *source,
       
       source->flags &= ~G_HOOK_FLAG_ACTIVE;
 
+      if (source->priv->timer_index)
+        timer_heap_remove (context, source);
+
       old_cb_data = source->callback_data;
       old_cb_funcs = source->callback_funcs;
 
@@ -1340,6 +1772,9 @@ g_source_add_poll (GSource *source,
   if (context)
     LOCK_CONTEXT (context);
   
+  if (context)
+    g_source_make_polled (source, context);
+
   source->poll_fds = g_slist_prepend (source->poll_fds, fd);
 
   if (context)
@@ -1421,7 +1856,10 @@ g_source_add_child_source (GSource *source,
   context = source->context;
 
   if (context)
-    LOCK_CONTEXT (context);
+    {
+      LOCK_CONTEXT (context);
+      g_source_make_polled (source, context);
+    }
 
   source->priv->child_sources = g_slist_prepend (source->priv->child_sources,
 						 g_source_ref (child_source));
@@ -1772,6 +2210,16 @@ g_source_set_ready_time (GSource *source,
 
   if (context)
     {
+      if (source->priv->is_timer && !SOURCE_BLOCKED (source) && !SOURCE_DESTROYED (source))
+        {
+          if (ready_time == -1)
+            timer_heap_remove (context, source);
+          else if (source->priv->timer_index)
+            timer_heap_update (context, source);
+          else
+            timer_heap_insert (context, source);
+        }
+
       /* Quite likely that we need to change the timeout on the poll */
       if (!SOURCE_BLOCKED (source))
         g_wakeup_signal (context->wakeup);
@@ -2302,6 +2750,9 @@ g_source_add_unix_fd (GSource      *source,
   if (context)
     LOCK_CONTEXT (context);
 
+  if (context)
+    g_source_make_polled (source, context);
+
   source->priv->fds = g_slist_prepend (source->priv->fds, poll_fd);
 
   if (context)
@@ -2348,7 +2799,15 @@ g_source_modify_unix_fd (GSource      *source,
   poll_fd->events = new_events;
 
   if (context)
-    g_main_context_wakeup (context);
+    {
+#ifdef HAVE_EPOLL
+      LOCK_CONTEXT (context);
+      if (context->epoll_fds)
+        g_main_context_epoll_update (context, poll_fd->fd);
+      UNLOCK_CONTEXT (context);
+#endif
+      g_main_context_wakeup (context);
+    }
 }
 
 /**
@@ -2947,6 +3406,9 @@ block_source (GSource *source)
 
   if (source->context)
     {
+      if (source->priv->timer_index)
+        timer_heap_remove (source->context, source);
+
       tmp_list = source->poll_fds;
       while (tmp_list)
         {
@@ -2980,6 +3442,9 @@ unblock_source (GSource *source)
   
   source->flags &= ~G_SOURCE_BLOCKED;
 
+  if (source->priv->is_timer && source->priv->ready_time != -1)
+    timer_heap_insert (source->context, source);
+
   tmp_list = source->poll_fds;
   while (tmp_list)
     {
@@ -3017,6 +3482,11 @@ g_main_dispatch (GMainContext *context)
 
       source->flags &= ~G_SOURCE_READY;
 
+      /* Timer sources only stay in the polled list while ready */
+      if (source->priv->is_timer && source->priv->is_polled && source->context)
+        source_unlink_polled (source,
+                              find_source_list_for_priority (context, source->priority, FALSE));
+
       if (!SOURCE_DESTROYED (source))
 	{
 	  gboolean was_in_call;
@@ -3311,9 +3781,9 @@ g_main_context_prepare (GMainContext *context,
   
   /* Prepare all sources */
 
-  context->timeout = -1;
+  context->timeout = g_main_context_check_timers (context);
   
-  g_source_iter_init (&iter, context, TRUE);
+  g_source_iter_init_polled (&iter, context);
   while (g_source_iter_next (&iter, &source))
     {
       gint source_timeout = -1;
@@ -3532,7 +4002,9 @@ g_main_context_check (GMainContext *context,
       i++;
     }
 
-  g_source_iter_init (&iter, context, TRUE);
+  g_main_context_check_timers (context);
+
+  g_source_iter_init_polled (&iter, context);
   while (g_source_iter_next (&iter, &source))
     {
       if (SOURCE_DESTROYED (source) || SOURCE_BLOCKED (source))
@@ -3656,6 +4128,7 @@ g_main_context_iterate (GMainContext *context,
   gboolean some_ready;
   gint nfds, allocated_nfds;
   GPollFD *fds = NULL;
+  gboolean use_epoll;
 
   UNLOCK_CONTEXT (context);
 
@@ -3677,8 +4150,11 @@ g_main_context_iterate (GMainContext *context,
     }
   else
     LOCK_CONTEXT (context);
-  
-  if (!context->cached_poll_array)
+
+  /* The epoll backend can only stand in for the default poll function */
+  use_epoll = context->epoll_fds != NULL && context->poll_func == g_poll;
+
+  if (!use_epoll && !context->cached_poll_array)
     {
       context->cached_poll_array_size = context->n_poll_records;
       context->cached_poll_array = g_new (GPollFD, context->n_poll_records);
@@ -3690,23 +4166,49 @@ g_main_context_iterate (GMainContext *context,
   UNLOCK_CONTEXT (context);
 
   g_main_context_prepare (context, &max_priority); 
-  
-  while ((nfds = g_main_context_query (context, max_priority, &timeout, fds, 
-				       allocated_nfds)) > allocated_nfds)
+
+#ifdef HAVE_EPOLL
+  if (use_epoll)
     {
+      /* The fds are registered with the kernel already, so there is
+       * no array to build; just pick up the timeout the way
+       * g_main_context_query() would.
+       */
       LOCK_CONTEXT (context);
-      g_free (fds);
-      context->cached_poll_array_size = allocated_nfds = nfds;
-      context->cached_poll_array = fds = g_new (GPollFD, nfds);
+      context->poll_changed = FALSE;
+      timeout = context->timeout;
+      if (timeout != 0)
+        context->time_is_fresh = FALSE;
       UNLOCK_CONTEXT (context);
+
+      if (!block)
+        timeout = 0;
+
+      g_main_context_epoll (context, timeout, max_priority);
+
+      /* The revents have been stored in the GPollFDs directly */
+      some_ready = g_main_context_check (context, max_priority, NULL, 0);
     }
+  else
+#endif
+    {
+      while ((nfds = g_main_context_query (context, max_priority, &timeout, fds, 
+                                           allocated_nfds)) > allocated_nfds)
+        {
+          LOCK_CONTEXT (context);
+          g_free (fds);
+          context->cached_poll_array_size = allocated_nfds = nfds;
+          context->cached_poll_array = fds = g_new (GPollFD, nfds);
+          UNLOCK_CONTEXT (context);
+        }
 
-  if (!block)
-    timeout = 0;
+      if (!block)
+        timeout = 0;
   
-  g_main_context_poll (context, timeout, max_priority, fds, nfds);
+      g_main_context_poll (context, timeout, max_priority, fds, nfds);
   
-  some_ready = g_main_context_check (context, max_priority, fds, nfds);
+      some_ready = g_main_context_check (context, max_priority, fds, nfds);
+    }
   
   if (dispatch)
     g_main_context_dispatch (context);
@@ -4125,8 +4627,16 @@ g_main_context_add_poll_unlocked (GMainContext *context,
   else 
     context->poll_records_tail = newrec;
 
+  newrec->epoll_next = NULL;
+  newrec->epoll_ready = FALSE;
+
   context->n_poll_records++;
 
+#ifdef HAVE_EPOLL
+  if (context->epoll_fds)
+    g_main_context_epoll_add (context, newrec);
+#endif
+
   context->poll_changed = TRUE;
 
   /* Now wake up the main loop if it is waiting in the poll() */
@@ -4162,6 +4672,20 @@ g_main_context_remove_poll_unlocked (GMainContext *context,
 {
   GPollRec *pollrec, *prevrec, *nextrec;
 
+#ifdef HAVE_EPOLL
+  /* The epoll backend finds the record without walking the list */
+  if (context->epoll_fds)
+    {
+      if (g_main_context_epoll_remove (context, fd))
+        return;
+
+      /* The fd number was changed after the fd was added, so the epoll
+       * set can't be kept in sync any longer.
+       */
+      g_main_context_epoll_free (context);
+    }
+#endif
+
   prevrec = NULL;
   pollrec = context->poll_records;
 
@@ -4195,6 +4719,279 @@ g_main_context_remove_poll_unlocked (GMainContext *context,
   g_wakeup_signal (context->wakeup);
 }
 
+#ifdef HAVE_EPOLL
+/* The epoll backend.
+ *
+ * Instead of handing the whole set of poll records to poll() on every
+ * iteration, each fd is registered with a per-context epoll instance
+ * once, when it is added with g_main_context_add_poll_unlocked(), and
+ * unregistered when it is removed.  Polling then only reports the fds
+ * that are actually ready, and their revents are stored straight into
+ * the GPollFDs the sources handed us, so g_main_context_query() and
+ * the copying loop in g_main_context_check() are skipped entirely.
+ *
+ * Since an fd can only be registered with an epoll instance once,
+ * all records for the same fd are chained together through
+ * epoll_next and the fd is registered for the union of their events.
+ *
+ * Note that this means that the events of a GPollFD may not be
+ * changed behind our back once it has been added; use
+ * g_source_modify_unix_fd() for that.
+ *
+ * If an fd can't be handled by epoll (for example a regular file) the
+ * context silently falls back to poll().
+ */
+
+/* HOLDS: context's lock */
+static void
+g_main_context_epoll_init (GMainContext *context)
+{
+  GPollRec *pollrec;
+
+  if (context->epoll_fd < 0)
+    context->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  if (context->epoll_fd < 0)
+    return;
+
+  context->epoll_fds = g_hash_table_new (NULL, NULL);
+  context->epoll_ready = g_ptr_array_new ();
+
+  for (pollrec = context->poll_records; pollrec; pollrec = pollrec->next)
+    {
+      g_main_context_epoll_add (context, pollrec);
+      if (context->epoll_fds == NULL)
+        break;
+    }
+}
+
+/* HOLDS: context's lock */
+static void
+g_main_context_epoll_free (GMainContext *context)
+{
+  GPollRec *pollrec;
+
+  if (context->epoll_fds)
+    {
+      for (pollrec = context->poll_records; pollrec; pollrec = pollrec->next)
+        {
+          pollrec->epoll_next = NULL;
+          pollrec->epoll_ready = FALSE;
+        }
+
+      g_hash_table_destroy (context->epoll_fds);
+      context->epoll_fds = NULL;
+      g_ptr_array_free (context->epoll_ready, TRUE);
+      context->epoll_ready = NULL;
+    }
+
+  /* The epoll fd itself is kept open: the owner may still be sitting
+   * in epoll_wait() if we got here because of a failure.
+   */
+}
+
+/* HOLDS: context's lock */
+static void
+g_main_context_epoll_update (GMainContext *context,
+                             gint          fd)
+{
+  struct epoll_event event;
+  GPollRec *pollrec;
+  guint32 events = 0;
+  gint op, ret;
+
+  /* The G_IO_* values are the same as the EPOLL* ones on Linux */
+  pollrec = g_hash_table_lookup (context->epoll_fds, GINT_TO_POINTER (fd));
+  for (; pollrec; pollrec = pollrec->epoll_next)
+    events |= pollrec->fd->events & (G_IO_IN | G_IO_OUT | G_IO_PRI | G_IO_ERR | G_IO_HUP);
+
+  memset (&event, 0, sizeof event);
+  event.events = events;
+  event.data.fd = fd;
+
+  /* Only fds with something to wait for are registered, even if that is
+   * just G_IO_HUP or G_IO_ERR; epoll reports those whatever the mask, so
+   * an fd that nobody asked about would make us spin.
+   */
+  if (events == 0)
+    {
+      /* ENOENT and EBADF just mean that it wasn't registered (or has
+       * been closed already), which is fine.
+       */
+      epoll_ctl (context->epoll_fd, EPOLL_CTL_DEL, fd, &event);
+      return;
+    }
+
+  op = EPOLL_CTL_MOD;
+  do
+    {
+      ret = epoll_ctl (context->epoll_fd, op, fd, &event);
+
+      if (ret < 0 && errno == ENOENT && op == EPOLL_CTL_MOD)
+        op = EPOLL_CTL_ADD;
+      else if (ret < 0 && errno == EEXIST && op == EPOLL_CTL_ADD)
+        op = EPOLL_CTL_MOD;
+      else
+        break;
+    }
+  while (TRUE);
+
+  if (ret < 0)
+    {
+      /* Most likely EPERM for an fd that doesn't support polling with
+       * epoll.  Let the regular poll() code take it from here.
+       */
+      g_main_context_epoll_free (context);
+      context->poll_changed = TRUE;
+    }
+}
+
+/* HOLDS: context's lock */
+static void
+g_main_context_epoll_add (GMainContext *context,
+                          GPollRec     *pollrec)
+{
+  gpointer key = GINT_TO_POINTER (pollrec->fd->fd);
+
+  pollrec->epoll_next = g_hash_table_lookup (context->epoll_fds, key);
+  g_hash_table_insert (context->epoll_fds, key, pollrec);
+
+  g_main_context_epoll_update (context, pollrec->fd->fd);
+}
+
+/* HOLDS: context's lock
+ *
+ * Returns %FALSE if @fd could not be found (for example because its fd
+ * number changed after it was added), in which case the caller has to
+ * fall back to searching the list of poll records.
+ */
+static gboolean
+g_main_context_epoll_remove (GMainContext *context,
+                             GPollFD      *fd)
+{
+  gpointer key = GINT_TO_POINTER (fd->fd);
+  GPollRec *pollrec, *prevrec, *head;
+
+  head = g_hash_table_lookup (context->epoll_fds, key);
+  for (prevrec = NULL, pollrec = head; pollrec; prevrec = pollrec, pollrec = pollrec->epoll_next)
+    if (pollrec->fd == fd)
+      break;
+
+  if (pollrec == NULL)
+    return FALSE;
+
+  if (prevrec)
+    prevrec->epoll_next = pollrec->epoll_next;
+  else if (pollrec->epoll_next)
+    g_hash_table_insert (context->epoll_fds, key, pollrec->epoll_next);
+  else
+    g_hash_table_remove (context->epoll_fds, key);
+
+  if (pollrec->epoll_ready)
+    g_ptr_array_remove_fast (context->epoll_ready, pollrec);
+
+  if (pollrec->prev)
+    pollrec->prev->next = pollrec->next;
+  else
+    context->poll_records = pollrec->next;
+
+  if (pollrec->next)
+    pollrec->next->prev = pollrec->prev;
+  else
+    context->poll_records_tail = pollrec->prev;
+
+  g_slice_free (GPollRec, pollrec);
+  context->n_poll_records--;
+
+  g_main_context_epoll_update (context, fd->fd);
+
+  context->poll_changed = TRUE;
+  g_wakeup_signal (context->wakeup);
+
+  return TRUE;
+}
+
+#define G_MAIN_EPOLL_MAX_EVENTS 256
+
+/* Called in place of g_main_context_poll() when the epoll backend is in
+ * use.  Unlike poll(), epoll_wait() only tells us about the fds that are
+ * ready, so only their revents are set; the revents that were set on the
+ * previous iteration are cleared first.
+ */
+static void
+g_main_context_epoll (GMainContext *context,
+                      gint          timeout,
+                      gint          priority)
+{
+  struct epoll_event events[G_MAIN_EPOLL_MAX_EVENTS];
+  GPollRec *pollrec;
+  gint epoll_fd;
+  gint n_events;
+  gint i;
+
+  LOCK_CONTEXT (context);
+
+  if (context->epoll_fds == NULL)
+    {
+      /* We fell back to poll() in the meantime.  Don't block, the next
+       * iteration will take care of it.
+       */
+      UNLOCK_CONTEXT (context);
+      return;
+    }
+
+  for (i = 0; i < context->epoll_ready->len; i++)
+    {
+      pollrec = context->epoll_ready->pdata[i];
+      pollrec->fd->revents = 0;
+      pollrec->epoll_ready = FALSE;
+    }
+  g_ptr_array_set_size (context->epoll_ready, 0);
+
+  epoll_fd = context->epoll_fd;
+
+  UNLOCK_CONTEXT (context);
+
+  n_events = epoll_wait (epoll_fd, events, G_MAIN_EPOLL_MAX_EVENTS, timeout);
+
+  if (n_events < 0)
+    {
+      if (errno != EINTR)
+        g_warning ("epoll_wait(2) failed due to: %s.", g_strerror (errno));
+      return;
+    }
+
+  LOCK_CONTEXT (context);
+
+  /* Records may have come and gone while we were waiting, which is
+   * why the fd (rather than a pointer) is used to find them again.
+   */
+  for (i = 0; i < n_events && context->epoll_fds; i++)
+    {
+      pollrec = g_hash_table_lookup (context->epoll_fds,
+                                     GINT_TO_POINTER (events[i].data.fd));
+
+      for (; pollrec; pollrec = pollrec->epoll_next)
+        {
+          gushort revents;
+
+          /* poll() would not have been asked about these */
+          if (pollrec->priority > priority || pollrec->fd->events == 0)
+            continue;
+
+          revents = events[i].events & (pollrec->fd->events | G_IO_ERR | G_IO_HUP);
+          if (revents == 0 || pollrec->epoll_ready)
+            continue;
+
+          pollrec->fd->revents = revents;
+          pollrec->epoll_ready = TRUE;
+          g_ptr_array_add (context->epoll_ready, pollrec);
+        }
+    }
+
+  UNLOCK_CONTEXT (context);
+}
+#endif /* HAVE_EPOLL */
+
 /**
  * g_source_get_current_time:
  * @source:  a #GSource
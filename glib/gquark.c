@@ -35,7 +35,7 @@
 #include <string.h>
 
 #include "gslice.h"
-#include "ghash.h"
+#include "gconcurrenthash.h"
 #include "gquark.h"
 #include "gstrfuncs.h"
 #include "gthread.h"
@@ -46,9 +46,10 @@
 #define QUARK_STRING_BLOCK_SIZE (4096 - sizeof (gsize))
 
 static inline GQuark  quark_new (gchar *string);
+static inline GQuark  quark_lookup (const gchar *string);
 
 G_LOCK_DEFINE_STATIC (quark_global);
-static GHashTable    *quark_ht = NULL;
+static GConcurrentHash *quark_ht = NULL;
 static gchar        **quarks = NULL;
 static gint           quark_seq_id = 0;
 static gchar         *quark_block = NULL;
@@ -121,17 +122,10 @@ static gint           quark_block_offset = 0;
 GQuark
 g_quark_try_string (const gchar *string)
 {
-  GQuark quark = 0;
-
   if (string == NULL)
     return 0;
 
-  G_LOCK (quark_global);
-  if (quark_ht)
-    quark = GPOINTER_TO_UINT (g_hash_table_lookup (quark_ht, string));
-  G_UNLOCK (quark_global);
-  
-  return quark;
+  return quark_lookup (string);
 }
 
 /* HOLDS: quark_global_lock */
@@ -167,10 +161,9 @@ static inline GQuark
 quark_from_string (const gchar *string,
                    gboolean     duplicate)
 {
-  GQuark quark = 0;
+  GQuark quark;
 
-  if (quark_ht)
-    quark = GPOINTER_TO_UINT (g_hash_table_lookup (quark_ht, string));
+  quark = quark_lookup (string);
 
   if (!quark)
     {
@@ -200,6 +193,10 @@ g_quark_from_string (const gchar *string)
   if (!string)
     return 0;
 
+  quark = quark_lookup (string);
+  if (quark)
+    return quark;
+
   G_LOCK (quark_global);
   quark = quark_from_string (string, TRUE);
   G_UNLOCK (quark_global);
@@ -235,6 +232,10 @@ g_quark_from_static_string (const gchar *string)
   if (!string)
     return 0;
 
+  quark = quark_lookup (string);
+  if (quark)
+    return quark;
+
   G_LOCK (quark_global);
   quark = quark_from_string (string, FALSE);
   G_UNLOCK (quark_global);
@@ -266,6 +267,27 @@ g_quark_to_string (GQuark quark)
   return result;
 }
 
+/* Does not need the lock.  quark_ht is published once, while still
+ * empty, and is never replaced or freed after that.  A lookup that
+ * misses, because the table is not there yet or the entry is not in
+ * it yet, just sends the caller to the locked path, which checks
+ * again.  Entries are only ever added, and quark_new() publishes the
+ * string in quarks[] and raises quark_seq_id before it inserts the
+ * entry with an atomic store, so whoever finds a quark here can also
+ * look up its string with g_quark_to_string().
+ */
+static inline GQuark
+quark_lookup (const gchar *string)
+{
+  GConcurrentHash *ht;
+
+  ht = g_atomic_pointer_get (&quark_ht);
+  if (ht == NULL)
+    return 0;
+
+  return GPOINTER_TO_UINT (g_concurrent_hash_lookup (ht, string));
+}
+
 /* HOLDS: g_quark_global_lock */
 static inline GQuark
 quark_new (gchar *string)
@@ -288,15 +310,18 @@ quark_new (gchar *string)
   if (!quark_ht)
     {
       g_assert (quark_seq_id == 0);
-      quark_ht = g_hash_table_new (g_str_hash, g_str_equal);
+      g_atomic_pointer_set (&quark_ht, g_concurrent_hash_new (g_str_hash, g_str_equal));
       quarks[quark_seq_id] = NULL;
       g_atomic_int_inc (&quark_seq_id);
     }
 
+  /* Publish the string before the table entry, so that anyone who
+   * finds the quark can also look up its string.
+   */
   quark = quark_seq_id;
   g_atomic_pointer_set (&quarks[quark], string);
-  g_hash_table_insert (quark_ht, string, GUINT_TO_POINTER (quark));
   g_atomic_int_inc (&quark_seq_id);
+  g_concurrent_hash_insert (quark_ht, string, GUINT_TO_POINTER (quark));
 
   return quark;
 }
@@ -322,6 +347,10 @@ g_intern_string (const gchar *string)
   if (!string)
     return NULL;
 
+  quark = quark_lookup (string);
+  if (quark)
+    return g_quark_to_string (quark);
+
   G_LOCK (quark_global);
   quark = quark_from_string (string, TRUE);
   result = quarks[quark];
@@ -352,6 +381,10 @@ g_intern_static_string (const gchar *string)
   if (!string)
     return NULL;
 
+  quark = quark_lookup (string);
+  if (quark)
+    return g_quark_to_string (quark);
+
   G_LOCK (quark_global);
   quark = quark_from_string (string, FALSE);
   result = quarks[quark];
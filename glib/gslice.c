@@ -35,6 +35,12 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>             /* sysconf() */
 #endif
+#ifdef HAVE_SCHED_GETCPU
+#include <sched.h>              /* sched_getcpu() */
+#endif
+#ifdef HAVE_MADVISE
+#include <sys/mman.h>           /* madvise() */
+#endif
 #ifdef G_OS_WIN32
 #include <windows.h>
 #include <process.h>
@@ -156,6 +162,8 @@
  *   the chunk size dependent magazine sizes automatically adapt (within limits,
  *   see [3]) to lock contention to properly scale performance across a variety
  *   of SMP systems.
+ *   with G_SLICE=per-cpu-caches, the depot is split into one shard per CPU,
+ *   each with its own lock, see [5].
  * - the slab allocator. this allocator allocates slabs (blocks of memory) close
  *   to the system page size or multiples thereof which have to be page aligned.
  *   the blocks are divided into smaller chunks which are used to satisfy
@@ -172,6 +180,8 @@
  *   block sizes are limited to the system page size (no multiples thereof).
  *   as a fallback, on system without even valloc(), a malloc(3)-based page
  *   allocator with alloc-only behaviour is used.
+ *   with G_SLICE=huge-pages, pages are instead carved out of 2MB areas that
+ *   are advised to be backed by transparent huge pages, see [6].
  *
  * NOTES:
  * [1] some systems memalign(3) implementations may rely on boundary tagging for
@@ -189,6 +199,17 @@
  *     16KB.
  * [4] allocating ca. 8 chunks per block/page keeps a good balance between
  *     external and internal fragmentation (<= 12.5%). [Bonwick94]
+ * [5] threads exchange magazines with the shard of the CPU they are running
+ *     on, as reported by sched_getcpu(3), or with a shard picked round robin
+ *     per thread where that is not available. a thread may have moved to
+ *     another CPU by the time it takes the lock, which only costs a bit of
+ *     locality. if its own shard is empty, a thread takes a magazine from
+ *     any other shard whose lock is free before falling back to the slab
+ *     allocator. the contention counters are shared by all shards.
+ * [6] huge page areas are allocated with posix_memalign(3) and never given
+ *     back to the system; pages freed by the slab allocator are kept on per
+ *     size free lists for reuse instead. this trades memory footprint for
+ *     fewer TLB misses with large working sets.
  */
 
 /* --- macros and constants --- */
@@ -202,6 +223,8 @@
 #define MAX_STAMP_COUNTER       (7)                                             /* distributes the load of gettimeofday() */
 #define MAX_SLAB_CHUNK_SIZE(al) (((al)->max_page_size - SLAB_INFO_SIZE) / 8)    /* we want at last 8 chunks per page, see [4] */
 #define MAX_SLAB_INDEX(al)      (SLAB_INDEX (al, MAX_SLAB_CHUNK_SIZE (al)) + 1)
+#define MAX_MAGAZINE_CACHES     (64)                                            /* upper bound for per-cpu caches, see [5] */
+#define HUGE_AREA_SIZE          (2 * 1024 * 1024)                               /* see [6] */
 #define SLAB_INDEX(al, asize)   ((asize) / P2ALIGNMENT - 1)                     /* asize must be P2ALIGNMENT aligned */
 #define SLAB_CHUNK_SIZE(al, ix) (((ix) + 1) * P2ALIGNMENT)
 #define SLAB_BPAGE_SIZE(al,csz) (8 * (csz) + SLAB_INFO_SIZE)
@@ -239,30 +262,42 @@ typedef struct {
 typedef struct {
   Magazine   *magazine1;                /* array of MAX_SLAB_INDEX (allocator) */
   Magazine   *magazine2;                /* array of MAX_SLAB_INDEX (allocator) */
+  guint       cache_index;              /* magazine cache without sched_getcpu() */
 } ThreadMemory;
 typedef struct {
   gboolean always_malloc;
   gboolean bypass_magazines;
   gboolean debug_blocks;
+  gboolean per_cpu_caches;
+  gboolean huge_pages;
   gsize    working_set_msecs;
   guint    color_increment;
 } SliceConfig;
+typedef struct {
+  GMutex        mutex;
+  ChunkLink   **magazines;                /* array of MAX_SLAB_INDEX (allocator) */
+  gint          mutex_counter;
+  guint         stamp_counter;
+  guint         last_stamp;
+  guint8        padding[64];              /* keep shards on separate cache lines */
+} MagazineCache;
 typedef struct {
   /* const after initialization */
   gsize         min_page_size, max_page_size;
   SliceConfig   config;
   gsize         max_slab_chunk_size_for_magazine_cache;
   /* magazine cache */
-  GMutex        magazine_mutex;
-  ChunkLink   **magazines;                /* array of MAX_SLAB_INDEX (allocator) */
-  guint        *contention_counters;      /* array of MAX_SLAB_INDEX (allocator) */
-  gint          mutex_counter;
-  guint         stamp_counter;
-  guint         last_stamp;
+  MagazineCache *caches;                  /* array of n_caches, see [5] */
+  guint          n_caches;
+  guint         *contention_counters;     /* array of MAX_SLAB_INDEX (allocator) */
   /* slab allocator */
   GMutex        slab_mutex;
   SlabInfo    **slab_stack;                /* array of MAX_SLAB_INDEX (allocator) */
   guint        color_accu;
+  /* huge page areas, see [6] */
+  guint8       *huge_area_next;
+  guint8       *huge_area_end;
+  ChunkLink    *huge_free_pages[32];      /* free lists indexed by log2 (page size) */
 } Allocator;
 
 /* --- g-slice prototypes --- */
@@ -274,7 +309,7 @@ static gpointer     allocator_memalign               (gsize      alignment,
                                                       gsize      memsize);
 static void         allocator_memfree                (gsize      memsize,
                                                       gpointer   mem);
-static inline void  magazine_cache_update_stamp      (void);
+static inline void  magazine_cache_update_stamp      (MagazineCache *cache);
 static inline gsize allocator_get_magazine_threshold (Allocator *allocator,
                                                       guint      ix);
 
@@ -292,6 +327,8 @@ static SliceConfig slice_config = {
   FALSE,        /* always_malloc */
   FALSE,        /* bypass_magazines */
   FALSE,        /* debug_blocks */
+  FALSE,        /* per_cpu_caches */
+  FALSE,        /* huge_pages */
   15 * 1000,    /* working_set_msecs */
   1,            /* color increment, alt: 0x7fffffff */
 };
@@ -374,8 +411,10 @@ slice_config_init (SliceConfig *config)
     {
       gint flags;
       const GDebugKey keys[] = {
-        { "always-malloc", 1 << 0 },
-        { "debug-blocks",  1 << 1 },
+        { "always-malloc",  1 << 0 },
+        { "debug-blocks",   1 << 1 },
+        { "per-cpu-caches", 1 << 2 },
+        { "huge-pages",     1 << 3 },
       };
 
       flags = g_parse_debug_string (val, keys, G_N_ELEMENTS (keys));
@@ -383,6 +422,10 @@ slice_config_init (SliceConfig *config)
         config->always_malloc = TRUE;
       if (flags & (1 << 1))
         config->debug_blocks = TRUE;
+      if (flags & (1 << 2))
+        config->per_cpu_caches = TRUE;
+      if (flags & (1 << 3))
+        config->huge_pages = TRUE;
     }
   else
     {
@@ -400,6 +443,8 @@ slice_config_init (SliceConfig *config)
 static void
 g_slice_init_nomessage (void)
 {
+  guint i;
+
   /* we may not use g_error() or friends here */
   mem_assert (sys_page_size == 0);
   mem_assert (MIN_MAGAZINE_SIZE >= 4);
@@ -433,26 +478,38 @@ g_slice_init_nomessage (void)
   /* we can only align to system page size */
   allocator->max_page_size = sys_page_size;
 #endif
+#if !(HAVE_COMPLIANT_POSIX_MEMALIGN || HAVE_MEMALIGN)
+  /* huge page areas need aligned allocations of HUGE_AREA_SIZE */
+  allocator->config.huge_pages = FALSE;
+#endif
+  allocator->n_caches = 1;
+  if (allocator->config.per_cpu_caches)
+    allocator->n_caches = CLAMP (g_get_num_processors (), 1, MAX_MAGAZINE_CACHES);
+  allocator->caches = g_new0 (MagazineCache, allocator->n_caches);
   if (allocator->config.always_malloc)
     {
       allocator->contention_counters = NULL;
-      allocator->magazines = NULL;
       allocator->slab_stack = NULL;
     }
   else
     {
       allocator->contention_counters = g_new0 (guint, MAX_SLAB_INDEX (allocator));
-      allocator->magazines = g_new0 (ChunkLink*, MAX_SLAB_INDEX (allocator));
+      for (i = 0; i < allocator->n_caches; i++)
+        allocator->caches[i].magazines = g_new0 (ChunkLink*, MAX_SLAB_INDEX (allocator));
       allocator->slab_stack = g_new0 (SlabInfo*, MAX_SLAB_INDEX (allocator));
     }
 
-  g_mutex_init (&allocator->magazine_mutex);
-  allocator->mutex_counter = 0;
-  allocator->stamp_counter = MAX_STAMP_COUNTER; /* force initial update */
-  allocator->last_stamp = 0;
+  for (i = 0; i < allocator->n_caches; i++)
+    {
+      MagazineCache *cache = &allocator->caches[i];
+      g_mutex_init (&cache->mutex);
+      cache->mutex_counter = 0;
+      cache->stamp_counter = MAX_STAMP_COUNTER; /* force initial update */
+      cache->last_stamp = 0;
+      magazine_cache_update_stamp (cache);
+    }
   g_mutex_init (&allocator->slab_mutex);
   allocator->color_accu = 0;
-  magazine_cache_update_stamp();
   /* values cached for performance reasons */
   allocator->max_slab_chunk_size_for_magazine_cache = MAX_SLAB_CHUNK_SIZE (allocator);
   if (allocator->config.always_malloc || allocator->config.bypass_magazines)
@@ -478,30 +535,30 @@ allocator_categorize (gsize aligned_chunk_size)
 }
 
 static inline void
-g_mutex_lock_a (GMutex *mutex,
-                guint  *contention_counter)
+g_mutex_lock_a (MagazineCache *cache,
+                guint         *contention_counter)
 {
   gboolean contention = FALSE;
-  if (!g_mutex_trylock (mutex))
+  if (!g_mutex_trylock (&cache->mutex))
     {
-      g_mutex_lock (mutex);
+      g_mutex_lock (&cache->mutex);
       contention = TRUE;
     }
   if (contention)
     {
-      allocator->mutex_counter++;
-      if (allocator->mutex_counter >= 1)        /* quickly adapt to contention */
+      cache->mutex_counter++;
+      if (cache->mutex_counter >= 1)            /* quickly adapt to contention */
         {
-          allocator->mutex_counter = 0;
+          cache->mutex_counter = 0;
           *contention_counter = MIN (*contention_counter + 1, MAX_MAGAZINE_SIZE);
         }
     }
   else /* !contention */
     {
-      allocator->mutex_counter--;
-      if (allocator->mutex_counter < -11)       /* moderately recover magazine sizes */
+      cache->mutex_counter--;
+      if (cache->mutex_counter < -11)           /* moderately recover magazine sizes */
         {
-          allocator->mutex_counter = 0;
+          cache->mutex_counter = 0;
           *contention_counter = MAX (*contention_counter, 1) - 1;
         }
     }
@@ -525,6 +582,13 @@ thread_memory_from_self (void)
       tmem = g_malloc0 (sizeof (ThreadMemory) + sizeof (Magazine) * 2 * n_magazines);
       tmem->magazine1 = (Magazine*) (tmem + 1);
       tmem->magazine2 = &tmem->magazine1[n_magazines];
+      if (allocator->n_caches > 1)
+        {
+          static guint next_cache_index = 0;
+          g_mutex_lock (&init_mutex);
+          tmem->cache_index = next_cache_index++ % allocator->n_caches;
+          g_mutex_unlock (&init_mutex);
+        }
       g_private_set (&private_thread_memory, tmem);
     }
   return tmem;
@@ -598,17 +662,32 @@ allocator_get_magazine_threshold (Allocator *allocator,
 
 /* --- magazine cache --- */
 static inline void
-magazine_cache_update_stamp (void)
+magazine_cache_update_stamp (MagazineCache *cache)
 {
-  if (allocator->stamp_counter >= MAX_STAMP_COUNTER)
+  if (cache->stamp_counter >= MAX_STAMP_COUNTER)
     {
       GTimeVal tv;
       g_get_current_time (&tv);
-      allocator->last_stamp = tv.tv_sec * 1000 + tv.tv_usec / 1000; /* milli seconds */
-      allocator->stamp_counter = 0;
+      cache->last_stamp = tv.tv_sec * 1000 + tv.tv_usec / 1000; /* milli seconds */
+      cache->stamp_counter = 0;
     }
   else
-    allocator->stamp_counter++;
+    cache->stamp_counter++;
+}
+
+static inline MagazineCache*
+magazine_cache_for_thread (ThreadMemory *tmem)
+{
+  if (G_LIKELY (allocator->n_caches == 1))
+    return &allocator->caches[0];
+#ifdef HAVE_SCHED_GETCPU
+  {
+    gint cpu = sched_getcpu ();
+    if (cpu >= 0)
+      return &allocator->caches[cpu % allocator->n_caches];
+  }
+#endif
+  return &allocator->caches[tmem->cache_index];
 }
 
 static inline ChunkLink*
@@ -639,13 +718,13 @@ magazine_chain_prepare_fields (ChunkLink *magazine_chunks)
 #define magazine_chain_count(mc)        ((mc)->next->next->next->data)
 
 static void
-magazine_cache_trim (Allocator *allocator,
-                     guint      ix,
-                     guint      stamp)
+magazine_cache_trim (MagazineCache *cache,
+                     guint          ix,
+                     guint          stamp)
 {
-  /* g_mutex_lock (allocator->mutex); done by caller */
+  /* g_mutex_lock (cache->mutex); done by caller */
   /* trim magazine cache from tail */
-  ChunkLink *current = magazine_chain_prev (allocator->magazines[ix]);
+  ChunkLink *current = magazine_chain_prev (cache->magazines[ix]);
   ChunkLink *trash = NULL;
   while (ABS (stamp - magazine_chain_uint_stamp (current)) >= allocator->config.working_set_msecs)
     {
@@ -661,14 +740,14 @@ magazine_cache_trim (Allocator *allocator,
       magazine_chain_prev (current) = trash;
       trash = current;
       /* fixup list head if required */
-      if (current == allocator->magazines[ix])
+      if (current == cache->magazines[ix])
         {
-          allocator->magazines[ix] = NULL;
+          cache->magazines[ix] = NULL;
           break;
         }
       current = prev;
     }
-  g_mutex_unlock (&allocator->magazine_mutex);
+  g_mutex_unlock (&cache->mutex);
   /* free trash */
   if (trash)
     {
@@ -690,15 +769,17 @@ magazine_cache_trim (Allocator *allocator,
 }
 
 static void
-magazine_cache_push_magazine (guint      ix,
-                              ChunkLink *magazine_chunks,
-                              gsize      count) /* must be >= MIN_MAGAZINE_SIZE */
+magazine_cache_push_magazine (ThreadMemory *tmem,
+                              guint         ix,
+                              ChunkLink    *magazine_chunks,
+                              gsize         count) /* must be >= MIN_MAGAZINE_SIZE */
 {
+  MagazineCache *cache = magazine_cache_for_thread (tmem);
   ChunkLink *current = magazine_chain_prepare_fields (magazine_chunks);
   ChunkLink *next, *prev;
-  g_mutex_lock (&allocator->magazine_mutex);
+  g_mutex_lock (&cache->mutex);
   /* add magazine at head */
-  next = allocator->magazines[ix];
+  next = cache->magazines[ix];
   if (next)
     prev = magazine_chain_prev (next);
   else
@@ -709,25 +790,61 @@ magazine_cache_push_magazine (guint      ix,
   magazine_chain_next (current) = next;
   magazine_chain_count (current) = (gpointer) count;
   /* stamp magazine */
-  magazine_cache_update_stamp();
-  magazine_chain_stamp (current) = GUINT_TO_POINTER (allocator->last_stamp);
-  allocator->magazines[ix] = current;
+  magazine_cache_update_stamp (cache);
+  magazine_chain_stamp (current) = GUINT_TO_POINTER (cache->last_stamp);
+  cache->magazines[ix] = current;
   /* free old magazines beyond a certain threshold */
-  magazine_cache_trim (allocator, ix, allocator->last_stamp);
-  /* g_mutex_unlock (allocator->mutex); was done by magazine_cache_trim() */
+  magazine_cache_trim (cache, ix, cache->last_stamp);
+  /* g_mutex_unlock (cache->mutex); was done by magazine_cache_trim() */
+}
+
+static ChunkLink*
+magazine_cache_unlink_magazine (MagazineCache *cache,
+                                guint          ix,
+                                gsize         *countp)
+{
+  /* g_mutex_lock (cache->mutex); done by caller */
+  ChunkLink *current = cache->magazines[ix];
+  ChunkLink *prev = magazine_chain_prev (current);
+  ChunkLink *next = magazine_chain_next (current);
+  /* unlink */
+  magazine_chain_next (prev) = next;
+  magazine_chain_prev (next) = prev;
+  cache->magazines[ix] = next == current ? NULL : next;
+  g_mutex_unlock (&cache->mutex);
+  /* clear special fields and hand out */
+  *countp = (gsize) magazine_chain_count (current);
+  magazine_chain_prev (current) = NULL;
+  magazine_chain_next (current) = NULL;
+  magazine_chain_count (current) = NULL;
+  magazine_chain_stamp (current) = NULL;
+  return current;
 }
 
 static ChunkLink*
-magazine_cache_pop_magazine (guint  ix,
-                             gsize *countp)
+magazine_cache_pop_magazine (ThreadMemory *tmem,
+                             guint         ix,
+                             gsize        *countp)
 {
-  g_mutex_lock_a (&allocator->magazine_mutex, &allocator->contention_counters[ix]);
-  if (!allocator->magazines[ix])
+  MagazineCache *cache = magazine_cache_for_thread (tmem);
+  g_mutex_lock_a (cache, &allocator->contention_counters[ix]);
+  if (!cache->magazines[ix])
     {
       guint magazine_threshold = allocator_get_magazine_threshold (allocator, ix);
       gsize i, chunk_size = SLAB_CHUNK_SIZE (allocator, ix);
       ChunkLink *chunk, *head;
-      g_mutex_unlock (&allocator->magazine_mutex);
+      g_mutex_unlock (&cache->mutex);
+      /* take a magazine from another shard that is not busy, see [5] */
+      for (i = 1; i < allocator->n_caches; i++)
+        {
+          MagazineCache *other = &allocator->caches[(cache - allocator->caches + i) % allocator->n_caches];
+          if (g_mutex_trylock (&other->mutex))
+            {
+              if (other->magazines[ix])
+                return magazine_cache_unlink_magazine (other, ix, countp);
+              g_mutex_unlock (&other->mutex);
+            }
+        }
       g_mutex_lock (&allocator->slab_mutex);
       head = slab_allocator_alloc_chunk (chunk_size);
       head->data = NULL;
@@ -744,23 +861,7 @@ magazine_cache_pop_magazine (guint  ix,
       return head;
     }
   else
-    {
-      ChunkLink *current = allocator->magazines[ix];
-      ChunkLink *prev = magazine_chain_prev (current);
-      ChunkLink *next = magazine_chain_next (current);
-      /* unlink */
-      magazine_chain_next (prev) = next;
-      magazine_chain_prev (next) = prev;
-      allocator->magazines[ix] = next == current ? NULL : next;
-      g_mutex_unlock (&allocator->magazine_mutex);
-      /* clear special fields and hand out */
-      *countp = (gsize) magazine_chain_count (current);
-      magazine_chain_prev (current) = NULL;
-      magazine_chain_next (current) = NULL;
-      magazine_chain_count (current) = NULL;
-      magazine_chain_stamp (current) = NULL;
-      return current;
-    }
+    return magazine_cache_unlink_magazine (cache, ix, countp);
 }
 
 /* --- thread magazines --- */
@@ -780,7 +881,7 @@ private_thread_memory_cleanup (gpointer data)
         {
           Magazine *mag = mags[j];
           if (mag->count >= MIN_MAGAZINE_SIZE)
-            magazine_cache_push_magazine (ix, mag->chunks, mag->count);
+            magazine_cache_push_magazine (tmem, ix, mag->chunks, mag->count);
           else
             {
               const gsize chunk_size = SLAB_CHUNK_SIZE (allocator, ix);
@@ -804,7 +905,7 @@ thread_memory_magazine1_reload (ThreadMemory *tmem,
   Magazine *mag = &tmem->magazine1[ix];
   mem_assert (mag->chunks == NULL); /* ensure that we may reset mag->count */
   mag->count = 0;
-  mag->chunks = magazine_cache_pop_magazine (ix, &mag->count);
+  mag->chunks = magazine_cache_pop_magazine (tmem, ix, &mag->count);
 }
 
 static void
@@ -812,7 +913,7 @@ thread_memory_magazine2_unload (ThreadMemory *tmem,
                                 guint         ix)
 {
   Magazine *mag = &tmem->magazine2[ix];
-  magazine_cache_push_magazine (ix, mag->chunks, mag->count);
+  magazine_cache_push_magazine (tmem, ix, mag->chunks, mag->count);
   mag->chunks = NULL;
   mag->count = 0;
 }
@@ -1243,6 +1344,48 @@ allocator_slab_stack_push (Allocator *allocator,
   allocator->slab_stack[ix] = sinfo;
 }
 
+static gpointer
+allocator_huge_page_alloc (Allocator *allocator,
+                           gsize      page_size)
+{
+  /* g_mutex_lock (allocator->slab_mutex); done by caller */
+  guint bits = g_bit_storage (page_size - 1);
+  ChunkLink *page = allocator->huge_free_pages[bits];
+  if (page)
+    {
+      allocator->huge_free_pages[bits] = page->next;
+      return page;
+    }
+  /* carve page out of the current area, pages are aligned to their size */
+  allocator->huge_area_next = (guint8*) ALIGN ((gsize) allocator->huge_area_next, page_size);
+  if (!allocator->huge_area_next || allocator->huge_area_next + page_size > allocator->huge_area_end)
+    {
+      guint8 *area = allocator_memalign (HUGE_AREA_SIZE, HUGE_AREA_SIZE);
+      if (!area)
+        return NULL;
+#if defined (HAVE_MADVISE) && defined (MADV_HUGEPAGE)
+      madvise (area, HUGE_AREA_SIZE, MADV_HUGEPAGE); /* failure only means small pages */
+#endif
+      allocator->huge_area_next = area;
+      allocator->huge_area_end = area + HUGE_AREA_SIZE;
+    }
+  page = (ChunkLink*) allocator->huge_area_next;
+  allocator->huge_area_next += page_size;
+  return page;
+}
+
+static void
+allocator_huge_page_free (Allocator *allocator,
+                          gsize      page_size,
+                          gpointer   mem)
+{
+  /* g_mutex_lock (allocator->slab_mutex); done by caller */
+  guint bits = g_bit_storage (page_size - 1);
+  ChunkLink *page = mem;
+  page->next = allocator->huge_free_pages[bits];
+  allocator->huge_free_pages[bits] = page;
+}
+
 static gsize
 allocator_aligned_page_size (Allocator *allocator,
                              gsize      n_bytes)
@@ -1262,7 +1405,9 @@ allocator_add_slab (Allocator *allocator,
   gsize addr, padding, n_chunks, color = 0;
   gsize page_size = allocator_aligned_page_size (allocator, SLAB_BPAGE_SIZE (allocator, chunk_size));
   /* allocate 1 page for the chunks and the slab */
-  gpointer aligned_memory = allocator_memalign (page_size, page_size - NATIVE_MALLOC_PADDING);
+  gpointer aligned_memory = allocator->config.huge_pages ?
+                            allocator_huge_page_alloc (allocator, page_size) :
+                            allocator_memalign (page_size, page_size - NATIVE_MALLOC_PADDING);
   guint8 *mem = aligned_memory;
   guint i;
   if (!mem)
@@ -1363,7 +1508,10 @@ slab_allocator_free_chunk (gsize    chunk_size,
       if (allocator->slab_stack[ix] == sinfo)
         allocator->slab_stack[ix] = next == sinfo ? NULL : next;
       /* free slab */
-      allocator_memfree (page_size, page);
+      if (allocator->config.huge_pages)
+        allocator_huge_page_free (allocator, page_size, page);
+      else
+        allocator_memfree (page_size, page);
     }
 }
 
@@ -30,9 +30,12 @@
 
 #include "gasyncqueue.h"
 #include "gasyncqueueprivate.h"
+#include "gatomic.h"
 #include "gmain.h"
+#include "gslist.h"
 #include "gtestutils.h"
 #include "gtimer.h"
+#include "gutils.h"
 
 /**
  * SECTION:thread_pools
@@ -69,12 +72,22 @@
  * controlled by g_thread_pool_get_max_unused_threads() and
  * g_thread_pool_set_max_unused_threads(). All currently unused threads
  * can be stopped by calling g_thread_pool_stop_unused_threads().
+ *
+ * Pools created with g_thread_pool_new_work_stealing() do not share a
+ * single task queue between their threads. Instead every thread owns
+ * a queue of its own, and threads that run out of work take tasks
+ * from the queues of the others. This avoids contention on a single
+ * lock when many threads push tasks at a high rate, at the cost of a
+ * fixed number of threads and only approximate ordering of tasks.
  */
 
 #define DEBUG_MSG(x)
 /* #define DEBUG_MSG(args) g_printerr args ; g_printerr ("\n");    */
 
 typedef struct _GRealThreadPool GRealThreadPool;
+typedef struct _GThreadPoolWorker GThreadPoolWorker;
+typedef struct _GThreadPoolArray GThreadPoolArray;
+typedef struct _GThreadPoolSort GThreadPoolSort;
 
 /**
  * GThreadPool:
@@ -98,8 +111,58 @@ struct _GRealThreadPool
   gboolean waiting;
   GCompareDataFunc sort_func;
   gpointer sort_user_data;
+
+  /* Only used by work-stealing pools */
+  GThreadPoolWorker **workers;
+  guint n_workers;
+  GMutex sleep_mutex;
+  volatile gint sleepers;
+  volatile gint unprocessed;
+  volatile gint live_workers;
+  GThreadPoolSort *sort;
+  GSList *retired_sorts;
+};
+
+/* A worker of a work-stealing pool owns a Chase-Lev deque: the worker
+ * pushes and pops tasks at the bottom end without taking any lock,
+ * while other workers steal from the top end with a compare-and-swap.
+ * Threads that are not workers of the pool cannot touch the bottom
+ * end, so they push onto the inbox instead, a lock-free stack that
+ * is emptied as a whole into the deque.
+ */
+struct _GThreadPoolArray
+{
+  gsize mask;
+  gpointer items[1];
+};
+
+struct _GThreadPoolWorker
+{
+  GRealThreadPool *pool;
+  GThread *thread;
+  guint index;
+  guint32 seed;
+
+  GSList *volatile inbox;
+
+  volatile gsize top;
+  volatile gsize bottom;
+  GThreadPoolArray *volatile array;
+  GSList *retired_arrays;
+};
+
+struct _GThreadPoolSort
+{
+  GCompareDataFunc func;
+  gpointer user_data;
 };
 
+#define G_THREAD_POOL_INITIAL_DEQUE_SIZE 256
+
+static GPrivate current_worker = G_PRIVATE_INIT (NULL);
+static GPrivate push_hint = G_PRIVATE_INIT (NULL);
+static volatile gint push_hint_serial = 0;
+
 /* The following is just an address to mark the wakeup order for a
  * thread, it could be any address (as long, as it isn't a valid
  * GThreadPool address)
@@ -123,6 +186,11 @@ static gboolean         g_thread_pool_start_thread        (GRealThreadPool  *poo
 static void             g_thread_pool_wakeup_and_stop_all (GRealThreadPool  *pool);
 static GRealThreadPool* g_thread_pool_wait_for_new_pool   (void);
 static gpointer         g_thread_pool_wait_for_new_task   (GRealThreadPool  *pool);
+static gboolean         g_thread_pool_push_stealing       (GRealThreadPool  *pool,
+                                                           gpointer          data);
+static void             g_thread_pool_free_stealing       (GRealThreadPool  *pool,
+                                                           gboolean          immediate,
+                                                           gboolean          wait_);
 
 static void
 g_thread_pool_queue_push_unlocked (GRealThreadPool *pool,
@@ -422,6 +490,324 @@ g_thread_pool_start_thread (GRealThreadPool  *pool,
   return TRUE;
 }
 
+static GThreadPoolArray *
+g_thread_pool_array_new (gsize size)
+{
+  GThreadPoolArray *array;
+
+  array = g_malloc (sizeof (GThreadPoolArray) + (size - 1) * sizeof (gpointer));
+  array->mask = size - 1;
+
+  return array;
+}
+
+/* Called by the owner only */
+static void
+g_thread_pool_deque_push (GThreadPoolWorker *worker,
+                          gpointer           data)
+{
+  GThreadPoolArray *array;
+  gsize top, bottom;
+
+  bottom = worker->bottom;
+  top = (gsize) g_atomic_pointer_get (&worker->top);
+  array = worker->array;
+
+  if (bottom - top >= array->mask)
+    {
+      GThreadPoolArray *new_array;
+      gsize i;
+
+      new_array = g_thread_pool_array_new ((array->mask + 1) * 2);
+      for (i = top; i != bottom; i++)
+        new_array->items[i & new_array->mask] = array->items[i & array->mask];
+
+      /* Thieves may still be reading from the old array, so it is
+       * only freed together with the pool.
+       */
+      worker->retired_arrays = g_slist_prepend (worker->retired_arrays, array);
+      g_atomic_pointer_set (&worker->array, new_array);
+      array = new_array;
+    }
+
+  array->items[bottom & array->mask] = data;
+  g_atomic_pointer_set (&worker->bottom, bottom + 1);
+}
+
+/* Called by the owner only */
+static gpointer
+g_thread_pool_deque_pop (GThreadPoolWorker *worker)
+{
+  gsize top, bottom;
+  gpointer data;
+
+  bottom = worker->bottom - 1;
+  g_atomic_pointer_set (&worker->bottom, bottom);
+  top = (gsize) g_atomic_pointer_get (&worker->top);
+
+  if ((gssize) (bottom - top) < 0)
+    {
+      g_atomic_pointer_set (&worker->bottom, top);
+      return NULL;
+    }
+
+  data = worker->array->items[bottom & worker->array->mask];
+
+  if (bottom != top)
+    return data;
+
+  /* This is the last task, race the thieves for it */
+  if (!g_atomic_pointer_compare_and_exchange (&worker->top, top, top + 1))
+    data = NULL;
+
+  g_atomic_pointer_set (&worker->bottom, top + 1);
+
+  return data;
+}
+
+static gpointer
+g_thread_pool_deque_steal (GThreadPoolWorker *victim)
+{
+  GThreadPoolArray *array;
+  gsize top, bottom;
+  gpointer data;
+
+  top = (gsize) g_atomic_pointer_get (&victim->top);
+  bottom = (gsize) g_atomic_pointer_get (&victim->bottom);
+
+  if ((gssize) (bottom - top) <= 0)
+    return NULL;
+
+  array = g_atomic_pointer_get (&victim->array);
+  data = array->items[top & array->mask];
+
+  if (!g_atomic_pointer_compare_and_exchange (&victim->top, top, top + 1))
+    return NULL;
+
+  return data;
+}
+
+/* Moves all tasks in the inbox of @victim to the deque of @worker.
+ * Any thread may empty an inbox, as it is always taken as a whole.
+ */
+static gboolean
+g_thread_pool_take_inbox (GThreadPoolWorker *worker,
+                          GThreadPoolWorker *victim)
+{
+  GThreadPoolSort *sort;
+  GSList *list, *l;
+
+  do
+    {
+      list = g_atomic_pointer_get (&victim->inbox);
+      if (list == NULL)
+        return FALSE;
+    }
+  while (!g_atomic_pointer_compare_and_exchange (&victim->inbox, list, NULL));
+
+  /* The inbox holds the newest task first. The deque pops the last
+   * pushed task first, so pushing the list as it is makes the owner
+   * process the tasks in the order they were pushed.
+   */
+  sort = g_atomic_pointer_get (&worker->pool->sort);
+  if (sort != NULL && sort->func != NULL && list->next != NULL)
+    {
+      list = g_slist_reverse (list);
+      list = g_slist_sort_with_data (list, sort->func, sort->user_data);
+      list = g_slist_reverse (list);
+    }
+
+  for (l = list; l; l = l->next)
+    g_thread_pool_deque_push (worker, l->data);
+
+  g_slist_free (list);
+
+  return TRUE;
+}
+
+static gpointer
+g_thread_pool_worker_take (GThreadPoolWorker *worker)
+{
+  GRealThreadPool *pool = worker->pool;
+  gpointer data;
+  guint start, i;
+
+  data = g_thread_pool_deque_pop (worker);
+  if (data)
+    return data;
+
+  if (g_thread_pool_take_inbox (worker, worker))
+    return g_thread_pool_deque_pop (worker);
+
+  /* xorshift, to pick a random victim to start with */
+  worker->seed ^= worker->seed << 13;
+  worker->seed ^= worker->seed >> 17;
+  worker->seed ^= worker->seed << 5;
+  start = worker->seed % pool->n_workers;
+
+  for (i = 0; i < pool->n_workers; i++)
+    {
+      GThreadPoolWorker *victim = pool->workers[(start + i) % pool->n_workers];
+
+      if (victim == worker)
+        continue;
+
+      data = g_thread_pool_deque_steal (victim);
+      if (data)
+        return data;
+
+      if (g_thread_pool_take_inbox (worker, victim))
+        return g_thread_pool_deque_pop (worker);
+    }
+
+  return NULL;
+}
+
+static gpointer
+g_thread_pool_worker_proxy (gpointer data)
+{
+  GThreadPoolWorker *worker = data;
+  GRealThreadPool *pool = worker->pool;
+
+  g_private_set (&current_worker, worker);
+
+  while (!g_atomic_int_get (&pool->immediate))
+    {
+      gpointer task;
+
+      task = g_thread_pool_worker_take (worker);
+      if (task)
+        {
+          g_atomic_int_add (&pool->unprocessed, -1);
+          pool->pool.func (task, pool->pool.user_data);
+          continue;
+        }
+
+      if (g_atomic_int_get (&pool->unprocessed) != 0)
+        {
+          /* A task is about to be published, or a thief took it */
+          g_thread_yield ();
+          continue;
+        }
+
+      if (!g_atomic_int_get (&pool->running))
+        break;
+
+      /* The unprocessed count is raised before a task is published,
+       * and pushers only look at the sleepers count after that, so
+       * a task pushed concurrently is either seen here or the pusher
+       * sees us sleeping and wakes us up.
+       */
+      g_mutex_lock (&pool->sleep_mutex);
+      g_atomic_int_inc (&pool->sleepers);
+      while (g_atomic_int_get (&pool->unprocessed) == 0 &&
+             g_atomic_int_get (&pool->running))
+        g_cond_wait (&pool->cond, &pool->sleep_mutex);
+      g_atomic_int_add (&pool->sleepers, -1);
+      g_mutex_unlock (&pool->sleep_mutex);
+    }
+
+  g_private_set (&current_worker, NULL);
+
+  /* If nobody waits for us in g_thread_pool_free(), the last worker
+   * has to clean up the pool.
+   */
+  if (g_atomic_int_dec_and_test (&pool->live_workers) && !pool->waiting)
+    g_thread_pool_free_internal (pool);
+
+  return NULL;
+}
+
+static gboolean
+g_thread_pool_push_stealing (GRealThreadPool *pool,
+                             gpointer         data)
+{
+  GThreadPoolWorker *worker;
+
+  g_atomic_int_inc (&pool->unprocessed);
+
+  worker = g_private_get (&current_worker);
+  if (worker != NULL && worker->pool == pool)
+    {
+      /* Tasks pushed from a task go to the deque of the current
+       * worker, which needs no atomic read-modify-write at all.
+       */
+      g_thread_pool_deque_push (worker, data);
+    }
+  else
+    {
+      GSList *node;
+      guint hint;
+
+      /* Spread the pushes of every thread over the workers, starting
+       * at a different worker for each thread.
+       */
+      hint = GPOINTER_TO_UINT (g_private_get (&push_hint));
+      if (hint == 0)
+        hint = g_atomic_int_add (&push_hint_serial, 1) + 1;
+      g_private_set (&push_hint, GUINT_TO_POINTER (hint + 1));
+
+      worker = pool->workers[hint % pool->n_workers];
+
+      node = g_slist_alloc ();
+      node->data = data;
+      do
+        node->next = g_atomic_pointer_get (&worker->inbox);
+      while (!g_atomic_pointer_compare_and_exchange (&worker->inbox, node->next, node));
+    }
+
+  if (g_atomic_int_get (&pool->sleepers) > 0)
+    {
+      g_mutex_lock (&pool->sleep_mutex);
+      g_cond_signal (&pool->cond);
+      g_mutex_unlock (&pool->sleep_mutex);
+    }
+
+  return TRUE;
+}
+
+static void
+g_thread_pool_free_stealing (GRealThreadPool *pool,
+                             gboolean         immediate,
+                             gboolean         wait_)
+{
+  guint i;
+
+  g_mutex_lock (&pool->sleep_mutex);
+
+  pool->waiting = wait_;
+
+  /* Once running is unset, the last worker may free the pool at any
+   * time when we do not wait for it, so drop our references to the
+   * threads before that.
+   */
+  if (!wait_)
+    for (i = 0; i < pool->n_workers; i++)
+      if (pool->workers[i]->thread)
+        {
+          g_thread_unref (pool->workers[i]->thread);
+          pool->workers[i]->thread = NULL;
+        }
+
+  g_atomic_int_set (&pool->immediate, immediate);
+  g_atomic_int_set (&pool->running, FALSE);
+  g_cond_broadcast (&pool->cond);
+
+  g_mutex_unlock (&pool->sleep_mutex);
+
+  if (wait_)
+    {
+      for (i = 0; i < pool->n_workers; i++)
+        if (pool->workers[i]->thread)
+          {
+            g_thread_join (pool->workers[i]->thread);
+            pool->workers[i]->thread = NULL;
+          }
+
+      g_thread_pool_free_internal (pool);
+    }
+}
+
 /**
  * g_thread_pool_new:
  * @func: a function to execute in the threads of the new thread pool
@@ -485,6 +871,10 @@ g_thread_pool_new (GFunc      func,
   retval->waiting = FALSE;
   retval->sort_func = NULL;
   retval->sort_user_data = NULL;
+  retval->workers = NULL;
+  retval->n_workers = 0;
+  retval->sort = NULL;
+  retval->retired_sorts = NULL;
 
   G_LOCK (init);
   if (!unused_thread_queue)
@@ -512,6 +902,110 @@ g_thread_pool_new (GFunc      func,
   return (GThreadPool*) retval;
 }
 
+/**
+ * g_thread_pool_new_work_stealing:
+ * @func: a function to execute in the threads of the new thread pool
+ * @user_data: user data that is handed over to @func every time it
+ *     is called
+ * @max_threads: the number of threads of the new thread pool, or -1
+ *     to use one thread per processor
+ * @error: return location for error, or %NULL
+ *
+ * This function creates a new exclusive thread pool, like
+ * g_thread_pool_new(), that schedules its tasks by work stealing.
+ *
+ * Each thread of the pool has a queue of its own. Tasks pushed by a
+ * thread of the pool, that is from within @func, are queued for that
+ * thread, while tasks pushed by other threads are spread over all
+ * threads of the pool. A thread that runs out of tasks takes tasks
+ * from the queues of the other threads. Pushing and processing tasks
+ * does not take any lock unless a thread of the pool is idle, which
+ * makes such pools scale better than the ones returned by
+ * g_thread_pool_new() when many threads push tasks at a high rate.
+ *
+ * All @max_threads threads are started immediately, and the number
+ * of threads cannot be changed with g_thread_pool_set_max_threads()
+ * later on. A function set with g_thread_pool_set_sort_function()
+ * is only honoured among the tasks that a thread takes into its
+ * queue at once, so the order of the tasks is approximate.
+ *
+ * While such a pool finishes its remaining tasks after a call to
+ * g_thread_pool_free() with @immediate set to %FALSE, @func may still
+ * push further tasks to it, and these are processed before the pool
+ * goes away.
+ *
+ * @error can be %NULL to ignore errors, or non-%NULL to report
+ * errors. An error occurs when not all @max_threads threads could
+ * be created, in which case no pool is created.
+ *
+ * Return value: the new #GThreadPool, or %NULL if an error occurred
+ *
+ * Since: 2.38
+ */
+GThreadPool *
+g_thread_pool_new_work_stealing (GFunc      func,
+                                 gpointer   user_data,
+                                 gint       max_threads,
+                                 GError   **error)
+{
+  GRealThreadPool *retval;
+  guint i;
+
+  g_return_val_if_fail (func, NULL);
+  g_return_val_if_fail (max_threads > 0 || max_threads == -1, NULL);
+
+  if (max_threads == -1)
+    max_threads = g_get_num_processors ();
+
+  retval = g_new0 (GRealThreadPool, 1);
+
+  retval->pool.func = func;
+  retval->pool.user_data = user_data;
+  retval->pool.exclusive = TRUE;
+  retval->queue = g_async_queue_new ();
+  g_cond_init (&retval->cond);
+  g_mutex_init (&retval->sleep_mutex);
+  retval->max_threads = max_threads;
+  retval->num_threads = max_threads;
+  retval->running = TRUE;
+
+  retval->n_workers = max_threads;
+  retval->workers = g_new (GThreadPoolWorker *, retval->n_workers);
+  for (i = 0; i < retval->n_workers; i++)
+    {
+      GThreadPoolWorker *worker;
+
+      worker = g_new0 (GThreadPoolWorker, 1);
+      worker->pool = retval;
+      worker->index = i;
+      worker->seed = (i + 1) * 2654435761u;
+      worker->array = g_thread_pool_array_new (G_THREAD_POOL_INITIAL_DEQUE_SIZE);
+      retval->workers[i] = worker;
+    }
+
+  /* The workers look at each other, so they are all allocated before
+   * the first one starts.
+   */
+  for (i = 0; i < retval->n_workers; i++)
+    {
+      GThreadPoolWorker *worker = retval->workers[i];
+      GError *local_error = NULL;
+
+      worker->thread = g_thread_try_new ("pool", g_thread_pool_worker_proxy,
+                                         worker, &local_error);
+      if (worker->thread == NULL)
+        {
+          g_propagate_error (error, local_error);
+          g_thread_pool_free_stealing (retval, TRUE, TRUE);
+          return NULL;
+        }
+
+      g_atomic_int_inc (&retval->live_workers);
+    }
+
+  return (GThreadPool*) retval;
+}
+
 /**
  * g_thread_pool_push:
  * @pool: a #GThreadPool
@@ -546,7 +1040,22 @@ g_thread_pool_push (GThreadPool  *pool,
   real = (GRealThreadPool*) pool;
 
   g_return_val_if_fail (real, FALSE);
-  g_return_val_if_fail (real->running, FALSE);
+
+  if (real->workers)
+    {
+      GThreadPoolWorker *worker = g_private_get (&current_worker);
+
+      /* The threads of a pool that is being drained by
+       * g_thread_pool_free() may still push follow-up tasks.
+       */
+      g_return_val_if_fail (g_atomic_int_get (&real->running) ||
+                            (worker != NULL && worker->pool == real &&
+                             !g_atomic_int_get (&real->immediate)), FALSE);
+
+      return g_thread_pool_push_stealing (real, data);
+    }
+
+  g_return_val_if_fail (g_atomic_int_get (&real->running), FALSE);
 
   result = TRUE;
 
@@ -596,6 +1105,9 @@ g_thread_pool_push (GThreadPool  *pool,
  * errors. An error can only occur when a new thread couldn't be
  * created.
  *
+ * The number of threads of a pool created with
+ * g_thread_pool_new_work_stealing() cannot be changed.
+ *
  * Before version 2.32, this function did not return a success status.
  *
  * Return value: %TRUE on success, %FALSE if an error occurred
@@ -615,6 +1127,7 @@ g_thread_pool_set_max_threads (GThreadPool  *pool,
   g_return_val_if_fail (real->running, FALSE);
   g_return_val_if_fail (!real->pool.exclusive || max_threads != -1, FALSE);
   g_return_val_if_fail (max_threads >= -1, FALSE);
+  g_return_val_if_fail (real->workers == NULL, FALSE);
 
   result = TRUE;
 
@@ -715,7 +1228,10 @@ g_thread_pool_unprocessed (GThreadPool *pool)
   g_return_val_if_fail (real, 0);
   g_return_val_if_fail (real->running, 0);
 
-  unprocessed = g_async_queue_length (real->queue);
+  if (real->workers)
+    unprocessed = g_atomic_int_get (&real->unprocessed);
+  else
+    unprocessed = g_async_queue_length (real->queue);
 
   return MAX (unprocessed, 0);
 }
@@ -753,6 +1269,12 @@ g_thread_pool_free (GThreadPool *pool,
   g_return_if_fail (real);
   g_return_if_fail (real->running);
 
+  if (real->workers)
+    {
+      g_thread_pool_free_stealing (real, immediate, wait_);
+      return;
+    }
+
   /* If there's no thread allowed here, there is not much sense in
    * not stopping this pool immediately, when it's not empty
    */
@@ -762,7 +1284,7 @@ g_thread_pool_free (GThreadPool *pool,
 
   g_async_queue_lock (real->queue);
 
-  real->running = FALSE;
+  g_atomic_int_set (&real->running, FALSE);
   real->immediate = immediate;
   real->waiting = wait_;
 
@@ -797,9 +1319,29 @@ g_thread_pool_free (GThreadPool *pool,
 static void
 g_thread_pool_free_internal (GRealThreadPool* pool)
 {
+  guint i;
+
   g_return_if_fail (pool);
   g_return_if_fail (pool->running == FALSE);
-  g_return_if_fail (pool->num_threads == 0);
+  g_return_if_fail (pool->workers != NULL || pool->num_threads == 0);
+
+  if (pool->workers)
+    g_mutex_clear (&pool->sleep_mutex);
+
+  for (i = 0; i < pool->n_workers; i++)
+    {
+      GThreadPoolWorker *worker = pool->workers[i];
+
+      g_slist_free (worker->inbox);
+      g_slist_free_full (worker->retired_arrays, g_free);
+      g_free (worker->array);
+      g_free (worker);
+    }
+  g_free (pool->workers);
+
+  if (pool->sort)
+    g_free (pool->sort);
+  g_slist_free_full (pool->retired_sorts, g_free);
 
   g_async_queue_unref (pool->queue);
   g_cond_clear (&pool->cond);
@@ -940,6 +1482,26 @@ g_thread_pool_set_sort_function (GThreadPool      *pool,
   g_return_if_fail (real);
   g_return_if_fail (real->running);
 
+  if (real->workers)
+    {
+      GThreadPoolSort *sort;
+
+      /* The workers read the function and its data without a lock,
+       * so a new pair is published and the old one is kept around.
+       */
+      sort = g_new (GThreadPoolSort, 1);
+      sort->func = func;
+      sort->user_data = user_data;
+
+      g_mutex_lock (&real->sleep_mutex);
+      if (real->sort)
+        real->retired_sorts = g_slist_prepend (real->retired_sorts, real->sort);
+      g_atomic_pointer_set (&real->sort, sort);
+      g_mutex_unlock (&real->sleep_mutex);
+
+      return;
+    }
+
   g_async_queue_lock (real->queue);
 
   real->sort_func = func;
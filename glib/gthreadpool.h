@@ -53,6 +53,11 @@ GThreadPool *   g_thread_pool_new               (GFunc            func,
                                                  gint             max_threads,
                                                  gboolean         exclusive,
                                                  GError         **error);
+GLIB_AVAILABLE_IN_2_38
+GThreadPool *   g_thread_pool_new_work_stealing (GFunc            func,
+                                                 gpointer         user_data,
+                                                 gint             max_threads,
+                                                 GError         **error);
 GLIB_AVAILABLE_IN_ALL
 void            g_thread_pool_free              (GThreadPool     *pool,
                                                  gboolean         immediate,
@@ -29,6 +29,7 @@
 #include <glib/gbytes.h>
 #include <glib/gslice.h>
 #include <glib/gmem.h>
+#include <glib/ghash.h>
 #include <string.h>
 
 
@@ -45,6 +46,8 @@
  * Most GVariant API functions are in gvariant.c.
  */
 
+typedef struct _GVariantDictIndex GVariantDictIndex;
+
 /**
  * GVariant:
  *
@@ -65,6 +68,7 @@ struct _GVariant
     {
       GBytes *bytes;
       gconstpointer data;
+      GVariantDictIndex *index;
     } serialised;
 
     struct
@@ -161,6 +165,13 @@ struct _GVariant
  *                if .data pointed to the appropriate number of nul
  *                bytes.
  *
+ *     .index: for dictionaries with string or object path keys that
+ *             are looked up often, a hash table from the keys to the
+ *             index of their entry, or %NULL.  It is built by
+ *             g_variant_lookup_indexed() while holding the lock and
+ *             set only once, so it can be read without the lock.  It
+ *             is freed with the instance.
+ *
  *   .tree: Only valid when the instance is in tree form.
  *
  *          Note that accesses from other threads could result in
@@ -203,12 +214,41 @@ struct _GVariant
  *    STATE_FLOATING: if this flag is set then the object has a floating
  *                    reference.  See g_variant_ref_sink().
  *
+ *    STATE_LOOKUPS: for serialised dictionaries, the number of
+ *                   g_variant_lookup_indexed() calls so far, up to the
+ *                   point where the index gets built, or
+ *                   STATE_NO_INDEX if the dictionary is too small to
+ *                   ever get one.  Only changed while holding the lock.
+ *
  * ref_count: the reference count of the instance
  */
 #define STATE_LOCKED     1
 #define STATE_SERIALISED 2
 #define STATE_TRUSTED    4
 #define STATE_FLOATING   8
+#define STATE_LOOKUPS    (7 << 4)
+#define STATE_LOOKUP_ONE (1 << 4)
+#define STATE_NO_INDEX   STATE_LOOKUPS
+
+/* A dictionary gets an index on its DICT_INDEX_MIN_LOOKUPS'th lookup,
+ * if it has at least DICT_INDEX_MIN_ENTRIES entries.  The count has to
+ * fit in STATE_LOOKUPS, below STATE_NO_INDEX.
+ */
+#define DICT_INDEX_MIN_LOOKUPS 4
+#define DICT_INDEX_MIN_ENTRIES 8
+
+typedef struct
+{
+  const gchar *key;             /* NULL for an empty slot */
+  guint        hash;
+  gsize        entry;
+} GVariantDictIndexSlot;
+
+struct _GVariantDictIndex
+{
+  gsize                 mask;
+  GVariantDictIndexSlot slots[1];
+};
 
 /* -- private -- */
 /* < private >
@@ -452,6 +492,7 @@ g_variant_ensure_serialised (GVariant *value)
       bytes = g_bytes_new_take (data, value->size);
       value->contents.serialised.data = g_bytes_get_data (bytes, NULL);
       value->contents.serialised.bytes = bytes;
+      value->contents.serialised.index = NULL;
       value->state |= STATE_SERIALISED;
     }
 }
@@ -482,6 +523,7 @@ g_variant_alloc (const GVariantType *type,
                  STATE_FLOATING;
   value->size = (gssize) -1;
   value->ref_count = 1;
+  value->contents.serialised.index = NULL;
 
   return value;
 }
@@ -538,6 +580,36 @@ g_variant_new_from_bytes (const GVariantType *type,
   return value;
 }
 
+/* < private >
+ * g_variant_new_serialised_child:
+ * @value: a serialised container #GVariant
+ * @s_child: the serialised data of a child of @value.  Consumed.
+ *
+ * Creates a new serialised instance for a child (or grandchild) of
+ * @value, sharing its bytes.
+ *
+ * Returns: a new, non-floating #GVariant
+ */
+static GVariant *
+g_variant_new_serialised_child (GVariant           *value,
+                                GVariantSerialised  s_child)
+{
+  GVariant *child;
+
+  child = g_slice_new (GVariant);
+  child->type_info = s_child.type_info;
+  child->state = (value->state & STATE_TRUSTED) |
+                 STATE_SERIALISED;
+  child->size = s_child.size;
+  child->ref_count = 1;
+  child->contents.serialised.bytes =
+    g_bytes_ref (value->contents.serialised.bytes);
+  child->contents.serialised.data = s_child.data;
+  child->contents.serialised.index = NULL;
+
+  return child;
+}
+
 /* -- internal -- */
 
 /* < internal >
@@ -609,6 +681,297 @@ g_variant_is_trusted (GVariant *value)
   return (value->state & STATE_TRUSTED) != 0;
 }
 
+/* < private >
+ * g_variant_dict_index_get_key:
+ * @entry: a serialised dictionary entry with a string or object path key
+ * @trusted: if @entry is trusted
+ *
+ * Gets the key of @entry the way that g_variant_get_string() would see
+ * it, without creating any instances.
+ *
+ * Returns: the key of @entry, valid as long as its container
+ */
+static const gchar *
+g_variant_dict_index_get_key (GVariantSerialised entry,
+                              gboolean           trusted)
+{
+  GVariantSerialised key;
+  const gchar *str;
+
+  key = g_variant_serialised_get_child (entry, 0);
+  str = (const gchar *) key.data;
+
+  if (!trusted)
+    {
+      if (g_variant_type_info_get_type_char (key.type_info) == G_VARIANT_CLASS_OBJECT_PATH)
+        {
+          if (!g_variant_serialiser_is_object_path (key.data, key.size))
+            str = "/";
+        }
+      else if (!g_variant_serialiser_is_string (key.data, key.size))
+        str = "";
+    }
+
+  g_variant_type_info_unref (key.type_info);
+
+  return str;
+}
+
+/* < private >
+ * g_variant_dict_index_new:
+ * @value: a serialised dictionary with string or object path keys
+ * @n_entries: the number of entries in @value
+ *
+ * Builds the index for g_variant_lookup_indexed().  The keys in the
+ * index point into the serialised data of @value.
+ *
+ * Returns: a new index, to be freed with g_free()
+ */
+static GVariantDictIndex *
+g_variant_dict_index_new (GVariant *value,
+                          gsize     n_entries)
+{
+  GVariantSerialised serialised = {
+    value->type_info,
+    (gpointer) value->contents.serialised.data,
+    value->size
+  };
+  gboolean trusted = (value->state & STATE_TRUSTED) != 0;
+  GVariantDictIndex *index;
+  gsize size;
+  gsize i;
+
+  /* keep it at most half full */
+  for (size = DICT_INDEX_MIN_ENTRIES * 2; size < n_entries * 2; size *= 2)
+    ;
+
+  index = g_malloc0 (sizeof (GVariantDictIndex) +
+                     (size - 1) * sizeof (GVariantDictIndexSlot));
+  index->mask = size - 1;
+
+  for (i = 0; i < n_entries; i++)
+    {
+      GVariantSerialised entry;
+      const gchar *key;
+      guint hash;
+      gsize j;
+
+      entry = g_variant_serialised_get_child (serialised, i);
+      key = g_variant_dict_index_get_key (entry, trusted);
+      g_variant_type_info_unref (entry.type_info);
+
+      hash = g_str_hash (key);
+
+      /* if a key appears more than once, the first one wins, just like
+       * with a linear search
+       */
+      for (j = hash & index->mask; index->slots[j].key; j = (j + 1) & index->mask)
+        if (index->slots[j].hash == hash && strcmp (index->slots[j].key, key) == 0)
+          break;
+
+      if (index->slots[j].key == NULL)
+        {
+          index->slots[j].key = key;
+          index->slots[j].hash = hash;
+          index->slots[j].entry = i;
+        }
+    }
+
+  return index;
+}
+
+/* < internal >
+ * g_variant_lookup_indexed:
+ * @dictionary: a dictionary #GVariant with string or object path keys
+ * @key: the key to look up
+ * @value: (out) (transfer full): return location for the value
+ *
+ * Looks up @key in the index of @dictionary.
+ *
+ * Serialised dictionaries with more than a few entries get an index
+ * once they have been looked up a few times.  Until then, and for all
+ * other dictionaries, this function returns %FALSE and the caller has
+ * to search @dictionary itself.
+ *
+ * Returns: %TRUE if @value was set to the value of the first entry
+ *          for @key, or to %NULL if there is no such entry
+ */
+gboolean
+g_variant_lookup_indexed (GVariant     *dictionary,
+                          const gchar  *key,
+                          GVariant    **value)
+{
+  GVariantDictIndex *index;
+  gint state;
+  guint hash;
+  gsize i;
+
+  /* small dictionaries are marked as such on their first lookup, so
+   * that later lookups give up here without taking the lock
+   */
+  state = g_atomic_int_get (&dictionary->state);
+  if (~state & STATE_SERIALISED || (state & STATE_LOOKUPS) == STATE_NO_INDEX)
+    return FALSE;
+
+  index = g_atomic_pointer_get (&dictionary->contents.serialised.index);
+
+  if (index == NULL)
+    {
+      g_variant_lock (dictionary);
+
+      index = dictionary->contents.serialised.index;
+
+      if (index == NULL && (dictionary->state & STATE_LOOKUPS) != STATE_NO_INDEX)
+        {
+          GVariantSerialised serialised = {
+            dictionary->type_info,
+            (gpointer) dictionary->contents.serialised.data,
+            dictionary->size
+          };
+
+          if ((dictionary->state & STATE_LOOKUPS) == 0 &&
+              g_variant_serialised_n_children (serialised) < DICT_INDEX_MIN_ENTRIES)
+            dictionary->state |= STATE_NO_INDEX;
+          else if ((dictionary->state & STATE_LOOKUPS) < DICT_INDEX_MIN_LOOKUPS * STATE_LOOKUP_ONE)
+            dictionary->state += STATE_LOOKUP_ONE;
+          else
+            {
+              index = g_variant_dict_index_new (dictionary, g_variant_serialised_n_children (serialised));
+              g_atomic_pointer_set (&dictionary->contents.serialised.index, index);
+            }
+        }
+
+      g_variant_unlock (dictionary);
+
+      if (index == NULL)
+        return FALSE;
+    }
+
+  hash = g_str_hash (key);
+
+  for (i = hash & index->mask; index->slots[i].key; i = (i + 1) & index->mask)
+    if (index->slots[i].hash == hash && strcmp (index->slots[i].key, key) == 0)
+      {
+        GVariantSerialised serialised = {
+          dictionary->type_info,
+          (gpointer) dictionary->contents.serialised.data,
+          dictionary->size
+        };
+        GVariantSerialised entry;
+
+        entry = g_variant_serialised_get_child (serialised, index->slots[i].entry);
+        *value = g_variant_new_serialised_child (dictionary, g_variant_serialised_get_child (entry, 1));
+        g_variant_type_info_unref (entry.type_info);
+
+        return TRUE;
+      }
+
+  *value = NULL;
+
+  return TRUE;
+}
+
+/* Compares the key of entry @index of @dictionary with @key (or with
+ * @uint_key, if @key is %NULL), like strcmp() does.
+ */
+static gint
+g_variant_sorted_dict_compare (GVariantSerialised  dictionary,
+                               gsize               index,
+                               gboolean            trusted,
+                               const gchar        *key,
+                               guint32             uint_key)
+{
+  GVariantSerialised entry;
+  gint result;
+
+  entry = g_variant_serialised_get_child (dictionary, index);
+
+  if (key != NULL)
+    result = strcmp (g_variant_dict_index_get_key (entry, trusted), key);
+  else
+    {
+      GVariantSerialised entry_key;
+      guint32 entry_uint_key = 0;
+
+      /* the data is NULL if the entry is invalid; then the key is 0,
+       * just like g_variant_get_uint32() would see it
+       */
+      entry_key = g_variant_serialised_get_child (entry, 0);
+      if (entry_key.data != NULL)
+        memcpy (&entry_uint_key, entry_key.data, sizeof entry_uint_key);
+      g_variant_type_info_unref (entry_key.type_info);
+
+      result = (entry_uint_key > uint_key) - (entry_uint_key < uint_key);
+    }
+
+  g_variant_type_info_unref (entry.type_info);
+
+  return result;
+}
+
+/* < internal >
+ * g_variant_lookup_sorted:
+ * @dictionary: a dictionary #GVariant with string, object path or
+ *              uint32 keys, sorted by key
+ * @key: (allow-none): the key to look up, or %NULL for uint32 keys
+ * @uint_key: the key to look up if @key is %NULL
+ *
+ * Binary searches the serialised form of @dictionary for the first
+ * entry with the given key.  No instances are created except for the
+ * returned value.
+ *
+ * If @dictionary is not sorted then the result is undefined (but
+ * safe, even for untrusted data).
+ *
+ * Returns: (allow-none) (transfer full): the value of the entry, or
+ *          %NULL if there is no entry for the key
+ */
+GVariant *
+g_variant_lookup_sorted (GVariant    *dictionary,
+                         const gchar *key,
+                         guint32      uint_key)
+{
+  GVariantSerialised serialised;
+  GVariantSerialised entry;
+  gboolean trusted;
+  gsize lower, upper;
+  gsize n_entries;
+  GVariant *value;
+
+  /* the serialised form never changes once it exists */
+  g_variant_get_data (dictionary);
+
+  serialised.type_info = dictionary->type_info;
+  serialised.data = (gpointer) dictionary->contents.serialised.data;
+  serialised.size = dictionary->size;
+  trusted = (dictionary->state & STATE_TRUSTED) != 0;
+
+  n_entries = g_variant_serialised_n_children (serialised);
+
+  /* find the first entry that is not less than the key */
+  lower = 0;
+  upper = n_entries;
+  while (lower < upper)
+    {
+      gsize middle = lower + (upper - lower) / 2;
+
+      if (g_variant_sorted_dict_compare (serialised, middle, trusted, key, uint_key) < 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  if (lower == n_entries ||
+      g_variant_sorted_dict_compare (serialised, lower, trusted, key, uint_key) != 0)
+    return NULL;
+
+  entry = g_variant_serialised_get_child (serialised, lower);
+  value = g_variant_new_serialised_child (dictionary, g_variant_serialised_get_child (entry, 1));
+  g_variant_type_info_unref (entry.type_info);
+
+  return value;
+}
+
 /* -- public -- */
 
 /**
@@ -637,7 +1000,10 @@ g_variant_unref (GVariant *value)
       g_variant_type_info_unref (value->type_info);
 
       if (value->state & STATE_SERIALISED)
-        g_bytes_unref (value->contents.serialised.bytes);
+        {
+          g_bytes_unref (value->contents.serialised.bytes);
+          g_free (value->contents.serialised.index);
+        }
       else
         g_variant_release_children (value);
 
@@ -1000,25 +1366,13 @@ g_variant_get_child_value (GVariant *value,
       value->size
     };
     GVariantSerialised s_child;
-    GVariant *child;
 
     /* get the serialiser to extract the serialised data for the child
      * from the serialised data for the container
      */
     s_child = g_variant_serialised_get_child (serialised, index_);
 
-    /* create a new serialised instance out of it */
-    child = g_slice_new (GVariant);
-    child->type_info = s_child.type_info;
-    child->state = (value->state & STATE_TRUSTED) |
-                   STATE_SERIALISED;
-    child->size = s_child.size;
-    child->ref_count = 1;
-    child->contents.serialised.bytes =
-      g_bytes_ref (value->contents.serialised.bytes);
-    child->contents.serialised.data = s_child.data;
-
-    return child;
+    return g_variant_new_serialised_child (value, s_child);
   }
 }
 
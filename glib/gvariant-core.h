@@ -36,4 +36,12 @@ gboolean                g_variant_is_trusted                            (GVarian
 
 GVariantTypeInfo *      g_variant_get_type_info                         (GVariant            *value);
 
+gboolean                g_variant_lookup_indexed                        (GVariant            *dictionary,
+                                                                         const gchar         *key,
+                                                                         GVariant           **value);
+
+GVariant *              g_variant_lookup_sorted                         (GVariant            *dictionary,
+                                                                         const gchar         *key,
+                                                                         guint32              uint_key);
+
 #endif /* __G_VARIANT_CORE_H__ */
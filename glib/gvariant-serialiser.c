@@ -484,6 +484,33 @@ gvs_fixed_sized_array_serialise (GVariantSerialised        value,
     }
 }
 
+/* Checks that each of the @size bytes at @data is 0 or 1.
+ *
+ * This ors the data together a word at a time (which compilers are
+ * happy to vectorise further) instead of checking byte by byte.
+ */
+static gboolean
+gvs_bytes_are_booleans (const guchar *data,
+                        gsize         size)
+{
+  const gsize ones = G_MAXSIZE / 0xff;
+  gsize accumulated = 0;
+  gsize i = 0;
+
+  for (; i + sizeof (gsize) <= size; i += sizeof (gsize))
+    {
+      gsize word;
+
+      memcpy (&word, data + i, sizeof word);
+      accumulated |= word;
+    }
+
+  for (; i < size; i++)
+    accumulated |= data[i];
+
+  return (accumulated & ~ones) == 0;
+}
+
 static gboolean
 gvs_fixed_sized_array_is_normal (GVariantSerialised value)
 {
@@ -495,6 +522,21 @@ gvs_fixed_sized_array_is_normal (GVariantSerialised value)
   if (value.size % child.size != 0)
     return FALSE;
 
+  /* avoid visiting each element for the basic types */
+  switch (g_variant_type_info_get_type_char (child.type_info))
+    {
+    case 'b':
+      return gvs_bytes_are_booleans (value.data, value.size);
+
+    case 'y': case 'n': case 'q': case 'i': case 'u':
+    case 'x': case 't': case 'h': case 'd':
+      /* all values are valid; see g_variant_serialised_is_normal() */
+      return TRUE;
+
+    default:
+      break;
+    }
+
   for (child.data = value.data;
        child.data < value.data + value.size;
        child.data += child.size)
@@ -1440,8 +1482,103 @@ g_variant_serialiser_needed_size (GVariantTypeInfo         *type_info,
   g_assert_not_reached ();
 }
 
+/* < private >
+ * g_variant_serialiser_array_size:
+ * @body_size: the size of the serialised children of the array
+ * @n_children: the number of children
+ *
+ * Determines the total size of a variable-sized array whose children
+ * take up @body_size bytes (including alignment padding), once the
+ * framing offsets are added.
+ *
+ * This is used by the serialised mode of #GVariantBuilder, which writes
+ * the children of an array directly into a buffer as they are added
+ * and only adds the framing at the end.
+ */
+gsize
+g_variant_serialiser_array_size (gsize body_size,
+                                 gsize n_children)
+{
+  return gvs_calculate_total_size (body_size, n_children);
+}
+
+/* < private >
+ * g_variant_serialiser_write_array_offsets:
+ * @data: the start of a variable-sized array
+ * @size: the total size of the array, from
+ *        g_variant_serialiser_array_size()
+ * @ends: the end offset of each child, relative to @data
+ * @n_children: the number of children
+ *
+ * Writes the framing offsets of a variable-sized array whose children
+ * are already in place at the start of @data.
+ */
+void
+g_variant_serialiser_write_array_offsets (guchar      *data,
+                                          gsize        size,
+                                          const gsize *ends,
+                                          gsize        n_children)
+{
+  guchar *offset_ptr;
+  gsize offset_size;
+  gsize i;
+
+  offset_size = gvs_get_offset_size (size);
+  offset_ptr = data + size - offset_size * n_children;
+
+  for (i = 0; i < n_children; i++)
+    {
+      gvs_write_unaligned_le (offset_ptr, ends[i], offset_size);
+      offset_ptr += offset_size;
+    }
+}
+
 /* Byteswapping {{{2 */
 
+/* Byteswaps each of the @width-byte integers in the @size bytes at
+ * @data.  These loops are simple enough for compilers to vectorise.
+ */
+static void
+gvs_byteswap_integers (guchar *data,
+                       gsize   size,
+                       gsize   width)
+{
+  gsize i;
+
+  switch (width)
+    {
+    case 2:
+      {
+        guint16 *ptr = (guint16 *) data;
+
+        for (i = 0; i < size / 2; i++)
+          ptr[i] = GUINT16_SWAP_LE_BE (ptr[i]);
+      }
+      break;
+
+    case 4:
+      {
+        guint32 *ptr = (guint32 *) data;
+
+        for (i = 0; i < size / 4; i++)
+          ptr[i] = GUINT32_SWAP_LE_BE (ptr[i]);
+      }
+      break;
+
+    case 8:
+      {
+        guint64 *ptr = (guint64 *) data;
+
+        for (i = 0; i < size / 8; i++)
+          ptr[i] = GUINT64_SWAP_LE_BE (ptr[i]);
+      }
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+}
+
 /* < private >
  * g_variant_serialised_byteswap:
  * @value: a #GVariantSerialised
@@ -1452,6 +1589,7 @@ g_variant_serialiser_needed_size (GVariantTypeInfo         *type_info,
 void
 g_variant_serialised_byteswap (GVariantSerialised serialised)
 {
+  gsize children, i;
   gsize fixed_size;
   guint alignment;
 
@@ -1508,23 +1646,41 @@ g_variant_serialised_byteswap (GVariantSerialised serialised)
       }
     }
 
-  /* else, we have a container that potentially contains
-   * some children that need to be byteswapped.
+  /* arrays of integers (or of things that are swapped like one, as
+   * above) can be swapped in one go instead of element by element.
    */
-  else
+  if (g_variant_type_info_get_type_char (serialised.type_info) ==
+      G_VARIANT_TYPE_INFO_CHAR_ARRAY)
     {
-      gsize children, i;
+      gsize element_fixed_size;
+      guint element_alignment;
 
-      children = g_variant_serialised_n_children (serialised);
-      for (i = 0; i < children; i++)
-        {
-          GVariantSerialised child;
+      g_variant_type_info_query_element (serialised.type_info,
+                                         &element_alignment,
+                                         &element_fixed_size);
 
-          child = g_variant_serialised_get_child (serialised, i);
-          g_variant_serialised_byteswap (child);
-          g_variant_type_info_unref (child.type_info);
+      if (element_alignment + 1 == element_fixed_size)
+        {
+          /* an array with an uneven size has no elements */
+          if (serialised.size % element_fixed_size == 0)
+            gvs_byteswap_integers (serialised.data, serialised.size,
+                                   element_fixed_size);
+          return;
         }
     }
+
+  /* else, we have a container that potentially contains
+   * some children that need to be byteswapped.
+   */
+  children = g_variant_serialised_n_children (serialised);
+  for (i = 0; i < children; i++)
+    {
+      GVariantSerialised child;
+
+      child = g_variant_serialised_get_child (serialised, i);
+      g_variant_serialised_byteswap (child);
+      g_variant_type_info_unref (child.type_info);
+    }
 }
 
 /* Normal form checking {{{2 */
@@ -1597,8 +1753,10 @@ gboolean
 g_variant_serialiser_is_string (gconstpointer data,
                                 gsize         size)
 {
+  const gsize ones = G_MAXSIZE / 0xff;
   const gchar *expected_end;
   const gchar *end;
+  gsize i;
 
   if (size == 0)
     return FALSE;
@@ -1608,7 +1766,23 @@ g_variant_serialiser_is_string (gconstpointer data,
   if (*expected_end != '\0')
     return FALSE;
 
-  g_utf8_validate (data, size, &end);
+  /* Skip over plain ASCII a word at a time.  A word containing a nul
+   * or a non-ASCII byte always has a high bit set in (word - ones) or
+   * in word itself; g_utf8_validate() checks the rest from there.
+   */
+  i = 0;
+  while (i + sizeof (gsize) < size)
+    {
+      gsize word;
+
+      memcpy (&word, (const gchar *) data + i, sizeof word);
+      if ((word | (word - ones)) & (ones << 7))
+        break;
+
+      i += sizeof word;
+    }
+
+  g_utf8_validate ((const gchar *) data + i, size - i, &end);
 
   return end == expected_end;
 }
@@ -55,6 +55,13 @@ void                            g_variant_serialiser_serialise          (GVarian
                                                                          const gpointer           *children,
                                                                          gsize                     n_children);
 
+gsize                           g_variant_serialiser_array_size         (gsize                     body_size,
+                                                                         gsize                     n_children);
+void                            g_variant_serialiser_write_array_offsets (guchar                  *data,
+                                                                          gsize                    size,
+                                                                          const gsize             *ends,
+                                                                          gsize                    n_children);
+
 /* misc */
 GLIB_AVAILABLE_IN_ALL
 gboolean                        g_variant_serialised_is_normal          (GVariantSerialised        value);
@@ -31,6 +31,8 @@
 #include <glib/gstrfuncs.h>
 #include <glib/gslice.h>
 #include <glib/ghash.h>
+#include <glib/gqsort.h>
+#include <glib/galloca.h>
 #include <glib/gmem.h>
 
 #include <string.h>
@@ -995,6 +997,38 @@ g_variant_lookup (GVariant    *dictionary,
     return FALSE;
 }
 
+/* The common end of the g_variant_lookup_value() functions: unboxes a
+ * variant @value and checks its type.  Consumes @value.
+ */
+static GVariant *
+g_variant_lookup_check_value (GVariant           *value,
+                              const GVariantType *expected_type)
+{
+  if (value == NULL)
+    return NULL;
+
+  if (g_variant_is_of_type (value, G_VARIANT_TYPE_VARIANT))
+    {
+      GVariant *tmp;
+
+      tmp = g_variant_get_variant (value);
+      g_variant_unref (value);
+
+      if (expected_type && !g_variant_is_of_type (tmp, expected_type))
+        {
+          g_variant_unref (tmp);
+          tmp = NULL;
+        }
+
+      value = tmp;
+    }
+
+  g_return_val_if_fail (expected_type == NULL || value == NULL ||
+                        g_variant_is_of_type (value, expected_type), NULL);
+
+  return value;
+}
+
 /**
  * g_variant_lookup_value:
  * @dictionary: a dictionary #GVariant
@@ -1023,6 +1057,10 @@ g_variant_lookup (GVariant    *dictionary,
  * returned.  If @expected_type was specified then any non-%NULL return
  * value will have this type.
  *
+ * Dictionaries are searched linearly at first.  Serialised
+ * dictionaries that are looked up repeatedly get an index, which
+ * makes further lookups on the same instance O(1).
+ *
  * Returns: (transfer full): the value of the dictionary key, or %NULL
  *
  * Since: 2.28
@@ -1042,49 +1080,109 @@ g_variant_lookup_value (GVariant           *dictionary,
                                               G_VARIANT_TYPE ("a{o*}")),
                         NULL);
 
-  g_variant_iter_init (&iter, dictionary);
-
-  while ((entry = g_variant_iter_next_value (&iter)))
+  if (g_variant_lookup_indexed (dictionary, key, &value))
+    {
+      if (value == NULL)
+        return NULL;
+    }
+  else
     {
-      GVariant *entry_key;
-      gboolean matches;
+      g_variant_iter_init (&iter, dictionary);
 
-      entry_key = g_variant_get_child_value (entry, 0);
-      matches = strcmp (g_variant_get_string (entry_key, NULL), key) == 0;
-      g_variant_unref (entry_key);
+      while ((entry = g_variant_iter_next_value (&iter)))
+        {
+          GVariant *entry_key;
+          gboolean matches;
 
-      if (matches)
-        break;
+          entry_key = g_variant_get_child_value (entry, 0);
+          matches = strcmp (g_variant_get_string (entry_key, NULL), key) == 0;
+          g_variant_unref (entry_key);
 
-      g_variant_unref (entry);
-    }
+          if (matches)
+            break;
 
-  if (entry == NULL)
-    return NULL;
+          g_variant_unref (entry);
+        }
 
-  value = g_variant_get_child_value (entry, 1);
-  g_variant_unref (entry);
+      if (entry == NULL)
+        return NULL;
 
-  if (g_variant_is_of_type (value, G_VARIANT_TYPE_VARIANT))
-    {
-      GVariant *tmp;
+      value = g_variant_get_child_value (entry, 1);
+      g_variant_unref (entry);
+    }
 
-      tmp = g_variant_get_variant (value);
-      g_variant_unref (value);
+  return g_variant_lookup_check_value (value, expected_type);
+}
 
-      if (expected_type && !g_variant_is_of_type (tmp, expected_type))
-        {
-          g_variant_unref (tmp);
-          tmp = NULL;
-        }
+/**
+ * g_variant_lookup_value_sorted:
+ * @dictionary: a dictionary #GVariant with string keys, sorted by key
+ * @key: the key to lookup in the dictionary
+ * @expected_type: (allow-none): a #GVariantType, or %NULL
+ *
+ * Looks up a value in a sorted dictionary #GVariant.
+ *
+ * This is the same as g_variant_lookup_value(), except that the entries
+ * of @dictionary must be sorted by key, in the order of strcmp(), as
+ * g_variant_builder_init_sorted() does.  The serialised data of
+ * @dictionary is then searched with a binary search, without creating
+ * any #GVariant instances for the entries.  This makes lookups in big
+ * dictionaries cheap even if they are only done once per instance, for
+ * example in tables that are loaded from a memory-mapped file with
+ * g_variant_new_from_data().
+ *
+ * If @dictionary is not sorted, it is unspecified which value, if any,
+ * is returned.  If there are several entries for @key, the first one is
+ * returned.
+ *
+ * Returns: (transfer full): the value of the dictionary key, or %NULL
+ *
+ * Since: 2.38
+ */
+GVariant *
+g_variant_lookup_value_sorted (GVariant           *dictionary,
+                               const gchar        *key,
+                               const GVariantType *expected_type)
+{
+  g_return_val_if_fail (g_variant_is_of_type (dictionary,
+                                              G_VARIANT_TYPE ("a{s*}")) ||
+                        g_variant_is_of_type (dictionary,
+                                              G_VARIANT_TYPE ("a{o*}")),
+                        NULL);
+  g_return_val_if_fail (key != NULL, NULL);
 
-      value = tmp;
-    }
+  return g_variant_lookup_check_value (g_variant_lookup_sorted (dictionary, key, 0),
+                                       expected_type);
+}
 
-  g_return_val_if_fail (expected_type == NULL || value == NULL ||
-                        g_variant_is_of_type (value, expected_type), NULL);
+/**
+ * g_variant_lookup_value_sorted_uint32:
+ * @dictionary: a dictionary #GVariant with uint32 keys, sorted by key
+ * @key: the key to lookup in the dictionary
+ * @expected_type: (allow-none): a #GVariantType, or %NULL
+ *
+ * Looks up a value in a sorted dictionary #GVariant of type
+ * <literal>a{u*}</literal>.
+ *
+ * This is the same as g_variant_lookup_value_sorted(), except for the
+ * key type.  The entries of @dictionary must be sorted by key, in
+ * ascending numerical order.
+ *
+ * Returns: (transfer full): the value of the dictionary key, or %NULL
+ *
+ * Since: 2.38
+ */
+GVariant *
+g_variant_lookup_value_sorted_uint32 (GVariant           *dictionary,
+                                      guint32             key,
+                                      const GVariantType *expected_type)
+{
+  g_return_val_if_fail (g_variant_is_of_type (dictionary,
+                                              G_VARIANT_TYPE ("a{u*}")),
+                        NULL);
 
-  return value;
+  return g_variant_lookup_check_value (g_variant_lookup_sorted (dictionary, NULL, key),
+                                       expected_type);
 }
 
 /**
@@ -3133,6 +3231,14 @@ g_variant_iter_next_value (GVariantIter *iter)
  * access it from more than one thread.
  **/
 
+/* The buffer that a builder in serialised mode writes into */
+typedef struct
+{
+  guchar *data;
+  gsize size;
+  gsize allocated;
+} GVariantStream;
+
 struct stack_builder
 {
   GVariantBuilder *parent;
@@ -3166,6 +3272,28 @@ struct stack_builder
    */
   guint trusted : 1;
 
+  /* set to '1' if the children are written directly into 'stream' in
+   * serialised form instead of being kept in 'children'
+   */
+  guint serialised : 1;
+
+  /* set to '1' if the entries of the dictionary are to be sorted by
+   * key when the builder is ended
+   */
+  guint sorted : 1;
+
+  /* serialised mode only: the buffer (shared with the parent builder),
+   * where our container starts in it, the type info of our container,
+   * the end offset of each child relative to 'stream_start' (not kept
+   * for arrays of fixed-sized elements) and, for variants, the type
+   * info of the child.
+   */
+  GVariantStream *stream;
+  gsize stream_start;
+  GVariantTypeInfo *type_info;
+  gsize *ends;
+  GVariantTypeInfo *child_info;
+
   gsize magic;
 };
 
@@ -3303,10 +3431,27 @@ g_variant_builder_clear (GVariantBuilder *builder)
 
   g_variant_type_free (GVSB(builder)->type);
 
-  for (i = 0; i < GVSB(builder)->offset; i++)
-    g_variant_unref (GVSB(builder)->children[i]);
+  if (GVSB(builder)->serialised)
+    {
+      /* the stream belongs to the outermost builder */
+      if (GVSB(builder)->parent == NULL && GVSB(builder)->stream != NULL)
+        {
+          g_free (GVSB(builder)->stream->data);
+          g_slice_free (GVariantStream, GVSB(builder)->stream);
+        }
+
+      g_variant_type_info_unref (GVSB(builder)->type_info);
+      if (GVSB(builder)->child_info)
+        g_variant_type_info_unref (GVSB(builder)->child_info);
+      g_free (GVSB(builder)->ends);
+    }
+  else
+    {
+      for (i = 0; i < GVSB(builder)->offset; i++)
+        g_variant_unref (GVSB(builder)->children[i]);
 
-  g_free (GVSB(builder)->children);
+      g_free (GVSB(builder)->children);
+    }
 
   if (GVSB(builder)->parent)
     {
@@ -3317,50 +3462,14 @@ g_variant_builder_clear (GVariantBuilder *builder)
   memset (builder, 0, sizeof (GVariantBuilder));
 }
 
-/**
- * g_variant_builder_init: (skip)
- * @builder: a #GVariantBuilder
- * @type: a container type
- *
- * Initialises a #GVariantBuilder structure.
- *
- * @type must be non-%NULL.  It specifies the type of container to
- * construct.  It can be an indefinite type such as
- * %G_VARIANT_TYPE_ARRAY or a definite type such as "as" or "(ii)".
- * Maybe, array, tuple, dictionary entry and variant-typed values may be
- * constructed.
- *
- * After the builder is initialised, values are added using
- * g_variant_builder_add_value() or g_variant_builder_add().
- *
- * After all the child values are added, g_variant_builder_end() frees
- * the memory associated with the builder and returns the #GVariant that
- * was created.
- *
- * This function completely ignores the previous contents of @builder.
- * On one hand this means that it is valid to pass in completely
- * uninitialised memory.  On the other hand, this means that if you are
- * initialising over top of an existing #GVariantBuilder you need to
- * first call g_variant_builder_clear() in order to avoid leaking
- * memory.
- *
- * You must not call g_variant_builder_ref() or
- * g_variant_builder_unref() on a #GVariantBuilder that was initialised
- * with this function.  If you ever pass a reference to a
- * #GVariantBuilder outside of the control of your own code then you
- * should assume that the person receiving that reference may try to use
- * reference counting; you should use g_variant_builder_new() instead of
- * this function.
- *
- * Since: 2.24
- **/
-void
-g_variant_builder_init (GVariantBuilder    *builder,
-                        const GVariantType *type)
+/* Common part of g_variant_builder_init() and
+ * g_variant_builder_init_stream(): everything except allocating the
+ * space for the children.
+ */
+static void
+g_variant_builder_setup (GVariantBuilder    *builder,
+                         const GVariantType *type)
 {
-  g_return_if_fail (type != NULL);
-  g_return_if_fail (g_variant_type_is_container (type));
-
   memset (builder, 0, sizeof (GVariantBuilder));
 
   GVSB(builder)->type = g_variant_type_copy (type);
@@ -3424,7 +3533,53 @@ g_variant_builder_init (GVariantBuilder    *builder,
     default:
       g_assert_not_reached ();
    }
+}
+
+/**
+ * g_variant_builder_init: (skip)
+ * @builder: a #GVariantBuilder
+ * @type: a container type
+ *
+ * Initialises a #GVariantBuilder structure.
+ *
+ * @type must be non-%NULL.  It specifies the type of container to
+ * construct.  It can be an indefinite type such as
+ * %G_VARIANT_TYPE_ARRAY or a definite type such as "as" or "(ii)".
+ * Maybe, array, tuple, dictionary entry and variant-typed values may be
+ * constructed.
+ *
+ * After the builder is initialised, values are added using
+ * g_variant_builder_add_value() or g_variant_builder_add().
+ *
+ * After all the child values are added, g_variant_builder_end() frees
+ * the memory associated with the builder and returns the #GVariant that
+ * was created.
+ *
+ * This function completely ignores the previous contents of @builder.
+ * On one hand this means that it is valid to pass in completely
+ * uninitialised memory.  On the other hand, this means that if you are
+ * initialising over top of an existing #GVariantBuilder you need to
+ * first call g_variant_builder_clear() in order to avoid leaking
+ * memory.
+ *
+ * You must not call g_variant_builder_ref() or
+ * g_variant_builder_unref() on a #GVariantBuilder that was initialised
+ * with this function.  If you ever pass a reference to a
+ * #GVariantBuilder outside of the control of your own code then you
+ * should assume that the person receiving that reference may try to use
+ * reference counting; you should use g_variant_builder_new() instead of
+ * this function.
+ *
+ * Since: 2.24
+ **/
+void
+g_variant_builder_init (GVariantBuilder    *builder,
+                        const GVariantType *type)
+{
+  g_return_if_fail (type != NULL);
+  g_return_if_fail (g_variant_type_is_container (type));
 
+  g_variant_builder_setup (builder, type);
   GVSB(builder)->children = g_new (GVariant *,
                                    GVSB(builder)->allocated_children);
 }
@@ -3440,6 +3595,560 @@ g_variant_builder_make_room (struct stack_builder *builder)
     }
 }
 
+/* Serialised mode: helpers */
+static guchar *
+g_variant_stream_reserve (GVariantStream *stream,
+                          gsize           size)
+{
+  guchar *data;
+
+  if (stream->size + size > stream->allocated)
+    {
+      stream->allocated = MAX (stream->allocated * 2, stream->size + size);
+      stream->allocated = MAX (stream->allocated, 64);
+      stream->data = g_realloc (stream->data, stream->allocated);
+    }
+
+  data = stream->data + stream->size;
+  stream->size += size;
+
+  return data;
+}
+
+static void
+g_variant_stream_align (GVariantStream *stream,
+                        guint           alignment)
+{
+  gsize padding;
+
+  padding = (-stream->size) & alignment;
+
+  if (padding)
+    memset (g_variant_stream_reserve (stream, padding), 0, padding);
+}
+
+static void
+g_variant_builder_init_stream (GVariantBuilder    *builder,
+                               const GVariantType *type,
+                               GVariantStream     *stream)
+{
+  gsize fixed_size;
+  guint alignment;
+
+  g_variant_builder_setup (builder, type);
+
+  GVSB(builder)->serialised = TRUE;
+  GVSB(builder)->stream = stream;
+  GVSB(builder)->type_info = g_variant_type_info_get (type);
+
+  g_variant_type_info_query (GVSB(builder)->type_info, &alignment, NULL);
+  g_variant_stream_align (stream, alignment);
+  GVSB(builder)->stream_start = stream->size;
+
+  /* the children of a fixed-sized array are located by their index */
+  fixed_size = 0;
+  if (g_variant_type_is_array (type))
+    g_variant_type_info_query_element (GVSB(builder)->type_info,
+                                       NULL, &fixed_size);
+
+  if (!fixed_size)
+    GVSB(builder)->ends = g_new (gsize, GVSB(builder)->allocated_children);
+}
+
+/**
+ * g_variant_builder_init_serialised: (skip)
+ * @builder: a #GVariantBuilder
+ * @type: a definite container type
+ *
+ * Initialises a #GVariantBuilder structure in serialised mode.
+ *
+ * This is the same as g_variant_builder_init() except that the
+ * children are written out in serialised form as soon as they are
+ * added, instead of being kept around as individual #GVariant
+ * instances until g_variant_builder_end() is called.  The framing
+ * information of each container is filled in when it is closed.
+ *
+ * This makes building large containers much cheaper: the builder only
+ * needs a single growing buffer for the whole value, and
+ * g_variant_builder_add() with a format string that contains only
+ * basic types, tuples and dictionary entries does not create any
+ * intermediate #GVariant at all.  The value returned from
+ * g_variant_builder_end() is already in serialised form.
+ *
+ * Unlike with g_variant_builder_init(), @type must be a definite type,
+ * since the layout of the serialised data depends on it.  Containers
+ * opened with g_variant_builder_open() may still have an indefinite
+ * type if they are inside of a variant; those are built the usual way
+ * and serialised when they are closed.
+ *
+ * Since: 2.38
+ **/
+void
+g_variant_builder_init_serialised (GVariantBuilder    *builder,
+                                   const GVariantType *type)
+{
+  g_return_if_fail (type != NULL);
+  g_return_if_fail (g_variant_type_is_container (type));
+  g_return_if_fail (g_variant_type_is_definite (type));
+
+  g_variant_builder_init_stream (builder, type,
+                                 g_slice_new0 (GVariantStream));
+}
+
+/**
+ * g_variant_builder_init_sorted: (skip)
+ * @builder: a #GVariantBuilder
+ * @type: a dictionary type with string, object path or uint32 keys
+ *
+ * Initialises a #GVariantBuilder structure for building a dictionary
+ * that is sorted by key.
+ *
+ * This is the same as g_variant_builder_init() except that
+ * g_variant_builder_end() sorts the entries of the dictionary by key:
+ * string and object path keys in the order of strcmp(), and uint32 keys
+ * numerically.  If a key was added more than once, only the entry that
+ * was added first is kept.
+ *
+ * This gives the canonical form of a dictionary that
+ * g_variant_lookup_value_sorted() and
+ * g_variant_lookup_value_sorted_uint32() can search in logarithmic time
+ * directly in its serialised data, for example in a lookup table that
+ * is written out to a file once and memory-mapped later.
+ *
+ * @type must be an array of dictionary entries with a key type of
+ * <literal>s</literal>, <literal>o</literal> or <literal>u</literal>,
+ * such as <literal>a{sv}</literal> or <literal>a{u*}</literal>.
+ *
+ * Since: 2.38
+ **/
+void
+g_variant_builder_init_sorted (GVariantBuilder    *builder,
+                               const GVariantType *type)
+{
+  g_return_if_fail (type != NULL);
+  g_return_if_fail (g_variant_type_is_subtype_of (type, G_VARIANT_TYPE ("a{s*}")) ||
+                    g_variant_type_is_subtype_of (type, G_VARIANT_TYPE ("a{o*}")) ||
+                    g_variant_type_is_subtype_of (type, G_VARIANT_TYPE ("a{u*}")));
+
+  g_variant_builder_init (builder, type);
+  GVSB(builder)->sorted = TRUE;
+}
+
+typedef struct
+{
+  GVariant *entry;
+  GVariant *key;
+} SortedEntry;
+
+static gint
+g_variant_builder_compare_entries (gconstpointer a,
+                                   gconstpointer b,
+                                   gpointer      user_data)
+{
+  const SortedEntry *entry_a = a;
+  const SortedEntry *entry_b = b;
+
+  if (g_variant_is_of_type (entry_a->key, G_VARIANT_TYPE_UINT32))
+    {
+      guint32 key_a = g_variant_get_uint32 (entry_a->key);
+      guint32 key_b = g_variant_get_uint32 (entry_b->key);
+
+      return (key_a > key_b) - (key_a < key_b);
+    }
+
+  return strcmp (g_variant_get_string (entry_a->key, NULL),
+                 g_variant_get_string (entry_b->key, NULL));
+}
+
+/* Sorts the children of a builder from g_variant_builder_init_sorted()
+ * by key and drops all but the first entry for each key.
+ */
+static void
+g_variant_builder_sort (struct stack_builder *builder)
+{
+  SortedEntry *entries;
+  gsize n_entries;
+  gsize i;
+
+  n_entries = builder->offset;
+  entries = g_new (SortedEntry, n_entries);
+
+  for (i = 0; i < n_entries; i++)
+    {
+      entries[i].entry = builder->children[i];
+      entries[i].key = g_variant_get_child_value (builder->children[i], 0);
+    }
+
+  /* this is a stable sort, so the first of equal keys stays first */
+  g_qsort_with_data (entries, n_entries, sizeof (SortedEntry),
+                     g_variant_builder_compare_entries, NULL);
+
+  builder->offset = 0;
+  for (i = 0; i < n_entries; i++)
+    {
+      if (i > 0 &&
+          g_variant_builder_compare_entries (&entries[i - 1], &entries[i], NULL) == 0)
+        g_variant_unref (entries[i].entry);
+      else
+        builder->children[builder->offset++] = entries[i].entry;
+    }
+
+  for (i = 0; i < n_entries; i++)
+    g_variant_unref (entries[i].key);
+
+  g_free (entries);
+}
+
+/* Called after a child of type @child_info has been written to the
+ * stream of @builder.  Does the bookkeeping that
+ * g_variant_builder_add_value() does for builders in the normal mode.
+ */
+static void
+g_variant_builder_stream_child_added (struct stack_builder *builder,
+                                      GVariantTypeInfo     *child_info)
+{
+  if (builder->ends != NULL)
+    {
+      if (builder->offset == builder->allocated_children)
+        {
+          builder->allocated_children *= 2;
+          builder->ends = g_renew (gsize, builder->ends,
+                                   builder->allocated_children);
+        }
+
+      builder->ends[builder->offset] =
+        builder->stream->size - builder->stream_start;
+    }
+
+  builder->offset++;
+
+  if (!builder->uniform_item_types)
+    {
+      /* advance our expected type pointers */
+      if (builder->expected_type)
+        builder->expected_type = g_variant_type_next (builder->expected_type);
+
+      if (builder->prev_item_type)
+        builder->prev_item_type = g_variant_type_next (builder->prev_item_type);
+    }
+  else if (builder->expected_type == NULL)
+    {
+      /* variant: the child itself is gone, so remember its type */
+      builder->child_info = g_variant_type_info_ref (child_info);
+      builder->prev_item_type = (const GVariantType *)
+        g_variant_type_info_get_type_string (child_info);
+    }
+  else
+    builder->prev_item_type = builder->expected_type;
+}
+
+static void
+g_variant_builder_stream_value (struct stack_builder *builder,
+                                GVariant             *value)
+{
+  GVariantTypeInfo *child_info;
+  guint alignment;
+  gsize size;
+
+  child_info = g_variant_get_type_info (value);
+  g_variant_type_info_query (child_info, &alignment, NULL);
+  g_variant_stream_align (builder->stream, alignment);
+
+  size = g_variant_get_size (value);
+  g_variant_store (value, g_variant_stream_reserve (builder->stream, size));
+
+  g_variant_builder_stream_child_added (builder, child_info);
+}
+
+static void
+g_variant_stream_fill_child (GVariantSerialised *serialised,
+                             gpointer            data)
+{
+  GVariantSerialised *child = data;
+
+  /* the data is already in place */
+  serialised->type_info = child->type_info;
+  serialised->size = child->size;
+}
+
+/* Writes the framing of a container of type @type_info that starts at
+ * @start in @stream and whose @n_children children are already written
+ * out, ending at the offsets (relative to @start) given in @ends.
+ *
+ * @child_info is the type of the child for variants.
+ */
+static void
+g_variant_stream_frame (GVariantStream   *stream,
+                        GVariantTypeInfo *type_info,
+                        gsize             start,
+                        const gsize      *ends,
+                        gsize             n_children,
+                        GVariantTypeInfo *child_info)
+{
+  GVariantSerialised children_buf[8];
+  gpointer pointers_buf[8];
+  GVariantSerialised *children;
+  GVariantSerialised container;
+  gpointer *pointers;
+  gsize offset;
+  gsize i;
+
+  if (g_variant_type_info_get_type_char (type_info) == G_VARIANT_CLASS_ARRAY)
+    {
+      gsize fixed_size;
+
+      g_variant_type_info_query_element (type_info, NULL, &fixed_size);
+
+      if (!fixed_size)
+        {
+          gsize body_size;
+          gsize size;
+
+          body_size = stream->size - start;
+          size = g_variant_serialiser_array_size (body_size, n_children);
+          g_variant_stream_reserve (stream, size - body_size);
+          g_variant_serialiser_write_array_offsets (stream->data + start,
+                                                    size, ends, n_children);
+        }
+
+      return;
+    }
+
+  if (n_children <= G_N_ELEMENTS (children_buf))
+    {
+      children = children_buf;
+      pointers = pointers_buf;
+    }
+  else
+    {
+      children = g_new (GVariantSerialised, n_children);
+      pointers = g_new (gpointer, n_children);
+    }
+
+  offset = 0;
+  for (i = 0; i < n_children; i++)
+    {
+      guint alignment;
+
+      if (g_variant_type_info_get_type_char (type_info) == G_VARIANT_CLASS_MAYBE)
+        children[i].type_info = g_variant_type_info_element (type_info);
+      else if (g_variant_type_info_get_type_char (type_info) == G_VARIANT_CLASS_VARIANT)
+        children[i].type_info = child_info;
+      else
+        children[i].type_info =
+          g_variant_type_info_member_info (type_info, i)->type_info;
+
+      g_variant_type_info_query (children[i].type_info, &alignment, NULL);
+      offset += (-offset) & alignment;
+
+      children[i].data = NULL;
+      children[i].size = ends[i] - offset;
+      pointers[i] = &children[i];
+      offset = ends[i];
+    }
+
+  container.type_info = type_info;
+  container.size = g_variant_serialiser_needed_size (type_info,
+                                                     g_variant_stream_fill_child,
+                                                     (gpointer *) pointers,
+                                                     n_children);
+  g_variant_stream_reserve (stream, container.size - (stream->size - start));
+  container.data = stream->data + start;
+  g_variant_serialiser_serialise (container, g_variant_stream_fill_child,
+                                  (gpointer *) pointers, n_children);
+
+  if (children != children_buf)
+    {
+      g_free (children);
+      g_free (pointers);
+    }
+}
+
+static void
+g_variant_builder_stream_finish (struct stack_builder *builder)
+{
+  g_variant_stream_frame (builder->stream, builder->type_info,
+                          builder->stream_start, builder->ends,
+                          builder->offset, builder->child_info);
+}
+
+/* Writes a value of type @type_info, described by the format string
+ * of the same type, directly from @app.  Only basic types, tuples and
+ * dictionary entries are supported; see g_variant_builder_add().
+ *
+ * Returns %FALSE (with the stream in an undefined state past the
+ * starting point) if one of the strings is invalid.
+ */
+static gboolean
+g_variant_stream_write_va (GVariantStream   *stream,
+                           GVariantTypeInfo *type_info,
+                           va_list          *app)
+{
+  guint alignment;
+
+  g_variant_type_info_query (type_info, &alignment, NULL);
+  g_variant_stream_align (stream, alignment);
+
+  switch (g_variant_type_info_get_type_char (type_info))
+    {
+    case G_VARIANT_CLASS_BOOLEAN:
+      {
+        guchar value = va_arg (*app, gboolean) != FALSE;
+        *g_variant_stream_reserve (stream, 1) = value;
+      }
+      break;
+
+    case G_VARIANT_CLASS_BYTE:
+      {
+        guchar value = va_arg (*app, guint);
+        *g_variant_stream_reserve (stream, 1) = value;
+      }
+      break;
+
+    case G_VARIANT_CLASS_INT16:
+    case G_VARIANT_CLASS_UINT16:
+      {
+        guint16 value = va_arg (*app, guint);
+        memcpy (g_variant_stream_reserve (stream, 2), &value, 2);
+      }
+      break;
+
+    case G_VARIANT_CLASS_INT32:
+    case G_VARIANT_CLASS_UINT32:
+    case G_VARIANT_CLASS_HANDLE:
+      {
+        guint32 value = va_arg (*app, guint);
+        memcpy (g_variant_stream_reserve (stream, 4), &value, 4);
+      }
+      break;
+
+    case G_VARIANT_CLASS_INT64:
+    case G_VARIANT_CLASS_UINT64:
+      {
+        guint64 value = va_arg (*app, guint64);
+        memcpy (g_variant_stream_reserve (stream, 8), &value, 8);
+      }
+      break;
+
+    case G_VARIANT_CLASS_DOUBLE:
+      {
+        gdouble value = va_arg (*app, gdouble);
+        memcpy (g_variant_stream_reserve (stream, 8), &value, 8);
+      }
+      break;
+
+    case G_VARIANT_CLASS_STRING:
+    case G_VARIANT_CLASS_OBJECT_PATH:
+    case G_VARIANT_CLASS_SIGNATURE:
+      {
+        const gchar *string = va_arg (*app, const gchar *);
+        gsize size;
+
+        g_return_val_if_fail (string != NULL, FALSE);
+        switch (g_variant_type_info_get_type_char (type_info))
+          {
+          case G_VARIANT_CLASS_STRING:
+            g_return_val_if_fail (g_utf8_validate (string, -1, NULL), FALSE);
+            break;
+
+          case G_VARIANT_CLASS_OBJECT_PATH:
+            g_return_val_if_fail (g_variant_is_object_path (string), FALSE);
+            break;
+
+          default:
+            g_return_val_if_fail (g_variant_is_signature (string), FALSE);
+            break;
+          }
+
+        size = strlen (string) + 1;
+        memcpy (g_variant_stream_reserve (stream, size), string, size);
+      }
+      break;
+
+    case G_VARIANT_CLASS_TUPLE:
+    case G_VARIANT_CLASS_DICT_ENTRY:
+      {
+        gsize n_members;
+        gsize start;
+        gsize *ends;
+        gsize i;
+
+        n_members = g_variant_type_info_n_members (type_info);
+        ends = g_newa (gsize, n_members);
+        start = stream->size;
+
+        for (i = 0; i < n_members; i++)
+          {
+            const GVariantMemberInfo *member;
+
+            member = g_variant_type_info_member_info (type_info, i);
+            if (!g_variant_stream_write_va (stream, member->type_info, app))
+              return FALSE;
+
+            ends[i] = stream->size - start;
+          }
+
+        g_variant_stream_frame (stream, type_info, start,
+                                ends, n_members, NULL);
+      }
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+
+  return TRUE;
+}
+
+/* Adds a value to a builder in serialised mode straight from the
+ * arguments of g_variant_builder_add(), if @format_string allows for
+ * that.  Returns %FALSE without touching @app if it does not.
+ */
+static gboolean
+g_variant_builder_stream_add_va (struct stack_builder *builder,
+                                 const gchar          *format_string,
+                                 va_list              *app)
+{
+  GVariantTypeInfo *child_info;
+  const gchar *type_string;
+  gsize saved_size;
+  gsize length;
+
+  if (!builder->serialised || builder->expected_type == NULL ||
+      builder->offset >= builder->max_items)
+    return FALSE;
+
+  /* the format string must be exactly the expected type, and not use
+   * any of the types that need a GVariant to be constructed.
+   */
+  length = strspn (format_string, "bynqiuxthdsog(){}");
+  if (format_string[length] != '\0' ||
+      length != g_variant_type_get_string_length (builder->expected_type))
+    return FALSE;
+
+  type_string = g_variant_type_peek_string (builder->expected_type);
+  if (memcmp (format_string, type_string, length) != 0)
+    return FALSE;
+
+  if (builder->uniform_item_types)
+    child_info = g_variant_type_info_element (builder->type_info);
+  else
+    child_info = g_variant_type_info_member_info (builder->type_info,
+                                                  builder->offset)->type_info;
+
+  saved_size = builder->stream->size;
+  if (!g_variant_stream_write_va (builder->stream, child_info, app))
+    {
+      /* like adding a NULL value: nothing is added */
+      builder->stream->size = saved_size;
+      return TRUE;
+    }
+
+  g_variant_builder_stream_child_added (builder, child_info);
+
+  return TRUE;
+}
+
 /**
  * g_variant_builder_add_value:
  * @builder: a #GVariantBuilder
@@ -3473,6 +4182,14 @@ g_variant_builder_add_value (GVariantBuilder *builder,
 
   GVSB(builder)->trusted &= g_variant_is_trusted (value);
 
+  if (GVSB(builder)->serialised)
+    {
+      g_variant_ref_sink (value);
+      g_variant_builder_stream_value (GVSB(builder), value);
+      g_variant_unref (value);
+      return;
+    }
+
   if (!GVSB(builder)->uniform_item_types)
     {
       /* advance our expected type pointers */
@@ -3523,7 +4240,10 @@ g_variant_builder_open (GVariantBuilder    *builder,
                                                   type));
 
   parent = g_slice_dup (GVariantBuilder, builder);
-  g_variant_builder_init (builder, type);
+  if (GVSB(parent)->serialised && g_variant_type_is_definite (type))
+    g_variant_builder_init_stream (builder, type, GVSB(parent)->stream);
+  else
+    g_variant_builder_init (builder, type);
   GVSB(builder)->parent = parent;
 
   /* push the prev_item_type down into the subcontainer */
@@ -3563,6 +4283,34 @@ g_variant_builder_close (GVariantBuilder *builder)
   g_return_if_fail (GVSB(builder)->parent != NULL);
 
   parent = GVSB(builder)->parent;
+
+  if (GVSB(builder)->serialised)
+    {
+      GVariantTypeInfo *type_info;
+      gboolean trusted;
+
+      g_return_if_fail (GVSB(builder)->offset >= GVSB(builder)->min_items);
+
+      /* the children are in the stream already; add the framing and
+       * account for the container in the parent.
+       */
+      g_variant_builder_stream_finish (GVSB(builder));
+      type_info = g_variant_type_info_ref (GVSB(builder)->type_info);
+      trusted = GVSB(builder)->trusted;
+
+      GVSB(builder)->parent = NULL;
+      GVSB(builder)->stream = NULL;
+      g_variant_builder_clear (builder);
+      *builder = *parent;
+      g_slice_free (GVariantBuilder, parent);
+
+      GVSB(builder)->trusted &= trusted;
+      g_variant_builder_stream_child_added (GVSB(builder), type_info);
+      g_variant_type_info_unref (type_info);
+
+      return;
+    }
+
   GVSB(builder)->parent = NULL;
 
   g_variant_builder_add_value (parent, g_variant_builder_end (builder));
@@ -3632,6 +4380,30 @@ g_variant_builder_end (GVariantBuilder *builder)
                         g_variant_type_is_definite (GVSB(builder)->type),
                         NULL);
 
+  if (GVSB(builder)->serialised)
+    {
+      GVariantStream *stream = GVSB(builder)->stream;
+      GBytes *bytes;
+
+      g_return_val_if_fail (GVSB(builder)->parent == NULL, NULL);
+
+      g_variant_builder_stream_finish (GVSB(builder));
+      bytes = g_bytes_new_take (g_realloc (stream->data, stream->size),
+                                stream->size);
+      stream->data = NULL;
+
+      value = g_variant_new_from_bytes (GVSB(builder)->type, bytes,
+                                        GVSB(builder)->trusted);
+      g_bytes_unref (bytes);
+
+      g_variant_builder_clear (builder);
+
+      return value;
+    }
+
+  if (GVSB(builder)->sorted)
+    g_variant_builder_sort (GVSB(builder));
+
   if (g_variant_type_is_definite (GVSB(builder)->type))
     my_type = g_variant_type_copy (GVSB(builder)->type);
 
@@ -4927,6 +5699,14 @@ g_variant_builder_add (GVariantBuilder *builder,
   va_list ap;
 
   va_start (ap, format_string);
+
+  if (is_valid_builder (builder) &&
+      g_variant_builder_stream_add_va (GVSB(builder), format_string, &ap))
+    {
+      va_end (ap);
+      return;
+    }
+
   variant = g_variant_new_va (format_string, NULL, &ap);
   va_end (ap);
 
@@ -219,6 +219,14 @@ GLIB_AVAILABLE_IN_ALL
 GVariant *                      g_variant_lookup_value                  (GVariant             *dictionary,
                                                                          const gchar          *key,
                                                                          const GVariantType   *expected_type);
+GLIB_AVAILABLE_IN_2_38
+GVariant *                      g_variant_lookup_value_sorted           (GVariant             *dictionary,
+                                                                         const gchar          *key,
+                                                                         const GVariantType   *expected_type);
+GLIB_AVAILABLE_IN_2_38
+GVariant *                      g_variant_lookup_value_sorted_uint32    (GVariant             *dictionary,
+                                                                         guint32               key,
+                                                                         const GVariantType   *expected_type);
 GLIB_AVAILABLE_IN_ALL
 gconstpointer                   g_variant_get_fixed_array               (GVariant             *value,
                                                                          gsize                *n_elements,
@@ -337,6 +345,12 @@ GVariantBuilder *               g_variant_builder_ref                   (GVarian
 GLIB_AVAILABLE_IN_ALL
 void                            g_variant_builder_init                  (GVariantBuilder      *builder,
                                                                          const GVariantType   *type);
+GLIB_AVAILABLE_IN_2_38
+void                            g_variant_builder_init_serialised       (GVariantBuilder      *builder,
+                                                                         const GVariantType   *type);
+GLIB_AVAILABLE_IN_2_38
+void                            g_variant_builder_init_sorted           (GVariantBuilder      *builder,
+                                                                         const GVariantType   *type);
 GLIB_AVAILABLE_IN_ALL
 GVariant *                      g_variant_builder_end                   (GVariantBuilder      *builder);
 GLIB_AVAILABLE_IN_ALL
@@ -26,9 +26,12 @@
 
 #include <glib/gtestutils.h>
 #include <glib/gthread.h>
+#include <glib/gstrfuncs.h>
 #include <glib/gslice.h>
 #include <glib/ghash.h>
 
+#include <string.h>
+
 /* < private >
  * GVariantTypeInfo:
  *
@@ -40,14 +43,20 @@
  * The GVariantTypeInfo structures for all of the base types, plus the
  * "variant" type are stored in a read-only static array.
  *
- * For container types, a hash table and reference counting is used to
- * ensure that only one of these structures exists for any given type.
- * In general, a container GVariantTypeInfo will exist for a given type
- * only if one or more GVariant instances of that type exist or if
- * another GVariantTypeInfo has that type as a subtype.  For example, if
- * a process contains a single GVariant instance with type "(asv)", then
- * container GVariantTypeInfo structures will exist for "(asv)" and
- * for "as" (note that "s" and "v" always exist in the static array).
+ * A fixed set of commonly used container types (such as "as", "a{sv}"
+ * and the usual D-Bus method signatures) is created once, the first
+ * time that any container type is requested, and kept forever.  These
+ * are found without taking any locks and are not reference counted.
+ *
+ * For other container types, a hash table and reference counting is
+ * used to ensure that only one of these structures exists for any given
+ * type.  In general, such a container GVariantTypeInfo will exist for a
+ * given type only if one or more GVariant instances of that type exist
+ * or if another GVariantTypeInfo has that type as a subtype.  For
+ * example, if a process contains a single GVariant instance with type
+ * "(asv)", then container GVariantTypeInfo structures will exist for
+ * "(asv)" and for "as" (note that "s" and "v" always exist in the
+ * static array, and "as" happens to be one of the permanent types).
  *
  * The trickiest part of GVariantTypeInfo (and in fact, the major reason
  * for its existence) is the storage of somewhat magical constants that
@@ -70,8 +79,14 @@ struct _GVariantTypeInfo
   guchar container_class;
 };
 
-/* Container types are reference counted.  They also need to have their
- * type string stored explicitly since it is not merely a single letter.
+/* Container types are reference counted, except for the permanent
+ * ones.  They also need to have their type string stored explicitly
+ * since it is not merely a single letter.
+ *
+ * Permanent infos are never freed, but debug builds still count the
+ * references to them in 'debug_ref_count', so that
+ * g_variant_type_info_assert_no_infos() can catch leaks of these types
+ * as well.
  */
 typedef struct
 {
@@ -79,6 +94,10 @@ typedef struct
 
   gchar *type_string;
   gint ref_count;
+  gboolean permanent;
+#ifdef G_ENABLE_DEBUG
+  gint debug_ref_count;
+#endif
 } ContainerInfo;
 
 /* For 'array' and 'maybe' types, we store some extra information on the
@@ -253,6 +272,8 @@ g_variant_type_info_query (GVariantTypeInfo *info,
     *fixed_size = info->fixed_size;
 }
 
+static GVariantTypeInfo *g_variant_type_info_lookup (const GVariantType *type);
+
 /* == array == */
 #define GV_ARRAY_INFO_CLASS 'a'
 static ArrayInfo *
@@ -283,7 +304,7 @@ array_info_new (const GVariantType *type)
   info = g_slice_new (ArrayInfo);
   info->container.info.container_class = GV_ARRAY_INFO_CLASS;
 
-  info->element = g_variant_type_info_get (g_variant_type_element (type));
+  info->element = g_variant_type_info_lookup (g_variant_type_element (type));
   info->container.info.alignment = info->element->alignment;
   info->container.info.fixed_size = 0;
 
@@ -365,7 +386,7 @@ tuple_allocate_members (const GVariantType  *type,
     {
       GVariantMemberInfo *member = &(*members)[i++];
 
-      member->type_info = g_variant_type_info_get (item_type);
+      member->type_info = g_variant_type_info_lookup (item_type);
       item_type = g_variant_type_next (item_type);
 
       if (member->type_info->fixed_size)
@@ -712,21 +733,143 @@ g_variant_type_info_member_info (GVariantTypeInfo *info,
 static GRecMutex g_variant_type_info_lock;
 static GHashTable *g_variant_type_info_table;
 
-/* < private >
- * g_variant_type_info_get:
- * @type: a #GVariantType
- *
- * Returns a reference to a #GVariantTypeInfo for @type.
- *
- * If an info structure already exists for this type, a new reference is
- * returned.  If not, the required calculations are performed and a new
- * info structure is returned.
- *
- * It is appropriate to call g_variant_type_info_unref() on the return
- * value.
+/* The permanent container types.  Each type comes after all of the
+ * container types that it contains, and all of those are in the list
+ * too, so that none of the permanent types refers to a reference
+ * counted one.
  */
-GVariantTypeInfo *
-g_variant_type_info_get (const GVariantType *type)
+static const gchar * const g_variant_type_info_permanent_types[] = {
+  "ab", "ay", "an", "aq", "ai", "au", "ax", "at", "ad", "as", "ao", "ag",
+  "av", "aay", "aas", "ms", "mv",
+  "{ss}", "a{ss}", "{sv}", "a{sv}", "aa{sv}", "{sa{sv}}", "a{sa{sv}}",
+  "{oa{sa{sv}}}", "a{oa{sa{sv}}}",
+  "()", "(b)", "(y)", "(i)", "(u)", "(x)", "(t)", "(d)", "(s)", "(o)",
+  "(g)", "(v)", "(ay)", "(as)", "(ao)", "(av)", "(ss)", "(su)", "(sv)",
+  "(ssv)", "(us)", "(uu)", "(a{sv})", "(sa{sv})", "(oa{sa{sv}})",
+  "(a{oa{sa{sv}}})", "(sa{sv}as)", "(ssa{sv})", "(sava{sv})"
+};
+
+/* Open-addressed hash table of the permanent types, indexed by
+ * g_variant_type_info_hash().  It is filled in once, under
+ * g_variant_type_info_permanent_initialised, and only read after that.
+ */
+#define PERMANENT_TABLE_SIZE 128
+static ContainerInfo *g_variant_type_info_permanent[PERMANENT_TABLE_SIZE];
+static gsize g_variant_type_info_permanent_initialised;
+
+static guint
+g_variant_type_info_hash (const gchar *type_string,
+                          gsize        length)
+{
+  guint hash = 5381;
+  gsize i;
+
+  for (i = 0; i < length; i++)
+    hash = (hash << 5) + hash + type_string[i];
+
+  return hash;
+}
+
+static inline void
+g_variant_type_info_permanent_ref (ContainerInfo *container)
+{
+#ifdef G_ENABLE_DEBUG
+  g_atomic_int_inc (&container->debug_ref_count);
+#endif
+}
+
+static inline void
+g_variant_type_info_permanent_unref (ContainerInfo *container)
+{
+#ifdef G_ENABLE_DEBUG
+  gint old_ref;
+
+  old_ref = g_atomic_int_add (&container->debug_ref_count, -1);
+  g_assert_cmpint (old_ref, >, 0);
+#endif
+}
+
+static ContainerInfo *
+g_variant_type_info_find_permanent (const gchar *type_string,
+                                    gsize        length)
+{
+  guint i;
+
+  i = g_variant_type_info_hash (type_string, length);
+
+  for (;; i++)
+    {
+      ContainerInfo *container;
+
+      container = g_variant_type_info_permanent[i % PERMANENT_TABLE_SIZE];
+
+      if (container == NULL)
+        return NULL;
+
+      if (strncmp (container->type_string, type_string, length) == 0 &&
+          container->type_string[length] == '\0')
+        return container;
+    }
+}
+
+static ContainerInfo *
+g_variant_type_info_container_new (const GVariantType *type)
+{
+  char type_char;
+
+  type_char = g_variant_type_peek_string (type)[0];
+
+  if (type_char == G_VARIANT_TYPE_INFO_CHAR_MAYBE ||
+      type_char == G_VARIANT_TYPE_INFO_CHAR_ARRAY)
+    return array_info_new (type);
+
+  else /* tuple or dict entry */
+    return tuple_info_new (type);
+}
+
+static void
+g_variant_type_info_init_permanent (void)
+{
+  gsize i;
+
+  G_STATIC_ASSERT (G_N_ELEMENTS (g_variant_type_info_permanent_types) <=
+                   PERMANENT_TABLE_SIZE / 2);
+
+  for (i = 0; i < G_N_ELEMENTS (g_variant_type_info_permanent_types); i++)
+    {
+      const gchar *type_string = g_variant_type_info_permanent_types[i];
+      ContainerInfo *container;
+      guint j;
+
+      container = g_variant_type_info_container_new (G_VARIANT_TYPE (type_string));
+      container->type_string = g_strdup (type_string);
+      container->ref_count = 1;
+      container->permanent = TRUE;
+
+      j = g_variant_type_info_hash (type_string, strlen (type_string));
+      while (g_variant_type_info_permanent[j % PERMANENT_TABLE_SIZE])
+        j++;
+      g_variant_type_info_permanent[j % PERMANENT_TABLE_SIZE] = container;
+    }
+
+  /* the list above has to be closed under taking subtypes */
+  g_assert (g_variant_type_info_table == NULL);
+
+#ifdef G_ENABLE_DEBUG
+  /* the references that permanent infos hold on each other are never
+   * dropped, so they do not count
+   */
+  for (i = 0; i < PERMANENT_TABLE_SIZE; i++)
+    if (g_variant_type_info_permanent[i])
+      g_variant_type_info_permanent[i]->debug_ref_count = 0;
+#endif
+}
+
+/* The same as g_variant_type_info_get(), except that the permanent
+ * types must already have been set up.
+ */
+static GVariantTypeInfo *
+g_variant_type_info_lookup (const GVariantType *type)
 {
   char type_char;
 
@@ -738,9 +881,31 @@ g_variant_type_info_get (const GVariantType *type)
       type_char == G_VARIANT_TYPE_INFO_CHAR_DICT_ENTRY)
     {
       GVariantTypeInfo *info;
+      ContainerInfo *container;
+      gchar buffer[64];
       gchar *type_string;
+      gsize length;
 
-      type_string = g_variant_type_dup_string (type);
+      length = g_variant_type_get_string_length (type);
+
+      container = g_variant_type_info_find_permanent (g_variant_type_peek_string (type),
+                                                      length);
+      if (container != NULL)
+        {
+          g_variant_type_info_permanent_ref (container);
+
+          return (GVariantTypeInfo *) container;
+        }
+
+      /* only copy the type string if we will store it */
+      if (length < sizeof buffer)
+        {
+          memcpy (buffer, g_variant_type_peek_string (type), length);
+          buffer[length] = '\0';
+          type_string = buffer;
+        }
+      else
+        type_string = g_variant_type_dup_string (type);
 
       g_rec_mutex_lock (&g_variant_type_info_lock);
 
@@ -751,23 +916,18 @@ g_variant_type_info_get (const GVariantType *type)
 
       if (info == NULL)
         {
-          ContainerInfo *container;
-
-          if (type_char == G_VARIANT_TYPE_INFO_CHAR_MAYBE ||
-              type_char == G_VARIANT_TYPE_INFO_CHAR_ARRAY)
-            {
-              container = array_info_new (type);
-            }
-          else /* tuple or dict entry */
-            {
-              container = tuple_info_new (type);
-            }
+          container = g_variant_type_info_container_new (type);
 
           info = (GVariantTypeInfo *) container;
-          container->type_string = type_string;
+          if (type_string == buffer)
+            container->type_string = g_strdup (buffer);
+          else
+            container->type_string = type_string;
           container->ref_count = 1;
+          container->permanent = FALSE;
 
-          g_hash_table_insert (g_variant_type_info_table, type_string, info);
+          g_hash_table_insert (g_variant_type_info_table,
+                               container->type_string, info);
           type_string = NULL;
         }
       else
@@ -775,7 +935,8 @@ g_variant_type_info_get (const GVariantType *type)
 
       g_rec_mutex_unlock (&g_variant_type_info_lock);
       g_variant_type_info_check (info, 0);
-      g_free (type_string);
+      if (type_string != buffer)
+        g_free (type_string);
 
       return info;
     }
@@ -796,6 +957,35 @@ g_variant_type_info_get (const GVariantType *type)
     }
 }
 
+/* < private >
+ * g_variant_type_info_get:
+ * @type: a #GVariantType
+ *
+ * Returns a reference to a #GVariantTypeInfo for @type.
+ *
+ * If an info structure already exists for this type, a new reference is
+ * returned.  If not, the required calculations are performed and a new
+ * info structure is returned.
+ *
+ * Basic types and the permanent container types are returned without
+ * taking a lock; other container types need the lock for the hash
+ * table lookup.
+ *
+ * It is appropriate to call g_variant_type_info_unref() on the return
+ * value.
+ */
+GVariantTypeInfo *
+g_variant_type_info_get (const GVariantType *type)
+{
+  if (g_once_init_enter (&g_variant_type_info_permanent_initialised))
+    {
+      g_variant_type_info_init_permanent ();
+      g_once_init_leave (&g_variant_type_info_permanent_initialised, 1);
+    }
+
+  return g_variant_type_info_lookup (type);
+}
+
 /* < private >
  * g_variant_type_info_ref:
  * @info: a #GVariantTypeInfo
@@ -812,7 +1002,10 @@ g_variant_type_info_ref (GVariantTypeInfo *info)
       ContainerInfo *container = (ContainerInfo *) info;
 
       g_assert_cmpint (container->ref_count, >, 0);
-      g_atomic_int_inc (&container->ref_count);
+      if (!container->permanent)
+        g_atomic_int_inc (&container->ref_count);
+      else
+        g_variant_type_info_permanent_ref (container);
     }
 
   return info;
@@ -833,6 +1026,27 @@ g_variant_type_info_unref (GVariantTypeInfo *info)
   if (info->container_class)
     {
       ContainerInfo *container = (ContainerInfo *) info;
+      gint old_ref;
+
+      if (container->permanent)
+        {
+          g_variant_type_info_permanent_unref (container);
+          return;
+        }
+
+      /* Only the last reference needs the lock: nobody can get a new
+       * reference from the hash table while we hold it.  Until then,
+       * just decrement.
+       */
+      old_ref = g_atomic_int_get (&container->ref_count);
+      while (old_ref > 1)
+        {
+          if (g_atomic_int_compare_and_exchange (&container->ref_count,
+                                                 old_ref, old_ref - 1))
+            return;
+
+          old_ref = g_atomic_int_get (&container->ref_count);
+        }
 
       g_rec_mutex_lock (&g_variant_type_info_lock);
       if (g_atomic_int_dec_and_test (&container->ref_count))
@@ -862,8 +1076,20 @@ g_variant_type_info_unref (GVariantTypeInfo *info)
     }
 }
 
+/* Only debug builds can tell whether references to the permanent
+ * types are still held.
+ */
 void
 g_variant_type_info_assert_no_infos (void)
 {
+#ifdef G_ENABLE_DEBUG
+  gsize i;
+
+  if (g_variant_type_info_permanent_initialised)
+    for (i = 0; i < PERMANENT_TABLE_SIZE; i++)
+      if (g_variant_type_info_permanent[i])
+        g_assert_cmpint (g_atomic_int_get (&g_variant_type_info_permanent[i]->debug_ref_count), ==, 0);
+#endif
+
   g_assert (g_variant_type_info_table == NULL);
 }
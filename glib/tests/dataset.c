@@ -43,6 +43,122 @@ test_quark_string (void)
   g_free (copy);
 }
 
+#define N_THREAD_QUARKS 3000
+
+static gchar *thread_quark_names[N_THREAD_QUARKS];
+
+static gpointer
+quark_thread (gpointer data)
+{
+  GQuark *quarks;
+  gint i;
+
+  quarks = g_new (GQuark, N_THREAD_QUARKS);
+
+  /* all threads race to create the same quarks, in different orders */
+  for (i = 0; i < N_THREAD_QUARKS; i++)
+    {
+      gint n = (i + GPOINTER_TO_INT (data) * 997) % N_THREAD_QUARKS;
+
+      quarks[n] = g_quark_from_string (thread_quark_names[n]);
+      g_assert_cmpstr (g_quark_to_string (quarks[n]), ==, thread_quark_names[n]);
+      g_assert_cmpuint (g_quark_try_string (thread_quark_names[n]), ==, quarks[n]);
+    }
+
+  return quarks;
+}
+
+static void
+test_quark_threaded (void)
+{
+  GThread *threads[8];
+  GQuark *first;
+  gint i, j;
+
+  for (i = 0; i < N_THREAD_QUARKS; i++)
+    thread_quark_names[i] = g_strdup_printf ("threaded-quark-%d", i);
+
+  for (i = 0; i < G_N_ELEMENTS (threads); i++)
+    threads[i] = g_thread_new ("quark", quark_thread, GINT_TO_POINTER (i));
+
+  first = g_thread_join (threads[0]);
+  for (i = 1; i < G_N_ELEMENTS (threads); i++)
+    {
+      GQuark *quarks = g_thread_join (threads[i]);
+
+      for (j = 0; j < N_THREAD_QUARKS; j++)
+        g_assert_cmpuint (quarks[j], ==, first[j]);
+
+      g_free (quarks);
+    }
+
+  for (i = 0; i < N_THREAD_QUARKS; i++)
+    {
+      g_assert_cmpstr (g_intern_string (thread_quark_names[i]), ==, thread_quark_names[i]);
+      g_assert (g_intern_string (thread_quark_names[i]) == g_quark_to_string (first[i]));
+      g_free (thread_quark_names[i]);
+    }
+
+  g_free (first);
+}
+
+#define N_LOOKUPS 2000000
+
+static volatile gint lookup_go;
+
+static gpointer
+lookup_thread (gpointer data)
+{
+  gchar **names = data;
+  guint sum = 0;
+  gint i;
+
+  while (!g_atomic_int_get (&lookup_go))
+    g_thread_yield ();
+
+  for (i = 0; i < N_LOOKUPS; i++)
+    sum += g_quark_try_string (names[i % 1000]);
+
+  return GUINT_TO_POINTER (sum);
+}
+
+static void
+test_quark_contention (void)
+{
+  GThread *threads[64];
+  gchar *names[1000];
+  gint n_threads;
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (names); i++)
+    {
+      names[i] = g_strdup_printf ("contended-quark-%d", i);
+      g_quark_from_string (names[i]);
+    }
+
+  for (n_threads = 1; n_threads <= G_N_ELEMENTS (threads); n_threads *= 2)
+    {
+      gdouble elapsed;
+
+      lookup_go = FALSE;
+      for (i = 0; i < n_threads; i++)
+        threads[i] = g_thread_new ("lookup", lookup_thread, names);
+
+      g_test_timer_start ();
+      g_atomic_int_set (&lookup_go, TRUE);
+      for (i = 0; i < n_threads; i++)
+        g_thread_join (threads[i]);
+      elapsed = g_test_timer_elapsed ();
+
+      g_test_maximized_result ((gdouble) n_threads * N_LOOKUPS / elapsed,
+                               "%d threads: %.0f quark lookups/s",
+                               n_threads, n_threads * N_LOOKUPS / elapsed);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (names); i++)
+    g_free (names[i]);
+}
+
 static void
 test_dataset_basic (void)
 {
@@ -200,6 +316,61 @@ test_datalist_clear (void)
   g_test_trap_assert_passed ();
 }
 
+static void
+test_datalist_large (void)
+{
+  GData *list;
+  GQuark keys[200];
+  gboolean present[200];
+  gint i, round;
+
+  for (i = 0; i < G_N_ELEMENTS (keys); i++)
+    {
+      gchar *name = g_strdup_printf ("datalist-large-%d", i);
+
+      keys[i] = g_quark_from_string (name);
+      present[i] = FALSE;
+      g_free (name);
+    }
+
+  /* grow well past the point where lookups go through the index, and
+   * shuffle things around with removals in between
+   */
+  g_datalist_init (&list);
+  for (round = 0; round < 3; round++)
+    {
+      for (i = 0; i < G_N_ELEMENTS (keys); i++)
+        {
+          if ((i * 7 + round) % 3 == 0)
+            {
+              g_datalist_id_remove_data (&list, keys[i]);
+              present[i] = FALSE;
+            }
+          else
+            {
+              g_datalist_id_set_data (&list, keys[i], GINT_TO_POINTER (i + 1));
+              present[i] = TRUE;
+            }
+        }
+
+      for (i = 0; i < G_N_ELEMENTS (keys); i++)
+        {
+          gpointer expected = present[i] ? GINT_TO_POINTER (i + 1) : NULL;
+
+          g_assert (g_datalist_id_get_data (&list, keys[i]) == expected);
+        }
+    }
+
+  g_assert (present[0]);
+  g_assert (g_datalist_id_replace_data (&list, keys[0], GINT_TO_POINTER (1), NULL, NULL, NULL));
+  g_assert (g_datalist_id_get_data (&list, keys[0]) == NULL);
+  g_assert (g_datalist_id_replace_data (&list, keys[0], NULL, GINT_TO_POINTER (1), NULL, NULL));
+  g_assert (g_datalist_id_get_data (&list, keys[0]) == GINT_TO_POINTER (1));
+
+  g_datalist_clear (&list);
+  g_assert (list == NULL);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -207,6 +378,9 @@ main (int argc, char *argv[])
 
   g_test_add_func ("/quark/basic", test_quark_basic);
   g_test_add_func ("/quark/string", test_quark_string);
+  g_test_add_func ("/quark/threaded", test_quark_threaded);
+  if (g_test_perf ())
+    g_test_add_func ("/quark/perf/contention", test_quark_contention);
   g_test_add_func ("/dataset/basic", test_dataset_basic);
   g_test_add_func ("/dataset/id", test_dataset_id);
   g_test_add_func ("/dataset/full", test_dataset_full);
@@ -214,6 +388,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/dataset/destroy", test_dataset_destroy);
   g_test_add_func ("/datalist/recursive-clear", test_datalist_clear);
   g_test_add_func ("/datalist/recursive-clear/subprocess", test_datalist_clear_subprocess);
+  g_test_add_func ("/datalist/large", test_datalist_large);
 
   return g_test_run ();
 }
@@ -1039,6 +1039,81 @@ test_gvarianttypeinfo (void)
   g_variant_type_info_assert_no_infos ();
 }
 
+static const gchar *typeinfo_threaded_types[] = {
+  /* permanent */
+  "as", "a{sv}", "(sa{sv}as)", "()",
+  /* reference counted */
+  "a(sii)", "(a{sv}ay)", "maas", "{ias}"
+};
+
+static gpointer
+typeinfo_threaded_func (gpointer data)
+{
+  GVariantTypeInfo **expected = data;
+  gint i;
+
+  for (i = 0; i < 20000; i++)
+    {
+      gint j = i % G_N_ELEMENTS (typeinfo_threaded_types);
+      GVariantTypeInfo *info;
+
+      info = g_variant_type_info_get (G_VARIANT_TYPE (typeinfo_threaded_types[j]));
+      g_assert (expected[j] == NULL || info == expected[j]);
+      g_variant_type_info_ref (info);
+      g_variant_type_info_unref (info);
+      g_variant_type_info_unref (info);
+    }
+
+  return NULL;
+}
+
+static void
+test_gvarianttypeinfo_threaded (void)
+{
+  GVariantTypeInfo *expected[G_N_ELEMENTS (typeinfo_threaded_types)];
+  GThread *threads[4];
+  gint i;
+
+  /* keep every other type alive, so that their identity can be
+   * checked; the reference counted ones among the rest come and go.
+   */
+  for (i = 0; i < G_N_ELEMENTS (typeinfo_threaded_types); i++)
+    {
+      const GVariantType *type = G_VARIANT_TYPE (typeinfo_threaded_types[i]);
+      gsize fixed_size1, fixed_size2;
+      guint alignment1, alignment2;
+
+      expected[i] = g_variant_type_info_get (type);
+      g_assert_cmpstr (g_variant_type_info_get_type_string (expected[i]), ==,
+                       typeinfo_threaded_types[i]);
+      calculate_type_info (type, &fixed_size1, &alignment1);
+      g_variant_type_info_query (expected[i], &alignment2, &fixed_size2);
+      g_assert_cmpint (fixed_size1, ==, fixed_size2);
+      g_assert_cmpint (alignment1, ==, alignment2 + 1);
+
+      if (g_variant_type_is_tuple (type) || g_variant_type_is_dict_entry (type))
+        check_offsets (expected[i], type);
+
+      if (i % 2)
+        {
+          g_variant_type_info_unref (expected[i]);
+          expected[i] = NULL;
+        }
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (threads); i++)
+    threads[i] = g_thread_new ("typeinfo", typeinfo_threaded_func, expected);
+
+  for (i = 0; i < G_N_ELEMENTS (threads); i++)
+    g_thread_join (threads[i]);
+
+  for (i = 0; i < G_N_ELEMENTS (typeinfo_threaded_types); i++)
+    if (expected[i])
+      g_variant_type_info_unref (expected[i]);
+
+  g_variant_type_info_assert_no_infos ();
+}
+
 #define MAX_FIXED_MULTIPLIER    256
 #define MAX_INSTANCE_SIZE       1024
 #define MAX_ARRAY_CHILDREN      128
@@ -1822,6 +1897,10 @@ test_strings (void)
     { is_nval,     13, "hello\0world!" },
     { is_nval,     12, "hello world!" },
     { is_nval,     13, "hello world!\xff" },
+    { is_string,   36, "a longer string of plain ASCII text" },
+    { is_nval,     36, "a longer string of plain\0ASCII text" },
+    { is_nval,     36, "a longer string of plain ASCII\xfftext" },
+    { is_string,   36, "a longer string with \xc3\xbcmlauts in it" },
 
     { is_objpath,   2, "/" },
     { is_objpath,   3, "/a" },
@@ -1832,6 +1911,7 @@ test_strings (void)
     { is_string,   11, "/some\\path" },
     { is_string,   12, "/some//path" },
     { is_string,   12, "/some-/path" },
+    { is_objpath,  31, "/a/somewhat/longer/object/path" },
 
     { is_sig,       2, "i" },
     { is_sig,       2, "s" },
@@ -2237,6 +2317,124 @@ test_byteswaps (void)
   g_variant_type_info_assert_no_infos ();
 }
 
+static void
+test_serialised_fixed_arrays (void)
+{
+  const gchar *types[] = { "aq", "ai", "ax", "ad", "a(u)" };
+  GVariantSerialised serialised;
+  guint64 buffer[8];
+  guchar *data = (guchar *) buffer;
+  gsize i, j;
+
+  /* arrays of integers are byteswapped in one go */
+  for (i = 0; i < G_N_ELEMENTS (types); i++)
+    {
+      gsize width;
+
+      serialised.type_info = g_variant_type_info_get (G_VARIANT_TYPE (types[i]));
+      g_variant_type_info_query_element (serialised.type_info, NULL, &width);
+
+      for (j = 0; j < sizeof buffer; j++)
+        data[j] = j;
+      serialised.data = data;
+      serialised.size = sizeof buffer;
+      g_variant_serialised_byteswap (serialised);
+
+      for (j = 0; j < sizeof buffer; j++)
+        g_assert_cmpint (data[j], ==, (j - j % width) + (width - 1 - j % width));
+
+      g_variant_type_info_unref (serialised.type_info);
+    }
+
+  /* every byte of an array of booleans is checked */
+  serialised.type_info = g_variant_type_info_get (G_VARIANT_TYPE ("ab"));
+  serialised.data = data;
+  for (serialised.size = 0; serialised.size <= sizeof buffer; serialised.size++)
+    {
+      for (j = 0; j < sizeof buffer; j++)
+        data[j] = j & 1;
+      g_assert (g_variant_serialised_is_normal (serialised));
+
+      for (j = 0; j < serialised.size; j++)
+        {
+          data[j] = 2 << (j % 7);
+          g_assert (!g_variant_serialised_is_normal (serialised));
+          data[j] = j & 1;
+        }
+    }
+  g_variant_type_info_unref (serialised.type_info);
+
+  g_variant_type_info_assert_no_infos ();
+}
+
+/* Measures checking for normal form and byteswapping untrusted arrays
+ * of fixed-sized basic types, and checking a long string.
+ */
+static void
+test_perf_fixed_arrays (gconstpointer user_data)
+{
+  const struct {
+    const gchar *type;
+    gsize width;
+  } arrays[] = {
+    { "ab", 1 }, { "ay", 1 }, { "aq", 2 }, { "ai", 4 }, { "ad", 8 }
+  };
+  gsize n = GPOINTER_TO_SIZE (user_data);
+  gdouble normal_time, byteswap_time;
+  gdouble total = 0;
+  GVariant *value, *swapped;
+  GTimer *timer;
+  gchar *data;
+  gsize i;
+
+  data = g_malloc0 (n * 8);
+  timer = g_timer_new ();
+
+  for (i = 0; i < G_N_ELEMENTS (arrays); i++)
+    {
+      const GVariantType *type = G_VARIANT_TYPE (arrays[i].type);
+      gsize size = n * arrays[i].width;
+
+      /* the result of the check is cached, so use a new value each time */
+      value = g_variant_ref_sink (g_variant_new_from_data (type, data, size, FALSE, NULL, NULL));
+      g_timer_start (timer);
+      g_assert (g_variant_is_normal_form (value));
+      normal_time = g_timer_elapsed (timer, NULL);
+      g_variant_unref (value);
+
+      value = g_variant_ref_sink (g_variant_new_from_data (type, data, size, FALSE, NULL, NULL));
+      g_timer_start (timer);
+      swapped = g_variant_byteswap (value);
+      byteswap_time = g_timer_elapsed (timer, NULL);
+      g_variant_unref (swapped);
+      g_variant_unref (value);
+
+      g_test_message ("%s of %" G_GSIZE_FORMAT " elements: %.6f s checking, "
+                      "%.6f s byteswapping", arrays[i].type, n,
+                      normal_time, byteswap_time);
+      total += normal_time + byteswap_time;
+    }
+
+  /* a string of the same length */
+  memset (data, 'x', n);
+  data[n] = '\0';
+  value = g_variant_ref_sink (g_variant_new_from_data (G_VARIANT_TYPE_STRING, data, n + 1,
+                                                       FALSE, NULL, NULL));
+  g_timer_start (timer);
+  g_assert (g_variant_is_normal_form (value));
+  normal_time = g_timer_elapsed (timer, NULL);
+  g_variant_unref (value);
+
+  g_test_message ("string of %" G_GSIZE_FORMAT " bytes: %.6f s checking",
+                  n, normal_time);
+  total += normal_time;
+
+  g_timer_destroy (timer);
+  g_free (data);
+
+  g_test_minimized_result (total, "%" G_GSIZE_FORMAT " elements: %.4f s", n, total);
+}
+
 static void
 test_fuzz (gdouble *fuzziness)
 {
@@ -3521,6 +3719,147 @@ test_builder_memory (void)
   g_variant_type_info_assert_no_infos ();
 }
 
+typedef void (* BuilderFiller) (GVariantBuilder *builder);
+
+static void
+fill_tuple_array (GVariantBuilder *builder)
+{
+  gint i;
+
+  for (i = 0; i < 300; i++)
+    {
+      gchar *name = g_strdup_printf ("item %d", i);
+
+      g_variant_builder_add (builder, "(sii)", name, i, -i);
+      g_free (name);
+    }
+}
+
+static void
+fill_dictionary (GVariantBuilder *builder)
+{
+  g_variant_builder_add (builder, "{sv}", "one", g_variant_new_int32 (1));
+  g_variant_builder_add (builder, "{sv}", "two", g_variant_new_string ("2"));
+  g_variant_builder_add (builder, "{sv}", "three", g_variant_new ("(yd)", 3, 3.0));
+  g_variant_builder_add (builder, "{sv}", "four", g_variant_new ("ax", NULL));
+}
+
+static void
+fill_nested (GVariantBuilder *builder)
+{
+  gint i;
+
+  /* (ya(sas)mvay(bo)) */
+  g_variant_builder_add (builder, "y", 42);
+
+  g_variant_builder_open (builder, G_VARIANT_TYPE ("a(sas)"));
+  for (i = 0; i < 3; i++)
+    {
+      gint j;
+
+      g_variant_builder_open (builder, G_VARIANT_TYPE ("(sas)"));
+      g_variant_builder_add (builder, "s", "outer");
+      g_variant_builder_open (builder, G_VARIANT_TYPE ("as"));
+      for (j = 0; j < i; j++)
+        g_variant_builder_add (builder, "s", "inner");
+      g_variant_builder_close (builder);
+      g_variant_builder_close (builder);
+    }
+  g_variant_builder_close (builder);
+
+  g_variant_builder_open (builder, G_VARIANT_TYPE ("mv"));
+  g_variant_builder_open (builder, G_VARIANT_TYPE_VARIANT);
+  /* indefinite type inside of a variant */
+  g_variant_builder_open (builder, G_VARIANT_TYPE_ARRAY);
+  g_variant_builder_add (builder, "u", 7);
+  g_variant_builder_add (builder, "u", 8);
+  g_variant_builder_close (builder);
+  g_variant_builder_close (builder);
+  g_variant_builder_close (builder);
+
+  g_variant_builder_open (builder, G_VARIANT_TYPE_BYTESTRING);
+  g_variant_builder_close (builder);
+
+  g_variant_builder_add (builder, "(bo)", TRUE, "/a/b");
+}
+
+static void
+fill_variant (GVariantBuilder *builder)
+{
+  g_variant_builder_add_value (builder, g_variant_new ("(ix)", -1, G_GINT64_CONSTANT (1) << 40));
+}
+
+static void
+fill_nothing (GVariantBuilder *builder)
+{
+}
+
+static void
+test_builder_serialised (void)
+{
+  const struct {
+    const gchar *type;
+    BuilderFiller fill;
+  } cases[] = {
+    { "a(sii)", fill_tuple_array },
+    { "a{sv}", fill_dictionary },
+    { "(ya(sas)mvay(bo))", fill_nested },
+    { "v", fill_variant },
+    { "mi", fill_nothing },
+    { "as", fill_nothing },
+    { "()", fill_nothing }
+  };
+  GVariantBuilder builder;
+  GVariant *value;
+  gchar *printed;
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (cases); i++)
+    {
+      GVariant *expected;
+
+      g_variant_builder_init (&builder, G_VARIANT_TYPE (cases[i].type));
+      cases[i].fill (&builder);
+      expected = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+      g_variant_builder_init_serialised (&builder, G_VARIANT_TYPE (cases[i].type));
+      cases[i].fill (&builder);
+      value = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+      g_assert (g_variant_is_of_type (value, G_VARIANT_TYPE (cases[i].type)));
+      g_assert (g_variant_is_normal_form (value));
+      g_assert (g_variant_equal (value, expected));
+      g_assert_cmpuint (g_variant_get_size (value), ==, g_variant_get_size (expected));
+      g_assert (memcmp (g_variant_get_data (value), g_variant_get_data (expected),
+                        g_variant_get_size (value)) == 0);
+
+      g_variant_unref (expected);
+      g_variant_unref (value);
+    }
+
+  /* aborting part-way through */
+  g_variant_builder_init_serialised (&builder, G_VARIANT_TYPE ("a(sas)"));
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("(sas)"));
+  g_variant_builder_add (&builder, "s", "abandoned");
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("as"));
+  g_variant_builder_clear (&builder);
+
+  /* an invalid string adds nothing */
+  g_variant_builder_init_serialised (&builder, G_VARIANT_TYPE ("a(so)"));
+  g_variant_builder_add (&builder, "(so)", "good", "/");
+  g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_CRITICAL, "*assertion*failed*");
+  g_variant_builder_add (&builder, "(so)", "bad", "not a path");
+  g_test_assert_expected_messages ();
+  g_variant_builder_add (&builder, "(so)", "good", "/x");
+  value = g_variant_ref_sink (g_variant_builder_end (&builder));
+  printed = g_variant_print (value, FALSE);
+  g_assert_cmpstr (printed, ==, "[('good', '/'), ('good', '/x')]");
+  g_free (printed);
+  g_variant_unref (value);
+
+  g_variant_type_info_assert_no_infos ();
+}
+
 static void
 test_hashing (void)
 {
@@ -4070,6 +4409,217 @@ test_lookup_value (void)
     }
 }
 
+static void
+test_lookup_indexed (void)
+{
+  GVariantBuilder builder;
+  GVariant *dict, *serialised;
+  gint round, i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+  for (i = 0; i < 200; i++)
+    {
+      gchar *key = g_strdup_printf ("key%d", i);
+
+      g_variant_builder_add (&builder, "{sv}", key, g_variant_new_int32 (i));
+      g_free (key);
+    }
+  /* a duplicate: the first entry has to win */
+  g_variant_builder_add (&builder, "{sv}", "key7", g_variant_new_string ("seven"));
+  dict = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+  /* untrusted copy of the same data */
+  serialised = g_variant_new_from_data (G_VARIANT_TYPE ("a{sv}"),
+                                        g_variant_get_data (dict),
+                                        g_variant_get_size (dict),
+                                        FALSE, NULL, NULL);
+  g_variant_ref_sink (serialised);
+
+  /* enough rounds for the index to get built halfway through */
+  for (round = 0; round < 8; round++)
+    {
+      GVariant *dicts[] = { dict, serialised };
+      gint j;
+
+      for (j = 0; j < G_N_ELEMENTS (dicts); j++)
+        {
+          GVariant *value;
+          gint32 num;
+
+          for (i = 0; i < 200; i += 7)
+            {
+              gchar *key = g_strdup_printf ("key%d", i);
+
+              g_assert (g_variant_lookup (dicts[j], key, "i", &num));
+              g_assert_cmpint (num, ==, i);
+              g_free (key);
+            }
+
+          value = g_variant_lookup_value (dicts[j], "key7", G_VARIANT_TYPE_STRING);
+          g_assert (value == NULL);
+          value = g_variant_lookup_value (dicts[j], "key199", NULL);
+          g_assert (g_variant_is_of_type (value, G_VARIANT_TYPE_INT32));
+          g_variant_unref (value);
+          g_assert (g_variant_lookup_value (dicts[j], "key200", NULL) == NULL);
+          g_assert (g_variant_lookup_value (dicts[j], "", NULL) == NULL);
+        }
+    }
+
+  g_variant_unref (serialised);
+  g_variant_unref (dict);
+
+  /* object path keys and values that are not variants */
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{os}"));
+  for (i = 0; i < 50; i++)
+    {
+      gchar *path = g_strdup_printf ("/obj/%d", i);
+
+      g_variant_builder_add (&builder, "{os}", path, path + 5);
+      g_free (path);
+    }
+  dict = g_variant_ref_sink (g_variant_builder_end (&builder));
+  g_variant_get_data (dict);
+
+  for (round = 0; round < 8; round++)
+    {
+      const gchar *str;
+
+      g_assert (g_variant_lookup (dict, "/obj/42", "&s", &str));
+      g_assert_cmpstr (str, ==, "42");
+      g_assert (!g_variant_lookup (dict, "/obj", "&s", &str));
+    }
+
+  g_variant_unref (dict);
+}
+
+static void
+test_lookup_sorted (void)
+{
+  GVariantBuilder builder;
+  GVariant *dict, *serialised;
+  GVariant *value;
+  gint i, j;
+
+  /* add the keys in a scrambled order; 37 is coprime to 200 */
+  g_variant_builder_init_sorted (&builder, G_VARIANT_TYPE ("a{sv}"));
+  for (i = 0; i < 200; i++)
+    {
+      gchar *key = g_strdup_printf ("key%03d", (i * 37) % 200);
+
+      g_variant_builder_add (&builder, "{sv}", key, g_variant_new_int32 ((i * 37) % 200));
+      g_free (key);
+    }
+  /* a duplicate: the first entry has to win */
+  g_variant_builder_add (&builder, "{sv}", "key007", g_variant_new_string ("seven"));
+  dict = g_variant_ref_sink (g_variant_builder_end (&builder));
+  g_variant_get_data (dict);
+
+  g_assert_cmpint (g_variant_n_children (dict), ==, 200);
+  for (i = 0; i < 200; i++)
+    {
+      const gchar *key;
+      gint32 num;
+
+      g_variant_get_child (dict, i, "{&sv}", &key, NULL);
+      g_assert_cmpint (atoi (key + 3), ==, i);
+      g_assert (g_variant_lookup (dict, key, "i", &num));
+      g_assert_cmpint (num, ==, i);
+    }
+
+  /* untrusted copy of the same data */
+  serialised = g_variant_new_from_data (G_VARIANT_TYPE ("a{sv}"),
+                                        g_variant_get_data (dict),
+                                        g_variant_get_size (dict),
+                                        FALSE, NULL, NULL);
+  g_variant_ref_sink (serialised);
+
+  for (j = 0; j < 2; j++)
+    {
+      GVariant *d = j ? serialised : dict;
+
+      for (i = 0; i < 200; i++)
+        {
+          gchar *key = g_strdup_printf ("key%03d", i);
+
+          value = g_variant_lookup_value_sorted (d, key, G_VARIANT_TYPE_INT32);
+          g_assert (value != NULL);
+          g_assert_cmpint (g_variant_get_int32 (value), ==, i);
+          g_variant_unref (value);
+          g_free (key);
+        }
+
+      g_assert (g_variant_lookup_value_sorted (d, "key007", G_VARIANT_TYPE_STRING) == NULL);
+      value = g_variant_lookup_value_sorted (d, "key199", NULL);
+      g_assert (g_variant_is_of_type (value, G_VARIANT_TYPE_INT32));
+      g_variant_unref (value);
+      g_assert (g_variant_lookup_value_sorted (d, "key200", NULL) == NULL);
+      g_assert (g_variant_lookup_value_sorted (d, "key0", NULL) == NULL);
+      g_assert (g_variant_lookup_value_sorted (d, "", NULL) == NULL);
+      g_assert (g_variant_lookup_value_sorted (d, "zzz", NULL) == NULL);
+    }
+
+  g_variant_unref (serialised);
+  g_variant_unref (dict);
+
+  /* uint32 keys, including ones that would sort differently as int32 */
+  g_variant_builder_init_sorted (&builder, G_VARIANT_TYPE ("a{us}"));
+  g_variant_builder_add (&builder, "{us}", 0xffffffffu, "max");
+  for (i = 99; i >= 0; i--)
+    {
+      gchar *str = g_strdup_printf ("%d", i * 3);
+
+      g_variant_builder_add (&builder, "{us}", (guint32) i * 3, str);
+      g_free (str);
+    }
+  g_variant_builder_add (&builder, "{us}", 0x80000000u, "half");
+  g_variant_builder_add (&builder, "{us}", 3, "three");
+  dict = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+  g_assert_cmpint (g_variant_n_children (dict), ==, 102);
+  for (i = 1; i < 102; i++)
+    {
+      guint32 a, b;
+
+      g_variant_get_child (dict, i - 1, "{u&s}", &a, NULL);
+      g_variant_get_child (dict, i, "{u&s}", &b, NULL);
+      g_assert_cmpuint (a, <, b);
+    }
+
+  for (i = 0; i < 300; i++)
+    {
+      value = g_variant_lookup_value_sorted_uint32 (dict, i, G_VARIANT_TYPE_STRING);
+      if (i % 3 == 0)
+        {
+          gchar *str = g_strdup_printf ("%d", i);
+
+          g_assert_cmpstr (g_variant_get_string (value, NULL), ==, str);
+          g_variant_unref (value);
+          g_free (str);
+        }
+      else
+        g_assert (value == NULL);
+    }
+
+  g_assert (g_variant_lookup_value_sorted_uint32 (dict, 300, NULL) == NULL);
+  value = g_variant_lookup_value_sorted_uint32 (dict, 0x80000000u, NULL);
+  g_assert_cmpstr (g_variant_get_string (value, NULL), ==, "half");
+  g_variant_unref (value);
+  value = g_variant_lookup_value_sorted_uint32 (dict, 0xffffffffu, NULL);
+  g_assert_cmpstr (g_variant_get_string (value, NULL), ==, "max");
+  g_variant_unref (value);
+  g_assert (g_variant_lookup_value_sorted_uint32 (dict, 0xfffffffeu, NULL) == NULL);
+
+  g_variant_unref (dict);
+
+  /* an empty dictionary */
+  g_variant_builder_init_sorted (&builder, G_VARIANT_TYPE ("a{sv}"));
+  dict = g_variant_ref_sink (g_variant_builder_end (&builder));
+  g_assert (g_variant_lookup_value_sorted (dict, "", NULL) == NULL);
+  g_variant_unref (dict);
+
+  g_variant_type_info_assert_no_infos ();
+}
+
 static void
 test_lookup (void)
 {
@@ -4339,12 +4889,14 @@ main (int argc, char **argv)
 
   g_test_add_func ("/gvariant/type", test_gvarianttype);
   g_test_add_func ("/gvariant/typeinfo", test_gvarianttypeinfo);
+  g_test_add_func ("/gvariant/typeinfo/threaded", test_gvarianttypeinfo_threaded);
   g_test_add_func ("/gvariant/serialiser/maybe", test_maybes);
   g_test_add_func ("/gvariant/serialiser/array", test_arrays);
   g_test_add_func ("/gvariant/serialiser/tuple", test_tuples);
   g_test_add_func ("/gvariant/serialiser/variant", test_variants);
   g_test_add_func ("/gvariant/serialiser/strings", test_strings);
   g_test_add_func ("/gvariant/serialiser/byteswap", test_byteswaps);
+  g_test_add_func ("/gvariant/serialiser/fixed-arrays", test_serialised_fixed_arrays);
 
   for (i = 1; i <= 20; i += 4)
     {
@@ -4365,6 +4917,7 @@ main (int argc, char **argv)
   g_test_add_func ("/gvariant/varargs/subprocess/empty-array", test_varargs_empty_array);
   g_test_add_func ("/gvariant/valist", test_valist);
   g_test_add_func ("/gvariant/builder-memory", test_builder_memory);
+  g_test_add_func ("/gvariant/builder/serialised", test_builder_serialised);
   g_test_add_func ("/gvariant/hashing", test_hashing);
   g_test_add_func ("/gvariant/byteswap", test_gv_byteswap);
   g_test_add_func ("/gvariant/parser", test_parses);
@@ -4377,6 +4930,8 @@ main (int argc, char **argv)
   g_test_add_func ("/gvariant/bytestring", test_bytestring);
   g_test_add_func ("/gvariant/lookup-value", test_lookup_value);
   g_test_add_func ("/gvariant/lookup", test_lookup);
+  g_test_add_func ("/gvariant/lookup/indexed", test_lookup_indexed);
+  g_test_add_func ("/gvariant/lookup/sorted", test_lookup_sorted);
   g_test_add_func ("/gvariant/compare", test_compare);
   g_test_add_func ("/gvariant/fixed-array", test_fixed_array);
   g_test_add_func ("/gvariant/check-format-string", test_check_format_string);
@@ -4386,5 +4941,17 @@ main (int argc, char **argv)
 
   g_test_add_func ("/gvariant/gbytes", test_gbytes);
 
+  if (g_test_perf ())
+    {
+      gsize n;
+
+      for (n = 1000; n <= 10000000; n *= 100)
+        {
+          gchar *path = g_strdup_printf ("/gvariant/perf/fixed-arrays/%" G_GSIZE_FORMAT, n);
+          g_test_add_data_func (path, GSIZE_TO_POINTER (n), test_perf_fixed_arrays);
+          g_free (path);
+        }
+    }
+
   return g_test_run ();
 }
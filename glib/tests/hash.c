@@ -1048,6 +1048,7 @@ struct _GHashTable
   gpointer        *keys;
   guint           *hashes;
   gpointer        *values;
+  guint8          *ctrl;
 
   GHashFunc        hash_func;
   GEqualFunc       key_equal_func;
@@ -1058,8 +1059,28 @@ struct _GHashTable
 #endif
   GDestroyNotify   key_destroy_func;
   GDestroyNotify   value_destroy_func;
+  guint8           key_size;
 };
 
+/* tables with inline integer keys have no hashes array */
+static guint
+node_hash (GHashTable *h, gint i)
+{
+  guint hash;
+
+  if (h->hashes)
+    return h->hashes[i];
+
+  if (h->ctrl[i] == 0x80)
+    return 0;
+  else if (h->ctrl[i] == 0xfe)
+    return 1;
+
+  hash = h->hash_func (&h->keys[i]);
+
+  return hash < 2 ? 2 : hash;
+}
+
 static void
 count_keys (GHashTable *h, gint *unused, gint *occupied, gint *tombstones)
 {
@@ -1070,9 +1091,9 @@ count_keys (GHashTable *h, gint *unused, gint *occupied, gint *tombstones)
   *tombstones = 0;
   for (i = 0; i < h->size; i++)
     {
-      if (h->hashes[i] == 0)
+      if (node_hash (h, i) == 0)
         (*unused)++;
-      else if (h->hashes[i] == 1)
+      else if (node_hash (h, i) == 1)
         (*tombstones)++;
       else
         (*occupied)++;
@@ -1086,18 +1107,43 @@ check_data (GHashTable *h)
 
   for (i = 0; i < h->size; i++)
     {
-      if (h->hashes[i] < 2)
+      if (node_hash (h, i) < 2)
         {
           g_assert (h->keys[i] == NULL);
           g_assert (h->values[i] == NULL);
         }
-      else
+      else if (h->hashes)
         {
           g_assert_cmpint (h->hashes[i], ==, h->hash_func (h->keys[i]));
         }
     }
 }
 
+static void
+check_ctrl (GHashTable *h)
+{
+  gint i;
+
+  for (i = 0; i < h->size; i++)
+    {
+      guint hash = node_hash (h, i);
+      guint8 expected;
+
+      if (hash == 0)
+        expected = 0x80;
+      else if (hash == 1)
+        expected = 0xfe;
+      else
+        expected = (hash * 0x9e3779b1u) >> 25;
+
+      g_assert_cmpint (h->ctrl[i], ==, expected);
+    }
+
+  /* the control bytes of the first nodes are mirrored after the end */
+  for (i = h->size; i < h->size + 15; i++)
+    g_assert_cmpint (h->ctrl[i], ==, h->ctrl[i % h->size]);
+}
+
 static void
 check_consistency (GHashTable *h)
 {
@@ -1112,6 +1158,7 @@ check_consistency (GHashTable *h)
   g_assert_cmpint (occupied + tombstones + unused, ==, h->size);
 
   check_data (h);
+  check_ctrl (h);
 }
 
 static void
@@ -1126,6 +1173,254 @@ trivial_key_destroy (gpointer key)
 {
 }
 
+static void
+test_ctrl_consistency (void)
+{
+  GHashTable *h;
+  gint i;
+
+  h = g_hash_table_new (NULL, NULL);
+
+  /* grow, shrink and leave tombstones behind, with small tables
+   * where groups of control bytes wrap around several times
+   */
+  for (i = 1; i <= 1000; i++)
+    {
+      g_hash_table_insert (h, GINT_TO_POINTER (i), GINT_TO_POINTER (i));
+      if (i % 3 == 0)
+        g_hash_table_remove (h, GINT_TO_POINTER (i / 3));
+      if (i % 97 == 0)
+        check_consistency (h);
+    }
+
+  /* keys 1 to 333 were removed again */
+  for (i = 1; i <= 1000; i++)
+    g_assert ((g_hash_table_lookup (h, GINT_TO_POINTER (i)) != NULL) == (i > 333));
+
+  for (i = 1; i <= 1000; i++)
+    {
+      g_hash_table_remove (h, GINT_TO_POINTER (i));
+      if (i % 89 == 0)
+        check_consistency (h);
+      g_assert (g_hash_table_lookup (h, GINT_TO_POINTER (i)) == NULL);
+    }
+
+  check_consistency (h);
+  g_assert_cmpint (g_hash_table_size (h), ==, 0);
+
+  g_hash_table_unref (h);
+}
+
+static gint destroyed_values;
+
+static void
+count_destroyed_value (gpointer value)
+{
+  destroyed_values++;
+}
+
+static gboolean
+remove_odd_int (gpointer key, gpointer value, gpointer user_data)
+{
+  return *(gint *) key % 2 == 1;
+}
+
+static void
+test_inline_int_keys (void)
+{
+  GHashTable *h;
+  GHashTableIter iter;
+  gpointer key, value;
+  gint i, sum;
+
+  h = g_hash_table_new_int (count_destroyed_value);
+  g_assert (h->hashes == NULL);
+  g_assert (h->keys != h->values);
+  destroyed_values = 0;
+
+  /* keys are copied, so a single variable can be reused */
+  for (i = 0; i < 1000; i++)
+    g_hash_table_insert (h, &i, GINT_TO_POINTER (i + 1));
+
+  g_assert_cmpint (g_hash_table_size (h), ==, 1000);
+  check_consistency (h);
+
+  for (i = 0; i < 1000; i++)
+    {
+      g_assert_cmpint (GPOINTER_TO_INT (g_hash_table_lookup (h, &i)), ==, i + 1);
+      g_assert (g_hash_table_lookup_extended (h, &i, &key, &value));
+      g_assert_cmpint (*(gint *) key, ==, i);
+    }
+  i = -1;
+  g_assert (!g_hash_table_contains (h, &i));
+
+  /* replacing a value keeps the key and destroys the old value */
+  i = 7;
+  g_hash_table_insert (h, &i, GINT_TO_POINTER (-7));
+  g_assert_cmpint (destroyed_values, ==, 1);
+  g_assert_cmpint (GPOINTER_TO_INT (g_hash_table_lookup (h, &i)), ==, -7);
+  g_hash_table_insert (h, &i, GINT_TO_POINTER (8));
+
+  sum = 0;
+  g_hash_table_iter_init (&iter, h);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      g_assert_cmpint (GPOINTER_TO_INT (value), ==, *(gint *) key + 1);
+      sum += *(gint *) key;
+    }
+  g_assert_cmpint (sum, ==, 999 * 1000 / 2);
+
+  g_assert_cmpint (g_hash_table_foreach_remove (h, remove_odd_int, NULL), ==, 500);
+  check_consistency (h);
+
+  for (i = 0; i < 1000; i++)
+    g_assert (g_hash_table_contains (h, &i) == (i % 2 == 0));
+
+  for (i = 0; i < 1000; i += 4)
+    g_assert (g_hash_table_remove (h, &i));
+  g_assert_cmpint (g_hash_table_size (h), ==, 250);
+  check_consistency (h);
+
+  /* used as a set, the values are NULL */
+  i = 12345;
+  g_hash_table_add (h, &i);
+  g_assert (g_hash_table_lookup_extended (h, &i, &key, &value));
+  g_assert (key != &i);
+  g_assert_cmpint (*(gint *) key, ==, 12345);
+  g_assert (value == NULL);
+
+  g_hash_table_remove_all (h);
+  check_counts (h, 0, 0);
+  check_consistency (h);
+
+  g_hash_table_unref (h);
+}
+
+static void
+test_inline_int64_keys (void)
+{
+  GHashTable *h;
+  GList *keys, *l;
+  gint64 k;
+  gint i;
+
+  h = g_hash_table_new_int64 (NULL);
+
+  for (i = 0; i < 1000; i++)
+    {
+      k = G_GINT64_CONSTANT (0x100000000) * i + i;
+      g_hash_table_replace (h, &k, GINT_TO_POINTER (i));
+    }
+
+  g_assert_cmpint (g_hash_table_size (h), ==, 1000);
+  check_consistency (h);
+
+  /* keys differing only in the upper half are distinct */
+  k = 5;
+  g_assert (!g_hash_table_contains (h, &k));
+
+  for (i = 0; i < 1000; i++)
+    {
+      k = G_GINT64_CONSTANT (0x100000000) * i + i;
+      g_assert_cmpint (GPOINTER_TO_INT (g_hash_table_lookup (h, &k)), ==, i);
+    }
+
+  keys = g_hash_table_get_keys (h);
+  g_assert_cmpint (g_list_length (keys), ==, 1000);
+  for (l = keys; l; l = l->next)
+    {
+      k = *(gint64 *) l->data;
+      g_assert_cmpint (k >> 32, ==, k & 0xffffffff);
+    }
+  g_list_free (keys);
+
+  for (i = 0; i < 1000; i++)
+    {
+      k = G_GINT64_CONSTANT (0x100000000) * i + i;
+      g_assert (g_hash_table_remove (h, &k));
+    }
+  g_assert_cmpint (g_hash_table_size (h), ==, 0);
+  check_consistency (h);
+
+  g_hash_table_unref (h);
+}
+
+static gint freed_keys;
+
+static void
+count_freed_key (gpointer key)
+{
+  freed_keys++;
+  g_free (key);
+}
+
+static gboolean
+remove_odd_int64 (gpointer key, gpointer value, gpointer user_data)
+{
+  return *(gint64 *) key % 2 == 1;
+}
+
+static void
+test_copied_int64_keys_steal (void)
+{
+  GHashTable *h;
+  GHashTableIter iter;
+  gpointer key;
+  gint64 k[2] = { 0, 0 };
+  gint i;
+
+#if GLIB_SIZEOF_VOID_P < 8
+  h = g_hash_table_new_int64 (NULL);
+#else
+  /* 64-bit keys fit into a pointer here; pretend they do not, the
+   * same way g_hash_table_new_int64() sets up tables on 32-bit
+   * platforms.  Only the first half of @k is hashed and compared.
+   */
+  h = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+  h->key_size = sizeof k;
+#endif
+  g_assert (h->hashes != NULL);
+  g_assert (h->key_destroy_func == g_free);
+  h->key_destroy_func = count_freed_key;
+  freed_keys = 0;
+
+  for (i = 0; i < 100; i++)
+    {
+      k[0] = 100 + i;
+      g_hash_table_insert (h, k, GINT_TO_POINTER (i + 1));
+    }
+  check_consistency (h);
+
+  /* the table owns its copies of the keys, so stealing frees them */
+  k[0] = 100;
+  g_assert (g_hash_table_steal (h, k));
+  g_assert_cmpint (freed_keys, ==, 1);
+
+  g_hash_table_iter_init (&iter, h);
+  g_assert (g_hash_table_iter_next (&iter, &key, NULL));
+  g_hash_table_iter_steal (&iter);
+  g_assert_cmpint (freed_keys, ==, 2);
+  check_consistency (h);
+
+  i = freed_keys;
+  i += g_hash_table_foreach_steal (h, remove_odd_int64, NULL);
+  g_assert_cmpint (freed_keys, ==, i);
+  check_consistency (h);
+
+  g_hash_table_steal_all (h);
+  g_assert_cmpint (freed_keys, ==, 100);
+  g_assert_cmpint (g_hash_table_size (h), ==, 0);
+  check_consistency (h);
+
+  /* removing still frees each key once */
+  k[0] = 1000;
+  g_hash_table_insert (h, k, NULL);
+  g_assert (g_hash_table_remove (h, k));
+  g_assert_cmpint (freed_keys, ==, 101);
+
+  g_hash_table_unref (h);
+}
+
 static void
 test_internal_consistency (void)
 {
@@ -1264,6 +1559,58 @@ test_set_insert_corruption (void)
   g_hash_table_unref (hash_table);
 }
 
+/* Measures insertions, successful and failed lookups, and removals
+ * in a table of a million nodes filled to different load factors.
+ */
+static void
+test_perf_probing (gconstpointer data)
+{
+  guint n_keys = GPOINTER_TO_UINT (data);
+  GHashTable *h;
+  GTimer *timer;
+  gdouble insert_time, hit_time, miss_time, remove_time;
+  gdouble load;
+  guint i;
+
+  h = g_hash_table_new (NULL, NULL);
+  timer = g_timer_new ();
+
+  /* keys are pseudo-random and distinct, since the multiplier is odd */
+  g_timer_start (timer);
+  for (i = 0; i < n_keys; i++)
+    g_hash_table_insert (h, GUINT_TO_POINTER (i * 2654435761u + 1), GUINT_TO_POINTER (i + 1));
+  insert_time = g_timer_elapsed (timer, NULL);
+
+  load = (gdouble) h->nnodes / h->size;
+
+  g_timer_start (timer);
+  for (i = 0; i < n_keys; i++)
+    g_assert (g_hash_table_lookup (h, GUINT_TO_POINTER (i * 2654435761u + 1)) == GUINT_TO_POINTER (i + 1));
+  hit_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < n_keys; i++)
+    g_hash_table_lookup (h, GUINT_TO_POINTER (i * 2654435761u + 2));
+  miss_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < n_keys; i++)
+    g_hash_table_remove (h, GUINT_TO_POINTER (i * 2654435761u + 1));
+  remove_time = g_timer_elapsed (timer, NULL);
+
+  g_test_message ("%u keys, load factor %.2f: "
+                  "%.0f inserts/s, %.0f hits/s, %.0f misses/s, %.0f removals/s",
+                  n_keys, load,
+                  n_keys / insert_time, n_keys / hit_time,
+                  n_keys / miss_time, n_keys / remove_time);
+  g_test_maximized_result (2 * n_keys / (hit_time + miss_time),
+                           "%.0f lookups/s at load factor %.2f",
+                           2 * n_keys / (hit_time + miss_time), load);
+
+  g_timer_destroy (timer);
+  g_hash_table_unref (h);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -1291,6 +1638,33 @@ main (int argc, char *argv[])
   g_test_add_func ("/hash/consistency", test_internal_consistency);
   g_test_add_func ("/hash/iter-replace", test_iter_replace);
   g_test_add_func ("/hash/set-insert-corruption", test_set_insert_corruption);
+  g_test_add_func ("/hash/ctrl-consistency", test_ctrl_consistency);
+  g_test_add_func ("/hash/inline-int", test_inline_int_keys);
+  g_test_add_func ("/hash/inline-int64", test_inline_int64_keys);
+  g_test_add_func ("/hash/copied-int64-steal", test_copied_int64_keys_steal);
+
+  if (g_test_perf ())
+    {
+      guint n_keys;
+
+      /* all of these end up in a table of 2^20 nodes, which fits
+       * into the caches of many machines...
+       */
+      for (n_keys = 500000; n_keys <= 900000; n_keys += 100000)
+        {
+          gchar *path = g_strdup_printf ("/hash/perf/probing/%u", n_keys);
+          g_test_add_data_func (path, GUINT_TO_POINTER (n_keys), test_perf_probing);
+          g_free (path);
+        }
+
+      /* ...and of 2^23 nodes, which does not */
+      for (n_keys = 4200000; n_keys <= 7800000; n_keys += 900000)
+        {
+          gchar *path = g_strdup_printf ("/hash/perf/probing/%u", n_keys);
+          g_test_add_data_func (path, GUINT_TO_POINTER (n_keys), test_perf_probing);
+          g_free (path);
+        }
+    }
 
   return g_test_run ();
 
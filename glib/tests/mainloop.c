@@ -1026,10 +1026,147 @@ test_wakeup(void)
   g_main_context_unref (ctx);
 }
 
+typedef struct
+{
+  GSource source;
+  gint64 expected_time;
+  gint n_dispatched;
+} DeadlineSource;
+
+static gboolean
+deadline_dispatch (GSource     *source,
+                   GSourceFunc  callback,
+                   gpointer     user_data)
+{
+  DeadlineSource *deadline = (DeadlineSource *) source;
+
+  g_assert_cmpint (g_source_get_time (source), >=, deadline->expected_time);
+  deadline->n_dispatched++;
+  g_source_set_ready_time (source, -1);
+
+  return TRUE;
+}
+
+static GSourceFuncs deadline_funcs = {
+  NULL, NULL, deadline_dispatch, NULL
+};
+
+#define N_DEADLINES 200
+
+static void
+test_many_ready_times (void)
+{
+  DeadlineSource *sources[N_DEADLINES];
+  GMainContext *ctx;
+  gint64 start_time;
+  gint n_done;
+  gint i;
+
+  ctx = g_main_context_new ();
+  start_time = g_get_monotonic_time ();
+
+  /* Deadlines spread over 200ms, added in a scrambled order */
+  for (i = 0; i < N_DEADLINES; i++)
+    {
+      sources[i] = (DeadlineSource *) g_source_new (&deadline_funcs, sizeof (DeadlineSource));
+      sources[i]->expected_time = start_time + ((i * 37) % N_DEADLINES) * 1000;
+      g_source_set_ready_time ((GSource *) sources[i], sources[i]->expected_time);
+      g_source_attach ((GSource *) sources[i], ctx);
+    }
+
+  /* Move some of them around while they are attached, and disable a
+   * few altogether.
+   */
+  for (i = 0; i < N_DEADLINES; i += 7)
+    {
+      sources[i]->expected_time = start_time + ((i * 13) % N_DEADLINES) * 1000;
+      g_source_set_ready_time ((GSource *) sources[i], sources[i]->expected_time);
+    }
+  for (i = 3; i < N_DEADLINES; i += 50)
+    {
+      sources[i]->expected_time = -1;
+      g_source_set_ready_time ((GSource *) sources[i], -1);
+    }
+
+  do
+    {
+      g_main_context_iteration (ctx, TRUE);
+
+      n_done = 0;
+      for (i = 0; i < N_DEADLINES; i++)
+        if (sources[i]->expected_time == -1 || sources[i]->n_dispatched > 0)
+          n_done++;
+    }
+  while (n_done < N_DEADLINES);
+
+  for (i = 0; i < N_DEADLINES; i++)
+    {
+      if (sources[i]->expected_time == -1)
+        g_assert_cmpint (sources[i]->n_dispatched, ==, 0);
+      else
+        g_assert_cmpint (sources[i]->n_dispatched, ==, 1);
+
+      g_source_destroy ((GSource *) sources[i]);
+      g_source_unref ((GSource *) sources[i]);
+    }
+
+  g_main_context_unref (ctx);
+}
+
+static gboolean
+count_iterations (gpointer data)
+{
+  gint *n_iterations = data;
+
+  (*n_iterations)++;
+
+  return TRUE;
+}
+
+static void
+test_pending_timeouts_perf (gconstpointer data)
+{
+  gint n_timeouts = GPOINTER_TO_INT (data);
+  GMainContext *ctx;
+  GSource *source;
+  gint64 start_time;
+  gint n_iterations = 0;
+  gdouble rate;
+  gint i;
+
+  ctx = g_main_context_new ();
+
+  /* Idle connection timers that never get to fire */
+  for (i = 0; i < n_timeouts; i++)
+    {
+      source = g_timeout_source_new_seconds (3600 + i % 60);
+      g_source_set_callback (source, cb, NULL, NULL);
+      g_source_attach (source, ctx);
+      g_source_unref (source);
+    }
+
+  source = g_idle_source_new ();
+  g_source_set_callback (source, count_iterations, &n_iterations, NULL);
+  g_source_attach (source, ctx);
+  g_source_unref (source);
+
+  start_time = g_get_monotonic_time ();
+  while (g_get_monotonic_time () - start_time < G_USEC_PER_SEC)
+    g_main_context_iteration (ctx, FALSE);
+  rate = n_iterations / ((g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC);
+
+  g_test_maximized_result (rate, "%d pending timeouts: %.0f iterations/s", n_timeouts, rate);
+
+  g_main_context_unref (ctx);
+}
+
 #ifdef G_OS_UNIX
 
 #include <glib-unix.h>
+#include <glib/gstdio.h>
 #include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
 
 static gchar zeros[1024];
 
@@ -1395,6 +1532,289 @@ test_source_unix_fd_api (void)
   close (fds_b[1]);
 }
 
+static gboolean
+dispatch_flag (GSource     *source,
+               GSourceFunc  callback,
+               gpointer     user_data)
+{
+  gboolean *flag = user_data;
+
+  *flag = TRUE;
+
+  return TRUE;
+}
+
+static GSourceFuncs flag_funcs = {
+  NULL, NULL, dispatch_flag, NULL
+};
+
+static GSource *
+add_fd_source_to_context (GMainContext  *context,
+                          gint           fd,
+                          GIOCondition   condition,
+                          gint           priority,
+                          gboolean      *flag,
+                          gpointer      *tag)
+{
+  GSource *source;
+  gpointer fd_tag;
+
+  source = g_source_new (&flag_funcs, sizeof (GSource));
+  fd_tag = g_source_add_unix_fd (source, fd, condition);
+  g_source_set_callback (source, NULL, flag, NULL);
+  g_source_set_priority (source, priority);
+  g_source_attach (source, context);
+
+  if (tag)
+    *tag = fd_tag;
+
+  return source;
+}
+
+static void
+test_epoll (void)
+{
+  GMainContext *context;
+  GSource *in_source;
+  GSource *out_source;
+  GSource *file_source;
+  GSource *hup_source;
+  gpointer out_tag;
+  gboolean in, out, file, hup;
+  gchar *filename;
+  gchar c = 'x';
+  gint fds[2];
+  gint sv[2];
+  gint file_fd;
+  gint s;
+
+  context = GLIB_PRIVATE_CALL (g_main_context_new_with_epoll) (TRUE);
+
+  s = pipe (fds);
+  g_assert (s == 0);
+
+  in = out = file = FALSE;
+  in_source = add_fd_source_to_context (context, fds[0], G_IO_IN, G_PRIORITY_HIGH, &in, NULL);
+
+  /* nothing to read yet */
+  while (g_main_context_iteration (context, FALSE));
+  g_assert (!in);
+
+  s = write (fds[1], &c, 1);
+  g_assert (s == 1);
+  g_assert (g_main_context_iteration (context, TRUE));
+  g_assert (in);
+
+  /* the byte is still there, so it must fire again */
+  in = FALSE;
+  g_assert (g_main_context_iteration (context, FALSE));
+  g_assert (in);
+
+  s = read (fds[0], &c, 1);
+  g_assert (s == 1);
+  in = FALSE;
+  while (g_main_context_iteration (context, FALSE));
+  g_assert (!in);
+
+  /* a lower priority source on the other end of the pipe */
+  out_source = add_fd_source_to_context (context, fds[1], G_IO_OUT, G_PRIORITY_DEFAULT, &out, &out_tag);
+  g_assert (g_main_context_iteration (context, FALSE));
+  g_assert (!in && out);
+
+  /* with both ready, only the higher priority one may dispatch */
+  out = FALSE;
+  s = write (fds[1], &c, 1);
+  g_assert (s == 1);
+  g_assert (g_main_context_iteration (context, FALSE));
+  g_assert (in && !out);
+  in = FALSE;
+  g_source_destroy (in_source);
+  g_source_unref (in_source);
+  g_assert (g_main_context_iteration (context, FALSE));
+  g_assert (!in && out);
+
+  /* changing the events on the fd must be picked up */
+  out = FALSE;
+  g_source_modify_unix_fd (out_source, out_tag, G_IO_IN);
+  while (g_main_context_iteration (context, FALSE));
+  g_assert (!out);
+
+  g_source_destroy (out_source);
+  g_source_unref (out_source);
+
+  /* a lower priority source on the same fd as a higher priority one,
+   * which share one registration with the events of both
+   */
+  s = socketpair (AF_UNIX, SOCK_STREAM, 0, sv);
+  g_assert (s == 0);
+  in = out = FALSE;
+  in_source = add_fd_source_to_context (context, sv[0], G_IO_IN, G_PRIORITY_HIGH, &in, NULL);
+  out_source = add_fd_source_to_context (context, sv[0], G_IO_OUT, G_PRIORITY_DEFAULT, &out, NULL);
+  g_assert (g_main_context_iteration (context, FALSE));
+  g_assert (!in && out);
+
+  /* with both ready, only the higher priority one may dispatch */
+  out = FALSE;
+  s = write (sv[1], &c, 1);
+  g_assert (s == 1);
+  g_assert (g_main_context_iteration (context, FALSE));
+  g_assert (in && !out);
+
+  /* removing it leaves the other one registered */
+  in = FALSE;
+  g_source_destroy (in_source);
+  g_source_unref (in_source);
+  g_assert (g_main_context_iteration (context, FALSE));
+  g_assert (!in && out);
+
+  g_source_destroy (out_source);
+  g_source_unref (out_source);
+  close (sv[1]);
+  close (sv[0]);
+
+  /* a source that only asks for hangups still gets them */
+  s = pipe (sv);
+  g_assert (s == 0);
+  hup = FALSE;
+  hup_source = add_fd_source_to_context (context, sv[0], G_IO_HUP, G_PRIORITY_DEFAULT, &hup, NULL);
+  while (g_main_context_iteration (context, FALSE));
+  g_assert (!hup);
+  close (sv[1]);
+  g_assert (g_main_context_iteration (context, FALSE));
+  g_assert (hup);
+
+  g_source_destroy (hup_source);
+  g_source_unref (hup_source);
+  close (sv[0]);
+
+  /* regular files can't be used with epoll, so this makes the context
+   * fall back to poll()
+   */
+  file_fd = g_file_open_tmp (NULL, &filename, NULL);
+  g_assert (file_fd >= 0);
+  file_source = add_fd_source_to_context (context, file_fd, G_IO_IN, G_PRIORITY_DEFAULT, &file, NULL);
+  in_source = add_fd_source_to_context (context, fds[0], G_IO_IN, G_PRIORITY_DEFAULT, &in, NULL);
+  g_assert (g_main_context_iteration (context, FALSE));
+  g_assert (file && in);
+
+  g_source_destroy (file_source);
+  g_source_unref (file_source);
+  g_source_destroy (in_source);
+  g_source_unref (in_source);
+  close (file_fd);
+  g_unlink (filename);
+  g_free (filename);
+
+  close (fds[1]);
+  close (fds[0]);
+
+  g_main_context_unref (context);
+}
+
+typedef struct
+{
+  gint n_fds;
+  gboolean use_epoll;
+} IdleFdsData;
+
+static gboolean
+read_one_byte (gint         fd,
+               GIOCondition condition,
+               gpointer     user_data)
+{
+  gint *n_read = user_data;
+  gchar c;
+
+  if (read (fd, &c, 1) == 1)
+    (*n_read)++;
+
+  return TRUE;
+}
+
+static void
+test_idle_fds_perf (gconstpointer user_data)
+{
+  const IdleFdsData *data = user_data;
+  GMainContext *context;
+  GSource *active_source;
+  GSource **sources;
+  gint *dup_fds;
+  struct rlimit limit;
+  gint64 start_time;
+  gdouble rate;
+  gint idle_fds[2];
+  gint fds[2];
+  gint n_read = 0;
+  gchar c = 'x';
+  gint i, s;
+
+  /* Every idle fd is a dup of the same pipe, which is never written to */
+  getrlimit (RLIMIT_NOFILE, &limit);
+  if (limit.rlim_cur < data->n_fds + 64)
+    {
+      limit.rlim_cur = MIN (limit.rlim_max, data->n_fds + 64);
+      setrlimit (RLIMIT_NOFILE, &limit);
+      getrlimit (RLIMIT_NOFILE, &limit);
+    }
+  if (limit.rlim_cur < data->n_fds + 64)
+    {
+      g_test_skip ("not enough file descriptors available");
+      return;
+    }
+
+  context = GLIB_PRIVATE_CALL (g_main_context_new_with_epoll) (data->use_epoll);
+
+  s = pipe (idle_fds);
+  g_assert (s == 0);
+  s = pipe (fds);
+  g_assert (s == 0);
+
+  sources = g_new (GSource *, data->n_fds);
+  dup_fds = g_new (gint, data->n_fds);
+  for (i = 0; i < data->n_fds; i++)
+    {
+      dup_fds[i] = dup (idle_fds[0]);
+      g_assert (dup_fds[i] >= 0);
+      sources[i] = g_unix_fd_source_new (dup_fds[i], G_IO_IN);
+      g_source_set_callback (sources[i], (GSourceFunc) read_one_byte, NULL, NULL);
+      g_source_attach (sources[i], context);
+    }
+
+  active_source = g_unix_fd_source_new (fds[0], G_IO_IN);
+  g_source_set_callback (active_source, (GSourceFunc) read_one_byte, &n_read, NULL);
+  g_source_attach (active_source, context);
+
+  start_time = g_get_monotonic_time ();
+  while (g_get_monotonic_time () - start_time < G_USEC_PER_SEC)
+    {
+      s = write (fds[1], &c, 1);
+      g_assert (s == 1);
+      g_main_context_iteration (context, TRUE);
+    }
+  rate = n_read / ((g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC);
+
+  g_test_maximized_result (rate, "%d idle fds (%s): %.0f iterations/s",
+                           data->n_fds, data->use_epoll ? "epoll" : "poll", rate);
+
+  g_source_destroy (active_source);
+  g_source_unref (active_source);
+  for (i = 0; i < data->n_fds; i++)
+    {
+      g_source_destroy (sources[i]);
+      g_source_unref (sources[i]);
+      close (dup_fds[i]);
+    }
+  g_free (sources);
+  g_free (dup_fds);
+
+  close (idle_fds[0]);
+  close (idle_fds[1]);
+  close (fds[0]);
+  close (fds[1]);
+
+  g_main_context_unref (context);
+}
+
 #endif
 
 int
@@ -1415,11 +1835,47 @@ main (int argc, char *argv[])
   g_test_add_func ("/mainloop/source_time", test_source_time);
   g_test_add_func ("/mainloop/overflow", test_mainloop_overflow);
   g_test_add_func ("/mainloop/ready-time", test_ready_time);
+  g_test_add_func ("/mainloop/many-ready-times", test_many_ready_times);
   g_test_add_func ("/mainloop/wakeup", test_wakeup);
 #ifdef G_OS_UNIX
   g_test_add_func ("/mainloop/unix-fd", test_unix_fd);
   g_test_add_func ("/mainloop/unix-fd-source", test_unix_fd_source);
   g_test_add_func ("/mainloop/source-unix-fd-api", test_source_unix_fd_api);
+  g_test_add_func ("/mainloop/epoll", test_epoll);
+#endif
+
+  if (g_test_perf ())
+    {
+      gint i;
+
+      for (i = 1000; i <= 100000; i *= 10)
+        {
+          gchar name[80];
+
+          g_snprintf (name, sizeof name, "/mainloop/perf/pending-timeouts/%d", i);
+          g_test_add_data_func (name, GINT_TO_POINTER (i), test_pending_timeouts_perf);
+        }
+    }
+
+#ifdef G_OS_UNIX
+
+  if (g_test_perf ())
+    {
+      static const gint n_fds[] = { 10, 100, 1000, 10000, 50000 };
+      static IdleFdsData data[2 * G_N_ELEMENTS (n_fds)];
+      gint i;
+
+      for (i = 0; i < G_N_ELEMENTS (data); i++)
+        {
+          gchar name[80];
+
+          data[i].n_fds = n_fds[i / 2];
+          data[i].use_epoll = i % 2;
+          g_snprintf (name, sizeof name, "/mainloop/perf/idle-fds/%s/%d",
+                      data[i].use_epoll ? "epoll" : "poll", data[i].n_fds);
+          g_test_add_data_func (name, &data[i], test_idle_fds_perf);
+        }
+    }
 #endif
 
   return g_test_run ();
@@ -125,6 +125,7 @@
 /* --- signals --- */
 enum {
   NOTIFY,
+  NOTIFY_BATCH,
   LAST_SIGNAL
 };
 
@@ -173,70 +174,235 @@ static gchar*	g_value_object_lcopy_value		(const GValue	*value,
 static void	g_object_dispatch_properties_changed	(GObject	*object,
 							 guint		 n_pspecs,
 							 GParamSpec    **pspecs);
+static GParamSpec *get_notify_pspec                     (GParamSpec     *pspec);
 static guint               object_floating_flag_handler (GObject        *object,
                                                          gint            job);
 
 static void object_interface_check_properties           (gpointer        check_data,
 							 gpointer        g_iface);
+static void     weak_refs_notify                        (GObject        *object);
 
 /* --- typedefs --- */
+typedef struct _GObjectNotifyIndex            GObjectNotifyIndex;
 typedef struct _GObjectNotifyQueue            GObjectNotifyQueue;
 
+/* The properties that can be notified on instances of a type, numbered
+ * so that a notify queue can record them in a bitset.  Built the first
+ * time an instance of the type is frozen and never changed afterwards,
+ * so it can be read without locking.
+ */
+struct _GObjectNotifyIndex
+{
+  GHashTable   *indices;        /* GParamSpec -> position + 1 */
+  guint         n_pspecs;
+  GParamSpec  **pspecs;
+};
+
+#define NOTIFY_QUEUE_WORD_BITS  (8 * sizeof (gsize))
+
+typedef struct _GObjectConstructPlan          GObjectConstructPlan;
+typedef struct _GObjectConstructCache         GObjectConstructCache;
+
+/* The properties that a sequence of names passed to
+ * g_object_new_valist() resolved to, after checking that they can be
+ * set at construction.
+ */
+struct _GObjectConstructPlan
+{
+  GObjectConstructPlan *next;
+  guint                 n_pspecs;
+  gchar               **names;
+  GParamSpec          **pspecs;
+};
+
+/* What constructing instances of a class has taught us so far.  Built
+ * on first use and hung off GObjectClass.construct_cache; after that,
+ * plans are only ever prepended, so it can be read without locking.
+ */
+struct _GObjectConstructCache
+{
+  guint                  n_construct_properties;
+  GParamSpec           **construct_properties;
+  const GValue         **valid_defaults;  /* NULL if it needs validating */
+  GObjectConstructPlan  *plans;
+  volatile gint          n_plans;
+};
+
+#define MAX_CONSTRUCT_PLANS     8
+
 struct _GObjectNotifyQueue
 {
-  GSList  *pspecs;
+  GObjectNotifyIndex *index;
+  GSList  *pspecs;              /* properties missing from the index */
   guint16  n_pspecs;
   guint16  freeze_count;
+  volatile gsize pending[1];    /* one bit per property in the index */
 };
 
+/* Every GWeakRef to an object points to the same entry rather than to
+ * the object itself.  Entries are never freed, only recycled, because
+ * g_weak_ref_get() may still look at one after it was released.
+ */
+typedef struct _WeakRefEntry WeakRefEntry;
+struct _WeakRefEntry
+{
+  GObject       *object;        /* NULL once the object is going away */
+  volatile gint  ref_count;     /* GWeakRefs pointing here, plus one while attached */
+  volatile gint  n_readers;     /* g_weak_ref_get() calls that may look at object */
+  WeakRefEntry  *next_free;
+};
+
+static void     weak_ref_entry_detach                   (WeakRefEntry   *entry);
+
+/* Objects created by g_object_newv_many() share one block of memory.
+ * The block is released together with its last object, and holds a
+ * single class reference on behalf of all of them.
+ */
+typedef struct
+{
+  volatile gint  n_alive;
+  GObjectClass  *class;
+} GObjectArena;
+
+#define OBJECT_ARENA_MAX_OBJECTS 256
+
+/* Internal per-object state that is looked up too often to go through
+ * the qdata datalist.  It is allocated with the instance and starts
+ * out zeroed.
+ */
+typedef struct
+{
+  GObjectNotifyQueue *notify_queue;     /* protected by notify_lock */
+  gpointer            weak_refs;        /* WeakRefStack, protected by weak_refs_lock() */
+  gpointer            toggle_refs;      /* ToggleRefStack, protected by toggle_refs_mutex */
+  WeakRefEntry       *weak_ref_entry;   /* only ever set with compare-and-exchange */
+  GObjectArena       *arena;            /* NULL unless from g_object_newv_many() */
+} GObjectPrivate;
+
 /* --- variables --- */
 G_LOCK_DEFINE_STATIC (closure_array_mutex);
-G_LOCK_DEFINE_STATIC (weak_refs_mutex);
 G_LOCK_DEFINE_STATIC (toggle_refs_mutex);
 static GQuark	            quark_closure_array = 0;
-static GQuark	            quark_weak_refs = 0;
-static GQuark	            quark_toggle_refs = 0;
-static GQuark               quark_notify_queue;
+static gint                 GObject_private_offset;
 static GParamSpecPool      *pspec_pool = NULL;
 static gulong	            gobject_signals[LAST_SIGNAL] = { 0, };
 static guint (*floating_flag_handler) (GObject*, gint) = object_floating_flag_handler;
 G_LOCK_DEFINE_STATIC (construction_mutex);
 static GSList *construction_objects = NULL;
-/* qdata pointing to GSList<GWeakRef *>, protected by weak_locations_lock */
-static GQuark	            quark_weak_locations = 0;
-static GRWLock              weak_locations_lock;
+/* construct caches of classes that had properties added too late,
+ * protected by construction_mutex
+ */
+static GSList *retired_construct_caches = NULL;
+G_LOCK_DEFINE_STATIC (weak_ref_entries);
+static WeakRefEntry        *free_weak_ref_entries = NULL;
+
+/* weak reference stacks are protected by one of these, chosen by
+ * hashing the object pointer
+ */
+#define WEAK_REFS_LOCK_BITS 5
+static GMutex               weak_refs_locks[1 << WEAK_REFS_LOCK_BITS];
+#define WEAK_REFS_LOCK(object)   g_mutex_lock (weak_refs_lock (object))
+#define WEAK_REFS_UNLOCK(object) g_mutex_unlock (weak_refs_lock (object))
 
+/* protects the lifetime of notify queues, and notify_indices */
 G_LOCK_DEFINE_STATIC(notify_lock);
+static GHashTable          *notify_indices = NULL;
 
 /* --- functions --- */
+static GObjectNotifyIndex*
+g_object_notify_index_get (GType type)
+{
+  GObjectNotifyIndex *index;
+  GParamSpec **pspecs;
+  guint i, n;
+
+  index = g_hash_table_lookup (notify_indices, GSIZE_TO_POINTER (type));
+  if (index)
+    return index;
+
+  pspecs = g_param_spec_pool_list (pspec_pool, type, &n);
+  index = g_new0 (GObjectNotifyIndex, 1);
+  index->indices = g_hash_table_new (NULL, NULL);
+  index->pspecs = g_new (GParamSpec*, n);
+  for (i = 0; i < n; i++)
+    {
+      GParamSpec *notify_pspec = get_notify_pspec (pspecs[i]);
+
+      if (notify_pspec && !g_hash_table_contains (index->indices, notify_pspec))
+        {
+          index->pspecs[index->n_pspecs++] = notify_pspec;
+          g_hash_table_insert (index->indices, notify_pspec, GUINT_TO_POINTER (index->n_pspecs));
+        }
+    }
+  g_free (pspecs);
+
+  g_hash_table_insert (notify_indices, GSIZE_TO_POINTER (type), index);
+
+  return index;
+}
+
+static void
+g_object_notify_index_free (GObjectNotifyIndex *index)
+{
+  g_hash_table_unref (index->indices);
+  g_free (index->pspecs);
+  g_free (index);
+}
+
+static inline gsize
+g_object_notify_queue_size (GObjectNotifyIndex *index)
+{
+  guint n_words = (index->n_pspecs + NOTIFY_QUEUE_WORD_BITS - 1) / NOTIFY_QUEUE_WORD_BITS;
+
+  return G_STRUCT_OFFSET (GObjectNotifyQueue, pending) + MAX (n_words, 1) * sizeof (gsize);
+}
+
 static void
 g_object_notify_queue_free (gpointer data)
 {
   GObjectNotifyQueue *nqueue = data;
 
   g_slist_free (nqueue->pspecs);
-  g_slice_free (GObjectNotifyQueue, nqueue);
+  g_slice_free1 (g_object_notify_queue_size (nqueue->index), nqueue);
+}
+
+static inline GObjectPrivate *
+g_object_get_instance_private (GObject *object)
+{
+  return G_STRUCT_MEMBER_P (object, GObject_private_offset);
 }
 
 static GObjectNotifyQueue*
 g_object_notify_queue_freeze (GObject  *object,
                               gboolean  conditional)
 {
+  GObjectPrivate *priv = g_object_get_instance_private (object);
   GObjectNotifyQueue *nqueue;
 
+  /* Most notifications happen on objects that are not frozen.  Another
+   * thread may be freezing the object right now, but then it is a race
+   * whether the notification gets queued anyway, so don't bother
+   * taking the lock to find out.
+   */
+  if (conditional && !g_atomic_pointer_get (&priv->notify_queue))
+    return NULL;
+
   G_LOCK(notify_lock);
-  nqueue = g_datalist_id_get_data (&object->qdata, quark_notify_queue);
+  nqueue = priv->notify_queue;
   if (!nqueue)
     {
+      GObjectNotifyIndex *index;
+
       if (conditional)
         {
           G_UNLOCK(notify_lock);
           return NULL;
         }
 
-      nqueue = g_slice_new0 (GObjectNotifyQueue);
-      g_datalist_id_set_data_full (&object->qdata, quark_notify_queue,
-                                   nqueue, g_object_notify_queue_free);
+      index = g_object_notify_index_get (G_OBJECT_TYPE (object));
+      nqueue = g_slice_alloc0 (g_object_notify_queue_size (index));
+      nqueue->index = index;
+      g_atomic_pointer_set (&priv->notify_queue, nqueue);
     }
 
   if (nqueue->freeze_count >= 65535)
@@ -256,8 +422,10 @@ g_object_notify_queue_thaw (GObject            *object,
                             GObjectNotifyQueue *nqueue)
 {
   GParamSpec *pspecs_mem[16], **pspecs, **free_me = NULL;
+  GObjectNotifyIndex *index;
   GSList *slist;
   guint n_pspecs = 0;
+  guint n_max, i;
 
   g_return_if_fail (nqueue->freeze_count > 0);
   g_return_if_fail (g_atomic_int_get(&object->ref_count) > 0);
@@ -278,13 +446,28 @@ g_object_notify_queue_thaw (GObject            *object,
     return;
   }
 
-  pspecs = nqueue->n_pspecs > 16 ? free_me = g_new (GParamSpec*, nqueue->n_pspecs) : pspecs_mem;
+  /* Nobody can add to the queue any longer since that requires a
+   * freeze, and taking the lock has made all the bits they set visible.
+   */
+  index = nqueue->index;
+  n_max = index->n_pspecs + nqueue->n_pspecs;
+  pspecs = n_max > 16 ? free_me = g_new (GParamSpec*, n_max) : pspecs_mem;
+
+  for (i = 0; i < index->n_pspecs; i += NOTIFY_QUEUE_WORD_BITS)
+    {
+      gsize bits = nqueue->pending[i / NOTIFY_QUEUE_WORD_BITS];
+      guint j;
 
+      for (j = i; bits; j++, bits >>= 1)
+        if (bits & 1)
+          pspecs[n_pspecs++] = index->pspecs[j];
+    }
   for (slist = nqueue->pspecs; slist; slist = slist->next)
     {
       pspecs[n_pspecs++] = slist->data;
     }
-  g_datalist_id_set_data (&object->qdata, quark_notify_queue, NULL);
+  g_atomic_pointer_set (&g_object_get_instance_private (object)->notify_queue, NULL);
+  g_object_notify_queue_free (nqueue);
 
   G_UNLOCK(notify_lock);
 
@@ -298,6 +481,22 @@ g_object_notify_queue_add (GObject            *object,
                            GObjectNotifyQueue *nqueue,
                            GParamSpec         *pspec)
 {
+  guint i;
+
+  /* the caller holds a freeze, so the queue stays around */
+  i = GPOINTER_TO_UINT (g_hash_table_lookup (nqueue->index->indices, pspec));
+  if (G_LIKELY (i != 0))
+    {
+      volatile gsize *word = &nqueue->pending[(i - 1) / NOTIFY_QUEUE_WORD_BITS];
+      gsize bit = (gsize) 1 << ((i - 1) % NOTIFY_QUEUE_WORD_BITS);
+
+      /* bulk updates tend to set the same properties over and over */
+      if (!(*word & bit))
+        g_atomic_pointer_or (word, bit);
+      return;
+    }
+
+  /* properties installed after the index was built end up here */
   G_LOCK(notify_lock);
 
   g_return_if_fail (nqueue->n_pspecs < 65535);
@@ -311,6 +510,152 @@ g_object_notify_queue_add (GObject            *object,
   G_UNLOCK(notify_lock);
 }
 
+static GObjectConstructCache*
+g_object_construct_cache_new (GObjectClass *class)
+{
+  GObjectConstructCache *cache;
+  GSList *node;
+  guint i;
+
+  cache = g_new0 (GObjectConstructCache, 1);
+  cache->n_construct_properties = g_slist_length (class->construct_properties);
+  cache->construct_properties = g_new (GParamSpec*, cache->n_construct_properties);
+  cache->valid_defaults = g_new0 (const GValue*, cache->n_construct_properties);
+
+  for (node = class->construct_properties, i = 0; node; node = node->next, i++)
+    {
+      GParamSpec *pspec = node->data;
+      const GValue *default_value = g_param_spec_get_default_value (pspec);
+      GValue tmp_value = G_VALUE_INIT;
+
+      cache->construct_properties[i] = pspec;
+
+      /* defaults are normally valid; the ones that are not take the
+       * slow path, which warns about them
+       */
+      g_value_init (&tmp_value, pspec->value_type);
+      g_value_copy (default_value, &tmp_value);
+      if (!g_param_value_validate (pspec, &tmp_value))
+        cache->valid_defaults[i] = default_value;
+      g_value_unset (&tmp_value);
+    }
+
+  return cache;
+}
+
+static void
+g_object_construct_cache_free (GObjectConstructCache *cache)
+{
+  while (cache->plans)
+    {
+      GObjectConstructPlan *plan = cache->plans;
+
+      cache->plans = plan->next;
+      g_strfreev (plan->names);
+      g_free (plan->pspecs);
+      g_free (plan);
+    }
+  g_free (cache->construct_properties);
+  g_free (cache->valid_defaults);
+  g_free (cache);
+}
+
+static inline GObjectConstructCache*
+g_object_class_get_construct_cache (GObjectClass *class)
+{
+  GObjectConstructCache *cache;
+
+  cache = g_atomic_pointer_get (&class->construct_cache);
+  if (G_LIKELY (cache))
+    return cache;
+
+  cache = g_object_construct_cache_new (class);
+  if (!g_atomic_pointer_compare_and_exchange (&class->construct_cache, NULL, cache))
+    {
+      g_object_construct_cache_free (cache);
+      cache = g_atomic_pointer_get (&class->construct_cache);
+    }
+
+  return cache;
+}
+
+/* Called when properties are added after the class was set up, which
+ * is not supported, but happens.  Other threads may still be using the
+ * old cache, so it can not be freed.
+ */
+static void
+g_object_class_forget_construct_cache (GObjectClass *class)
+{
+  GObjectConstructCache *cache;
+
+  do
+    cache = g_atomic_pointer_get (&class->construct_cache);
+  while (!g_atomic_pointer_compare_and_exchange (&class->construct_cache, cache, NULL));
+
+  if (cache)
+    {
+      G_LOCK (construction_mutex);
+      retired_construct_caches = g_slist_prepend (retired_construct_caches, cache);
+      G_UNLOCK (construction_mutex);
+    }
+}
+
+/* Finds the first plan, starting at @plan, that agrees with the
+ * properties found so far and continues with @name.
+ */
+static GObjectConstructPlan*
+g_object_construct_plan_find (GObjectConstructPlan  *plan,
+                              GObjectConstructParam *params,
+                              guint                  n_params,
+                              const gchar           *name)
+{
+  for (; plan; plan = plan->next)
+    if (n_params < plan->n_pspecs && strcmp (plan->names[n_params], name) == 0)
+      {
+        guint i;
+
+        for (i = 0; i < n_params; i++)
+          if (plan->pspecs[i] != params[i].pspec)
+            break;
+        if (i == n_params)
+          return plan;
+      }
+
+  return NULL;
+}
+
+static void
+g_object_construct_plan_add (GObjectConstructCache *cache,
+                             GObjectConstructParam *params,
+                             const gchar          **names,
+                             guint                  n_params)
+{
+  GObjectConstructPlan *plan;
+  guint i;
+
+  /* sequences of names are usually fixed at compile time, so there are
+   * few of them for each class; don't let code that makes them up as it
+   * goes grow the list without bounds
+   */
+  if (g_atomic_int_add (&cache->n_plans, 1) >= MAX_CONSTRUCT_PLANS)
+    return;
+
+  plan = g_new (GObjectConstructPlan, 1);
+  plan->n_pspecs = n_params;
+  plan->names = g_new (gchar*, n_params + 1);
+  plan->pspecs = g_new (GParamSpec*, n_params);
+  for (i = 0; i < n_params; i++)
+    {
+      plan->names[i] = g_strdup (names[i]);
+      plan->pspecs[i] = params[i].pspec;
+    }
+  plan->names[n_params] = NULL;
+
+  do
+    plan->next = g_atomic_pointer_get (&cache->plans);
+  while (!g_atomic_pointer_compare_and_exchange (&cache->plans, plan->next, plan));
+}
+
 #ifdef	G_ENABLE_DEBUG
 #define	IF_DEBUG(debug_type)	if (_g_type_debug_flags & G_TYPE_DEBUG_ ## debug_type)
 G_LOCK_DEFINE_STATIC     (debug_objects);
@@ -416,6 +761,7 @@ g_object_base_class_init (GObjectClass *class)
 
   /* reset instance specific fields and methods that don't get inherited */
   class->construct_properties = pclass ? g_slist_copy (pclass->construct_properties) : NULL;
+  class->construct_cache = NULL;
   class->get_property = NULL;
   class->set_property = NULL;
 }
@@ -423,12 +769,26 @@ g_object_base_class_init (GObjectClass *class)
 static void
 g_object_base_class_finalize (GObjectClass *class)
 {
+  GObjectNotifyIndex *index;
   GList *list, *node;
   
   _g_signals_destroy (G_OBJECT_CLASS_TYPE (class));
 
   g_slist_free (class->construct_properties);
   class->construct_properties = NULL;
+  if (class->construct_cache)
+    g_object_construct_cache_free (class->construct_cache);
+  class->construct_cache = NULL;
+
+  G_LOCK (notify_lock);
+  index = g_hash_table_lookup (notify_indices, GSIZE_TO_POINTER (G_OBJECT_CLASS_TYPE (class)));
+  if (index)
+    {
+      g_hash_table_remove (notify_indices, GSIZE_TO_POINTER (G_OBJECT_CLASS_TYPE (class)));
+      g_object_notify_index_free (index);
+    }
+  G_UNLOCK (notify_lock);
+
   list = g_param_spec_pool_list_owned (pspec_pool, G_OBJECT_CLASS_TYPE (class));
   for (node = list; node; node = node->next)
     {
@@ -447,10 +807,10 @@ g_object_do_class_init (GObjectClass *class)
   /* read the comment about typedef struct CArray; on why not to change this quark */
   quark_closure_array = g_quark_from_static_string ("GObject-closure-array");
 
-  quark_weak_refs = g_quark_from_static_string ("GObject-weak-references");
-  quark_weak_locations = g_quark_from_static_string ("GObject-weak-locations");
-  quark_toggle_refs = g_quark_from_static_string ("GObject-toggle-references");
-  quark_notify_queue = g_quark_from_static_string ("GObject-notify-queue");
+  GObject_private_offset = sizeof (GObjectPrivate);
+  g_type_class_adjust_private_offset (class, &GObject_private_offset);
+
+  notify_indices = g_hash_table_new (NULL, NULL);
   pspec_pool = g_param_spec_pool_new (TRUE);
 
   class->constructor = g_object_constructor;
@@ -495,6 +855,39 @@ g_object_do_class_init (GObjectClass *class)
 		  G_TYPE_NONE,
 		  1, G_TYPE_PARAM);
 
+  /**
+   * GObject::notify-batch:
+   * @gobject: the object which received the signal.
+   * @n_pspecs: the number of properties which changed.
+   * @pspecs: (array length=n_pspecs): the #GParamSpec<!-- -->s of the
+   *   properties which changed.
+   *
+   * The notify-batch signal is emitted once every time property change
+   * notifications are dispatched on an object, after the
+   * #GObject::notify signals for the individual properties.  Properties
+   * that change while notification is frozen with
+   * g_object_freeze_notify() are all reported in a single emission when
+   * the object is thawed.
+   *
+   * Handlers that care about many properties can connect to this signal
+   * instead of #GObject::notify, to be called once per batch rather than
+   * once per property.
+   *
+   * Since: 2.38
+   */
+  gobject_signals[NOTIFY_BATCH] =
+    g_signal_new (g_intern_static_string ("notify-batch"),
+		  G_TYPE_FROM_CLASS (class),
+		  G_SIGNAL_RUN_FIRST | G_SIGNAL_NO_HOOKS,
+		  0,
+		  NULL, NULL,
+		  g_cclosure_marshal_VOID__UINT_POINTER,
+		  G_TYPE_NONE,
+		  2, G_TYPE_UINT, G_TYPE_POINTER);
+  g_signal_set_va_marshaller (gobject_signals[NOTIFY_BATCH],
+			      G_TYPE_FROM_CLASS (class),
+			      g_cclosure_marshal_VOID__UINT_POINTERv);
+
   /* Install a check function that we'll use to verify that classes that
    * implement an interface implement all properties for that interface
    */
@@ -560,6 +953,7 @@ g_object_class_install_property (GObjectClass *class,
     g_return_if_fail (pspec->flags & G_PARAM_WRITABLE);
 
   install_property_internal (G_OBJECT_CLASS_TYPE (class), property_id, pspec);
+  g_object_class_forget_construct_cache (class);
 
   if (pspec->flags & (G_PARAM_CONSTRUCT | G_PARAM_CONSTRUCT_ONLY))
     class->construct_properties = g_slist_append (class->construct_properties, pspec);
@@ -680,6 +1074,7 @@ g_object_class_install_properties (GObjectClass  *oclass,
 
       oclass->flags |= CLASS_HAS_PROPS_FLAG;
       install_property_internal (oclass_type, i, pspec);
+      g_object_class_forget_construct_cache (oclass);
 
       if (pspec->flags & (G_PARAM_CONSTRUCT | G_PARAM_CONSTRUCT_ONLY))
         oclass->construct_properties = g_slist_append (oclass->construct_properties, pspec);
@@ -1015,13 +1410,23 @@ g_object_real_dispose (GObject *object)
 {
   g_signal_handlers_destroy (object);
   g_datalist_id_set_data (&object->qdata, quark_closure_array, NULL);
-  g_datalist_id_set_data (&object->qdata, quark_weak_refs, NULL);
+  weak_refs_notify (object);
 }
 
 static void
 g_object_finalize (GObject *object)
 {
+  GObjectPrivate *priv = g_object_get_instance_private (object);
+
   g_datalist_clear (&object->qdata);
+
+  /* these may have been set up again after dispose */
+  weak_refs_notify (object);
+  if (priv->weak_ref_entry != NULL)
+    weak_ref_entry_detach (priv->weak_ref_entry);
+  g_free (priv->toggle_refs);
+  if (priv->notify_queue != NULL)
+    g_object_notify_queue_free (priv->notify_queue);
   
 #ifdef	G_ENABLE_DEBUG
   IF_DEBUG (OBJECTS)
@@ -1043,8 +1448,12 @@ g_object_dispatch_properties_changed (GObject     *object,
 {
   guint i;
 
-  for (i = 0; i < n_pspecs; i++)
-    g_signal_emit (object, gobject_signals[NOTIFY], g_quark_from_string (pspecs[i]->name), pspecs[i]);
+  /* spare looking up the detail of every property when nobody listens */
+  if (!_g_signal_emission_is_nop (object, gobject_signals[NOTIFY]))
+    for (i = 0; i < n_pspecs; i++)
+      g_signal_emit (object, gobject_signals[NOTIFY], g_quark_from_string (pspecs[i]->name), pspecs[i]);
+
+  g_signal_emit (object, gobject_signals[NOTIFY_BATCH], 0, n_pspecs, pspecs);
 }
 
 /**
@@ -1304,16 +1713,74 @@ object_get_property (GObject     *object,
 }
 
 static inline void
-object_set_property (GObject             *object,
-		     GParamSpec          *pspec,
-		     const GValue        *value,
-		     GObjectNotifyQueue  *nqueue)
+consider_issuing_property_deprecation_warning (GObject    *object,
+                                               GParamSpec *pspec)
+{
+  static const gchar * enable_diagnostic = NULL;
+
+  if (G_UNLIKELY (!enable_diagnostic))
+    {
+      enable_diagnostic = g_getenv ("G_ENABLE_DIAGNOSTIC");
+      if (!enable_diagnostic)
+        enable_diagnostic = "0";
+    }
+
+  if (enable_diagnostic[0] == '1')
+    {
+      if (pspec->flags & G_PARAM_DEPRECATED)
+        g_warning ("The property %s:%s is deprecated and shouldn't be used "
+                   "anymore. It will be removed in a future version.",
+                   G_OBJECT_TYPE_NAME (object), pspec->name);
+    }
+}
+
+/* Whether validating a value for @pspec in place leaves a shallow copy
+ * of the value intact, so that the copy can still be shown in the
+ * warning about an invalid value.  That is the case for plain data
+ * types, and for strings unless the validation may rewrite or free
+ * them.
+ */
+static inline gboolean
+validation_keeps_shallow_copy (GParamSpec *pspec)
+{
+  GType fundamental = G_TYPE_FUNDAMENTAL (pspec->value_type);
+
+  if (pspec->flags & G_PARAM_LAX_VALIDATION)
+    return TRUE;
+
+  if (fundamental >= G_TYPE_CHAR && fundamental <= G_TYPE_DOUBLE)
+    return TRUE;
+
+  if (G_PARAM_SPEC_TYPE (pspec) == G_TYPE_PARAM_STRING)
+    {
+      GParamSpecString *sspec = G_PARAM_SPEC_STRING (pspec);
+
+      return !sspec->cset_first && !sspec->cset_nth && !sspec->null_fold_if_empty;
+    }
+
+  return FALSE;
+}
+
+/* If @value_is_valid, @value is known to hold a valid value of the
+ * type of @pspec and is used as it is.  If @value_is_scratch, nobody
+ * looks at @value afterwards, so it may be validated in place instead
+ * of in a copy where that does not lose the original value.
+ */
+static inline void
+object_set_property_full (GObject             *object,
+                          GParamSpec          *pspec,
+                          const GValue        *value,
+                          gboolean             value_is_valid,
+                          gboolean             value_is_scratch,
+                          GObjectNotifyQueue  *nqueue)
 {
   GValue tmp_value = G_VALUE_INIT;
+  GValue shallow_copy;
+  const GValue *original_value = value;
   GObjectClass *class = g_type_class_peek (pspec->owner_type);
   guint param_id = PARAM_SPEC_PARAM_ID (pspec);
   GParamSpec *redirect;
-  static const gchar * enable_diagnostic = NULL;
+  GValue *work_value;
 
   if (class == NULL)
     {
@@ -1326,31 +1793,38 @@ object_set_property (GObject             *object,
   if (redirect)
     pspec = redirect;
 
-  if (G_UNLIKELY (!enable_diagnostic))
+  consider_issuing_property_deprecation_warning (object, pspec);
+
+  if (value_is_valid)
+    work_value = (GValue *) value;
+  else if (value_is_scratch && G_VALUE_TYPE (value) == pspec->value_type &&
+           validation_keeps_shallow_copy (pspec))
     {
-      enable_diagnostic = g_getenv ("G_ENABLE_DIAGNOSTIC");
-      if (!enable_diagnostic)
-        enable_diagnostic = "0";
+      /* the validation may change @value, so keep what was passed */
+      shallow_copy = *value;
+      original_value = &shallow_copy;
+      work_value = (GValue *) value;
     }
-
-  if (enable_diagnostic[0] == '1')
+  else
     {
-      if (pspec->flags & G_PARAM_DEPRECATED)
-        g_warning ("The property %s:%s is deprecated and shouldn't be used "
-                   "anymore. It will be removed in a future version.",
-                   G_OBJECT_TYPE_NAME (object), pspec->name);
+      /* provide a copy to work from, convert (if necessary) and validate */
+      g_value_init (&tmp_value, pspec->value_type);
+      if (!g_value_transform (value, &tmp_value))
+        {
+          g_warning ("unable to set property '%s' of type '%s' from value of type '%s'",
+                     pspec->name,
+                     g_type_name (pspec->value_type),
+                     G_VALUE_TYPE_NAME (value));
+          g_value_unset (&tmp_value);
+          return;
+        }
+      work_value = &tmp_value;
     }
 
-  /* provide a copy to work from, convert (if necessary) and validate */
-  g_value_init (&tmp_value, pspec->value_type);
-  if (!g_value_transform (value, &tmp_value))
-    g_warning ("unable to set property '%s' of type '%s' from value of type '%s'",
-	       pspec->name,
-	       g_type_name (pspec->value_type),
-	       G_VALUE_TYPE_NAME (value));
-  else if (g_param_value_validate (pspec, &tmp_value) && !(pspec->flags & G_PARAM_LAX_VALIDATION))
+  if (!value_is_valid &&
+      g_param_value_validate (pspec, work_value) && !(pspec->flags & G_PARAM_LAX_VALIDATION))
     {
-      gchar *contents = g_strdup_value_contents (value);
+      gchar *contents = g_strdup_value_contents (original_value);
 
       g_warning ("value \"%s\" of type '%s' is invalid or out of range for property '%s' of type '%s'",
 		 contents,
@@ -1363,14 +1837,25 @@ object_set_property (GObject             *object,
     {
       GParamSpec *notify_pspec;
 
-      class->set_property (object, param_id, &tmp_value, pspec);
+      class->set_property (object, param_id, work_value, pspec);
 
       notify_pspec = get_notify_pspec (pspec);
 
       if (notify_pspec != NULL)
         g_object_notify_queue_add (object, nqueue, notify_pspec);
     }
-  g_value_unset (&tmp_value);
+
+  if (work_value == &tmp_value)
+    g_value_unset (&tmp_value);
+}
+
+static inline void
+object_set_property (GObject             *object,
+		     GParamSpec          *pspec,
+		     const GValue        *value,
+		     GObjectNotifyQueue  *nqueue)
+{
+  object_set_property_full (object, pspec, value, FALSE, FALSE, nqueue);
 }
 
 static void
@@ -1732,51 +2217,47 @@ g_object_new_with_custom_constructor (GObjectClass          *class,
   return object;
 }
 
-static gpointer
-g_object_new_internal (GObjectClass          *class,
-                       GObjectConstructParam *params,
-                       guint                  n_params)
+/* the part of g_object_new_internal() that runs once @object exists */
+static void
+g_object_construct_instance (GObjectClass          *class,
+                             GObject               *object,
+                             GObjectConstructParam *params,
+                             guint                  n_params,
+                             gboolean               params_are_scratch)
 {
   GObjectNotifyQueue *nqueue = NULL;
-  GObject *object;
-
-  if G_UNLIKELY (CLASS_HAS_CUSTOM_CONSTRUCTOR (class))
-    return g_object_new_with_custom_constructor (class, params, n_params);
-
-  object = (GObject *) g_type_create_instance (class->g_type_class.g_type);
 
   if (CLASS_HAS_PROPS (class))
     {
-      GSList *node;
+      GObjectConstructCache *cache;
+      guint k;
 
       /* This will have been setup in g_object_init() */
-      nqueue = g_datalist_id_get_data (&object->qdata, quark_notify_queue);
+      nqueue = g_object_get_instance_private (object)->notify_queue;
       g_assert (nqueue != NULL);
 
       /* We will set exactly n_construct_properties construct
        * properties, but they may come from either the class default
        * values or the passed-in parameter list.
        */
-      for (node = class->construct_properties; node; node = node->next)
+      cache = g_object_class_get_construct_cache (class);
+      for (k = 0; k < cache->n_construct_properties; k++)
         {
-          const GValue *value;
           GParamSpec *pspec;
           gint j;
 
-          pspec = node->data;
-          value = NULL; /* to silence gcc... */
+          pspec = cache->construct_properties[k];
 
           for (j = 0; j < n_params; j++)
             if (params[j].pspec == pspec)
-              {
-                value = params[j].value;
-                break;
-              }
-
-          if (j == n_params)
-            value = g_param_spec_get_default_value (pspec);
+              break;
 
-          object_set_property (object, pspec, value, nqueue);
+          if (j < n_params)
+            object_set_property_full (object, pspec, params[j].value, FALSE, params_are_scratch, nqueue);
+          else if (cache->valid_defaults[k])
+            object_set_property_full (object, pspec, cache->valid_defaults[k], TRUE, FALSE, nqueue);
+          else
+            object_set_property (object, pspec, g_param_spec_get_default_value (pspec), nqueue);
         }
     }
 
@@ -1794,14 +2275,86 @@ g_object_new_internal (GObjectClass          *class,
        */
       for (i = 0; i < n_params; i++)
         if (!(params[i].pspec->flags & (G_PARAM_CONSTRUCT | G_PARAM_CONSTRUCT_ONLY)))
-          object_set_property (object, params[i].pspec, params[i].value, nqueue);
+          object_set_property_full (object, params[i].pspec, params[i].value, FALSE, params_are_scratch, nqueue);
 
       g_object_notify_queue_thaw (object, nqueue);
     }
+}
+
+static gpointer
+g_object_new_internal (GObjectClass          *class,
+                       GObjectConstructParam *params,
+                       guint                  n_params,
+                       gboolean               params_are_scratch)
+{
+  GObject *object;
+
+  if G_UNLIKELY (CLASS_HAS_CUSTOM_CONSTRUCTOR (class))
+    return g_object_new_with_custom_constructor (class, params, n_params);
+
+  object = (GObject *) g_type_create_instance (class->g_type_class.g_type);
+
+  g_object_construct_instance (class, object, params, n_params, params_are_scratch);
 
   return object;
 }
 
+/* Looks up the pspecs for @parameters, leaving out (with a critical)
+ * the ones that can not be set.  Returns the number of entries filled
+ * in @cparams, which must have room for @n_parameters.
+ */
+static guint
+g_object_lookup_parameters (GType                  object_type,
+                            guint                  n_parameters,
+                            GParameter            *parameters,
+                            GObjectConstructParam *cparams)
+{
+  guint i, j;
+
+  j = 0;
+
+  for (i = 0; i < n_parameters; i++)
+    {
+      GParamSpec *pspec;
+      gint k;
+
+      pspec = g_param_spec_pool_lookup (pspec_pool, parameters[i].name, object_type, TRUE);
+
+      if G_UNLIKELY (!pspec)
+        {
+          g_critical ("%s: object class '%s' has no property named '%s'",
+                      G_STRFUNC, g_type_name (object_type), parameters[i].name);
+          continue;
+        }
+
+      if G_UNLIKELY (~pspec->flags & G_PARAM_WRITABLE)
+        {
+          g_critical ("%s: property '%s' of object class '%s' is not writable",
+                      G_STRFUNC, pspec->name, g_type_name (object_type));
+          continue;
+        }
+
+      if (pspec->flags & (G_PARAM_CONSTRUCT | G_PARAM_CONSTRUCT_ONLY))
+        {
+          for (k = 0; k < j; k++)
+            if (cparams[k].pspec == pspec)
+                break;
+          if G_UNLIKELY (k != j)
+            {
+              g_critical ("%s: construct property '%s' for type '%s' cannot be set twice",
+                          G_STRFUNC, parameters[i].name, g_type_name (object_type));
+              continue;
+            }
+        }
+
+      cparams[j].pspec = pspec;
+      cparams[j].value = &parameters[i].value;
+      j++;
+    }
+
+  return j;
+}
+
 /**
  * g_object_newv:
  * @object_type: the type id of the #GObject subtype to instantiate
@@ -1839,60 +2392,139 @@ g_object_newv (GType       object_type,
   if (n_parameters)
     {
       GObjectConstructParam *cparams;
-      guint i, j;
+      guint n_cparams;
 
       cparams = g_newa (GObjectConstructParam, n_parameters);
-      j = 0;
+      n_cparams = g_object_lookup_parameters (object_type, n_parameters, parameters, cparams);
 
-      for (i = 0; i < n_parameters; i++)
-        {
-          GParamSpec *pspec;
-          gint k;
+      object = g_object_new_internal (class, cparams, n_cparams, FALSE);
+    }
+  else
+    /* Fast case: no properties passed in. */
+    object = g_object_new_internal (class, NULL, 0, FALSE);
 
-          pspec = g_param_spec_pool_lookup (pspec_pool, parameters[i].name, object_type, TRUE);
+  if (unref_class)
+    g_type_class_unref (unref_class);
 
-          if G_UNLIKELY (!pspec)
-            {
-              g_critical ("%s: object class '%s' has no property named '%s'",
-                          G_STRFUNC, g_type_name (object_type), parameters[i].name);
-              continue;
-            }
+  return object;
+}
 
-          if G_UNLIKELY (~pspec->flags & G_PARAM_WRITABLE)
-            {
-              g_critical ("%s: property '%s' of object class '%s' is not writable",
-                          G_STRFUNC, pspec->name, g_type_name (object_type));
-              continue;
-            }
+/**
+ * g_object_newv_many:
+ * @object_type: the type id of the #GObject subtype to instantiate
+ * @n_parameters: the length of the @parameters array
+ * @parameters: (array length=n_parameters): an array of #GParameter
+ * @n_objects: the number of objects to create
+ * @objects: (out caller-allocates) (array length=n_objects) (transfer full):
+ *     return location for the new objects
+ *
+ * Creates @n_objects new instances of a #GObject subtype, each with
+ * the properties in @parameters, as if g_object_newv() had been
+ * called @n_objects times.
+ *
+ * Where possible, the instances are carved out of a few large blocks
+ * of memory instead of being allocated one by one, which makes both
+ * creating and releasing them considerably cheaper.  This is meant
+ * for large numbers of short-lived objects that tend to die
+ * together, such as the nodes of a parsed document; use
+ * g_object_unref_many() to release them.  The objects are otherwise
+ * entirely normal and can be unreffed individually and in any order,
+ * but a block is only freed once all of its objects are gone.
+ *
+ * Since: 2.38
+ */
+void
+g_object_newv_many (GType       object_type,
+                    guint       n_parameters,
+                    GParameter *parameters,
+                    guint       n_objects,
+                    GObject   **objects)
+{
+  GObjectConstructParam *cparams;
+  GObjectClass *class;
+  guint n_cparams;
+  gsize private_size;
+  gsize stride;
+  guint i;
 
-          if (pspec->flags & (G_PARAM_CONSTRUCT | G_PARAM_CONSTRUCT_ONLY))
-            {
-              for (k = 0; k < j; k++)
-                if (cparams[k].pspec == pspec)
-                    break;
-              if G_UNLIKELY (k != j)
-                {
-                  g_critical ("%s: construct property '%s' for type '%s' cannot be set twice",
-                              G_STRFUNC, parameters[i].name, g_type_name (object_type));
-                  continue;
-                }
-            }
+  g_return_if_fail (G_TYPE_IS_OBJECT (object_type));
+  g_return_if_fail (n_parameters == 0 || parameters != NULL);
+  g_return_if_fail (n_objects == 0 || objects != NULL);
 
-          cparams[j].pspec = pspec;
-          cparams[j].value = &parameters[i].value;
-          j++;
-        }
+  class = g_type_class_ref (object_type);
 
-      object = g_object_new_internal (class, cparams, j);
-    }
+  cparams = g_newa (GObjectConstructParam, n_parameters);
+  n_cparams = g_object_lookup_parameters (object_type, n_parameters, parameters, cparams);
+
+  /* Custom constructors may return anything at all, not necessarily
+   * the instance that was created for them.
+   */
+  if (CLASS_HAS_CUSTOM_CONSTRUCTOR (class))
+    stride = 0;
   else
-    /* Fast case: no properties passed in. */
-    object = g_object_new_internal (class, NULL, 0);
+    stride = _g_type_get_instance_size (object_type, &private_size);
 
-  if (unref_class)
-    g_type_class_unref (unref_class);
+  if (stride == 0)
+    {
+      for (i = 0; i < n_objects; i++)
+        objects[i] = g_object_new_internal (class, cparams, n_cparams, FALSE);
 
-  return object;
+      g_type_class_unref (class);
+      return;
+    }
+
+  stride = (stride + 2 * sizeof (gsize) - 1) & ~(2 * sizeof (gsize) - 1);
+
+  i = 0;
+  while (i < n_objects)
+    {
+      GObjectArena *arena;
+      gsize header_size;
+      gchar *slot;
+      guint n, j;
+
+      n = MIN (n_objects - i, OBJECT_ARENA_MAX_OBJECTS);
+      header_size = (sizeof (GObjectArena) + 2 * sizeof (gsize) - 1) & ~(2 * sizeof (gsize) - 1);
+      arena = g_malloc0 (header_size + n * stride);
+      arena->n_alive = n;
+      arena->class = g_type_class_ref (object_type);
+
+      slot = ((gchar *) arena) + header_size;
+      for (j = 0; j < n; j++, i++, slot += stride)
+        {
+          GObject *object = (GObject *) (slot + private_size);
+
+          _g_type_init_instance ((GTypeInstance *) object, (GTypeClass *) class);
+          g_object_get_instance_private (object)->arena = arena;
+          g_object_construct_instance (class, object, cparams, n_cparams, FALSE);
+
+          objects[i] = object;
+        }
+    }
+
+  g_type_class_unref (class);
+}
+
+/**
+ * g_object_unref_many:
+ * @objects: (array length=n_objects): the objects to release
+ * @n_objects: the length of @objects
+ *
+ * Calls g_object_unref() on each of @objects.  This is the
+ * counterpart of g_object_newv_many(), but works with any objects.
+ *
+ * Since: 2.38
+ */
+void
+g_object_unref_many (GObject **objects,
+                     guint     n_objects)
+{
+  guint i;
+
+  g_return_if_fail (n_objects == 0 || objects != NULL);
+
+  for (i = 0; i < n_objects; i++)
+    g_object_unref (objects[i]);
 }
 
 /**
@@ -1930,12 +2562,21 @@ g_object_new_valist (GType        object_type,
   if (first_property_name)
     {
       GObjectConstructParam stack_params[16];
+      const gchar *stack_names[16];
       GObjectConstructParam *params;
+      const gchar **names;
+      GObjectConstructCache *cache;
+      GObjectConstructPlan *plan;
       const gchar *name;
       gint n_params = 0;
 
       name = first_property_name;
       params = stack_params;
+      names = stack_names;
+
+      /* calls with the same names as an earlier one skip looking them up */
+      cache = g_object_class_get_construct_cache (class);
+      plan = g_atomic_pointer_get (&cache->plans);
 
       do
         {
@@ -1943,43 +2584,57 @@ g_object_new_valist (GType        object_type,
           GParamSpec *pspec;
           gint i;
 
-          pspec = g_param_spec_pool_lookup (pspec_pool, name, object_type, TRUE);
+          if (plan != NULL &&
+              (n_params >= plan->n_pspecs || strcmp (plan->names[n_params], name) != 0))
+            plan = g_object_construct_plan_find (plan->next, params, n_params, name);
 
-          if G_UNLIKELY (!pspec)
+          if (n_params == 16)
             {
-              g_critical ("%s: object class '%s' has no property named '%s'",
-                          G_STRFUNC, g_type_name (object_type), name);
-              /* Can't continue because arg list will be out of sync. */
-              break;
+              params = g_new (GObjectConstructParam, n_params + 1);
+              memcpy (params, stack_params, sizeof stack_params);
+              names = g_new (const gchar*, n_params + 1);
+              memcpy (names, stack_names, sizeof stack_names);
             }
-
-          if G_UNLIKELY (~pspec->flags & G_PARAM_WRITABLE)
+          else if (n_params > 16)
             {
-              g_critical ("%s: property '%s' of object class '%s' is not writable",
-                          G_STRFUNC, pspec->name, g_type_name (object_type));
-              break;
+              params = g_renew (GObjectConstructParam, params, n_params + 1);
+              names = g_renew (const gchar*, names, n_params + 1);
             }
 
-          if (pspec->flags & (G_PARAM_CONSTRUCT | G_PARAM_CONSTRUCT_ONLY))
+          if (plan != NULL)
+            pspec = plan->pspecs[n_params];
+          else
             {
-              for (i = 0; i < n_params; i++)
-                if (params[i].pspec == pspec)
-                    break;
-              if G_UNLIKELY (i != n_params)
+              pspec = g_param_spec_pool_lookup (pspec_pool, name, object_type, TRUE);
+
+              if G_UNLIKELY (!pspec)
                 {
-                  g_critical ("%s: property '%s' for type '%s' cannot be set twice",
-                              G_STRFUNC, name, g_type_name (object_type));
+                  g_critical ("%s: object class '%s' has no property named '%s'",
+                              G_STRFUNC, g_type_name (object_type), name);
+                  /* Can't continue because arg list will be out of sync. */
                   break;
                 }
-            }
 
-          if (n_params == 16)
-            {
-              params = g_new (GObjectConstructParam, n_params + 1);
-              memcpy (params, stack_params, sizeof stack_params);
+              if G_UNLIKELY (~pspec->flags & G_PARAM_WRITABLE)
+                {
+                  g_critical ("%s: property '%s' of object class '%s' is not writable",
+                              G_STRFUNC, pspec->name, g_type_name (object_type));
+                  break;
+                }
+
+              if (pspec->flags & (G_PARAM_CONSTRUCT | G_PARAM_CONSTRUCT_ONLY))
+                {
+                  for (i = 0; i < n_params; i++)
+                    if (params[i].pspec == pspec)
+                        break;
+                  if G_UNLIKELY (i != n_params)
+                    {
+                      g_critical ("%s: property '%s' for type '%s' cannot be set twice",
+                                  G_STRFUNC, name, g_type_name (object_type));
+                      break;
+                    }
+                }
             }
-          else if (n_params > 16)
-            params = g_renew (GObjectConstructParam, params, n_params + 1);
 
           params[n_params].pspec = pspec;
           params[n_params].value = g_newa (GValue, 1);
@@ -1995,21 +2650,31 @@ g_object_new_valist (GType        object_type,
               break;
             }
 
+          names[n_params] = name;
           n_params++;
         }
       while ((name = va_arg (var_args, const gchar *)));
 
-      object = g_object_new_internal (class, params, n_params);
+      /* remember how all of the names resolved, unless one of them
+       * was wrong
+       */
+      if (name == NULL && (plan == NULL || plan->n_pspecs != n_params))
+        g_object_construct_plan_add (cache, params, names, n_params);
+
+      object = g_object_new_internal (class, params, n_params, TRUE);
 
       while (n_params--)
         g_value_unset (params[n_params].value);
 
       if (params != stack_params)
-        g_free (params);
+        {
+          g_free (params);
+          g_free (names);
+        }
     }
   else
     /* Fast case: no properties passed in. */
-    object = g_object_new_internal (class, NULL, 0);
+    object = g_object_new_internal (class, NULL, 0, FALSE);
 
   if (unref_class)
     g_type_class_unref (unref_class);
@@ -2123,7 +2788,7 @@ g_object_set_valist (GObject	 *object,
 	  break;
 	}
       
-      object_set_property (object, pspec, &value, nqueue);
+      object_set_property_full (object, pspec, &value, FALSE, TRUE, nqueue);
       g_value_unset (&value);
       
       name = va_arg (var_args, gchar*);
@@ -2633,12 +3298,29 @@ typedef struct {
   } weak_refs[1];  /* flexible array */
 } WeakRefStack;
 
+static inline GMutex *
+weak_refs_lock (GObject *object)
+{
+  guint hash = GPOINTER_TO_SIZE (object) >> 3;
+
+  return &weak_refs_locks[(hash * 2654435769U) >> (32 - WEAK_REFS_LOCK_BITS)];
+}
+
 static void
-weak_refs_notify (gpointer data)
+weak_refs_notify (GObject *object)
 {
-  WeakRefStack *wstack = data;
+  GObjectPrivate *priv = g_object_get_instance_private (object);
+  WeakRefStack *wstack;
   guint i;
 
+  WEAK_REFS_LOCK (object);
+  wstack = priv->weak_refs;
+  priv->weak_refs = NULL;
+  WEAK_REFS_UNLOCK (object);
+
+  if (wstack == NULL)
+    return;
+
   for (i = 0; i < wstack->n_weak_refs; i++)
     wstack->weak_refs[i].notify (wstack->weak_refs[i].data, wstack->object);
   g_free (wstack);
@@ -2666,6 +3348,7 @@ g_object_weak_ref (GObject    *object,
 		   GWeakNotify notify,
 		   gpointer    data)
 {
+  GObjectPrivate *priv;
   WeakRefStack *wstack;
   guint i;
   
@@ -2673,8 +3356,10 @@ g_object_weak_ref (GObject    *object,
   g_return_if_fail (notify != NULL);
   g_return_if_fail (object->ref_count >= 1);
 
-  G_LOCK (weak_refs_mutex);
-  wstack = g_datalist_id_remove_no_notify (&object->qdata, quark_weak_refs);
+  priv = g_object_get_instance_private (object);
+
+  WEAK_REFS_LOCK (object);
+  wstack = priv->weak_refs;
   if (wstack)
     {
       i = wstack->n_weak_refs++;
@@ -2689,8 +3374,8 @@ g_object_weak_ref (GObject    *object,
     }
   wstack->weak_refs[i].notify = notify;
   wstack->weak_refs[i].data = data;
-  g_datalist_id_set_data_full (&object->qdata, quark_weak_refs, wstack, weak_refs_notify);
-  G_UNLOCK (weak_refs_mutex);
+  priv->weak_refs = wstack;
+  WEAK_REFS_UNLOCK (object);
 }
 
 /**
@@ -2712,8 +3397,8 @@ g_object_weak_unref (GObject    *object,
   g_return_if_fail (G_IS_OBJECT (object));
   g_return_if_fail (notify != NULL);
 
-  G_LOCK (weak_refs_mutex);
-  wstack = g_datalist_id_get_data (&object->qdata, quark_weak_refs);
+  WEAK_REFS_LOCK (object);
+  wstack = g_object_get_instance_private (object)->weak_refs;
   if (wstack)
     {
       guint i;
@@ -2730,7 +3415,7 @@ g_object_weak_unref (GObject    *object,
 	    break;
 	  }
     }
-  G_UNLOCK (weak_refs_mutex);
+  WEAK_REFS_UNLOCK (object);
   if (!found_one)
     g_warning ("%s: couldn't find weak ref %p(%p)", G_STRFUNC, notify, data);
 }
@@ -2895,7 +3580,7 @@ toggle_refs_notify (GObject *object,
   ToggleRefStack tstack, *tstackptr;
 
   G_LOCK (toggle_refs_mutex);
-  tstackptr = g_datalist_id_get_data (&object->qdata, quark_toggle_refs);
+  tstackptr = g_object_get_instance_private (object)->toggle_refs;
   tstack = *tstackptr;
   G_UNLOCK (toggle_refs_mutex);
 
@@ -2950,6 +3635,7 @@ g_object_add_toggle_ref (GObject       *object,
 			 GToggleNotify  notify,
 			 gpointer       data)
 {
+  GObjectPrivate *priv;
   ToggleRefStack *tstack;
   guint i;
   
@@ -2959,8 +3645,10 @@ g_object_add_toggle_ref (GObject       *object,
 
   g_object_ref (object);
 
+  priv = g_object_get_instance_private (object);
+
   G_LOCK (toggle_refs_mutex);
-  tstack = g_datalist_id_remove_no_notify (&object->qdata, quark_toggle_refs);
+  tstack = priv->toggle_refs;
   if (tstack)
     {
       i = tstack->n_toggle_refs++;
@@ -2982,8 +3670,7 @@ g_object_add_toggle_ref (GObject       *object,
   
   tstack->toggle_refs[i].notify = notify;
   tstack->toggle_refs[i].data = data;
-  g_datalist_id_set_data_full (&object->qdata, quark_toggle_refs, tstack,
-			       (GDestroyNotify)g_free);
+  priv->toggle_refs = tstack;
   G_UNLOCK (toggle_refs_mutex);
 }
 
@@ -3012,7 +3699,7 @@ g_object_remove_toggle_ref (GObject       *object,
   g_return_if_fail (notify != NULL);
 
   G_LOCK (toggle_refs_mutex);
-  tstack = g_datalist_id_get_data (&object->qdata, quark_toggle_refs);
+  tstack = g_object_get_instance_private (object)->toggle_refs;
   if (tstack)
     {
       guint i;
@@ -3073,6 +3760,20 @@ g_object_ref (gpointer _object)
   return object;
 }
 
+static void
+g_object_arena_release (GObject *object)
+{
+  GObjectArena *arena = g_object_get_instance_private (object)->arena;
+
+  _g_type_release_instance ((GTypeInstance *) object);
+
+  if (g_atomic_int_dec_and_test (&arena->n_alive))
+    {
+      g_type_class_unref (arena->class);
+      g_free (arena);
+    }
+}
+
 /**
  * g_object_unref:
  * @object: (type GObject.Object): a #GObject
@@ -3113,7 +3814,7 @@ g_object_unref (gpointer _object)
     }
   else
     {
-      GSList **weak_locations;
+      WeakRefEntry *entry;
 
       /* The only way that this object can live at this point is if
        * there are outstanding weak references already established
@@ -3121,38 +3822,25 @@ g_object_unref (gpointer _object)
        *
        * If there were not already weak references then no more can be
        * established at this time, because the other thread would have
-       * to hold a strong ref in order to call
-       * g_object_add_weak_pointer() and then we wouldn't be here.
+       * to hold a strong ref in order to call g_weak_ref_set() and
+       * then we wouldn't be here.
        */
-      weak_locations = g_datalist_id_get_data (&object->qdata, quark_weak_locations);
+      entry = g_atomic_pointer_get (&g_object_get_instance_private (object)->weak_ref_entry);
 
-      if (weak_locations != NULL)
+      if (entry != NULL)
         {
-          g_rw_lock_writer_lock (&weak_locations_lock);
-
-          /* It is possible that one of the weak references beat us to
-           * the lock. Make sure the refcount is still what we expected
-           * it to be.
+          /* g_weak_ref_get() only takes references while the count is
+           * not zero.  If one of them beat us to it, the object lives on.
            */
-          old_ref = g_atomic_int_get (&object->ref_count);
-          if (old_ref != 1)
-            {
-              g_rw_lock_writer_unlock (&weak_locations_lock);
-              goto retry_atomic_decrement1;
-            }
+          if (!g_atomic_int_compare_and_exchange ((int *)&object->ref_count, 1, 0))
+            goto retry_atomic_decrement1;
 
-          /* We got the lock first, so the object will definitely die
-           * now. Clear out all the weak references.
+          /* The object will definitely die now.  Detach the weak
+           * references from it before giving dispose its reference back.
            */
-          while (*weak_locations)
-            {
-              GWeakRef *weak_ref_location = (*weak_locations)->data;
-
-              weak_ref_location->priv.p = NULL;
-              *weak_locations = g_slist_delete_link (*weak_locations, *weak_locations);
-            }
-
-          g_rw_lock_writer_unlock (&weak_locations_lock);
+          g_atomic_pointer_set (&g_object_get_instance_private (object)->weak_ref_entry, NULL);
+          weak_ref_entry_detach (entry);
+          g_atomic_int_set (&object->ref_count, 1);
         }
 
       /* we are about to remove the last reference */
@@ -3183,7 +3871,7 @@ g_object_unref (gpointer _object)
       /* we are still in the process of taking away the last ref */
       g_datalist_id_set_data (&object->qdata, quark_closure_array, NULL);
       g_signal_handlers_destroy (object);
-      g_datalist_id_set_data (&object->qdata, quark_weak_refs, NULL);
+      weak_refs_notify (object);
       
       /* decrement the last reference */
       old_ref = g_atomic_int_add (&object->ref_count, -1);
@@ -3207,7 +3895,10 @@ g_object_unref (gpointer _object)
 	      G_UNLOCK (debug_objects);
 	    }
 #endif	/* G_ENABLE_DEBUG */
-          g_type_free_instance ((GTypeInstance*) object);
+          if (g_object_get_instance_private (object)->arena)
+            g_object_arena_release (object);
+          else
+            g_type_free_instance ((GTypeInstance*) object);
 	}
     }
 }
@@ -4157,6 +4848,115 @@ g_initially_unowned_class_init (GInitiallyUnownedClass *klass)
  * goes back to zero, at which point they too will be invalidated.
  */
 
+static WeakRefEntry *
+weak_ref_entry_new (GObject *object)
+{
+  WeakRefEntry *entry;
+
+  G_LOCK (weak_ref_entries);
+  entry = free_weak_ref_entries;
+  if (entry != NULL)
+    free_weak_ref_entries = entry->next_free;
+  G_UNLOCK (weak_ref_entries);
+
+  if (entry == NULL)
+    entry = g_new0 (WeakRefEntry, 1);
+
+  entry->ref_count = 1;
+  g_atomic_pointer_set (&entry->object, object);
+
+  return entry;
+}
+
+static void
+weak_ref_entry_unref (WeakRefEntry *entry)
+{
+  if (!g_atomic_int_dec_and_test (&entry->ref_count))
+    return;
+
+  /* no weak reference points to the entry any more, but a reader may
+   * have loaded it just before that; it must not find the entry
+   * recycled for another object while it is counted in n_readers
+   */
+  while (g_atomic_int_get (&entry->n_readers) > 0)
+    g_thread_yield ();
+
+  G_LOCK (weak_ref_entries);
+  entry->next_free = free_weak_ref_entries;
+  free_weak_ref_entries = entry;
+  G_UNLOCK (weak_ref_entries);
+}
+
+/* Detaches the entry from its object.  The reference count of the
+ * object is zero whenever this runs, so g_weak_ref_get() can not
+ * revive it any more.  What remains is to make sure that no reader is
+ * about to look at the object before it goes away.
+ */
+static void
+weak_ref_entry_detach (WeakRefEntry *entry)
+{
+  /* this is a full barrier: readers that come later see NULL and
+   * readers that came earlier are counted in n_readers
+   */
+  g_atomic_pointer_compare_and_exchange (&entry->object, entry->object, NULL);
+  while (g_atomic_int_get (&entry->n_readers) > 0)
+    g_thread_yield ();
+
+  weak_ref_entry_unref (entry);
+}
+
+/* returns a new reference to the entry; the caller owns a strong
+ * reference to @object
+ */
+static WeakRefEntry *
+object_ref_weak_ref_entry (GObject *object)
+{
+  GObjectPrivate *priv = g_object_get_instance_private (object);
+  WeakRefEntry *entry;
+
+  entry = g_atomic_pointer_get (&priv->weak_ref_entry);
+  if (entry == NULL)
+    {
+      WeakRefEntry *new_entry = weak_ref_entry_new (object);
+
+      if (g_atomic_pointer_compare_and_exchange (&priv->weak_ref_entry, NULL, new_entry))
+        entry = new_entry;
+      else
+        {
+          /* another thread was faster */
+          new_entry->object = NULL;
+          weak_ref_entry_unref (new_entry);
+          entry = g_atomic_pointer_get (&priv->weak_ref_entry);
+        }
+    }
+
+  g_atomic_int_inc (&entry->ref_count);
+
+  return entry;
+}
+
+/* like g_object_ref(), but fails once the reference count went to zero */
+static gboolean
+object_ref_if_alive (GObject *object)
+{
+  gint old_ref;
+
+  do
+    {
+      old_ref = g_atomic_int_get (&object->ref_count);
+      if (old_ref == 0)
+        return FALSE;
+    }
+  while (!g_atomic_int_compare_and_exchange ((int *)&object->ref_count, old_ref, old_ref + 1));
+
+  if (old_ref == 1 && OBJECT_HAS_TOGGLE_REF (object))
+    toggle_refs_notify (object, FALSE);
+
+  TRACE (GOBJECT_OBJECT_REF(object,G_TYPE_FROM_INSTANCE(object),old_ref));
+
+  return TRUE;
+}
+
 /**
  * g_weak_ref_init: (skip)
  * @weak_ref: (inout): uninitialized or empty location for a weak
@@ -4228,20 +5028,35 @@ g_weak_ref_clear (GWeakRef *weak_ref)
 gpointer
 g_weak_ref_get (GWeakRef *weak_ref)
 {
-  gpointer object_or_null;
+  WeakRefEntry *entry;
+  GObject *object;
 
   g_return_val_if_fail (weak_ref!= NULL, NULL);
 
-  g_rw_lock_reader_lock (&weak_locations_lock);
+  while (TRUE)
+    {
+      entry = g_atomic_pointer_get (&weak_ref->priv.p);
+      if (entry == NULL)
+        return NULL;
 
-  object_or_null = weak_ref->priv.p;
+      g_atomic_int_inc (&entry->n_readers);
 
-  if (object_or_null != NULL)
-    g_object_ref (object_or_null);
+      /* the entry may have been released and recycled for another
+       * object before we were counted; once we are, it stays put
+       */
+      if (G_UNLIKELY (g_atomic_pointer_get (&weak_ref->priv.p) != entry))
+        {
+          g_atomic_int_add (&entry->n_readers, -1);
+          continue;
+        }
 
-  g_rw_lock_reader_unlock (&weak_locations_lock);
+      object = g_atomic_pointer_get (&entry->object);
+      if (object != NULL && !object_ref_if_alive (object))
+        object = NULL;
+      g_atomic_int_add (&entry->n_readers, -1);
 
-  return object_or_null;
+      return object;
+    }
 }
 
 /**
@@ -4261,61 +5076,21 @@ void
 g_weak_ref_set (GWeakRef *weak_ref,
                 gpointer  object)
 {
-  GSList **weak_locations;
-  GObject *new_object;
-  GObject *old_object;
+  WeakRefEntry *new_entry;
+  WeakRefEntry *old_entry;
 
   g_return_if_fail (weak_ref != NULL);
   g_return_if_fail (object == NULL || G_IS_OBJECT (object));
 
-  new_object = object;
-
-  g_rw_lock_writer_lock (&weak_locations_lock);
-
-  /* We use the extra level of indirection here so that if we have ever
-   * had a weak pointer installed at any point in time on this object,
-   * we can see that there is a non-NULL value associated with the
-   * weak-pointer quark and know that this value will not change at any
-   * point in the object's lifetime.
-   *
-   * Both properties are important for reducing the amount of times we
-   * need to acquire locks and for decreasing the duration of time the
-   * lock is held while avoiding some rather tricky races.
-   *
-   * Specifically: we can avoid having to do an extra unconditional lock
-   * in g_object_unref() without worrying about some extremely tricky
-   * races.
-   */
-
-  old_object = weak_ref->priv.p;
-  if (new_object != old_object)
-    {
-      weak_ref->priv.p = new_object;
-
-      /* Remove the weak ref from the old object */
-      if (old_object != NULL)
-        {
-          weak_locations = g_datalist_id_get_data (&old_object->qdata, quark_weak_locations);
-          /* for it to point to an object, the object must have had it added once */
-          g_assert (weak_locations != NULL);
-
-          *weak_locations = g_slist_remove (*weak_locations, weak_ref);
-        }
-
-      /* Add the weak ref to the new object */
-      if (new_object != NULL)
-        {
-          weak_locations = g_datalist_id_get_data (&new_object->qdata, quark_weak_locations);
-
-          if (weak_locations == NULL)
-            {
-              weak_locations = g_new0 (GSList *, 1);
-              g_datalist_id_set_data_full (&new_object->qdata, quark_weak_locations, weak_locations, g_free);
-            }
+  if (object != NULL)
+    new_entry = object_ref_weak_ref_entry (object);
+  else
+    new_entry = NULL;
 
-          *weak_locations = g_slist_prepend (*weak_locations, weak_ref);
-        }
-    }
+  do
+    old_entry = g_atomic_pointer_get (&weak_ref->priv.p);
+  while (!g_atomic_pointer_compare_and_exchange (&weak_ref->priv.p, old_entry, new_entry));
 
-  g_rw_lock_writer_unlock (&weak_locations_lock);
+  if (old_entry != NULL)
+    weak_ref_entry_unref (old_entry);
 }
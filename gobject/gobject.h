@@ -347,9 +347,10 @@ struct  _GObjectClass
 
   /*< private >*/
   gsize		flags;
+  gpointer	construct_cache;
 
   /* padding */
-  gpointer	pdummy[6];
+  gpointer	pdummy[5];
 };
 /**
  * GObjectConstructParam:
@@ -426,6 +427,15 @@ GLIB_AVAILABLE_IN_ALL
 GObject*    g_object_new_valist               (GType           object_type,
 					       const gchar    *first_property_name,
 					       va_list         var_args);
+GLIB_AVAILABLE_IN_2_38
+void        g_object_newv_many                (GType           object_type,
+					       guint           n_parameters,
+					       GParameter     *parameters,
+					       guint           n_objects,
+					       GObject       **objects);
+GLIB_AVAILABLE_IN_2_38
+void        g_object_unref_many               (GObject       **objects,
+					       guint           n_objects);
 GLIB_AVAILABLE_IN_ALL
 void	    g_object_set                      (gpointer	       object,
 					       const gchar    *first_property_name,
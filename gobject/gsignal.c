@@ -121,6 +121,7 @@ typedef struct _Emission     Emission;
 typedef struct _Handler      Handler;
 typedef struct _HandlerList  HandlerList;
 typedef struct _HandlerMatch HandlerMatch;
+typedef struct _InstanceStripe InstanceStripe;
 typedef enum
 {
   EMISSION_STOP,
@@ -144,7 +145,6 @@ static	      void		handler_insert		(guint		  signal_id,
 							 Handler	 *handler);
 static	      Handler*		handler_lookup		(gpointer	  instance,
 							 gulong		  handler_id,
-							 GClosure        *closure,
 							 guint		 *signal_id_p);
 static inline HandlerMatch*	handler_match_prepend	(HandlerMatch	 *list,
 							 Handler	 *handler,
@@ -182,10 +182,8 @@ static	      gboolean		signal_emit_unlocked_R	(SignalNode	 *node,
 							 gpointer	  instance,
 							 GValue		 *return_value,
 							 const GValue	 *instance_and_params);
-static       void               add_invalid_closure_notify    (Handler         *handler,
-							       gpointer         instance);
-static       void               remove_invalid_closure_notify (Handler         *handler,
-							       gpointer         instance);
+static       void               add_invalid_closure_notify    (Handler         *handler);
+static       void               remove_invalid_closure_notify (Handler         *handler);
 static       void               invalid_closure_notify  (gpointer         data,
 							 GClosure        *closure);
 static const gchar *            type_debug_name         (GType            type);
@@ -217,16 +215,18 @@ struct _SignalNode
   /* reinitializable portion */
   guint              flags : 9;
   guint              n_params : 8;
-  guint              single_va_closure_is_valid : 1;
   guint              single_va_closure_is_after : 1;
   GType		    *param_types; /* mangled with G_SIGNAL_TYPE_STATIC_SCOPE flag */
   GType		     return_type; /* mangled with G_SIGNAL_TYPE_STATIC_SCOPE flag */
-  GBSearchArray     *class_closure_bsa;
+  GBSearchArray     *class_closure_bsa; /* copied on write, read without lock */
   SignalAccumulator *accumulator;
   GSignalCMarshaller c_marshaller;
   GSignalCVaMarshaller va_marshaller;
   GHookList         *emission_hooks;
 
+  /* recomputed under SIGNAL_LOCK() whenever the class closures or
+   * emission hooks change, read without lock by emissions
+   */
   GClosure *single_va_closure;
 };
 
@@ -256,6 +256,12 @@ struct _HandlerList
   Handler *tail_after;   /* CONNECT_AFTER handlers are appended here  */
 };
 
+typedef struct
+{
+  Handler      *next;
+  Handler      *prev;   /* the head's prev is the tail of the chain */
+} HandlerLink;
+
 struct _Handler
 {
   gulong        sequential_number;
@@ -267,7 +273,14 @@ struct _Handler
 #define HANDLER_MAX_BLOCK_COUNT (1 << 16)
   guint         after : 1;
   guint         has_invalid_closure_notify : 1;
+  guint         signal_id;
   GClosure     *closure;
+
+  /* per-instance index, only connected handlers are indexed */
+  gpointer      instance;
+  gpointer      data;           /* closure->data at connection time */
+  HandlerLink   data_link;      /* handlers with the same data */
+  HandlerLink   detail_link;    /* handlers with the same signal and detail */
 };
 struct _HandlerMatch
 {
@@ -282,6 +295,32 @@ typedef struct
   GClosure *closure;
 } ClassClosure;
 
+#define HANDLER_COUNT_BITS	10
+
+/* Handlers and emissions of an instance are protected by the lock of
+ * the stripe the instance hashes to, so that unrelated instances can
+ * be connected to and emitted on from different threads without
+ * contending on a single lock.
+ *
+ * Each stripe also counts the connected handlers per bucket of
+ * (instance, signal) pairs.  A bucket that is zero proves that there
+ * are no handlers for any of its pairs, which lets emissions that
+ * nobody listens to return without taking the lock.  The counts are
+ * only written with the stripe locked; a bucket that would overflow
+ * sticks at G_MAXUINT16.
+ */
+struct _InstanceStripe
+{
+  GMutex         mutex;
+  GHashTable    *handler_list_bsa_ht;
+  GHashTable    *handlers;              /* by instance and handler id */
+  GHashTable    *handlers_by_data;      /* chain heads, by instance and data */
+  GHashTable    *handlers_by_detail;    /* chain heads, by instance, signal and detail */
+  Emission      *recursive_emissions;
+  Emission      *restart_emissions;
+  guint16        handler_counts[1 << HANDLER_COUNT_BITS];
+};
+
 
 /* --- variables --- */
 static GBSearchArray *g_signal_key_bsa = NULL;
@@ -300,28 +339,124 @@ static GBSearchConfig g_class_closure_bconfig = {
   class_closures_cmp,
   0,
 };
-static GHashTable    *g_handler_list_bsa_ht = NULL;
-static Emission      *g_recursive_emissions = NULL;
-static Emission      *g_restart_emissions = NULL;
-static gulong         g_handler_sequential_number = 1;
-G_LOCK_DEFINE_STATIC (g_signal_mutex);
-#define	SIGNAL_LOCK()		G_LOCK (g_signal_mutex)
-#define	SIGNAL_UNLOCK()		G_UNLOCK (g_signal_mutex)
+static GSList        *g_retired_node_arrays = NULL;   /* may still be seen by lock-free readers */
+static GSList        *g_retired_class_closure_arrays = NULL;
+static volatile gsize g_handler_sequential_number = 1;
+
+/* The signal lock protects signal registration, the signal key table,
+ * class closures and emission hooks.  Readers of the key table only
+ * need the reader lock.  Handlers and emissions are protected by the
+ * instance stripes below, and signal nodes are looked up without any
+ * lock at all.
+ */
+static GRWLock        g_signal_rw_lock;
+#define	SIGNAL_LOCK()		g_rw_lock_writer_lock (&g_signal_rw_lock)
+#define	SIGNAL_UNLOCK()		g_rw_lock_writer_unlock (&g_signal_rw_lock)
+#define	SIGNAL_READ_LOCK()	g_rw_lock_reader_lock (&g_signal_rw_lock)
+#define	SIGNAL_READ_UNLOCK()	g_rw_lock_reader_unlock (&g_signal_rw_lock)
+
+#define INSTANCE_STRIPE_BITS	6
+static InstanceStripe g_instance_stripes[1 << INSTANCE_STRIPE_BITS];
+
+static inline InstanceStripe*
+instance_stripe (gconstpointer instance)
+{
+  guint hash = GPOINTER_TO_SIZE (instance) >> 3;
+
+  return &g_instance_stripes[(hash * 2654435769U) >> (32 - INSTANCE_STRIPE_BITS)];
+}
+
+static inline guint16*
+instance_handler_count (gconstpointer instance,
+                        guint         signal_id)
+{
+  guint hash = GPOINTER_TO_SIZE (instance) >> 3;
+
+  hash = (hash + signal_id * 0x85ebca6bU) * 2654435769U;
+  return &instance_stripe (instance)->handler_counts[(hash >> (32 - INSTANCE_STRIPE_BITS - HANDLER_COUNT_BITS)) &
+                                                     ((1 << HANDLER_COUNT_BITS) - 1)];
+}
+
+/* may be called without the instance lock; a FALSE result is exact as
+ * far as this thread can tell, TRUE may be a false positive
+ */
+static inline gboolean
+instance_may_have_handlers (gconstpointer instance,
+                            guint         signal_id)
+{
+  return *(volatile guint16 *) instance_handler_count (instance, signal_id) != 0;
+}
+
+#define	INSTANCE_LOCK(instance)		g_mutex_lock (&instance_stripe (instance)->mutex)
+#define	INSTANCE_UNLOCK(instance)	g_mutex_unlock (&instance_stripe (instance)->mutex)
+
+/* Loads of data that is published without lock only need to be
+ * ordered before the loads that depend on them, which is much cheaper
+ * than the full barrier in g_atomic_pointer_get().
+ */
+#if defined (__ATOMIC_ACQUIRE)
+#define	LOAD_PUBLISHED(p)	(__atomic_load_n ((p), __ATOMIC_ACQUIRE))
+#else
+#define	LOAD_PUBLISHED(p)	(g_atomic_pointer_get (p))
+#endif
 
 
 /* --- signal nodes --- */
-static guint          g_n_signal_nodes = 0;
-static SignalNode   **g_signal_nodes = NULL;
+typedef struct
+{
+  guint       n_nodes;
+  SignalNode *nodes[1];
+} SignalNodeArray;
+
+/* Nodes are only ever appended, under SIGNAL_LOCK().  A node pointer
+ * is published once the node is set up, and a full array is replaced
+ * by a copy of twice the size.  Readers may still be looking at the
+ * old array, so it is retired instead of freed; this never costs more
+ * than the current array.
+ */
+static guint            g_n_signal_nodes = 0;
+static SignalNodeArray *g_signal_nodes = NULL;
 
 static inline SignalNode*
 LOOKUP_SIGNAL_NODE (register guint signal_id)
 {
-  if (signal_id < g_n_signal_nodes)
-    return g_signal_nodes[signal_id];
+  SignalNodeArray *array = LOAD_PUBLISHED (&g_signal_nodes);
+
+  if (signal_id < array->n_nodes)
+    return LOAD_PUBLISHED (&array->nodes[signal_id]);
   else
     return NULL;
 }
 
+static SignalNodeArray*
+signal_node_array_new (guint n_nodes)
+{
+  SignalNodeArray *array;
+
+  array = g_malloc0 (sizeof (SignalNodeArray) + (n_nodes - 1) * sizeof (SignalNode*));
+  array->n_nodes = n_nodes;
+
+  return array;
+}
+
+static guint
+signal_node_array_append (void)
+{
+  guint signal_id = g_n_signal_nodes++;
+
+  if (signal_id >= g_signal_nodes->n_nodes)
+    {
+      SignalNodeArray *array;
+
+      array = signal_node_array_new (g_signal_nodes->n_nodes * 2);
+      memcpy (array->nodes, g_signal_nodes->nodes, g_signal_nodes->n_nodes * sizeof (SignalNode*));
+      g_retired_node_arrays = g_slist_prepend (g_retired_node_arrays, g_signal_nodes);
+      g_atomic_pointer_set (&g_signal_nodes, array);
+    }
+
+  return signal_id;
+}
+
 
 /* --- functions --- */
 static inline guint
@@ -391,7 +526,8 @@ static inline HandlerList*
 handler_list_ensure (guint    signal_id,
 		     gpointer instance)
 {
-  GBSearchArray *hlbsa = g_hash_table_lookup (g_handler_list_bsa_ht, instance);
+  GHashTable *handler_list_bsa_ht = instance_stripe (instance)->handler_list_bsa_ht;
+  GBSearchArray *hlbsa = g_hash_table_lookup (handler_list_bsa_ht, instance);
   HandlerList key;
   
   key.signal_id = signal_id;
@@ -402,7 +538,7 @@ handler_list_ensure (guint    signal_id,
     {
       hlbsa = g_bsearch_array_create (&g_signal_hlbsa_bconfig);
       hlbsa = g_bsearch_array_insert (hlbsa, &g_signal_hlbsa_bconfig, &key);
-      g_hash_table_insert (g_handler_list_bsa_ht, instance, hlbsa);
+      g_hash_table_insert (handler_list_bsa_ht, instance, hlbsa);
     }
   else
     {
@@ -410,7 +546,7 @@ handler_list_ensure (guint    signal_id,
 
       hlbsa = g_bsearch_array_insert (o, &g_signal_hlbsa_bconfig, &key);
       if (hlbsa != o)
-	g_hash_table_insert (g_handler_list_bsa_ht, instance, hlbsa);
+	g_hash_table_insert (handler_list_bsa_ht, instance, hlbsa);
     }
   return g_bsearch_array_lookup (hlbsa, &g_signal_hlbsa_bconfig, &key);
 }
@@ -419,7 +555,7 @@ static inline HandlerList*
 handler_list_lookup (guint    signal_id,
 		     gpointer instance)
 {
-  GBSearchArray *hlbsa = g_hash_table_lookup (g_handler_list_bsa_ht, instance);
+  GBSearchArray *hlbsa = g_hash_table_lookup (instance_stripe (instance)->handler_list_bsa_ht, instance);
   HandlerList key;
   
   key.signal_id = signal_id;
@@ -427,35 +563,160 @@ handler_list_lookup (guint    signal_id,
   return hlbsa ? g_bsearch_array_lookup (hlbsa, &g_signal_hlbsa_bconfig, &key) : NULL;
 }
 
-static Handler*
-handler_lookup (gpointer  instance,
-		gulong    handler_id,
-		GClosure *closure,
-		guint    *signal_id_p)
+static guint
+handler_hash (gconstpointer key)
 {
-  GBSearchArray *hlbsa = g_hash_table_lookup (g_handler_list_bsa_ht, instance);
-  
-  if (hlbsa)
+  const Handler *handler = key;
+
+  return (guint) handler->sequential_number ^ g_direct_hash (handler->instance);
+}
+
+static gboolean
+handler_equal (gconstpointer a,
+               gconstpointer b)
+{
+  const Handler *ha = a, *hb = b;
+
+  return ha->sequential_number == hb->sequential_number && ha->instance == hb->instance;
+}
+
+static guint
+handler_data_hash (gconstpointer key)
+{
+  const Handler *handler = key;
+
+  return g_direct_hash (handler->data) * 31 + g_direct_hash (handler->instance);
+}
+
+static gboolean
+handler_data_equal (gconstpointer a,
+                    gconstpointer b)
+{
+  const Handler *ha = a, *hb = b;
+
+  return ha->data == hb->data && ha->instance == hb->instance;
+}
+
+static guint
+handler_detail_hash (gconstpointer key)
+{
+  const Handler *handler = key;
+
+  return (handler->signal_id * 31 + handler->detail) * 31 + g_direct_hash (handler->instance);
+}
+
+static gboolean
+handler_detail_equal (gconstpointer a,
+                      gconstpointer b)
+{
+  const Handler *ha = a, *hb = b;
+
+  return ha->signal_id == hb->signal_id && ha->detail == hb->detail && ha->instance == hb->instance;
+}
+
+#define	HANDLER_LINK(handler, offset)	(G_STRUCT_MEMBER_P ((handler), (offset)))
+
+/* Handlers that share a key are chained in connection order, and the
+ * table holds the head of each chain.  All handlers in a chain are
+ * equal as far as the table is concerned, so a new head simply
+ * replaces the old one.
+ */
+static void
+handler_chain_append (GHashTable *heads,
+                      Handler    *handler,
+                      gsize       link_offset)
+{
+  HandlerLink *link = HANDLER_LINK (handler, link_offset);
+  Handler *head = g_hash_table_lookup (heads, handler);
+
+  link->next = NULL;
+  if (head)
     {
-      guint i;
-      
-      for (i = 0; i < hlbsa->n_nodes; i++)
+      HandlerLink *head_link = HANDLER_LINK (head, link_offset);
+      Handler *tail = head_link->prev;
+
+      ((HandlerLink *) HANDLER_LINK (tail, link_offset))->next = handler;
+      link->prev = tail;
+      head_link->prev = handler;
+    }
+  else
+    {
+      link->prev = handler;
+      g_hash_table_add (heads, handler);
+    }
+}
+
+static void
+handler_chain_remove (GHashTable *heads,
+                      Handler    *handler,
+                      gsize       link_offset)
+{
+  HandlerLink *link = HANDLER_LINK (handler, link_offset);
+  Handler *head = g_hash_table_lookup (heads, handler);
+
+  if (head == handler)
+    {
+      if (link->next)
         {
-          HandlerList *hlist = g_bsearch_array_get_nth (hlbsa, &g_signal_hlbsa_bconfig, i);
-          Handler *handler;
-          
-          for (handler = hlist->handlers; handler; handler = handler->next)
-            if (closure ? (handler->closure == closure) : (handler->sequential_number == handler_id))
-              {
-                if (signal_id_p)
-                  *signal_id_p = hlist->signal_id;
-		
-                return handler;
-              }
+          ((HandlerLink *) HANDLER_LINK (link->next, link_offset))->prev = link->prev;
+          g_hash_table_add (heads, link->next);
         }
+      else
+        g_hash_table_remove (heads, handler);
     }
-  
-  return NULL;
+  else
+    {
+      ((HandlerLink *) HANDLER_LINK (link->prev, link_offset))->next = link->next;
+      if (link->next)
+        ((HandlerLink *) HANDLER_LINK (link->next, link_offset))->prev = link->prev;
+      else
+        ((HandlerLink *) HANDLER_LINK (head, link_offset))->prev = link->prev;
+    }
+  link->next = link->prev = NULL;
+}
+
+static void
+handler_index_add (Handler *handler)
+{
+  InstanceStripe *stripe = instance_stripe (handler->instance);
+  guint16 *count = instance_handler_count (handler->instance, handler->signal_id);
+
+  if (*count != G_MAXUINT16)
+    *count += 1;
+  handler->data = handler->closure->data;
+  g_hash_table_add (stripe->handlers, handler);
+  handler_chain_append (stripe->handlers_by_data, handler, G_STRUCT_OFFSET (Handler, data_link));
+  handler_chain_append (stripe->handlers_by_detail, handler, G_STRUCT_OFFSET (Handler, detail_link));
+}
+
+/* must be called before the handler's sequential number is cleared */
+static void
+handler_index_remove (Handler *handler)
+{
+  InstanceStripe *stripe = instance_stripe (handler->instance);
+  guint16 *count = instance_handler_count (handler->instance, handler->signal_id);
+
+  if (*count != G_MAXUINT16)
+    *count -= 1;
+  g_hash_table_remove (stripe->handlers, handler);
+  handler_chain_remove (stripe->handlers_by_data, handler, G_STRUCT_OFFSET (Handler, data_link));
+  handler_chain_remove (stripe->handlers_by_detail, handler, G_STRUCT_OFFSET (Handler, detail_link));
+}
+
+static Handler*
+handler_lookup (gpointer  instance,
+		gulong    handler_id,
+		guint    *signal_id_p)
+{
+  Handler key, *handler;
+
+  key.sequential_number = handler_id;
+  key.instance = instance;
+  handler = g_hash_table_lookup (instance_stripe (instance)->handlers, &key);
+  if (handler && signal_id_p)
+    *signal_id_p = handler->signal_id;
+
+  return handler;
 }
 
 static inline HandlerMatch*
@@ -485,6 +746,38 @@ handler_match_free1_R (HandlerMatch *node,
   return next;
 }
 
+static inline gboolean
+handler_match (Handler         *handler,
+	       GSignalMatchType mask,
+	       guint            signal_id,
+	       GQuark           detail,
+	       GClosure        *closure,
+	       gpointer         func,
+	       gpointer         data)
+{
+  SignalNode *node = NULL;
+
+  if (!handler->sequential_number)
+    return FALSE;
+
+  if (mask & G_SIGNAL_MATCH_FUNC)
+    {
+      node = LOOKUP_SIGNAL_NODE (handler->signal_id);
+      if (!node || !node->c_marshaller)
+	return FALSE;
+    }
+
+  mask = ~mask;
+  return (((mask & G_SIGNAL_MATCH_ID) || handler->signal_id == signal_id) &&
+	  ((mask & G_SIGNAL_MATCH_DETAIL) || handler->detail == detail) &&
+	  ((mask & G_SIGNAL_MATCH_CLOSURE) || handler->closure == closure) &&
+	  ((mask & G_SIGNAL_MATCH_DATA) || handler->closure->data == data) &&
+	  ((mask & G_SIGNAL_MATCH_UNBLOCKED) || handler->block_count == 0) &&
+	  ((mask & G_SIGNAL_MATCH_FUNC) || (handler->closure->marshal == node->c_marshaller &&
+					    G_REAL_CLOSURE (handler->closure)->meta_marshal == NULL &&
+					    ((GCClosure*) handler->closure)->callback == func)));
+}
+
 static HandlerMatch*
 handlers_find (gpointer         instance,
 	       GSignalMatchType mask,
@@ -495,31 +788,42 @@ handlers_find (gpointer         instance,
 	       gpointer         data,
 	       gboolean         one_and_only)
 {
+  InstanceStripe *stripe = instance_stripe (instance);
   HandlerMatch *mlist = NULL;
+  Handler key, *handler;
   
-  if (mask & G_SIGNAL_MATCH_ID)
+  key.instance = instance;
+  if ((mask & G_SIGNAL_MATCH_ID) && (mask & G_SIGNAL_MATCH_DETAIL))
+    {
+      key.signal_id = signal_id;
+      key.detail = detail;
+      for (handler = g_hash_table_lookup (stripe->handlers_by_detail, &key);
+	   handler; handler = handler->detail_link.next)
+	if (handler_match (handler, mask, signal_id, detail, closure, func, data))
+	  {
+	    mlist = handler_match_prepend (mlist, handler, handler->signal_id);
+	    if (one_and_only)
+	      return mlist;
+	  }
+    }
+  else if ((mask & G_SIGNAL_MATCH_DATA) || ((mask & G_SIGNAL_MATCH_CLOSURE) && closure))
+    {
+      key.data = (mask & G_SIGNAL_MATCH_DATA) ? data : closure->data;
+      for (handler = g_hash_table_lookup (stripe->handlers_by_data, &key);
+	   handler; handler = handler->data_link.next)
+	if (handler_match (handler, mask, signal_id, detail, closure, func, data))
+	  {
+	    mlist = handler_match_prepend (mlist, handler, handler->signal_id);
+	    if (one_and_only)
+	      return mlist;
+	  }
+    }
+  else if (mask & G_SIGNAL_MATCH_ID)
     {
       HandlerList *hlist = handler_list_lookup (signal_id, instance);
-      Handler *handler;
-      SignalNode *node = NULL;
-      
-      if (mask & G_SIGNAL_MATCH_FUNC)
-	{
-	  node = LOOKUP_SIGNAL_NODE (signal_id);
-	  if (!node || !node->c_marshaller)
-	    return NULL;
-	}
       
-      mask = ~mask;
       for (handler = hlist ? hlist->handlers : NULL; handler; handler = handler->next)
-        if (handler->sequential_number &&
-	    ((mask & G_SIGNAL_MATCH_DETAIL) || handler->detail == detail) &&
-	    ((mask & G_SIGNAL_MATCH_CLOSURE) || handler->closure == closure) &&
-            ((mask & G_SIGNAL_MATCH_DATA) || handler->closure->data == data) &&
-	    ((mask & G_SIGNAL_MATCH_UNBLOCKED) || handler->block_count == 0) &&
-	    ((mask & G_SIGNAL_MATCH_FUNC) || (handler->closure->marshal == node->c_marshaller &&
-					      G_REAL_CLOSURE (handler->closure)->meta_marshal == NULL &&
-					      ((GCClosure*) handler->closure)->callback == func)))
+	if (handler_match (handler, mask, signal_id, detail, closure, func, data))
 	  {
 	    mlist = handler_match_prepend (mlist, handler, signal_id);
 	    if (one_and_only)
@@ -528,9 +832,8 @@ handlers_find (gpointer         instance,
     }
   else
     {
-      GBSearchArray *hlbsa = g_hash_table_lookup (g_handler_list_bsa_ht, instance);
+      GBSearchArray *hlbsa = g_hash_table_lookup (stripe->handler_list_bsa_ht, instance);
       
-      mask = ~mask;
       if (hlbsa)
         {
           guint i;
@@ -538,25 +841,9 @@ handlers_find (gpointer         instance,
           for (i = 0; i < hlbsa->n_nodes; i++)
             {
               HandlerList *hlist = g_bsearch_array_get_nth (hlbsa, &g_signal_hlbsa_bconfig, i);
-	      SignalNode *node = NULL;
-              Handler *handler;
               
-	      if (!(mask & G_SIGNAL_MATCH_FUNC))
-		{
-		  node = LOOKUP_SIGNAL_NODE (hlist->signal_id);
-		  if (!node->c_marshaller)
-		    continue;
-		}
-	      
               for (handler = hlist->handlers; handler; handler = handler->next)
-		if (handler->sequential_number &&
-		    ((mask & G_SIGNAL_MATCH_DETAIL) || handler->detail == detail) &&
-                    ((mask & G_SIGNAL_MATCH_CLOSURE) || handler->closure == closure) &&
-                    ((mask & G_SIGNAL_MATCH_DATA) || handler->closure->data == data) &&
-		    ((mask & G_SIGNAL_MATCH_UNBLOCKED) || handler->block_count == 0) &&
-		    ((mask & G_SIGNAL_MATCH_FUNC) || (handler->closure->marshal == node->c_marshaller &&
-						      G_REAL_CLOSURE (handler->closure)->meta_marshal == NULL &&
-						      ((GCClosure*) handler->closure)->callback == func)))
+		if (handler_match (handler, mask, signal_id, detail, closure, func, data))
 		  {
 		    mlist = handler_match_prepend (mlist, handler, hlist->signal_id);
 		    if (one_and_only)
@@ -573,20 +860,25 @@ static inline Handler*
 handler_new (gboolean after)
 {
   Handler *handler = g_slice_new (Handler);
+  
+  handler->sequential_number = (gulong) g_atomic_pointer_add (&g_handler_sequential_number, 1);
 #ifndef G_DISABLE_CHECKS
-  if (g_handler_sequential_number < 1)
+  if (handler->sequential_number < 1)
     g_error (G_STRLOC ": handler id overflow, %s", REPORT_BUG);
 #endif
-  
-  handler->sequential_number = g_handler_sequential_number++;
   handler->prev = NULL;
   handler->next = NULL;
   handler->detail = 0;
   handler->ref_count = 1;
   handler->block_count = 0;
   handler->after = after != FALSE;
+  handler->signal_id = 0;
   handler->closure = NULL;
   handler->has_invalid_closure_notify = 0;
+  handler->instance = NULL;
+  handler->data = NULL;
+  handler->data_link.next = handler->data_link.prev = NULL;
+  handler->detail_link.next = handler->detail_link.prev = NULL;
   
   return handler;
 }
@@ -622,7 +914,10 @@ handler_unref_R (guint    signal_id,
           hlist->handlers = handler->next;
         }
 
-      if (instance)
+      /* g_signal_handlers_destroy() passes a signal_id of 0, for which
+       * there is no list left to fix up
+       */
+      if (signal_id)
         {
           /*  check if we are removing the handler pointed to by tail_before  */
           if (!handler->after && (!handler->next || handler->next->after))
@@ -649,9 +944,9 @@ handler_unref_R (guint    signal_id,
             }
         }
 
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
       g_closure_unref (handler->closure);
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
       g_slice_free (Handler, handler);
     }
 }
@@ -665,6 +960,10 @@ handler_insert (guint    signal_id,
   
   g_assert (handler->prev == NULL && handler->next == NULL); /* paranoid */
   
+  handler->signal_id = signal_id;
+  handler->instance = instance;
+  handler_index_add (handler);
+
   hlist = handler_list_ensure (signal_id, instance);
   if (!hlist->handlers)
     {
@@ -737,9 +1036,8 @@ node_update_single_va_closure (SignalNode *node)
 	}
     }
 
-  node->single_va_closure_is_valid = TRUE;
-  node->single_va_closure = closure;
   node->single_va_closure_is_after = is_after;
+  g_atomic_pointer_set (&node->single_va_closure, closure);
 }
 
 static inline void
@@ -787,15 +1085,16 @@ emission_find (Emission *emission_list,
 static inline Emission*
 emission_find_innermost (gpointer instance)
 {
+  InstanceStripe *stripe = instance_stripe (instance);
   Emission *emission, *s = NULL, *c = NULL;
   
-  for (emission = g_restart_emissions; emission; emission = emission->next)
+  for (emission = stripe->restart_emissions; emission; emission = emission->next)
     if (emission->instance == instance)
       {
 	s = emission;
 	break;
       }
-  for (emission = g_recursive_emissions; emission; emission = emission->next)
+  for (emission = stripe->recursive_emissions; emission; emission = emission->next)
     if (emission->instance == instance)
       {
 	c = emission;
@@ -827,14 +1126,21 @@ _g_signal_init (void)
   SIGNAL_LOCK ();
   if (!g_n_signal_nodes)
     {
-      /* setup handler list binary searchable array hash table (in german, that'd be one word ;) */
-      g_handler_list_bsa_ht = g_hash_table_new (g_direct_hash, NULL);
+      guint i;
+
+      /* setup handler list binary searchable array hash tables (in german, that'd be one word ;) */
+      for (i = 0; i < G_N_ELEMENTS (g_instance_stripes); i++)
+        {
+          g_instance_stripes[i].handler_list_bsa_ht = g_hash_table_new (g_direct_hash, NULL);
+          g_instance_stripes[i].handlers = g_hash_table_new (handler_hash, handler_equal);
+          g_instance_stripes[i].handlers_by_data = g_hash_table_new (handler_data_hash, handler_data_equal);
+          g_instance_stripes[i].handlers_by_detail = g_hash_table_new (handler_detail_hash, handler_detail_equal);
+        }
       g_signal_key_bsa = g_bsearch_array_create (&g_signal_key_bconfig);
       
       /* invalid (0) signal_id */
       g_n_signal_nodes = 1;
-      g_signal_nodes = g_renew (SignalNode*, g_signal_nodes, g_n_signal_nodes);
-      g_signal_nodes[0] = NULL;
+      g_atomic_pointer_set (&g_signal_nodes, signal_node_array_new (256));
     }
   SIGNAL_UNLOCK ();
 }
@@ -847,9 +1153,9 @@ _g_signals_destroy (GType itype)
   SIGNAL_LOCK ();
   for (i = 1; i < g_n_signal_nodes; i++)
     {
-      SignalNode *node = g_signal_nodes[i];
+      SignalNode *node = g_signal_nodes->nodes[i];
       
-      if (node->itype == itype)
+      if (node && node->itype == itype)
         {
           if (node->destroyed)
             g_warning (G_STRLOC ": signal \"%s\" of type '%s' already destroyed",
@@ -886,17 +1192,18 @@ g_signal_stop_emission (gpointer instance,
   g_return_if_fail (G_TYPE_CHECK_INSTANCE (instance));
   g_return_if_fail (signal_id > 0);
   
-  SIGNAL_LOCK ();
+  INSTANCE_LOCK (instance);
   node = LOOKUP_SIGNAL_NODE (signal_id);
   if (node && detail && !(node->flags & G_SIGNAL_DETAILED))
     {
       g_warning ("%s: signal id '%u' does not support detail (%u)", G_STRLOC, signal_id, detail);
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
       return;
     }
   if (node && g_type_is_a (G_TYPE_FROM_INSTANCE (instance), node->itype))
     {
-      Emission *emission_list = node->flags & G_SIGNAL_NO_RECURSE ? g_restart_emissions : g_recursive_emissions;
+      InstanceStripe *stripe = instance_stripe (instance);
+      Emission *emission_list = node->flags & G_SIGNAL_NO_RECURSE ? stripe->restart_emissions : stripe->recursive_emissions;
       Emission *emission = emission_find (emission_list, signal_id, detail, instance);
       
       if (emission)
@@ -913,7 +1220,7 @@ g_signal_stop_emission (gpointer instance,
     }
   else
     g_warning ("%s: signal id '%u' is invalid for instance '%p'", G_STRLOC, signal_id, instance);
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 }
 
 static void
@@ -980,7 +1287,6 @@ g_signal_add_emission_hook (guint               signal_id,
       SIGNAL_UNLOCK ();
       return 0;
     }
-    node->single_va_closure_is_valid = FALSE;
   if (!node->emission_hooks)
     {
       node->emission_hooks = g_new (GHookList, 1);
@@ -1000,6 +1306,8 @@ g_signal_add_emission_hook (guint               signal_id,
   g_hook_append (node->emission_hooks, hook);
   seq_hook_id = node->emission_hooks->seq_id;
 
+  node_update_single_va_closure (node);
+
   SIGNAL_UNLOCK ();
 
   return hook->hook_id;
@@ -1032,7 +1340,7 @@ g_signal_remove_emission_hook (guint  signal_id,
   else if (!node->emission_hooks || !g_hook_destroy (node->emission_hooks, hook_id))
     g_warning ("%s: signal \"%s\" had no hook (%lu) to remove", G_STRLOC, node->name, hook_id);
 
-  node->single_va_closure_is_valid = FALSE;
+  node_update_single_va_closure (node);
 
  out:
   SIGNAL_UNLOCK ();
@@ -1109,9 +1417,9 @@ g_signal_parse_name (const gchar *detailed_signal,
   g_return_val_if_fail (detailed_signal != NULL, FALSE);
   g_return_val_if_fail (G_TYPE_IS_INSTANTIATABLE (itype) || G_TYPE_IS_INTERFACE (itype), FALSE);
   
-  SIGNAL_LOCK ();
+  SIGNAL_READ_LOCK ();
   signal_id = signal_parse_name (detailed_signal, itype, &detail, force_detail_quark);
-  SIGNAL_UNLOCK ();
+  SIGNAL_READ_UNLOCK ();
 
   node = signal_id ? LOOKUP_SIGNAL_NODE (signal_id) : NULL;
   if (!node || node->destroyed ||
@@ -1147,9 +1455,11 @@ g_signal_stop_emission_by_name (gpointer     instance,
   g_return_if_fail (G_TYPE_CHECK_INSTANCE (instance));
   g_return_if_fail (detailed_signal != NULL);
   
-  SIGNAL_LOCK ();
   itype = G_TYPE_FROM_INSTANCE (instance);
+  SIGNAL_READ_LOCK ();
   signal_id = signal_parse_name (detailed_signal, itype, &detail, TRUE);
+  SIGNAL_READ_UNLOCK ();
+  INSTANCE_LOCK (instance);
   if (signal_id)
     {
       SignalNode *node = LOOKUP_SIGNAL_NODE (signal_id);
@@ -1161,7 +1471,8 @@ g_signal_stop_emission_by_name (gpointer     instance,
                    G_STRLOC, detailed_signal, instance, g_type_name (itype));
       else
 	{
-	  Emission *emission_list = node->flags & G_SIGNAL_NO_RECURSE ? g_restart_emissions : g_recursive_emissions;
+	  InstanceStripe *stripe = instance_stripe (instance);
+	  Emission *emission_list = node->flags & G_SIGNAL_NO_RECURSE ? stripe->restart_emissions : stripe->recursive_emissions;
 	  Emission *emission = emission_find (emission_list, signal_id, detail, instance);
 	  
 	  if (emission)
@@ -1180,7 +1491,7 @@ g_signal_stop_emission_by_name (gpointer     instance,
   else
     g_warning ("%s: signal '%s' is invalid for instance '%p' of type '%s'",
                G_STRLOC, detailed_signal, instance, g_type_name (itype));
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 }
 
 /**
@@ -1206,9 +1517,9 @@ g_signal_lookup (const gchar *name,
   g_return_val_if_fail (name != NULL, 0);
   g_return_val_if_fail (G_TYPE_IS_INSTANTIATABLE (itype) || G_TYPE_IS_INTERFACE (itype), 0);
   
-  SIGNAL_LOCK ();
+  SIGNAL_READ_LOCK ();
   signal_id = signal_id_lookup (g_quark_try_string (name), itype);
-  SIGNAL_UNLOCK ();
+  SIGNAL_READ_UNLOCK ();
   if (!signal_id)
     {
       /* give elaborate warnings */
@@ -1249,7 +1560,7 @@ g_signal_list_ids (GType  itype,
   g_return_val_if_fail (G_TYPE_IS_INSTANTIATABLE (itype) || G_TYPE_IS_INTERFACE (itype), NULL);
   g_return_val_if_fail (n_ids != NULL, NULL);
   
-  SIGNAL_LOCK ();
+  SIGNAL_READ_LOCK ();
   keys = g_bsearch_array_get_nth (g_signal_key_bsa, &g_signal_key_bconfig, 0);
   n_nodes = g_bsearch_array_get_n_nodes (g_signal_key_bsa);
   result = g_array_new (FALSE, FALSE, sizeof (guint));
@@ -1266,7 +1577,7 @@ g_signal_list_ids (GType  itype,
 	  g_array_append_val (result, keys[i].signal_id);
       }
   *n_ids = result->len;
-  SIGNAL_UNLOCK ();
+  SIGNAL_READ_UNLOCK ();
   if (!n_nodes)
     {
       /* give elaborate warnings */
@@ -1300,10 +1611,8 @@ g_signal_name (guint signal_id)
   SignalNode *node;
   const gchar *name;
   
-  SIGNAL_LOCK ();
   node = LOOKUP_SIGNAL_NODE (signal_id);
   name = node ? node->name : NULL;
-  SIGNAL_UNLOCK ();
   
   return (char*) name;
 }
@@ -1329,7 +1638,7 @@ g_signal_query (guint         signal_id,
   
   g_return_if_fail (query != NULL);
   
-  SIGNAL_LOCK ();
+  SIGNAL_READ_LOCK ();
   node = LOOKUP_SIGNAL_NODE (signal_id);
   if (!node || node->destroyed)
     query->signal_id = 0;
@@ -1343,7 +1652,7 @@ g_signal_query (guint         signal_id,
       query->n_params = node->n_params;
       query->param_types = node->param_types;
     }
-  SIGNAL_UNLOCK ();
+  SIGNAL_READ_UNLOCK ();
 }
 
 /**
@@ -1489,7 +1798,7 @@ static inline ClassClosure*
 signal_find_class_closure (SignalNode *node,
 			   GType       itype)
 {
-  GBSearchArray *bsa = node->class_closure_bsa;
+  GBSearchArray *bsa = LOAD_PUBLISHED (&node->class_closure_bsa);
   ClassClosure *cc;
 
   if (bsa)
@@ -1515,11 +1824,12 @@ static inline GClosure*
 signal_lookup_closure (SignalNode    *node,
 		       GTypeInstance *instance)
 {
+  GBSearchArray *bsa = LOAD_PUBLISHED (&node->class_closure_bsa);
   ClassClosure *cc;
 
-  if (node->class_closure_bsa && g_bsearch_array_get_n_nodes (node->class_closure_bsa) == 1)
+  if (bsa && g_bsearch_array_get_n_nodes (bsa) == 1)
     {
-      cc = g_bsearch_array_get_nth (node->class_closure_bsa, &g_class_closure_bconfig, 0);
+      cc = g_bsearch_array_get_nth (bsa, &g_class_closure_bconfig, 0);
       if (cc && cc->instance_type == 0) /* check for default closure */
         return cc->closure;
     }
@@ -1527,22 +1837,57 @@ signal_lookup_closure (SignalNode    *node,
   return cc ? cc->closure : NULL;
 }
 
+/* Class closure arrays are read without the signal lock, but only ever
+ * with the instance lock of the emitting instance held, and nothing
+ * keeps pointing into them once that is dropped.  So after every stripe
+ * has been seen unlocked, nobody can still be looking at an array that
+ * was retired before.  If a stripe is busy, the arrays are kept for the
+ * next attempt; trying the locks rather than waiting for them also
+ * keeps this safe if the caller holds one itself.  Called with the
+ * signal lock held.
+ */
+static void
+class_closure_arrays_collect (void)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (g_instance_stripes); i++)
+    {
+      if (!g_mutex_trylock (&g_instance_stripes[i].mutex))
+        return;
+      g_mutex_unlock (&g_instance_stripes[i].mutex);
+    }
+
+  g_slist_free_full (g_retired_class_closure_arrays, g_free);
+  g_retired_class_closure_arrays = NULL;
+}
+
 static void
 signal_add_class_closure (SignalNode *node,
 			  GType       itype,
 			  GClosure   *closure)
 {
+  GBSearchArray *old_bsa = node->class_closure_bsa;
+  GBSearchArray *bsa;
   ClassClosure key;
 
-  node->single_va_closure_is_valid = FALSE;
-
-  if (!node->class_closure_bsa)
-    node->class_closure_bsa = g_bsearch_array_create (&g_class_closure_bconfig);
+  /* emissions look class closures up without taking the lock, so
+   * insert into a copy and retire the old array
+   */
+  if (!old_bsa)
+    bsa = g_bsearch_array_create (&g_class_closure_bconfig);
+  else
+    bsa = g_memdup (old_bsa, sizeof (GBSearchArray) + old_bsa->n_nodes * g_class_closure_bconfig.sizeof_node);
   key.instance_type = itype;
   key.closure = g_closure_ref (closure);
-  node->class_closure_bsa = g_bsearch_array_insert (node->class_closure_bsa,
-						    &g_class_closure_bconfig,
-						    &key);
+  bsa = g_bsearch_array_insert (bsa, &g_class_closure_bconfig, &key);
+  g_atomic_pointer_set (&node->class_closure_bsa, bsa);
+  if (old_bsa)
+    {
+      g_retired_class_closure_arrays = g_slist_prepend (g_retired_class_closure_arrays, old_bsa);
+      class_closure_arrays_collect ();
+    }
+  node_update_single_va_closure (node);
   g_closure_sink (closure);
   if (node->c_marshaller && closure && G_CLOSURE_NEEDS_MARSHAL (closure))
     {
@@ -1669,11 +2014,9 @@ g_signal_newv (const gchar       *signal_name,
     {
       SignalKey key;
       
-      signal_id = g_n_signal_nodes++;
-      node = g_new (SignalNode, 1);
+      signal_id = signal_node_array_append ();
+      node = g_new0 (SignalNode, 1);
       node->signal_id = signal_id;
-      g_signal_nodes = g_renew (SignalNode*, g_signal_nodes, g_n_signal_nodes);
-      g_signal_nodes[signal_id] = node;
       node->itype = itype;
       node->name = name;
       key.itype = itype;
@@ -1690,7 +2033,7 @@ g_signal_newv (const gchar       *signal_name,
   node->destroyed = FALSE;
 
   /* setup reinitializable portion */
-  node->single_va_closure_is_valid = FALSE;
+  node->single_va_closure = NULL;
   node->flags = signal_flags & G_SIGNAL_FLAGS_MASK;
   node->n_params = n_params;
   node->param_types = g_memdup (param_types, sizeof (GType) * n_params);
@@ -1760,6 +2103,10 @@ g_signal_newv (const gchar       *signal_name,
   node->emission_hooks = NULL;
   if (class_closure)
     signal_add_class_closure (node, 0, class_closure);
+  node_update_single_va_closure (node);
+
+  /* the node can be looked up without lock from now on */
+  g_atomic_pointer_set (&g_signal_nodes->nodes[signal_id], node);
 
   SIGNAL_UNLOCK ();
 
@@ -1790,7 +2137,7 @@ g_signal_set_va_marshaller (guint              signal_id,
 	    _g_closure_set_va_marshal (cc->closure, va_marshaller);
 	}
 
-      node->single_va_closure_is_valid = FALSE;
+      node_update_single_va_closure (node);
     }
 
   SIGNAL_UNLOCK ();
@@ -1866,7 +2213,7 @@ signal_destroy_R (SignalNode *signal_node)
   signal_node->destroyed = TRUE;
   
   /* reentrancy caution, zero out real contents first */
-  signal_node->single_va_closure_is_valid = FALSE;
+  signal_node->single_va_closure = NULL;
   signal_node->n_params = 0;
   signal_node->param_types = NULL;
   signal_node->return_type = 0;
@@ -1880,12 +2227,20 @@ signal_destroy_R (SignalNode *signal_node)
   /* check current emissions */
   {
     Emission *emission;
+    guint i;
     
-    for (emission = (node.flags & G_SIGNAL_NO_RECURSE) ? g_restart_emissions : g_recursive_emissions;
-         emission; emission = emission->next)
-      if (emission->ihint.signal_id == node.signal_id)
-        g_critical (G_STRLOC ": signal \"%s\" being destroyed is currently in emission (instance '%p')",
-                    node.name, emission->instance);
+    for (i = 0; i < G_N_ELEMENTS (g_instance_stripes); i++)
+      {
+        InstanceStripe *stripe = &g_instance_stripes[i];
+
+        g_mutex_lock (&stripe->mutex);
+        for (emission = (node.flags & G_SIGNAL_NO_RECURSE) ? stripe->restart_emissions : stripe->recursive_emissions;
+             emission; emission = emission->next)
+          if (emission->ihint.signal_id == node.signal_id)
+            g_critical (G_STRLOC ": signal \"%s\" being destroyed is currently in emission (instance '%p')",
+                        node.name, emission->instance);
+        g_mutex_unlock (&stripe->mutex);
+      }
   }
 #endif
   
@@ -2022,7 +2377,7 @@ g_signal_chain_from_overridden (const GValue *instance_and_params,
   instance = g_value_peek_pointer (instance_and_params);
   g_return_if_fail (G_TYPE_CHECK_INSTANCE (instance));
   
-  SIGNAL_LOCK ();
+  INSTANCE_LOCK (instance);
   emission = emission_find_innermost (instance);
   if (emission)
     {
@@ -2056,16 +2411,16 @@ g_signal_chain_from_overridden (const GValue *instance_and_params,
   if (closure)
     {
       emission->chain_type = chain_type;
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
       g_closure_invoke (closure,
 			return_value,
 			n_params + 1,
 			instance_and_params,
 			&emission->ihint);
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
       emission->chain_type = restore_type;
     }
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 }
 
 /**
@@ -2094,7 +2449,7 @@ g_signal_chain_from_overridden_handler (gpointer instance,
 
   g_return_if_fail (G_TYPE_CHECK_INSTANCE (instance));
 
-  SIGNAL_LOCK ();
+  INSTANCE_LOCK (instance);
   emission = emission_find_innermost (instance);
   if (emission)
     {
@@ -2146,7 +2501,7 @@ g_signal_chain_from_overridden_handler (gpointer instance,
           GType ptype = node->param_types[i] & ~G_SIGNAL_TYPE_STATIC_SCOPE;
           gboolean static_scope = node->param_types[i] & G_SIGNAL_TYPE_STATIC_SCOPE;
 
-          SIGNAL_UNLOCK ();
+          INSTANCE_UNLOCK (instance);
           G_VALUE_COLLECT_INIT (param_values + i, ptype,
 				var_args,
 				static_scope ? G_VALUE_NOCOPY_CONTENTS : 0,
@@ -2165,17 +2520,17 @@ g_signal_chain_from_overridden_handler (gpointer instance,
               va_end (var_args);
               return;
             }
-          SIGNAL_LOCK ();
+          INSTANCE_LOCK (instance);
         }
 
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
       instance_and_params->g_type = 0;
       g_value_init (instance_and_params, G_TYPE_FROM_INSTANCE (instance));
       g_value_set_instance (instance_and_params, instance);
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
 
       emission->chain_type = chain_type;
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
 
       if (signal_return_type == G_TYPE_NONE)
         {
@@ -2225,10 +2580,10 @@ g_signal_chain_from_overridden_handler (gpointer instance,
 
       va_end (var_args);
 
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
       emission->chain_type = restore_type;
     }
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 }
 
 /**
@@ -2246,9 +2601,9 @@ g_signal_get_invocation_hint (gpointer instance)
   
   g_return_val_if_fail (G_TYPE_CHECK_INSTANCE (instance), NULL);
 
-  SIGNAL_LOCK ();
+  INSTANCE_LOCK (instance);
   emission = emission_find_innermost (instance);
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
   
   return emission ? &emission->ihint : NULL;
 }
@@ -2280,7 +2635,7 @@ g_signal_connect_closure_by_id (gpointer  instance,
   g_return_val_if_fail (signal_id > 0, 0);
   g_return_val_if_fail (closure != NULL, 0);
   
-  SIGNAL_LOCK ();
+  INSTANCE_LOCK (instance);
   node = LOOKUP_SIGNAL_NODE (signal_id);
   if (node)
     {
@@ -2296,7 +2651,7 @@ g_signal_connect_closure_by_id (gpointer  instance,
 	  handler->detail = detail;
 	  handler->closure = g_closure_ref (closure);
 	  g_closure_sink (closure);
-	  add_invalid_closure_notify (handler, instance);
+	  add_invalid_closure_notify (handler);
 	  handler_insert (signal_id, instance, handler);
 	  if (node->c_marshaller && G_CLOSURE_NEEDS_MARSHAL (closure))
 	    {
@@ -2308,7 +2663,7 @@ g_signal_connect_closure_by_id (gpointer  instance,
     }
   else
     g_warning ("%s: signal id '%u' is invalid for instance '%p'", G_STRLOC, signal_id, instance);
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
   
   return handler_seq_no;
 }
@@ -2340,9 +2695,11 @@ g_signal_connect_closure (gpointer     instance,
   g_return_val_if_fail (detailed_signal != NULL, 0);
   g_return_val_if_fail (closure != NULL, 0);
 
-  SIGNAL_LOCK ();
   itype = G_TYPE_FROM_INSTANCE (instance);
+  SIGNAL_READ_LOCK ();
   signal_id = signal_parse_name (detailed_signal, itype, &detail, TRUE);
+  SIGNAL_READ_UNLOCK ();
+  INSTANCE_LOCK (instance);
   if (signal_id)
     {
       SignalNode *node = LOOKUP_SIGNAL_NODE (signal_id);
@@ -2360,7 +2717,7 @@ g_signal_connect_closure (gpointer     instance,
 	  handler->detail = detail;
 	  handler->closure = g_closure_ref (closure);
 	  g_closure_sink (closure);
-	  add_invalid_closure_notify (handler, instance);
+	  add_invalid_closure_notify (handler);
 	  handler_insert (signal_id, instance, handler);
 	  if (node->c_marshaller && G_CLOSURE_NEEDS_MARSHAL (handler->closure))
 	    {
@@ -2373,7 +2730,7 @@ g_signal_connect_closure (gpointer     instance,
   else
     g_warning ("%s: signal '%s' is invalid for instance '%p' of type '%s'",
                G_STRLOC, detailed_signal, instance, g_type_name (itype));
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 
   return handler_seq_no;
 }
@@ -2439,9 +2796,11 @@ g_signal_connect_data (gpointer       instance,
   swapped = (connect_flags & G_CONNECT_SWAPPED) != FALSE;
   after = (connect_flags & G_CONNECT_AFTER) != FALSE;
 
-  SIGNAL_LOCK ();
   itype = G_TYPE_FROM_INSTANCE (instance);
+  SIGNAL_READ_LOCK ();
   signal_id = signal_parse_name (detailed_signal, itype, &detail, TRUE);
+  SIGNAL_READ_UNLOCK ();
+  INSTANCE_LOCK (instance);
   if (signal_id)
     {
       SignalNode *node = LOOKUP_SIGNAL_NODE (signal_id);
@@ -2473,7 +2832,7 @@ g_signal_connect_data (gpointer       instance,
   else
     g_warning ("%s: signal '%s' is invalid for instance '%p' of type '%s'",
                G_STRLOC, detailed_signal, instance, g_type_name (itype));
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 
   return handler_seq_no;
 }
@@ -2501,8 +2860,8 @@ g_signal_handler_block (gpointer instance,
   g_return_if_fail (G_TYPE_CHECK_INSTANCE (instance));
   g_return_if_fail (handler_id > 0);
   
-  SIGNAL_LOCK ();
-  handler = handler_lookup (instance, handler_id, NULL, NULL);
+  INSTANCE_LOCK (instance);
+  handler = handler_lookup (instance, handler_id, NULL);
   if (handler)
     {
 #ifndef G_DISABLE_CHECKS
@@ -2513,7 +2872,7 @@ g_signal_handler_block (gpointer instance,
     }
   else
     g_warning ("%s: instance '%p' has no handler with id '%lu'", G_STRLOC, instance, handler_id);
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 }
 
 /**
@@ -2544,8 +2903,8 @@ g_signal_handler_unblock (gpointer instance,
   g_return_if_fail (G_TYPE_CHECK_INSTANCE (instance));
   g_return_if_fail (handler_id > 0);
   
-  SIGNAL_LOCK ();
-  handler = handler_lookup (instance, handler_id, NULL, NULL);
+  INSTANCE_LOCK (instance);
+  handler = handler_lookup (instance, handler_id, NULL);
   if (handler)
     {
       if (handler->block_count)
@@ -2555,7 +2914,7 @@ g_signal_handler_unblock (gpointer instance,
     }
   else
     g_warning ("%s: instance '%p' has no handler with id '%lu'", G_STRLOC, instance, handler_id);
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 }
 
 /**
@@ -2580,18 +2939,19 @@ g_signal_handler_disconnect (gpointer instance,
   g_return_if_fail (G_TYPE_CHECK_INSTANCE (instance));
   g_return_if_fail (handler_id > 0);
   
-  SIGNAL_LOCK ();
-  handler = handler_lookup (instance, handler_id, NULL, &signal_id);
+  INSTANCE_LOCK (instance);
+  handler = handler_lookup (instance, handler_id, &signal_id);
   if (handler)
     {
+      handler_index_remove (handler);
       handler->sequential_number = 0;
       handler->block_count = 1;
-      remove_invalid_closure_notify (handler, instance);
+      remove_invalid_closure_notify (handler);
       handler_unref_R (signal_id, instance, handler);
     }
   else
     g_warning ("%s: instance '%p' has no handler with id '%lu'", G_STRLOC, instance, handler_id);
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 }
 
 /**
@@ -2612,10 +2972,10 @@ g_signal_handler_is_connected (gpointer instance,
 
   g_return_val_if_fail (G_TYPE_CHECK_INSTANCE (instance), FALSE);
 
-  SIGNAL_LOCK ();
-  handler = handler_lookup (instance, handler_id, NULL, NULL);
+  INSTANCE_LOCK (instance);
+  handler = handler_lookup (instance, handler_id, NULL);
   connected = handler != NULL;
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 
   return connected;
 }
@@ -2631,14 +2991,14 @@ g_signal_handlers_destroy (gpointer instance)
   
   g_return_if_fail (G_TYPE_CHECK_INSTANCE (instance));
   
-  SIGNAL_LOCK ();
-  hlbsa = g_hash_table_lookup (g_handler_list_bsa_ht, instance);
+  INSTANCE_LOCK (instance);
+  hlbsa = g_hash_table_lookup (instance_stripe (instance)->handler_list_bsa_ht, instance);
   if (hlbsa)
     {
       guint i;
       
       /* reentrancy caution, delete instance trace first */
-      g_hash_table_remove (g_handler_list_bsa_ht, instance);
+      g_hash_table_remove (instance_stripe (instance)->handler_list_bsa_ht, instance);
       
       for (i = 0; i < hlbsa->n_nodes; i++)
         {
@@ -2656,15 +3016,16 @@ g_signal_handlers_destroy (gpointer instance)
               tmp->prev = tmp;
               if (tmp->sequential_number)
 		{
-		  remove_invalid_closure_notify (tmp, instance);
+		  remove_invalid_closure_notify (tmp);
+		  handler_index_remove (tmp);
 		  tmp->sequential_number = 0;
-		  handler_unref_R (0, NULL, tmp);
+		  handler_unref_R (0, instance, tmp);
 		}
             }
         }
       g_bsearch_array_free (hlbsa, &g_signal_hlbsa_bconfig);
     }
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 }
 
 /**
@@ -2704,14 +3065,14 @@ g_signal_handler_find (gpointer         instance,
     {
       HandlerMatch *mlist;
       
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
       mlist = handlers_find (instance, mask, signal_id, detail, closure, func, data, TRUE);
       if (mlist)
 	{
 	  handler_seq_no = mlist->handler->sequential_number;
 	  handler_match_free1_R (mlist, instance);
 	}
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
     }
   
   return handler_seq_no;
@@ -2737,9 +3098,9 @@ signal_handlers_foreach_matched_R (gpointer         instance,
       n_handlers++;
       if (mlist->handler->sequential_number)
 	{
-	  SIGNAL_UNLOCK ();
+	  INSTANCE_UNLOCK (instance);
 	  callback (instance, mlist->handler->sequential_number);
-	  SIGNAL_LOCK ();
+	  INSTANCE_LOCK (instance);
 	}
       mlist = handler_match_free1_R (mlist, instance);
     }
@@ -2784,11 +3145,11 @@ g_signal_handlers_block_matched (gpointer         instance,
   
   if (mask & (G_SIGNAL_MATCH_CLOSURE | G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA))
     {
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
       n_handlers = signal_handlers_foreach_matched_R (instance, mask, signal_id, detail,
 						      closure, func, data,
 						      g_signal_handler_block);
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
     }
   
   return n_handlers;
@@ -2832,11 +3193,11 @@ g_signal_handlers_unblock_matched (gpointer         instance,
   
   if (mask & (G_SIGNAL_MATCH_CLOSURE | G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA))
     {
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
       n_handlers = signal_handlers_foreach_matched_R (instance, mask, signal_id, detail,
 						      closure, func, data,
 						      g_signal_handler_unblock);
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
     }
   
   return n_handlers;
@@ -2880,11 +3241,11 @@ g_signal_handlers_disconnect_matched (gpointer         instance,
   
   if (mask & (G_SIGNAL_MATCH_CLOSURE | G_SIGNAL_MATCH_FUNC | G_SIGNAL_MATCH_DATA))
     {
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
       n_handlers = signal_handlers_foreach_matched_R (instance, mask, signal_id, detail,
 						      closure, func, data,
 						      g_signal_handler_disconnect);
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
     }
   
   return n_handlers;
@@ -2919,8 +3280,7 @@ g_signal_has_handler_pending (gpointer instance,
   
   g_return_val_if_fail (G_TYPE_CHECK_INSTANCE (instance), FALSE);
   g_return_val_if_fail (signal_id > 0, FALSE);
-  
-  SIGNAL_LOCK ();
+
   if (detail)
     {
       SignalNode *node = LOOKUP_SIGNAL_NODE (signal_id);
@@ -2928,10 +3288,14 @@ g_signal_has_handler_pending (gpointer instance,
       if (!(node->flags & G_SIGNAL_DETAILED))
 	{
 	  g_warning ("%s: signal id '%u' does not support detail (%u)", G_STRLOC, signal_id, detail);
-	  SIGNAL_UNLOCK ();
 	  return FALSE;
 	}
     }
+
+  if (!instance_may_have_handlers (instance, signal_id))
+    return FALSE;
+
+  INSTANCE_LOCK (instance);
   mlist = handlers_find (instance,
 			 (G_SIGNAL_MATCH_ID | G_SIGNAL_MATCH_DETAIL | (may_be_blocked ? 0 : G_SIGNAL_MATCH_UNBLOCKED)),
 			 signal_id, detail, NULL, NULL, NULL, TRUE);
@@ -2942,11 +3306,33 @@ g_signal_has_handler_pending (gpointer instance,
     }
   else
     has_pending = FALSE;
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
   
   return has_pending;
 }
 
+/* Whether emitting @signal_id on @instance is known to do nothing, so
+ * that callers can skip preparing the arguments.  May return %FALSE
+ * for emissions that turn out to be NOPs after all.
+ */
+gboolean
+_g_signal_emission_is_nop (gpointer instance,
+                           guint    signal_id)
+{
+  SignalNode *node = LOOKUP_SIGNAL_NODE (signal_id);
+  GClosure *single_va_closure = LOAD_PUBLISHED (&node->single_va_closure);
+
+  return single_va_closure != NULL &&
+    (single_va_closure == SINGLE_VA_CLOSURE_EMPTY_MAGIC ||
+     _g_closure_is_void (single_va_closure, instance)) &&
+    !instance_may_have_handlers (instance, signal_id)
+#ifdef	G_ENABLE_DEBUG
+    && !COND_DEBUG (SIGNALS, g_trace_instance_signals != instance &&
+                    g_trap_instance_signals == instance)
+#endif	/* G_ENABLE_DEBUG */
+    ;
+}
+
 /**
  * g_signal_emitv:
  * @instance_and_params: (array): argument list for the signal emission.
@@ -2969,6 +3355,7 @@ g_signal_emitv (const GValue *instance_and_params,
 {
   gpointer instance;
   SignalNode *node;
+  GClosure *single_va_closure;
 #ifdef G_ENABLE_DEBUG
   const GValue *param_values;
   guint i;
@@ -2983,19 +3370,16 @@ g_signal_emitv (const GValue *instance_and_params,
   param_values = instance_and_params + 1;
 #endif
 
-  SIGNAL_LOCK ();
   node = LOOKUP_SIGNAL_NODE (signal_id);
   if (!node || !g_type_is_a (G_TYPE_FROM_INSTANCE (instance), node->itype))
     {
       g_warning ("%s: signal id '%u' is invalid for instance '%p'", G_STRLOC, signal_id, instance);
-      SIGNAL_UNLOCK ();
       return;
     }
 #ifdef G_ENABLE_DEBUG
   if (detail && !(node->flags & G_SIGNAL_DETAILED))
     {
       g_warning ("%s: signal id '%u' does not support detail (%u)", G_STRLOC, signal_id, detail);
-      SIGNAL_UNLOCK ();
       return;
     }
   for (i = 0; i < node->n_params; i++)
@@ -3007,7 +3391,6 @@ g_signal_emitv (const GValue *instance_and_params,
 		    i,
 		    node->name,
 		    G_VALUE_TYPE_NAME (param_values + i));
-	SIGNAL_UNLOCK ();
 	return;
       }
   if (node->return_type != G_TYPE_NONE)
@@ -3018,7 +3401,6 @@ g_signal_emitv (const GValue *instance_and_params,
 		      G_STRLOC,
 		      type_debug_name (node->return_type),
 		      node->name);
-	  SIGNAL_UNLOCK ();
 	  return;
 	}
       else if (!node->accumulator && !G_TYPE_CHECK_VALUE_TYPE (return_value, node->return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE))
@@ -3028,7 +3410,6 @@ g_signal_emitv (const GValue *instance_and_params,
 		      type_debug_name (node->return_type),
 		      node->name,
 		      G_VALUE_TYPE_NAME (return_value));
-	  SIGNAL_UNLOCK ();
 	  return;
 	}
     }
@@ -3037,29 +3418,33 @@ g_signal_emitv (const GValue *instance_and_params,
 #endif	/* G_ENABLE_DEBUG */
 
   /* optimize NOP emissions */
-  if (!node->single_va_closure_is_valid)
-    node_update_single_va_closure (node);
-
-  if (node->single_va_closure != NULL &&
-      (node->single_va_closure == SINGLE_VA_CLOSURE_EMPTY_MAGIC ||
-       _g_closure_is_void (node->single_va_closure, instance))
+  single_va_closure = LOAD_PUBLISHED (&node->single_va_closure);
+  if (single_va_closure != NULL &&
+      (single_va_closure == SINGLE_VA_CLOSURE_EMPTY_MAGIC ||
+       _g_closure_is_void (single_va_closure, instance))
 #ifdef	G_ENABLE_DEBUG
       && !COND_DEBUG (SIGNALS, g_trace_instance_signals != instance &&
 		      g_trap_instance_signals == instance)
 #endif	/* G_ENABLE_DEBUG */
       )
     {
-      HandlerList* hlist = handler_list_lookup (node->signal_id, instance);
+      HandlerList* hlist;
+
+      if (!instance_may_have_handlers (instance, node->signal_id))
+	return;
+
+      INSTANCE_LOCK (instance);
+      hlist = handler_list_lookup (node->signal_id, instance);
       if (hlist == NULL || hlist->handlers == NULL)
 	{
 	  /* nothing to do to emit this signal */
-	  SIGNAL_UNLOCK ();
+	  INSTANCE_UNLOCK (instance);
 	  /* g_printerr ("omitting emission of \"%s\"\n", node->name); */
 	  return;
 	}
+      INSTANCE_UNLOCK (instance);
     }
 
-  SIGNAL_UNLOCK ();
   signal_emit_unlocked_R (node, detail, instance, return_value, instance_and_params);
 }
 
@@ -3104,51 +3489,60 @@ g_signal_emit_valist (gpointer instance,
   GType signal_return_type;
   GValue *param_values;
   SignalNode *node;
+  GClosure *single_va_closure;
   guint i, n_params;
 
   g_return_if_fail (G_TYPE_CHECK_INSTANCE (instance));
   g_return_if_fail (signal_id > 0);
 
-  SIGNAL_LOCK ();
   node = LOOKUP_SIGNAL_NODE (signal_id);
   if (!node || !g_type_is_a (G_TYPE_FROM_INSTANCE (instance), node->itype))
     {
       g_warning ("%s: signal id '%u' is invalid for instance '%p'", G_STRLOC, signal_id, instance);
-      SIGNAL_UNLOCK ();
       return;
     }
 #ifndef G_DISABLE_CHECKS
   if (detail && !(node->flags & G_SIGNAL_DETAILED))
     {
       g_warning ("%s: signal id '%u' does not support detail (%u)", G_STRLOC, signal_id, detail);
-      SIGNAL_UNLOCK ();
       return;
     }
 #endif  /* !G_DISABLE_CHECKS */
 
-  if (!node->single_va_closure_is_valid)
-    node_update_single_va_closure (node);
-
-  if (node->single_va_closure != NULL
+  single_va_closure = LOAD_PUBLISHED (&node->single_va_closure);
+  if (single_va_closure != NULL
 #ifdef	G_ENABLE_DEBUG
       && !COND_DEBUG (SIGNALS, g_trace_instance_signals != instance &&
 		      g_trap_instance_signals == instance)
 #endif	/* G_ENABLE_DEBUG */
       )
     {
-      HandlerList* hlist = handler_list_lookup (node->signal_id, instance);
+      InstanceStripe *stripe = instance_stripe (instance);
+      HandlerList* hlist;
       Handler *fastpath_handler = NULL;
       Handler *l;
       GClosure *closure = NULL;
       gboolean fastpath = TRUE;
       GSignalFlags run_type = G_SIGNAL_RUN_FIRST;
 
-      if (node->single_va_closure != SINGLE_VA_CLOSURE_EMPTY_MAGIC &&
-	  !_g_closure_is_void (node->single_va_closure, instance))
+      /* nothing is connected and there is no class closure to run,
+       * so there is nothing to do and no need to take the lock
+       */
+      if (node->return_type == G_TYPE_NONE &&
+	  (single_va_closure == SINGLE_VA_CLOSURE_EMPTY_MAGIC ||
+	   _g_closure_is_void (single_va_closure, instance)) &&
+	  !instance_may_have_handlers (instance, node->signal_id))
+	return;
+
+      INSTANCE_LOCK (instance);
+      hlist = handler_list_lookup (node->signal_id, instance);
+
+      if (single_va_closure != SINGLE_VA_CLOSURE_EMPTY_MAGIC &&
+	  !_g_closure_is_void (single_va_closure, instance))
 	{
-	  if (_g_closure_supports_invoke_va (node->single_va_closure))
+	  if (_g_closure_supports_invoke_va (single_va_closure))
 	    {
-	      closure = node->single_va_closure;
+	      closure = single_va_closure;
 	      if (node->single_va_closure_is_after)
 		run_type = G_SIGNAL_RUN_LAST;
 	      else
@@ -3182,7 +3576,7 @@ g_signal_emit_valist (gpointer instance,
 
       if (fastpath && closure == NULL && node->return_type == G_TYPE_NONE)
 	{
-	  SIGNAL_UNLOCK ();
+	  INSTANCE_UNLOCK (instance);
 	  return;
 	}
 
@@ -3217,12 +3611,12 @@ g_signal_emit_valist (gpointer instance,
 	  emission.ihint.run_type = run_type;
 	  emission.state = EMISSION_RUN;
 	  emission.chain_type = instance_type;
-	  emission_push (&g_recursive_emissions, &emission);
+	  emission_push (&stripe->recursive_emissions, &emission);
 
           if (fastpath_handler)
             handler_ref (fastpath_handler);
 
-	  SIGNAL_UNLOCK ();
+	  INSTANCE_UNLOCK (instance);
 
 	  TRACE(GOBJECT_SIGNAL_EMIT(signal_id, detail, instance, instance_type));
 
@@ -3244,15 +3638,15 @@ g_signal_emit_valist (gpointer instance,
 	      accumulate (&emission.ihint, &emission_return, &accu, accumulator);
 	    }
 
-	  SIGNAL_LOCK ();
+	  INSTANCE_LOCK (instance);
 
 	  emission.chain_type = G_TYPE_NONE;
-	  emission_pop (&g_recursive_emissions, &emission);
+	  emission_pop (&stripe->recursive_emissions, &emission);
 
           if (fastpath_handler)
             handler_unref_R (signal_id, instance, fastpath_handler);
 
-	  SIGNAL_UNLOCK ();
+	  INSTANCE_UNLOCK (instance);
 
 	  if (accumulator)
 	    g_value_unset (&accu);
@@ -3289,8 +3683,9 @@ g_signal_emit_valist (gpointer instance,
 
 	  return;
 	}
+
+      INSTANCE_UNLOCK (instance);
     }
-  SIGNAL_UNLOCK ();
 
   n_params = node->n_params;
   signal_return_type = node->return_type;
@@ -3414,9 +3809,9 @@ g_signal_emit_by_name (gpointer     instance,
 
   itype = G_TYPE_FROM_INSTANCE (instance);
 
-  SIGNAL_LOCK ();
+  SIGNAL_READ_LOCK ();
   signal_id = signal_parse_name (detailed_signal, itype, &detail, TRUE);
-  SIGNAL_UNLOCK ();
+  SIGNAL_READ_UNLOCK ();
 
   if (signal_id)
     {
@@ -3438,6 +3833,7 @@ signal_emit_unlocked_R (SignalNode   *node,
 			GValue	     *emission_return,
 			const GValue *instance_and_params)
 {
+  InstanceStripe *stripe = instance_stripe (instance);
   SignalAccumulator *accumulator;
   Emission emission;
   GClosure *class_closure;
@@ -3462,27 +3858,27 @@ signal_emit_unlocked_R (SignalNode   *node,
 
   TRACE(GOBJECT_SIGNAL_EMIT(node->signal_id, detail, instance, G_TYPE_FROM_INSTANCE (instance)));
 
-  SIGNAL_LOCK ();
+  INSTANCE_LOCK (instance);
   signal_id = node->signal_id;
 
   if (node->flags & G_SIGNAL_NO_RECURSE)
     {
-      Emission *node = emission_find (g_restart_emissions, signal_id, detail, instance);
+      Emission *node = emission_find (stripe->restart_emissions, signal_id, detail, instance);
       
       if (node)
 	{
 	  node->state = EMISSION_RESTART;
-	  SIGNAL_UNLOCK ();
+	  INSTANCE_UNLOCK (instance);
 	  return return_value_altered;
 	}
     }
   accumulator = node->accumulator;
   if (accumulator)
     {
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
       g_value_init (&accu, node->return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE);
       return_accu = &accu;
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
     }
   else
     return_accu = emission_return;
@@ -3492,14 +3888,14 @@ signal_emit_unlocked_R (SignalNode   *node,
   emission.ihint.run_type = 0;
   emission.state = 0;
   emission.chain_type = G_TYPE_NONE;
-  emission_push ((node->flags & G_SIGNAL_NO_RECURSE) ? &g_restart_emissions : &g_recursive_emissions, &emission);
+  emission_push ((node->flags & G_SIGNAL_NO_RECURSE) ? &stripe->restart_emissions : &stripe->recursive_emissions, &emission);
   class_closure = signal_lookup_closure (node, instance);
   
  EMIT_RESTART:
   
   if (handler_list)
     handler_unref_R (signal_id, instance, handler_list);
-  max_sequential_handler_number = g_handler_sequential_number;
+  max_sequential_handler_number = (gulong) g_atomic_pointer_get (&g_handler_sequential_number);
   hlist = handler_list_lookup (signal_id, instance);
   handler_list = hlist ? hlist->handlers : NULL;
   if (handler_list)
@@ -3512,7 +3908,7 @@ signal_emit_unlocked_R (SignalNode   *node,
       emission.state = EMISSION_RUN;
 
       emission.chain_type = G_TYPE_FROM_INSTANCE (instance);
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
       g_closure_invoke (class_closure,
 			return_accu,
 			node->n_params + 1,
@@ -3521,7 +3917,7 @@ signal_emit_unlocked_R (SignalNode   *node,
       if (!accumulate (&emission.ihint, emission_return, &accu, accumulator) &&
 	  emission.state == EMISSION_RUN)
 	emission.state = EMISSION_STOP;
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
       emission.chain_type = G_TYPE_NONE;
       return_value_altered = TRUE;
       
@@ -3534,10 +3930,19 @@ signal_emit_unlocked_R (SignalNode   *node,
   if (node->emission_hooks)
     {
       gboolean need_destroy, was_in_call, may_recurse = TRUE;
+      gboolean hooks_destroyed = FALSE;
       GHook *hook;
 
+      /* emission hooks are shared between all instances and are
+       * protected by the signal lock instead of the instance lock.
+       * The lock is dropped around each hook function, so hooks may
+       * reenter, but every emission of a signal with hooks still
+       * takes the writer lock to walk the hook list.
+       */
       emission.state = EMISSION_HOOK;
-      hook = g_hook_first_valid (node->emission_hooks, may_recurse);
+      INSTANCE_UNLOCK (instance);
+      SIGNAL_LOCK ();
+      hook = node->emission_hooks ? g_hook_first_valid (node->emission_hooks, may_recurse) : NULL;
       while (hook)
 	{
 	  SignalHook *signal_hook = SIGNAL_HOOK (hook);
@@ -3554,10 +3959,17 @@ signal_emit_unlocked_R (SignalNode   *node,
 	      if (!was_in_call)
 		hook->flags &= ~G_HOOK_FLAG_IN_CALL;
 	      if (need_destroy)
-		g_hook_destroy_link (node->emission_hooks, hook);
+		{
+		  g_hook_destroy_link (node->emission_hooks, hook);
+		  hooks_destroyed = TRUE;
+		}
 	    }
 	  hook = g_hook_next_valid (node->emission_hooks, hook, may_recurse);
 	}
+      if (hooks_destroyed)
+	node_update_single_va_closure (node);
+      SIGNAL_UNLOCK ();
+      INSTANCE_LOCK (instance);
       
       if (emission.state == EMISSION_RESTART)
 	goto EMIT_RESTART;
@@ -3582,7 +3994,7 @@ signal_emit_unlocked_R (SignalNode   *node,
 	  else if (!handler->block_count && (!handler->detail || handler->detail == detail) &&
 		   handler->sequential_number < max_sequential_handler_number)
 	    {
-	      SIGNAL_UNLOCK ();
+	      INSTANCE_UNLOCK (instance);
 	      g_closure_invoke (handler->closure,
 				return_accu,
 				node->n_params + 1,
@@ -3591,7 +4003,7 @@ signal_emit_unlocked_R (SignalNode   *node,
 	      if (!accumulate (&emission.ihint, emission_return, &accu, accumulator) &&
 		  emission.state == EMISSION_RUN)
 		emission.state = EMISSION_STOP;
-	      SIGNAL_LOCK ();
+	      INSTANCE_LOCK (instance);
 	      return_value_altered = TRUE;
 	      
 	      tmp = emission.state == EMISSION_RUN ? handler->next : NULL;
@@ -3620,7 +4032,7 @@ signal_emit_unlocked_R (SignalNode   *node,
       emission.state = EMISSION_RUN;
       
       emission.chain_type = G_TYPE_FROM_INSTANCE (instance);
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
       g_closure_invoke (class_closure,
 			return_accu,
 			node->n_params + 1,
@@ -3629,7 +4041,7 @@ signal_emit_unlocked_R (SignalNode   *node,
       if (!accumulate (&emission.ihint, emission_return, &accu, accumulator) &&
 	  emission.state == EMISSION_RUN)
 	emission.state = EMISSION_STOP;
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
       emission.chain_type = G_TYPE_NONE;
       return_value_altered = TRUE;
       
@@ -3652,7 +4064,7 @@ signal_emit_unlocked_R (SignalNode   *node,
 	  if (handler->after && !handler->block_count && (!handler->detail || handler->detail == detail) &&
 	      handler->sequential_number < max_sequential_handler_number)
 	    {
-	      SIGNAL_UNLOCK ();
+	      INSTANCE_UNLOCK (instance);
 	      g_closure_invoke (handler->closure,
 				return_accu,
 				node->n_params + 1,
@@ -3661,7 +4073,7 @@ signal_emit_unlocked_R (SignalNode   *node,
 	      if (!accumulate (&emission.ihint, emission_return, &accu, accumulator) &&
 		  emission.state == EMISSION_RUN)
 		emission.state = EMISSION_STOP;
-	      SIGNAL_LOCK ();
+	      INSTANCE_LOCK (instance);
 	      return_value_altered = TRUE;
 	      
 	      tmp = emission.state == EMISSION_RUN ? handler->next : NULL;
@@ -3693,7 +4105,7 @@ signal_emit_unlocked_R (SignalNode   *node,
       emission.state = EMISSION_STOP;
       
       emission.chain_type = G_TYPE_FROM_INSTANCE (instance);
-      SIGNAL_UNLOCK ();
+      INSTANCE_UNLOCK (instance);
       if (node->return_type != G_TYPE_NONE && !accumulator)
 	{
 	  g_value_init (&accu, node->return_type & ~G_SIGNAL_TYPE_STATIC_SCOPE);
@@ -3706,7 +4118,7 @@ signal_emit_unlocked_R (SignalNode   *node,
 			&emission.ihint);
       if (need_unset)
 	g_value_unset (&accu);
-      SIGNAL_LOCK ();
+      INSTANCE_LOCK (instance);
       emission.chain_type = G_TYPE_NONE;
       
       if (emission.state == EMISSION_RESTART)
@@ -3716,8 +4128,8 @@ signal_emit_unlocked_R (SignalNode   *node,
   if (handler_list)
     handler_unref_R (signal_id, instance, handler_list);
   
-  emission_pop ((node->flags & G_SIGNAL_NO_RECURSE) ? &g_restart_emissions : &g_recursive_emissions, &emission);
-  SIGNAL_UNLOCK ();
+  emission_pop ((node->flags & G_SIGNAL_NO_RECURSE) ? &stripe->restart_emissions : &stripe->recursive_emissions, &emission);
+  INSTANCE_UNLOCK (instance);
   if (accumulator)
     g_value_unset (&accu);
 
@@ -3726,42 +4138,43 @@ signal_emit_unlocked_R (SignalNode   *node,
   return return_value_altered;
 }
 
+/* the handler itself is passed as notifier data, so that it does not
+ * need to be looked up when the closure is invalidated
+ */
 static void
-add_invalid_closure_notify (Handler  *handler,
-			    gpointer  instance)
+add_invalid_closure_notify (Handler  *handler)
 {
-  g_closure_add_invalidate_notifier (handler->closure, instance, invalid_closure_notify);
+  g_closure_add_invalidate_notifier (handler->closure, handler, invalid_closure_notify);
   handler->has_invalid_closure_notify = 1;
 }
 
 static void
-remove_invalid_closure_notify (Handler  *handler,
-			       gpointer  instance)
+remove_invalid_closure_notify (Handler  *handler)
 {
   if (handler->has_invalid_closure_notify)
     {
-      g_closure_remove_invalidate_notifier (handler->closure, instance, invalid_closure_notify);
+      g_closure_remove_invalidate_notifier (handler->closure, handler, invalid_closure_notify);
       handler->has_invalid_closure_notify = 0;
     }
 }
 
 static void
-invalid_closure_notify (gpointer  instance,
+invalid_closure_notify (gpointer  data,
 		        GClosure *closure)
 {
-  Handler *handler;
-  guint signal_id;
+  Handler *handler = data;
+  gpointer instance = handler->instance;
 
-  SIGNAL_LOCK ();
+  INSTANCE_LOCK (instance);
 
-  handler = handler_lookup (instance, 0, closure, &signal_id);
   g_assert (handler->closure == closure);
 
+  handler_index_remove (handler);
   handler->sequential_number = 0;
   handler->block_count = 1;
-  handler_unref_R (signal_id, instance, handler);
+  handler_unref_R (handler->signal_id, instance, handler);
 
-  SIGNAL_UNLOCK ();
+  INSTANCE_UNLOCK (instance);
 }
 
 static const gchar*
@@ -74,6 +74,15 @@ void        _g_closure_invoke_va (GClosure       *closure,
 
 gboolean    g_type_is_in_init    (GType type);
 
+/* for gobject.c */
+gboolean    _g_signal_emission_is_nop (gpointer instance,
+                                       guint    signal_id);
+gsize       _g_type_get_instance_size (GType          type,
+                                       gsize         *private_size);
+void        _g_type_init_instance     (GTypeInstance *instance,
+                                       GTypeClass    *class);
+void        _g_type_release_instance  (GTypeInstance *instance);
+
 G_END_DECLS
 
 #endif /* __G_TYPE_PRIVATE_H__ */
@@ -240,6 +240,7 @@ struct _TypeNode
     GAtomicArray offsets;
   } _prot;
   GType       *prerequisites;
+  GType * volatile conformity_cache; /* for instantiatable types, see type_node_conforms_to_U() */
   GType        supers[1]; /* flexible array */
 };
 
@@ -248,6 +249,7 @@ struct _TypeNode
 #define MAX_N_CHILDREN				(4095)
 #define	MAX_N_INTERFACES			(255) /* Limited by offsets being 8 bits */
 #define	MAX_N_PREREQUISITES			(511)
+#define	CONFORMITY_CACHE_SIZE			(8)
 #define NODE_TYPE(node)				(node->supers[0])
 #define NODE_PARENT_TYPE(node)			(node->supers[1])
 #define NODE_FUNDAMENTAL_TYPE(node)		(node->supers[node->n_supers])
@@ -1766,6 +1768,32 @@ type_iface_blow_holder_info_Wm (TypeNode *iface,
     }
 }
 
+static void
+type_instance_init_I (TypeNode      *node,
+                      GTypeInstance *instance,
+                      GTypeClass    *class)
+{
+  guint i;
+
+  for (i = node->n_supers; i > 0; i--)
+    {
+      TypeNode *pnode;
+      
+      pnode = lookup_type_node_I (node->supers[i]);
+      if (pnode->data->instance.instance_init)
+	{
+	  instance->g_class = pnode->data->instance.class;
+	  pnode->data->instance.instance_init (instance, class);
+	}
+    }
+
+  instance->g_class = class;
+  if (node->data->instance.instance_init)
+    node->data->instance.instance_init (instance, class);
+
+  TRACE(GOBJECT_OBJECT_NEW(instance, NODE_TYPE (node)));
+}
+
 /**
  * g_type_create_instance: (skip)
  * @type: An instantiatable type to create an instance for.
@@ -1796,7 +1824,6 @@ g_type_create_instance (GType type)
   gchar *allocated;
   gint private_size;
   gint ivar_size;
-  guint i;
 
   node = lookup_type_node_I (type);
   if (!node || !node->is_instantiatable)
@@ -1851,25 +1878,61 @@ g_type_create_instance (GType type)
 
   instance = (GTypeInstance *) (allocated + private_size);
 
-  for (i = node->n_supers; i > 0; i--)
-    {
-      TypeNode *pnode;
-      
-      pnode = lookup_type_node_I (node->supers[i]);
-      if (pnode->data->instance.instance_init)
-	{
-	  instance->g_class = pnode->data->instance.class;
-	  pnode->data->instance.instance_init (instance, class);
-	}
-    }
+  type_instance_init_I (node, instance, class);
 
-  instance->g_class = class;
-  if (node->data->instance.instance_init)
-    node->data->instance.instance_init (instance, class);
+  return instance;
+}
 
-  TRACE(GOBJECT_OBJECT_NEW(instance, type));
+/* for gobject.c: instances that live in memory allocated by the
+ * caller, such as the arenas of g_object_newv_many().  The caller
+ * holds a class reference for them, and must have zeroed the memory.
+ *
+ * Returns 0 if the instances have to be allocated by
+ * g_type_create_instance() after all, which is also what reports
+ * types that cannot be instantiated.
+ */
+gsize
+_g_type_get_instance_size (GType  type,
+                           gsize *private_size)
+{
+  TypeNode *node = lookup_type_node_I (type);
 
-  return instance;
+  /* G_TYPE_IS_ABSTRACT() is an external call: _U */
+  if (!node || !node->is_instantiatable ||
+      (!node->mutatable_check_cache && G_TYPE_IS_ABSTRACT (type)))
+    return 0;
+
+  /* only final once the class is initialized */
+  g_assert (node->data->instance.class != NULL);
+
+  /* see g_type_create_instance() */
+  if (node->data->instance.private_size && RUNNING_ON_VALGRIND)
+    return 0;
+
+  *private_size = node->data->instance.private_size;
+
+  return node->data->instance.private_size + node->data->instance.instance_size;
+}
+
+void
+_g_type_init_instance (GTypeInstance *instance,
+                       GTypeClass    *class)
+{
+  type_instance_init_I (lookup_type_node_I (class->g_type), instance, class);
+}
+
+void
+_g_type_release_instance (GTypeInstance *instance)
+{
+#ifdef G_ENABLE_DEBUG
+  TypeNode *node = lookup_type_node_I (instance->g_class->g_type);
+  gint private_size = node->data->instance.private_size;
+
+  memset (((gchar *) instance) - private_size, 0xaa,
+          node->data->instance.instance_size + private_size);
+#else
+  instance->g_class = NULL;
+#endif
 }
 
 /**
@@ -3480,13 +3543,75 @@ type_node_is_a_L (TypeNode *node,
   return type_node_check_conformities_UorL (node, iface_node, TRUE, TRUE, TRUE);
 }
 
+/* Instantiatable types remember some of the interfaces they were found
+ * to implement in a small table indexed by a hash of the interface
+ * type, one cache line in size.  A type never stops implementing an
+ * interface, so entries never go stale and the table can be read and
+ * written without locking; when two interfaces share a slot, the last
+ * one checked wins.
+ */
+#if defined (__ATOMIC_ACQUIRE)
+#define conformity_cache_get(node) (__atomic_load_n (&(node)->conformity_cache, __ATOMIC_ACQUIRE))
+#else
+#define conformity_cache_get(node) (g_atomic_pointer_get (&(node)->conformity_cache))
+#endif
+
+static inline guint
+conformity_cache_slot (GType iface_type)
+{
+  return ((iface_type >> 4) ^ (iface_type >> 9)) & (CONFORMITY_CACHE_SIZE - 1);
+}
+
+static void
+type_node_remember_conformity_U (TypeNode *node,
+                                 GType     iface_type)
+{
+  GType *cache = g_atomic_pointer_get (&node->conformity_cache);
+
+  if (!cache)
+    {
+      cache = g_new0 (GType, CONFORMITY_CACHE_SIZE);
+      if (!g_atomic_pointer_compare_and_exchange (&node->conformity_cache, NULL, cache))
+        {
+          g_free (cache);
+          cache = g_atomic_pointer_get (&node->conformity_cache);
+        }
+    }
+
+  cache[conformity_cache_slot (iface_type)] = iface_type;
+}
+
 static inline gboolean
 type_node_conforms_to_U (TypeNode *node,
 			 TypeNode *iface_node,
 			 gboolean  support_interfaces,
 			 gboolean  support_prerequisites)
 {
-  return type_node_check_conformities_UorL (node, iface_node, support_interfaces, support_prerequisites, FALSE);
+  GType *cache;
+
+  if (NODE_IS_ANCESTOR (iface_node, node))
+    return TRUE;
+
+  if (!support_interfaces || !node->is_instantiatable)
+    return type_node_check_conformities_UorL (node, iface_node, support_interfaces, support_prerequisites, FALSE);
+
+  /* a racing read may miss an entry that was just added, but never
+   * sees a wrong one
+   */
+  cache = conformity_cache_get (node);
+  if (cache && cache[conformity_cache_slot (NODE_TYPE (iface_node))] == NODE_TYPE (iface_node))
+    return TRUE;
+
+  if (NODE_IS_IFACE (iface_node) && type_lookup_iface_vtable_I (node, iface_node, NULL))
+    {
+      type_node_remember_conformity_U (node, NODE_TYPE (iface_node));
+      return TRUE;
+    }
+
+  /* instantiatable types are not interfaces, so there are no
+   * prerequisites to look at
+   */
+  return FALSE;
 }
 
 /**
@@ -215,6 +215,105 @@ properties_notify (void)
   g_object_unref (obj);
 }
 
+static void
+on_notify_batch (GObject     *gobject,
+                 guint        n_pspecs,
+                 GParamSpec **pspecs,
+                 GPtrArray   *batches)
+{
+  GPtrArray *batch = g_ptr_array_new ();
+  guint i;
+
+  for (i = 0; i < n_pspecs; i++)
+    g_ptr_array_add (batch, pspecs[i]);
+  g_ptr_array_add (batches, batch);
+}
+
+static gboolean
+batch_contains (GPtrArray  *batch,
+                GParamSpec *pspec)
+{
+  guint i;
+
+  for (i = 0; i < batch->len; i++)
+    if (g_ptr_array_index (batch, i) == pspec)
+      return TRUE;
+
+  return FALSE;
+}
+
+static void
+properties_notify_batch (void)
+{
+  TestObject *obj = g_object_new (test_object_get_type (), NULL);
+  GPtrArray *batches, *batch;
+
+  batches = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+  g_signal_connect (obj, "notify-batch", G_CALLBACK (on_notify_batch), batches);
+
+  /* unfrozen notifications come one at a time */
+  g_object_set (obj, "foo", 47, NULL);
+  g_assert_cmpint (batches->len, ==, 1);
+  batch = g_ptr_array_index (batches, 0);
+  g_assert_cmpint (batch->len, ==, 1);
+  g_assert (g_ptr_array_index (batch, 0) == properties[PROP_FOO]);
+  g_ptr_array_set_size (batches, 0);
+
+  /* frozen ones are collected, once per property */
+  g_object_freeze_notify (G_OBJECT (obj));
+  g_object_set (obj, "foo", 48, "baz", "boo", NULL);
+  g_object_set (obj, "foo", 49, "bar", FALSE, NULL);
+  g_object_notify_by_pspec (G_OBJECT (obj), properties[PROP_BAZ]);
+  g_assert_cmpint (batches->len, ==, 0);
+  g_object_thaw_notify (G_OBJECT (obj));
+
+  g_assert_cmpint (batches->len, ==, 1);
+  batch = g_ptr_array_index (batches, 0);
+  g_assert_cmpint (batch->len, ==, 3);
+  g_assert (batch_contains (batch, properties[PROP_FOO]));
+  g_assert (batch_contains (batch, properties[PROP_BAR]));
+  g_assert (batch_contains (batch, properties[PROP_BAZ]));
+
+  g_object_unref (obj);
+  g_ptr_array_unref (batches);
+}
+
+static void
+on_notify_batch_set_bar (GObject     *gobject,
+                         guint        n_pspecs,
+                         GParamSpec **pspecs,
+                         GPtrArray   *batches)
+{
+  on_notify_batch (gobject, n_pspecs, pspecs, batches);
+
+  /* g_object_set() notifies even if the value does not change */
+  if (batches->len == 1)
+    g_object_set (gobject, "bar", FALSE, NULL);
+}
+
+static void
+properties_notify_batch_nested (void)
+{
+  TestObject *obj = g_object_new (test_object_get_type (), NULL);
+  GPtrArray *batches, *batch;
+
+  batches = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+  g_signal_connect (obj, "notify-batch", G_CALLBACK (on_notify_batch_set_bar), batches);
+
+  /* a property set from a handler is reported in a batch of its own */
+  g_object_set (obj, "foo", 47, NULL);
+  g_assert_cmpint (batches->len, ==, 2);
+  batch = g_ptr_array_index (batches, 0);
+  g_assert_cmpint (batch->len, ==, 1);
+  g_assert (g_ptr_array_index (batch, 0) == properties[PROP_FOO]);
+  batch = g_ptr_array_index (batches, 1);
+  g_assert_cmpint (batch->len, ==, 1);
+  g_assert (g_ptr_array_index (batch, 0) == properties[PROP_BAR]);
+
+  g_object_unref (obj);
+  g_ptr_array_unref (batches);
+}
+
 static void
 properties_construct (void)
 {
@@ -260,6 +359,176 @@ properties_construct (void)
   g_object_unref (obj);
 }
 
+static void
+check_test_object (TestObject  *obj,
+                   gint         foo,
+                   gboolean     bar,
+                   const gchar *baz)
+{
+  g_assert_cmpint (obj->foo, ==, foo);
+  g_assert (obj->bar == bar);
+  g_assert_cmpstr (obj->baz, ==, baz);
+  g_object_unref (obj);
+}
+
+static void
+properties_construct_repeated (void)
+{
+  gchar *name;
+  gint i;
+
+  /* the same sequences of names over and over, some of them sharing
+   * a prefix with others, and names that are built at runtime
+   */
+  for (i = 0; i < 3; i++)
+    {
+      check_test_object (g_object_new (test_object_get_type (),
+                                       "foo", i, "bar", FALSE, NULL),
+                         i, FALSE, "Hello");
+      check_test_object (g_object_new (test_object_get_type (),
+                                       "foo", i + 1, "baz", "boo", NULL),
+                         i + 1, TRUE, "boo");
+      check_test_object (g_object_new (test_object_get_type (),
+                                       "foo", i + 2, NULL),
+                         i + 2, TRUE, "Hello");
+      check_test_object (g_object_new (test_object_get_type (),
+                                       "foo", i + 3, "bar", FALSE, "baz", NULL, NULL),
+                         i + 3, FALSE, NULL);
+
+      if (i % 2)
+        {
+          name = g_strdup ("baz");
+          check_test_object (g_object_new (test_object_get_type (),
+                                           "bar", FALSE, name, "moo", NULL),
+                             42, FALSE, "moo");
+        }
+      else
+        {
+          name = g_strdup ("foo");
+          check_test_object (g_object_new (test_object_get_type (),
+                                           "bar", FALSE, name, i, NULL),
+                             i, FALSE, "Hello");
+        }
+      g_free (name);
+    }
+}
+
+static void
+properties_construct_many (void)
+{
+  GParameter params[2] = { { "foo", G_VALUE_INIT }, { "baz", G_VALUE_INIT } };
+  GObject *objects[600];
+  gpointer survivor;
+  gint i;
+
+  g_value_init (&params[0].value, G_TYPE_INT);
+  g_value_set_int (&params[0].value, 7);
+  g_value_init (&params[1].value, G_TYPE_STRING);
+  g_value_set_static_string (&params[1].value, "many");
+
+  /* more than fit in one block */
+  g_object_newv_many (test_object_get_type (), 2, params, G_N_ELEMENTS (objects), objects);
+
+  for (i = 0; i < G_N_ELEMENTS (objects); i++)
+    {
+      TestObject *obj = (TestObject *) objects[i];
+
+      g_assert (G_TYPE_CHECK_INSTANCE_TYPE (obj, test_object_get_type ()));
+      g_assert_cmpint (objects[i]->ref_count, ==, 1);
+      g_assert_cmpint (obj->foo, ==, 7);
+      g_assert (obj->bar);
+      g_assert_cmpstr (obj->baz, ==, "many");
+    }
+
+  /* the parameters are not consumed */
+  g_assert_cmpint (g_value_get_int (&params[0].value), ==, 7);
+  g_assert_cmpstr (g_value_get_string (&params[1].value), ==, "many");
+
+  /* members can outlive the others in their block */
+  survivor = objects[300];
+  g_object_add_weak_pointer (survivor, &survivor);
+  objects[300] = g_object_ref (objects[299]);
+  g_object_unref_many (objects, G_N_ELEMENTS (objects));
+
+  g_assert (survivor != NULL);
+  g_object_set (survivor, "foo", 8, NULL);
+  g_assert_cmpint (((TestObject *) survivor)->foo, ==, 8);
+  g_object_unref (survivor);
+  g_assert (survivor == NULL);
+
+  g_object_newv_many (test_object_get_type (), 0, NULL, 3, objects);
+  for (i = 0; i < 3; i++)
+    {
+      TestObject *obj = (TestObject *) objects[i];
+
+      g_assert_cmpint (obj->foo, ==, 42);
+      g_assert (obj->bar);
+      g_assert_cmpstr (obj->baz, ==, "Hello");
+    }
+  g_object_unref_many (objects, 3);
+
+  g_value_unset (&params[0].value);
+  g_value_unset (&params[1].value);
+}
+
+typedef GObject AbstractObject;
+typedef GObjectClass AbstractObjectClass;
+
+static GType abstract_object_get_type (void);
+G_DEFINE_ABSTRACT_TYPE (AbstractObject, abstract_object, G_TYPE_OBJECT);
+
+static void
+abstract_object_class_init (AbstractObjectClass *klass)
+{
+}
+
+static void
+abstract_object_init (AbstractObject *self)
+{
+}
+
+static void
+properties_construct_many_abstract_subprocess (void)
+{
+  GObject *objects[2];
+
+  g_object_newv_many (abstract_object_get_type (), 0, NULL, G_N_ELEMENTS (objects), objects);
+}
+
+static void
+properties_construct_many_abstract (void)
+{
+  /* abstract types are refused just like by g_object_newv() */
+  g_test_trap_subprocess ("/properties/construct-many/abstract/subprocess", 0, 0);
+  g_test_trap_assert_failed ();
+  g_test_trap_assert_stderr ("*cannot create instance of abstract*AbstractObject*");
+}
+
+static void
+properties_invalid (void)
+{
+  TestObject *obj;
+
+  obj = g_object_new (test_object_get_type (), "foo", 3, NULL);
+
+  /* the warning shows the value that was passed, not the clamped one */
+  g_test_expect_message ("GLib-GObject", G_LOG_LEVEL_WARNING,
+                         "value \"-5\" of type 'gint' is invalid or out of range for property 'foo'*");
+  g_object_set (obj, "foo", -5, NULL);
+  g_test_assert_expected_messages ();
+  g_assert_cmpint (obj->foo, ==, 3);
+
+  g_object_unref (obj);
+
+  g_test_expect_message ("GLib-GObject", G_LOG_LEVEL_WARNING,
+                         "value \"-7\" of type 'gint' is invalid or out of range for property 'foo'*");
+  obj = g_object_new (test_object_get_type (), "foo", -7, NULL);
+  g_test_assert_expected_messages ();
+  g_assert_cmpint (obj->foo, ==, 42);
+
+  g_object_unref (obj);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -269,7 +538,15 @@ main (int argc, char *argv[])
 
   g_test_add_func ("/properties/install", properties_install);
   g_test_add_func ("/properties/notify", properties_notify);
+  g_test_add_func ("/properties/notify-batch", properties_notify_batch);
+  g_test_add_func ("/properties/notify-batch-nested", properties_notify_batch_nested);
   g_test_add_func ("/properties/construct", properties_construct);
+  g_test_add_func ("/properties/construct-repeated", properties_construct_repeated);
+  g_test_add_func ("/properties/construct-many", properties_construct_many);
+  g_test_add_func ("/properties/construct-many/abstract", properties_construct_many_abstract);
+  g_test_add_func ("/properties/construct-many/abstract/subprocess",
+                   properties_construct_many_abstract_subprocess);
+  g_test_add_func ("/properties/invalid", properties_invalid);
 
   return g_test_run ();
 }
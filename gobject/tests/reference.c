@@ -355,6 +355,57 @@ test_weak_ref (void)
   g_free (dynamic_weak);
 }
 
+typedef struct
+{
+  GWeakRef weak;
+  gboolean revive;
+} WeakRefInDispose;
+
+static void
+weak_ref_in_dispose (gpointer  data,
+                     GObject  *where_the_object_was)
+{
+  WeakRefInDispose *d = data;
+
+  /* weak references taken before dispose are already empty */
+  g_assert (g_weak_ref_get (&d->weak) == NULL);
+
+  g_weak_ref_set (&d->weak, where_the_object_was);
+  if (d->revive)
+    g_object_ref (where_the_object_was);
+}
+
+static void
+test_weak_ref_on_dispose (void)
+{
+  WeakRefInDispose d;
+  GObject *obj;
+  GObject *tmp;
+
+  /* a weak reference taken during dispose is cleared on finalize */
+  obj = g_object_new (G_TYPE_OBJECT, NULL);
+  g_weak_ref_init (&d.weak, obj);
+  d.revive = FALSE;
+  g_object_weak_ref (obj, weak_ref_in_dispose, &d);
+  g_object_unref (obj);
+  g_assert (g_weak_ref_get (&d.weak) == NULL);
+  g_weak_ref_clear (&d.weak);
+
+  /* ... and keeps working if dispose revives the object */
+  obj = g_object_new (G_TYPE_OBJECT, NULL);
+  g_weak_ref_init (&d.weak, obj);
+  d.revive = TRUE;
+  g_object_weak_ref (obj, weak_ref_in_dispose, &d);
+  g_object_unref (obj);
+  g_assert_cmpint (obj->ref_count, ==, 1);
+  tmp = g_weak_ref_get (&d.weak);
+  g_assert (tmp == obj);
+  g_object_unref (tmp);
+  g_object_unref (obj);
+  g_assert (g_weak_ref_get (&d.weak) == NULL);
+  g_weak_ref_clear (&d.weak);
+}
+
 typedef struct
 {
   gboolean should_be_last;
@@ -608,6 +659,7 @@ main (int argc, char **argv)
   g_test_add_func ("/object/initially-unowned", test_initially_unowned);
   g_test_add_func ("/object/weak-pointer", test_weak_pointer);
   g_test_add_func ("/object/weak-ref", test_weak_ref);
+  g_test_add_func ("/object/weak-ref/on-dispose", test_weak_ref_on_dispose);
   g_test_add_func ("/object/toggle-ref", test_toggle_ref);
   g_test_add_func ("/object/qdata", test_object_qdata);
   g_test_add_func ("/object/qdata2", test_object_qdata2);
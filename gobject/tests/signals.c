@@ -1039,6 +1039,109 @@ test_stop_emission (void)
   g_object_unref (test1);
 }
 
+static GArray *handler_order;
+
+static void
+record_handler (gpointer instance, gpointer data)
+{
+  gint value = GPOINTER_TO_INT (data);
+
+  g_array_append_val (handler_order, value);
+}
+
+static void
+test_many_handlers (void)
+{
+  GObject *test1;
+  gulong ids[1000];
+  gulong handler;
+  guint notify_id;
+  GQuark foo, bar;
+  guint n;
+  gint i;
+
+  test1 = g_object_new (test_get_type (), NULL);
+  handler_order = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  for (i = 0; i < 1000; i++)
+    ids[i] = g_signal_connect (test1, "simple", G_CALLBACK (record_handler), GINT_TO_POINTER (i % 10));
+
+  n = g_signal_handlers_disconnect_by_func (test1, record_handler, GINT_TO_POINTER (3));
+  g_assert_cmpuint (n, ==, 100);
+  for (i = 5; i < 1000; i += 20)
+    g_signal_handler_disconnect (test1, ids[i]);
+  for (i = 0; i < 1000; i++)
+    g_assert (g_signal_handler_is_connected (test1, ids[i]) == (i % 10 != 3 && i % 20 != 5));
+
+  /* the remaining handlers still run in the order they were connected */
+  g_signal_emit (test1, simple_id, 0);
+  n = 0;
+  for (i = 0; i < 1000; i++)
+    if (i % 10 != 3 && i % 20 != 5)
+      g_assert_cmpint (g_array_index (handler_order, gint, n++), ==, i % 10);
+  g_assert_cmpuint (handler_order->len, ==, n);
+
+  handler = g_signal_handler_find (test1, G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, GINT_TO_POINTER (7));
+  g_assert_cmpuint (handler, ==, ids[7]);
+  handler = g_signal_handler_find (test1, G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, GINT_TO_POINTER (3));
+  g_assert_cmpuint (handler, ==, 0);
+
+  notify_id = g_signal_lookup ("notify", G_TYPE_OBJECT);
+  foo = g_quark_from_static_string ("foo");
+  bar = g_quark_from_static_string ("bar");
+  g_assert (!g_signal_has_handler_pending (test1, notify_id, foo, TRUE));
+  handler = g_signal_connect (test1, "notify::foo", G_CALLBACK (record_handler), NULL);
+  g_assert (g_signal_has_handler_pending (test1, notify_id, foo, FALSE));
+  g_assert (!g_signal_has_handler_pending (test1, notify_id, bar, TRUE));
+  g_signal_handler_block (test1, handler);
+  g_assert (!g_signal_has_handler_pending (test1, notify_id, foo, FALSE));
+  g_assert (g_signal_has_handler_pending (test1, notify_id, foo, TRUE));
+  g_signal_handler_disconnect (test1, handler);
+  g_assert (!g_signal_has_handler_pending (test1, notify_id, foo, TRUE));
+
+  g_object_unref (test1);
+  g_array_free (handler_order, TRUE);
+}
+
+static void
+test_unhandled_emission (void)
+{
+  GObject *objects[100];
+  gulong ids[100];
+  gint i;
+
+  handler_order = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  for (i = 0; i < 100; i++)
+    {
+      objects[i] = g_object_new (test_get_type (), NULL);
+      g_signal_emit (objects[i], simple_id, 0);
+      g_assert (!g_signal_has_handler_pending (objects[i], simple_id, 0, TRUE));
+    }
+  g_assert_cmpuint (handler_order->len, ==, 0);
+
+  /* connect to every object, then disconnect from every other one;
+   * emissions must keep finding the handlers that remain
+   */
+  for (i = 0; i < 100; i++)
+    ids[i] = g_signal_connect (objects[i], "simple", G_CALLBACK (record_handler), GINT_TO_POINTER (i));
+  for (i = 0; i < 100; i += 2)
+    g_signal_handler_disconnect (objects[i], ids[i]);
+
+  for (i = 0; i < 100; i++)
+    {
+      g_assert (g_signal_has_handler_pending (objects[i], simple_id, 0, TRUE) == (i % 2 == 1));
+      g_signal_emit (objects[i], simple_id, 0);
+    }
+  g_assert_cmpuint (handler_order->len, ==, 50);
+  for (i = 0; i < 50; i++)
+    g_assert_cmpint (g_array_index (handler_order, gint, i), ==, 2 * i + 1);
+
+  for (i = 0; i < 100; i++)
+    g_object_unref (objects[i]);
+  g_array_free (handler_order, TRUE);
+}
+
 /* --- */
 
 int
@@ -1061,6 +1164,8 @@ main (int argc,
   g_test_add_func ("/gobject/signals/introspection", test_introspection);
   g_test_add_func ("/gobject/signals/block-handler", test_block_handler);
   g_test_add_func ("/gobject/signals/stop-emission", test_stop_emission);
+  g_test_add_func ("/gobject/signals/many-handlers", test_many_handlers);
+  g_test_add_func ("/gobject/signals/unhandled-emission", test_unhandled_emission);
 
   return g_test_run ();
 }
@@ -335,6 +335,94 @@ test_threaded_weak_ref (void)
              get_wins, unref_wins);
 }
 
+typedef struct {
+    GWeakRef weak;
+    volatile gint stop;
+    volatile gint n_toggles;
+} WeakRefTogglesData;
+
+static gpointer
+get_weak_ref_in_thread (gpointer p)
+{
+  WeakRefTogglesData *data = p;
+  GObject *obj;
+
+  while (!g_atomic_int_get (&data->stop))
+    {
+      obj = g_weak_ref_get (&data->weak);
+      if (obj != NULL)
+        g_object_unref (obj);
+    }
+
+  return NULL;
+}
+
+static void
+count_toggles (gpointer  data,
+               GObject  *object,
+               gboolean  is_last_ref)
+{
+  WeakRefTogglesData *d = data;
+
+  g_atomic_int_inc (&d->n_toggles);
+}
+
+/* A reader must never take a reference on an object the weak reference
+ * it was given does not point to, even when the weak reference is
+ * cleared and its entry reused for another object under its feet.
+ */
+static void
+test_threaded_weak_ref_toggles (void)
+{
+  WeakRefTogglesData data;
+  GThread *thread;
+  guint i;
+  guint n;
+
+  if (g_test_thorough ())
+    n = NUM_COUNTER_INCREMENTS;
+  else
+    n = NUM_COUNTER_INCREMENTS / 20;
+
+  g_weak_ref_init (&data.weak, NULL);
+  data.stop = FALSE;
+  data.n_toggles = 0;
+
+  thread = g_thread_new ("weak-ref-get", get_weak_ref_in_thread, &data);
+
+  for (i = 0; i < n; i++)
+    {
+      GObject *plain;
+      GObject *toggled;
+      GWeakRef other;
+
+      plain = g_object_new (G_TYPE_OBJECT, NULL);
+      g_weak_ref_set (&data.weak, plain);
+      g_weak_ref_set (&data.weak, NULL);
+      g_object_unref (plain);
+
+      /* only held by its toggle reference; the weak reference entry
+       * that just went away is the first one to be reused
+       */
+      toggled = g_object_new (G_TYPE_OBJECT, NULL);
+      g_object_add_toggle_ref (toggled, count_toggles, &data);
+      g_object_unref (toggled);
+      g_atomic_int_set (&data.n_toggles, 0);
+
+      g_weak_ref_init (&other, toggled);
+      g_thread_yield ();
+      g_weak_ref_clear (&other);
+
+      g_assert_cmpint (g_atomic_int_get (&data.n_toggles), ==, 0);
+
+      g_object_remove_toggle_ref (toggled, count_toggles, &data);
+    }
+
+  g_atomic_int_set (&data.stop, TRUE);
+  g_thread_join (thread);
+  g_weak_ref_clear (&data.weak);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -344,6 +432,7 @@ main (int   argc,
   /* g_test_add_func ("/GObject/threaded-class-init", test_threaded_class_init); */
   g_test_add_func ("/GObject/threaded-object-init", test_threaded_object_init);
   g_test_add_func ("/GObject/threaded-weak-ref", test_threaded_weak_ref);
+  g_test_add_func ("/GObject/threaded-weak-ref/toggles", test_threaded_weak_ref_toggles);
 
   return g_test_run();
 }
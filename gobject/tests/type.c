@@ -138,6 +138,63 @@ test_next_base (void)
   g_assert (type == G_TYPE_INITIALLY_UNOWNED);
 }
 
+static void
+dummy_iface_init (gpointer g_iface,
+                  gpointer iface_data)
+{
+}
+
+static void
+test_interface_conformity (void)
+{
+  static const GTypeInfo iface_info = { sizeof (GTypeInterface) };
+  static const GTypeInfo object_info = { sizeof (GObjectClass), NULL, NULL, NULL, NULL, NULL, sizeof (GObject) };
+  static const GInterfaceInfo implementation = { dummy_iface_init };
+  GType ifaces[20];
+  GType parent_type, child_type;
+  GObject *parent, *child;
+  gint i, round;
+
+  /* more interfaces than instances remember, so that some of them
+   * have to share
+   */
+  for (i = 0; i < G_N_ELEMENTS (ifaces); i++)
+    {
+      gchar *name = g_strdup_printf ("ConformityIface%d", i);
+
+      ifaces[i] = g_type_register_static (G_TYPE_INTERFACE, name, &iface_info, 0);
+      g_free (name);
+    }
+
+  parent_type = g_type_register_static (G_TYPE_OBJECT, "ConformityParent", &object_info, 0);
+  child_type = g_type_register_static (parent_type, "ConformityChild", &object_info, 0);
+  for (i = 0; i < G_N_ELEMENTS (ifaces); i++)
+    {
+      if (i % 2 == 0)
+        g_type_add_interface_static (parent_type, ifaces[i], &implementation);
+      else if (i % 3 == 0)
+        g_type_add_interface_static (child_type, ifaces[i], &implementation);
+    }
+
+  parent = g_object_new (parent_type, NULL);
+  child = g_object_new (child_type, NULL);
+
+  for (round = 0; round < 3; round++)
+    for (i = 0; i < G_N_ELEMENTS (ifaces); i++)
+      {
+        g_assert (G_TYPE_CHECK_INSTANCE_TYPE (parent, ifaces[i]) == (i % 2 == 0));
+        g_assert (G_TYPE_CHECK_INSTANCE_TYPE (child, ifaces[i]) == (i % 2 == 0 || i % 3 == 0));
+        g_assert (g_type_is_a (child_type, ifaces[i]) == (i % 2 == 0 || i % 3 == 0));
+        g_assert (!G_TYPE_CHECK_CLASS_TYPE (G_OBJECT_GET_CLASS (child), ifaces[i]));
+      }
+
+  g_assert (G_TYPE_CHECK_INSTANCE_TYPE (child, parent_type));
+  g_assert (!G_TYPE_CHECK_INSTANCE_TYPE (parent, child_type));
+
+  g_object_unref (child);
+  g_object_unref (parent);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -147,6 +204,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/type/interface-prerequisite", test_interface_prerequisite);
   g_test_add_func ("/type/interface-check", test_interface_check);
   g_test_add_func ("/type/next-base", test_next_base);
+  g_test_add_func ("/type/interface-conformity", test_interface_conformity);
 
   return g_test_run ();
 }
@@ -0,0 +1,102 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2013 GLib contributors
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General
+# Public License along with this library; if not, write to the
+# Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+# Boston, MA 02111-1307, USA.
+
+"""Compare two result files of the GObject performance tests.
+
+The files are the output of 'performance --format=json' or
+'performance-threaded --format=csv' (either format works) for two
+revisions.  Every test present in both is listed with its relative
+change, and the script exits with status 1 if any of them got worse by
+more than the threshold.
+"""
+
+import csv
+import json
+import optparse
+import sys
+
+def load_results(filename):
+    with open(filename) as f:
+        data = f.read()
+
+    if data.lstrip().startswith('{'):
+        rows = json.loads(data)['results']
+    else:
+        rows = list(csv.DictReader(data.splitlines()))
+        for row in rows:
+            row['value'] = float(row['value'])
+            row['higher_is_better'] = row['higher_is_better'] not in ('0', 'false')
+
+    results = {}
+    order = []
+    for row in rows:
+        results[row['name']] = row
+        order.append(row['name'])
+    return results, order
+
+def main():
+    parser = optparse.OptionParser(usage='%prog [options] OLD NEW')
+    parser.add_option('-t', '--threshold', type='float', default=5.0,
+                      help='percentage by which a result may get worse '
+                           'before it counts as a regression (default: 5)')
+    options, args = parser.parse_args()
+    if len(args) != 2:
+        parser.error('expected two result files')
+
+    old, old_order = load_results(args[0])
+    new, new_order = load_results(args[1])
+
+    regressions = []
+    print('%-32s %14s %14s %9s' % ('test', 'old', 'new', 'change'))
+    for name in old_order:
+        if name not in new:
+            print('%-32s %14s' % (name, 'missing in new results'))
+            continue
+
+        old_value = old[name]['value']
+        new_value = new[name]['value']
+        if old_value == 0:
+            continue
+
+        # positive is an improvement, whichever way the unit goes
+        change = (new_value - old_value) / old_value * 100
+        if not old[name]['higher_is_better']:
+            change = -change
+
+        status = ''
+        if change < -options.threshold:
+            status = '  REGRESSION'
+            regressions.append(name)
+
+        print('%-32s %14.3f %14.3f %+8.1f%%%s  %s' %
+              (name, old_value, new_value, change, status, old[name]['unit']))
+
+    for name in new_order:
+        if name not in old:
+            print('%-32s %14s' % (name, 'new test'))
+
+    if regressions:
+        print('\n%d regression(s) beyond %.1f%%: %s' %
+              (len(regressions), options.threshold, ', '.join(regressions)))
+        return 1
+
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
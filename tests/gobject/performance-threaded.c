@@ -21,6 +21,7 @@
 #include <string.h>
 #include <glib-object.h>
 #include "testcommon.h"
+#include "perfreport.h"
 
 #define DEFAULT_TEST_TIME 2 /* seconds */
 
@@ -138,6 +139,288 @@ liststore_interface_peek_same_run (gpointer klass)
     }
 }
 
+/* test emitting signals on a different object in every thread */
+
+static GType emission_object;
+static guint emission_signal;
+
+static gpointer
+emission_unhandled_setup (void)
+{
+  static volatile gsize inited = 0;
+  if (g_once_init_enter (&inited))
+    {
+      emission_object = simple_register_class ("EmissionObject", G_TYPE_OBJECT, (GType) 0);
+      emission_signal = g_signal_new ("signal", emission_object, G_SIGNAL_RUN_LAST,
+                                      0, NULL, NULL, NULL, G_TYPE_NONE, 0);
+
+      g_once_init_leave (&inited, 1);
+    }
+  return g_object_new (emission_object, NULL);
+}
+
+static void
+emission_handler (GObject *object, gpointer data)
+{
+}
+
+static gpointer
+emission_handled_setup (void)
+{
+  GObject *object = emission_unhandled_setup ();
+
+  g_signal_connect (object, "signal", G_CALLBACK (emission_handler), NULL);
+  return object;
+}
+
+static void 
+emission_run (gpointer object)
+{
+  guint i;
+
+  for (i = 0; i < 1000; i++)
+    g_signal_emit (object, emission_signal, 0);
+}
+
+/* test finalizing weakly referenced objects while all threads also
+ * read a weak reference to an object they share
+ */
+
+static GType weak_ref_object;
+static GObject *weak_ref_shared;
+static GWeakRef weak_ref_shared_ref;
+
+static gpointer
+weak_ref_setup (void)
+{
+  static volatile gsize inited = 0;
+  if (g_once_init_enter (&inited))
+    {
+      weak_ref_object = simple_register_class ("WeakRefObject", G_TYPE_OBJECT, (GType) 0);
+      weak_ref_shared = g_object_new (weak_ref_object, NULL);
+      g_weak_ref_init (&weak_ref_shared_ref, weak_ref_shared);
+
+      g_once_init_leave (&inited, 1);
+    }
+  return NULL;
+}
+
+static void
+weak_ref_get_run (gpointer data)
+{
+  guint i;
+
+  for (i = 0; i < 1000; i++)
+    {
+      GObject *object = g_weak_ref_get (&weak_ref_shared_ref);
+
+      g_assert (object == weak_ref_shared);
+      g_object_unref (object);
+    }
+}
+
+static void
+weak_ref_unref_run (gpointer data)
+{
+  guint i;
+
+  for (i = 0; i < 1000; i++)
+    {
+      GObject *object = g_object_new (weak_ref_object, NULL);
+      GObject *shared;
+      GWeakRef weak;
+
+      g_weak_ref_init (&weak, object);
+      shared = g_weak_ref_get (&weak_ref_shared_ref);
+      g_object_unref (shared);
+      g_object_unref (object);
+      g_assert (g_weak_ref_get (&weak) == NULL);
+      g_weak_ref_clear (&weak);
+    }
+}
+
+/* tests for common operations, mostly on a different object in every
+ * thread
+ */
+
+typedef struct _PropertyObject      PropertyObject;
+typedef struct _PropertyObjectClass PropertyObjectClass;
+
+struct _PropertyObject
+{
+  GObject parent_instance;
+  int value;
+};
+
+struct _PropertyObjectClass
+{
+  GObjectClass parent_class;
+};
+
+static GType property_object_get_type (void);
+G_DEFINE_TYPE (PropertyObject, property_object, G_TYPE_OBJECT)
+
+static GParamSpec *property_object_value;
+
+static void
+property_object_set_property (GObject      *object,
+                              guint         prop_id,
+                              const GValue *value,
+                              GParamSpec   *pspec)
+{
+  ((PropertyObject *) object)->value = g_value_get_int (value);
+}
+
+static void
+property_object_get_property (GObject    *object,
+                              guint       prop_id,
+                              GValue     *value,
+                              GParamSpec *pspec)
+{
+  g_value_set_int (value, ((PropertyObject *) object)->value);
+}
+
+static void
+property_object_class_init (PropertyObjectClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->set_property = property_object_set_property;
+  object_class->get_property = property_object_get_property;
+
+  property_object_value = g_param_spec_int ("value", "value", "value",
+                                            0, G_MAXINT, 0,
+                                            G_PARAM_READWRITE);
+  g_object_class_install_property (object_class, 1, property_object_value);
+}
+
+static void
+property_object_init (PropertyObject *object)
+{
+}
+
+static GObject *property_object_shared;
+
+static gpointer
+property_object_setup (void)
+{
+  return g_object_new (property_object_get_type (), NULL);
+}
+
+static gpointer
+property_object_shared_setup (void)
+{
+  static volatile gsize inited = 0;
+  if (g_once_init_enter (&inited))
+    {
+      property_object_shared = g_object_new (property_object_get_type (), NULL);
+
+      g_once_init_leave (&inited, 1);
+    }
+  return g_object_ref (property_object_shared);
+}
+
+static void
+property_object_notify (GObject *object, GParamSpec *pspec, gpointer data)
+{
+}
+
+static gpointer
+property_object_notify_setup (void)
+{
+  GObject *object = property_object_setup ();
+
+  g_signal_connect (object, "notify::value", G_CALLBACK (property_object_notify), NULL);
+  return object;
+}
+
+static gpointer
+property_object_bind_setup (void)
+{
+  GObject *object = property_object_setup ();
+  GObject *target = property_object_setup ();
+
+  g_object_bind_property (object, "value", target, "value", G_BINDING_DEFAULT);
+  g_object_set_data_full (object, "target", target, g_object_unref);
+  return object;
+}
+
+static void
+property_object_toggle_notify (gpointer data, GObject *object, gboolean is_last_ref)
+{
+}
+
+static gpointer
+property_object_toggle_setup (void)
+{
+  GObject *object = property_object_setup ();
+
+  g_object_add_toggle_ref (object, property_object_toggle_notify, NULL);
+  g_object_unref (object);
+  return object;
+}
+
+static void
+property_object_toggle_teardown (gpointer object)
+{
+  g_object_remove_toggle_ref (object, property_object_toggle_notify, NULL);
+}
+
+static gpointer
+construction_setup (void)
+{
+  return g_type_class_ref (property_object_get_type ());
+}
+
+static void
+construction_run (gpointer data)
+{
+  guint i;
+
+  for (i = 0; i < 1000; i++)
+    g_object_unref (g_object_new (property_object_get_type (), NULL));
+}
+
+static void
+property_set_run (gpointer object)
+{
+  guint i;
+
+  for (i = 0; i < 1000; i++)
+    g_object_set (object, "value", i, NULL);
+}
+
+static void
+property_get_run (gpointer object)
+{
+  guint i;
+  int value;
+
+  for (i = 0; i < 1000; i++)
+    g_object_get (object, "value", &value, NULL);
+}
+
+static void
+notify_run (gpointer object)
+{
+  guint i;
+
+  for (i = 0; i < 1000; i++)
+    g_object_notify_by_pspec (object, property_object_value);
+}
+
+static void
+toggle_ref_run (gpointer object)
+{
+  guint i;
+
+  for (i = 0; i < 1000; i++)
+    {
+      g_object_ref (object);
+      g_object_unref (object);
+    }
+}
+
 #if 0
 /* DUMB test doing nothing */
 
@@ -189,6 +472,61 @@ static const PerformanceTest tests[] = {
     liststore_interface_peek_same_run,
     no_reset,
     g_type_class_unref },
+  { "emit-unhandled",
+    emission_unhandled_setup,
+    emission_run,
+    no_reset,
+    g_object_unref },
+  { "emit-handled",
+    emission_handled_setup,
+    emission_run,
+    no_reset,
+    g_object_unref },
+  { "weak-ref-get",
+    weak_ref_setup,
+    weak_ref_get_run,
+    no_reset,
+    no_teardown },
+  { "weak-ref-unref",
+    weak_ref_setup,
+    weak_ref_unref_run,
+    no_reset,
+    no_teardown },
+  { "construction",
+    construction_setup,
+    construction_run,
+    no_reset,
+    g_type_class_unref },
+  { "property-get",
+    property_object_setup,
+    property_get_run,
+    no_reset,
+    g_object_unref },
+  { "property-set",
+    property_object_setup,
+    property_set_run,
+    no_reset,
+    g_object_unref },
+  { "property-set-shared",
+    property_object_shared_setup,
+    property_set_run,
+    no_reset,
+    g_object_unref },
+  { "notify",
+    property_object_notify_setup,
+    notify_run,
+    no_reset,
+    g_object_unref },
+  { "toggle-ref",
+    property_object_toggle_setup,
+    toggle_ref_run,
+    no_reset,
+    property_object_toggle_teardown },
+  { "bind-property",
+    property_object_bind_setup,
+    property_set_run,
+    no_reset,
+    g_object_unref },
 #if 0
   { "nothing",
     no_setup,
@@ -265,7 +603,8 @@ compare_doubles (gconstpointer a, gconstpointer b)
 }
 
 static void
-print_results (GArray *array)
+print_results (const PerformanceTest *test,
+               GArray                *array)
 {
   double min, max, avg;
   guint i;
@@ -283,7 +622,8 @@ print_results (GArray *array)
     }
   avg = avg / array->len * 1000;
 
-  g_print ("  %u runs, min/avg/max = %.3f/%.3f/%.3f ms\n", array->len, min, avg, max);
+  perf_report_message ("  %u runs, min/avg/max = %.3f/%.3f/%.3f ms\n", array->len, min, avg, max);
+  perf_report_result (test->name, NULL, avg, "ms", FALSE);
 }
 
 static void
@@ -291,7 +631,7 @@ run_test (const PerformanceTest *test)
 {
   GArray *results;
 
-  g_print ("Running test \"%s\"\n", test->name);
+  perf_report_message ("Running test \"%s\"\n", test->name);
 
   if (n_threads == 0) {
     results = run_test_thread ((gpointer) test);
@@ -315,7 +655,7 @@ run_test (const PerformanceTest *test)
     g_free (threads);
   }
 
-  print_results (results);
+  print_results (test, results);
   g_array_free (results, TRUE);
 }
 
@@ -342,7 +682,9 @@ main (int   argc,
 
   context = g_option_context_new ("GObject performance tests");
   g_option_context_add_main_entries (context, cmd_entries, NULL);
-  if (!g_option_context_parse (context, &argc, &argv, &error))
+  g_option_context_add_main_entries (context, perf_report_entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error) ||
+      !perf_report_begin ("performance-threaded", &error))
     {
       g_printerr ("%s: %s\n", argv[0], error->message);
       return 1;
@@ -372,5 +714,7 @@ main (int   argc,
 	run_test (&tests[i]);
     }
 
+  perf_report_end ();
+
   return 0;
 }
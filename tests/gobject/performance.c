@@ -21,6 +21,7 @@
 #include <string.h>
 #include <glib-object.h>
 #include "testcommon.h"
+#include "perfreport.h"
 
 #define WARM_UP_N_RUNS 50
 #define ESTIMATE_ROUND_TIME_N_RUNS 5
@@ -70,14 +71,14 @@ run_test (PerformanceTest *test)
   double elapsed, min_elapsed, factor;
   GTimer *timer;
 
-  g_print ("Running test %s\n", test->name);
+  perf_report_message ("Running test %s\n", test->name);
 
   /* Set up test */
   timer = g_timer_new ();
   data = test->setup (test);
 
   if (verbose)
-    g_print ("Warming up\n");
+    perf_report_message ("Warming up\n");
 
   /* Warm up the test by doing a few runs */
   for (i = 0; i < WARM_UP_N_RUNS; i++)
@@ -88,7 +89,7 @@ run_test (PerformanceTest *test)
     }
 
   if (verbose)
-    g_print ("Estimating round time\n");
+    perf_report_message ("Estimating round time\n");
 
   /* Estimate time for one run by doing a few test rounds */
   min_elapsed = 0;
@@ -110,13 +111,13 @@ run_test (PerformanceTest *test)
   factor = TARGET_ROUND_TIME / min_elapsed;
 
   if (verbose)
-    g_print ("Uncorrected round time: %f.4 secs, correction factor %f.2\n", min_elapsed, factor);
+    perf_report_message ("Uncorrected round time: %f.4 secs, correction factor %f.2\n", min_elapsed, factor);
 
   /* Calculate number of rounds needed */
   num_rounds = (test_length / TARGET_ROUND_TIME) + 1;
 
   if (verbose)
-    g_print ("Running %"G_GINT64_MODIFIER"d rounds\n", num_rounds);
+    perf_report_message ("Running %"G_GINT64_MODIFIER"d rounds\n", num_rounds);
 
   /* Run the test */
   for (i = 0; i < num_rounds; i++)
@@ -135,7 +136,7 @@ run_test (PerformanceTest *test)
     }
 
   if (verbose)
-    g_print ("Minimum corrected round time: %f secs\n", min_elapsed);
+    perf_report_message ("Minimum corrected round time: %f secs\n", min_elapsed);
 
   /* Print the results */
   test->print_result (test, data, min_elapsed);
@@ -514,8 +515,8 @@ test_construction_print_result (PerformanceTest *test,
 {
   struct ConstructionTest *data = _data;
 
-  g_print ("Number of constructed objects per second: %.0f\n",
-	   data->n_objects / time);
+  perf_report_result (test->name, "Number of constructed objects per second",
+                      data->n_objects / time, "objects/s", TRUE);
 }
 
 /*************************************************************
@@ -594,8 +595,8 @@ test_type_check_print_result (PerformanceTest *test,
 			      double time)
 {
   struct TypeCheckTest *data = _data;
-  g_print ("Million type checks per second: %.2f\n",
-	   data->n_checks / (1000*time));
+  perf_report_result (test->name, "Million type checks per second",
+                      data->n_checks / (1000*time), "Mchecks/s", TRUE);
 }
 
 static void
@@ -682,8 +683,8 @@ test_emission_unhandled_print_result (PerformanceTest *test,
 {
   struct EmissionTest *data = _data;
 
-  g_print ("Emissions per second: %.0f\n",
-	   data->n_checks / time);
+  perf_report_result (test->name, "Emissions per second",
+                      data->n_checks / time, "emissions/s", TRUE);
 }
 
 static void
@@ -755,8 +756,8 @@ test_emission_handled_print_result (PerformanceTest *test,
 {
   struct EmissionTest *data = _data;
 
-  g_print ("Emissions per second: %.0f\n",
-	   data->n_checks / time);
+  perf_report_result (test->name, "Emissions per second",
+                      data->n_checks / time, "emissions/s", TRUE);
 }
 
 static void
@@ -769,6 +770,293 @@ test_emission_handled_teardown (PerformanceTest *test,
   g_free (data);
 }
 
+/*************************************************************
+ * Test performance of common operations on one object
+ *************************************************************/
+
+#define NUM_OPERATIONS_PER_ROUND 10000
+
+struct OperationTest {
+  GObject *object;
+  GObject *peer;
+  GParamSpec *pspec;
+  GWeakRef weak_ref;
+  int n_operations;
+};
+
+static void
+test_operation_notify_handler (GObject    *object,
+                               GParamSpec *pspec,
+                               gpointer    data)
+{
+}
+
+static void
+test_operation_toggle_notify (gpointer  data,
+                              GObject  *object,
+                              gboolean  is_last_ref)
+{
+}
+
+static gpointer
+test_operation_setup (PerformanceTest *test)
+{
+  struct OperationTest *data;
+
+  data = g_new0 (struct OperationTest, 1);
+  data->object = g_object_new (COMPLEX_TYPE_OBJECT, NULL);
+  data->pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (data->object), "val2");
+
+  return data;
+}
+
+static gpointer
+test_notify_setup (PerformanceTest *test)
+{
+  struct OperationTest *data = test_operation_setup (test);
+
+  g_signal_connect (data->object, "notify::val2",
+                    G_CALLBACK (test_operation_notify_handler), NULL);
+
+  return data;
+}
+
+static gpointer
+test_weak_ref_setup (PerformanceTest *test)
+{
+  struct OperationTest *data = test_operation_setup (test);
+
+  g_weak_ref_init (&data->weak_ref, data->object);
+
+  return data;
+}
+
+static gpointer
+test_toggle_ref_setup (PerformanceTest *test)
+{
+  struct OperationTest *data = test_operation_setup (test);
+
+  /* leave the toggle reference as the only one */
+  g_object_add_toggle_ref (data->object, test_operation_toggle_notify, NULL);
+  g_object_unref (data->object);
+
+  return data;
+}
+
+static gpointer
+test_bind_property_setup (PerformanceTest *test)
+{
+  struct OperationTest *data = test_operation_setup (test);
+
+  data->peer = g_object_new (COMPLEX_TYPE_OBJECT, NULL);
+  g_object_bind_property (data->object, "val2", data->peer, "val2", G_BINDING_DEFAULT);
+
+  return data;
+}
+
+static void
+test_operation_init (PerformanceTest *test,
+                     gpointer _data,
+                     double factor)
+{
+  struct OperationTest *data = _data;
+
+  data->n_operations = factor * NUM_OPERATIONS_PER_ROUND;
+}
+
+static void
+test_property_get_run (PerformanceTest *test,
+                       gpointer _data)
+{
+  struct OperationTest *data = _data;
+  GObject *object = data->object;
+  int i, val;
+
+  for (i = 0; i < data->n_operations; i++)
+    g_object_get (object, "val2", &val, NULL);
+}
+
+static void
+test_property_set_run (PerformanceTest *test,
+                       gpointer _data)
+{
+  struct OperationTest *data = _data;
+  GObject *object = data->object;
+  int i;
+
+  for (i = 0; i < data->n_operations; i++)
+    g_object_set (object, "val2", i, NULL);
+}
+
+/* There is no public API to get or set a property through its
+ * GParamSpec, so this is the closest equivalent: a GValue and the
+ * interned name from the pspec, as language bindings do it.
+ */
+static void
+test_property_get_value_run (PerformanceTest *test,
+                             gpointer _data)
+{
+  struct OperationTest *data = _data;
+  GObject *object = data->object;
+  GValue value = G_VALUE_INIT;
+  int i;
+
+  g_value_init (&value, G_TYPE_INT);
+  for (i = 0; i < data->n_operations; i++)
+    g_object_get_property (object, data->pspec->name, &value);
+  g_value_unset (&value);
+}
+
+static void
+test_property_set_value_run (PerformanceTest *test,
+                             gpointer _data)
+{
+  struct OperationTest *data = _data;
+  GObject *object = data->object;
+  GValue value = G_VALUE_INIT;
+  int i;
+
+  g_value_init (&value, G_TYPE_INT);
+  for (i = 0; i < data->n_operations; i++)
+    {
+      g_value_set_int (&value, i);
+      g_object_set_property (object, data->pspec->name, &value);
+    }
+  g_value_unset (&value);
+}
+
+static void
+test_notify_run (PerformanceTest *test,
+                 gpointer _data)
+{
+  struct OperationTest *data = _data;
+  GObject *object = data->object;
+  int i;
+
+  for (i = 0; i < data->n_operations; i++)
+    g_object_notify_by_pspec (object, data->pspec);
+}
+
+static void
+test_notify_frozen_run (PerformanceTest *test,
+                        gpointer _data)
+{
+  struct OperationTest *data = _data;
+  GObject *object = data->object;
+  int i;
+
+  g_object_freeze_notify (object);
+  for (i = 0; i < data->n_operations; i++)
+    g_object_notify_by_pspec (object, data->pspec);
+  g_object_thaw_notify (object);
+}
+
+static void
+test_weak_ref_get_run (PerformanceTest *test,
+                       gpointer _data)
+{
+  struct OperationTest *data = _data;
+  int i;
+
+  for (i = 0; i < data->n_operations; i++)
+    g_object_unref (g_weak_ref_get (&data->weak_ref));
+}
+
+static void
+test_weak_ref_set_run (PerformanceTest *test,
+                       gpointer _data)
+{
+  struct OperationTest *data = _data;
+  GObject *object = data->object;
+  GWeakRef weak_ref;
+  int i;
+
+  for (i = 0; i < data->n_operations; i++)
+    {
+      g_weak_ref_init (&weak_ref, object);
+      g_weak_ref_clear (&weak_ref);
+    }
+}
+
+static void
+test_toggle_ref_run (PerformanceTest *test,
+                     gpointer _data)
+{
+  struct OperationTest *data = _data;
+  GObject *object = data->object;
+  int i;
+
+  /* every one of these toggles */
+  for (i = 0; i < data->n_operations; i++)
+    {
+      g_object_ref (object);
+      g_object_unref (object);
+    }
+}
+
+static void
+test_interface_cast_run (PerformanceTest *test,
+                         gpointer _data)
+{
+  struct OperationTest *data = _data;
+  GObject *object = data->object;
+  GType types[4];
+  int i;
+
+  types[0] = test_iface1_get_type ();
+  types[1] = test_iface2_get_type ();
+  types[2] = test_iface3_get_type ();
+  types[3] = test_iface4_get_type ();
+
+  for (i = 0; i < data->n_operations; i++)
+    {
+      TestIface *iface;
+
+      iface = G_TYPE_CHECK_INSTANCE_CAST (object, types[i % 4], TestIface);
+      G_TYPE_INSTANCE_GET_INTERFACE (iface, types[i % 4], TestIfaceClass)->method (iface);
+    }
+}
+
+static void
+test_operation_finish (PerformanceTest *test,
+                       gpointer data)
+{
+}
+
+static void
+test_operation_teardown (PerformanceTest *test,
+                         gpointer _data)
+{
+  struct OperationTest *data = _data;
+
+  g_weak_ref_clear (&data->weak_ref);
+  if (data->peer)
+    g_object_unref (data->peer);
+  g_object_unref (data->object);
+  g_free (data);
+}
+
+static void
+test_toggle_ref_teardown (PerformanceTest *test,
+                          gpointer _data)
+{
+  struct OperationTest *data = _data;
+
+  g_object_remove_toggle_ref (data->object, test_operation_toggle_notify, NULL);
+  g_free (data);
+}
+
+static void
+test_operation_print_result (PerformanceTest *test,
+                             gpointer _data,
+                             double time)
+{
+  struct OperationTest *data = _data;
+
+  perf_report_result (test->name, "Operations per second",
+                      data->n_operations / time, "operations/s", TRUE);
+}
+
 /*************************************************************
  * Main test code
  *************************************************************/
@@ -903,6 +1191,116 @@ static PerformanceTest tests[] = {
     test_emission_handled_finish,
     test_emission_handled_teardown,
     test_emission_handled_print_result
+  },
+  {
+    "property-get",
+    NULL,
+    test_operation_setup,
+    test_operation_init,
+    test_property_get_run,
+    test_operation_finish,
+    test_operation_teardown,
+    test_operation_print_result
+  },
+  {
+    "property-set",
+    NULL,
+    test_operation_setup,
+    test_operation_init,
+    test_property_set_run,
+    test_operation_finish,
+    test_operation_teardown,
+    test_operation_print_result
+  },
+  {
+    "property-get-value",
+    NULL,
+    test_operation_setup,
+    test_operation_init,
+    test_property_get_value_run,
+    test_operation_finish,
+    test_operation_teardown,
+    test_operation_print_result
+  },
+  {
+    "property-set-value",
+    NULL,
+    test_operation_setup,
+    test_operation_init,
+    test_property_set_value_run,
+    test_operation_finish,
+    test_operation_teardown,
+    test_operation_print_result
+  },
+  {
+    "notify",
+    NULL,
+    test_notify_setup,
+    test_operation_init,
+    test_notify_run,
+    test_operation_finish,
+    test_operation_teardown,
+    test_operation_print_result
+  },
+  {
+    "notify-frozen",
+    NULL,
+    test_notify_setup,
+    test_operation_init,
+    test_notify_frozen_run,
+    test_operation_finish,
+    test_operation_teardown,
+    test_operation_print_result
+  },
+  {
+    "weak-ref-get",
+    NULL,
+    test_weak_ref_setup,
+    test_operation_init,
+    test_weak_ref_get_run,
+    test_operation_finish,
+    test_operation_teardown,
+    test_operation_print_result
+  },
+  {
+    "weak-ref-set",
+    NULL,
+    test_operation_setup,
+    test_operation_init,
+    test_weak_ref_set_run,
+    test_operation_finish,
+    test_operation_teardown,
+    test_operation_print_result
+  },
+  {
+    "toggle-ref",
+    NULL,
+    test_toggle_ref_setup,
+    test_operation_init,
+    test_toggle_ref_run,
+    test_operation_finish,
+    test_toggle_ref_teardown,
+    test_operation_print_result
+  },
+  {
+    "bind-property",
+    NULL,
+    test_bind_property_setup,
+    test_operation_init,
+    test_property_set_run,
+    test_operation_finish,
+    test_operation_teardown,
+    test_operation_print_result
+  },
+  {
+    "interface-cast",
+    NULL,
+    test_operation_setup,
+    test_operation_init,
+    test_interface_cast_run,
+    test_operation_finish,
+    test_operation_teardown,
+    test_operation_print_result
   }
 };
 
@@ -928,7 +1326,9 @@ main (int   argc,
 
   context = g_option_context_new ("GObject performance tests");
   g_option_context_add_main_entries (context, cmd_entries, NULL);
-  if (!g_option_context_parse (context, &argc, &argv, &error))
+  g_option_context_add_main_entries (context, perf_report_entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error) ||
+      !perf_report_begin ("performance", &error))
     {
       g_printerr ("%s: %s\n", argv[0], error->message);
       return 1;
@@ -949,5 +1349,7 @@ main (int   argc,
 	run_test (&tests[i]);
     }
 
+  perf_report_end ();
+
   return 0;
 }
@@ -0,0 +1,181 @@
+/* GObject - GLib Type, Object, Parameter and Signal Library
+ * Copyright (C) 2013 GLib contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+
+#include "perfreport.h"
+
+typedef enum {
+  FORMAT_TEXT,
+  FORMAT_JSON,
+  FORMAT_CSV
+} ReportFormat;
+
+typedef struct {
+  char *test;
+  double value;
+  char *unit;
+  gboolean higher_is_better;
+} ReportResult;
+
+static char *format_name = NULL;
+static ReportFormat format = FORMAT_TEXT;
+static const char *suite_name;
+static GPtrArray *results;
+
+GOptionEntry perf_report_entries[] = {
+  {"format", 'f', 0, G_OPTION_ARG_STRING, &format_name,
+   "Output format: text (default), json or csv", "FORMAT"},
+  {NULL}
+};
+
+static void
+report_result_free (gpointer data)
+{
+  ReportResult *result = data;
+
+  g_free (result->test);
+  g_free (result->unit);
+  g_slice_free (ReportResult, result);
+}
+
+gboolean
+perf_report_begin (const char  *suite,
+                   GError     **error)
+{
+  if (format_name == NULL || strcmp (format_name, "text") == 0)
+    format = FORMAT_TEXT;
+  else if (strcmp (format_name, "json") == 0)
+    format = FORMAT_JSON;
+  else if (strcmp (format_name, "csv") == 0)
+    format = FORMAT_CSV;
+  else
+    {
+      g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                   "Unknown output format '%s'", format_name);
+      return FALSE;
+    }
+
+  suite_name = suite;
+  results = g_ptr_array_new_with_free_func (report_result_free);
+
+  return TRUE;
+}
+
+void
+perf_report_message (const char *message_format,
+                     ...)
+{
+  va_list args;
+  char *message;
+
+  va_start (args, message_format);
+  message = g_strdup_vprintf (message_format, args);
+  va_end (args);
+
+  if (format == FORMAT_TEXT)
+    g_print ("%s", message);
+  else
+    g_printerr ("%s", message);
+
+  g_free (message);
+}
+
+void
+perf_report_result (const char *test,
+                    const char *description,
+                    double      value,
+                    const char *unit,
+                    gboolean    higher_is_better)
+{
+  ReportResult *result;
+
+  if (format == FORMAT_TEXT && description != NULL)
+    g_print ("%s: %.*f\n", description, value < 100 ? 2 : 0, value);
+
+  result = g_slice_new (ReportResult);
+  result->test = g_strdup (test);
+  result->value = value;
+  result->unit = g_strdup (unit);
+  result->higher_is_better = higher_is_better;
+  g_ptr_array_add (results, result);
+}
+
+static void
+print_json_string (const char *str)
+{
+  g_print ("\"");
+  for (; *str; str++)
+    {
+      if (*str == '"' || *str == '\\')
+        g_print ("\\%c", *str);
+      else if ((guchar) *str < 0x20)
+        g_print ("\\u%04x", *str);
+      else
+        g_print ("%c", *str);
+    }
+  g_print ("\"");
+}
+
+void
+perf_report_end (void)
+{
+  char buf[G_ASCII_DTOSTR_BUF_SIZE];
+  guint i;
+
+  switch (format)
+    {
+    case FORMAT_TEXT:
+      break;
+
+    case FORMAT_JSON:
+      g_print ("{\n  \"suite\": ");
+      print_json_string (suite_name);
+      g_print (",\n  \"results\": [");
+      for (i = 0; i < results->len; i++)
+        {
+          ReportResult *result = g_ptr_array_index (results, i);
+
+          g_print ("%s\n    { \"name\": ", i ? "," : "");
+          print_json_string (result->test);
+          g_print (", \"value\": %s, \"unit\": ",
+                   g_ascii_dtostr (buf, sizeof buf, result->value));
+          print_json_string (result->unit);
+          g_print (", \"higher_is_better\": %s }",
+                   result->higher_is_better ? "true" : "false");
+        }
+      g_print ("\n  ]\n}\n");
+      break;
+
+    case FORMAT_CSV:
+      g_print ("name,value,unit,higher_is_better\n");
+      for (i = 0; i < results->len; i++)
+        {
+          ReportResult *result = g_ptr_array_index (results, i);
+
+          g_print ("%s,%s,%s,%d\n", result->test,
+                   g_ascii_dtostr (buf, sizeof buf, result->value),
+                   result->unit, result->higher_is_better);
+        }
+      break;
+    }
+
+  g_ptr_array_free (results, TRUE);
+  results = NULL;
+}
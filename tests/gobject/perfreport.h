@@ -0,0 +1,54 @@
+/* GObject - GLib Type, Object, Parameter and Signal Library
+ * Copyright (C) 2013 GLib contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __PERF_REPORT_H__
+#define __PERF_REPORT_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Result reporting shared by the performance tests.
+ *
+ * In the default "text" format results are printed as they come in,
+ * in the same human-readable form as always.  The "json" and "csv"
+ * formats print all results to stdout once perf_report_end() is
+ * called, and send progress messages to stderr instead, so that the
+ * output can be saved and fed to perf-compare.py.
+ *
+ * In text mode, results with a %NULL description are not printed, for
+ * tests that print their results in more detail themselves.
+ */
+
+extern GOptionEntry perf_report_entries[];
+
+gboolean perf_report_begin   (const char  *suite,
+                              GError     **error);
+void     perf_report_message (const char  *format,
+                              ...) G_GNUC_PRINTF (1, 2);
+void     perf_report_result  (const char  *test,
+                              const char  *description,
+                              double       value,
+                              const char  *unit,
+                              gboolean     higher_is_better);
+void     perf_report_end     (void);
+
+G_END_DECLS
+
+#endif /* __PERF_REPORT_H__ */
@@ -1,6 +1,24 @@
 #!/bin/sh
+# Usage: run-performance.sh [BASELINE.json] [-- PERFORMANCE-OPTIONS]
+#
+# Runs the performance tests on the current revision and saves the
+# results to perf-REVISION.json.  If a results file from an earlier
+# revision is given, the two are compared and the script fails if
+# anything regressed.
 DIR=`dirname $0`;
+BASELINE=
+if test $# -gt 0 && test "x$1" != "x--"; then
+  BASELINE=$1
+  shift
+fi
+if test "x$1" = "x--"; then
+  shift
+fi
 (cd $DIR; make performance)
 ID=`git rev-list --max-count=1 HEAD`
 echo "Testing revision ${ID}"
-$DIR/performance | tee "perf-${ID}.log"
+$DIR/performance --format=json "$@" > "perf-${ID}.json" || exit 1
+echo "Results saved to perf-${ID}.json"
+if test -n "${BASELINE}"; then
+  python $DIR/perf-compare.py "${BASELINE}" "perf-${ID}.json"
+fi
@@ -19,6 +19,7 @@
  */
 #include <glib.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #define N_THREADS	8
@@ -91,11 +92,130 @@ thread_func (void *arg)
   return NULL;
 }
 
+/* Throughput benchmark, run as "slice-concurrent --benchmark". Every
+ * thread keeps allocating batches of blocks sized like small GObject
+ * instances, and frees batches handed over by other threads. Run it with
+ * different G_SLICE settings, e.g. G_SLICE=per-cpu-caches,huge-pages, to
+ * compare allocator configurations.
+ */
+#define BENCH_BATCH     512
+#define BENCH_MSECS     500
+#define BENCH_THREADS   32
+
+typedef struct
+{
+  gpointer mem[BENCH_BATCH];
+  gsize    size[BENCH_BATCH];
+} Batch;
+
+static volatile gint bench_running = 0;
+static volatile gint bench_stop = 0;
+static Batch * volatile bench_exchange = NULL;
+
+static void
+batch_free (Batch *batch)
+{
+  int i;
+
+  for (i = 0; i < BENCH_BATCH; i++)
+    g_slice_free1 (batch->size[i], batch->mem[i]);
+  g_free (batch);
+}
+
+static gpointer
+bench_thread_func (gpointer data)
+{
+  guint64 *n_ops = data;
+  guint32 seed = GPOINTER_TO_UINT (data) | 1;
+
+  while (!g_atomic_int_get (&bench_running))
+    g_thread_yield ();
+
+  while (!g_atomic_int_get (&bench_stop))
+    {
+      Batch *batch = g_new (Batch, 1);
+      Batch *other;
+      int i;
+
+      for (i = 0; i < BENCH_BATCH; i++)
+        {
+          seed = seed * 1103515245 + 12345;
+          batch->size[i] = 16 + ((seed >> 16) % 15) * 8; /* 16..128 bytes */
+          batch->mem[i] = g_slice_alloc (batch->size[i]);
+        }
+
+      /* swap with whatever batch another thread left behind */
+      do
+        other = g_atomic_pointer_get (&bench_exchange);
+      while (!g_atomic_pointer_compare_and_exchange (&bench_exchange, other, batch));
+
+      if (other)
+        batch_free (other);
+
+      *n_ops += 2 * BENCH_BATCH;
+    }
+
+  return NULL;
+}
+
+static void
+benchmark (void)
+{
+  guint n_threads;
+
+  g_print ("%-8s %16s %16s\n", "threads", "ops/sec", "ops/sec/thread");
+
+  for (n_threads = 1; n_threads <= BENCH_THREADS; n_threads *= 2)
+    {
+      GThread *threads[BENCH_THREADS];
+      guint64 n_ops[BENCH_THREADS] = { 0, };
+      guint64 total = 0;
+      GTimer *timer;
+      gdouble elapsed;
+      guint t;
+
+      bench_running = 0;
+      bench_stop = 0;
+
+      for (t = 0; t < n_threads; t++)
+        threads[t] = g_thread_new ("bench", bench_thread_func, &n_ops[t]);
+
+      timer = g_timer_new ();
+      g_atomic_int_set (&bench_running, 1);
+      g_usleep (BENCH_MSECS * 1000);
+      g_atomic_int_set (&bench_stop, 1);
+
+      for (t = 0; t < n_threads; t++)
+        g_thread_join (threads[t]);
+      elapsed = g_timer_elapsed (timer, NULL);
+      g_timer_destroy (timer);
+
+      if (bench_exchange)
+        {
+          batch_free (bench_exchange);
+          bench_exchange = NULL;
+        }
+
+      for (t = 0; t < n_threads; t++)
+        total += n_ops[t];
+
+      g_print ("%-8u %16.0f %16.0f\n", n_threads,
+               total / elapsed, total / elapsed / n_threads);
+    }
+}
+
 int
-main (void)
+main (int   argc,
+      char *argv[])
 {
   int t;
 
+  if (argc > 1 && strcmp (argv[1], "--benchmark") == 0)
+    {
+      benchmark ();
+      return 0;
+    }
+
   for (t = 0; t < N_THREADS; t++)
     {
       tdata[t].thread_id = t + 1;
@@ -5,6 +5,8 @@
 
 #include <glib.h>
 
+#include <stdlib.h>
+
 /* #define DEBUG 1 */
 
 #ifdef DEBUG
@@ -297,6 +299,147 @@ test_thread_sort (gboolean sort)
   g_assert (g_thread_pool_get_num_threads (pool) == g_thread_pool_get_max_threads (pool));
 }
 
+#define STEALING_PRODUCERS  4
+#define STEALING_TASKS      10000
+
+static volatile gint stealing_counter = 0;
+static GThreadPool *stealing_pool = NULL;
+
+static void
+test_thread_stealing_entry_func (gpointer data, gpointer user_data)
+{
+  guint id;
+
+  id = GPOINTER_TO_UINT (data);
+
+  /* Every tenth task spawns another one from within the pool */
+  if (id % 10 == 0)
+    g_thread_pool_push (stealing_pool, GUINT_TO_POINTER (id + 1), NULL);
+
+  g_atomic_int_inc (&stealing_counter);
+}
+
+static gpointer
+test_thread_stealing_producer (gpointer data)
+{
+  GThreadPool *pool = data;
+  guint i;
+
+  for (i = 0; i < STEALING_TASKS; i++)
+    g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+
+  return NULL;
+}
+
+static void
+test_thread_work_stealing (void)
+{
+  GThread *producers[STEALING_PRODUCERS];
+  GError *error = NULL;
+  guint i;
+
+  stealing_counter = 0;
+  stealing_pool = g_thread_pool_new_work_stealing (test_thread_stealing_entry_func,
+                                                   NULL, MAX_THREADS, &error);
+  g_assert_no_error (error);
+  g_assert (stealing_pool != NULL);
+  g_assert_cmpint (g_thread_pool_get_max_threads (stealing_pool), ==, MAX_THREADS);
+  g_assert_cmpint (g_thread_pool_get_num_threads (stealing_pool), ==, MAX_THREADS);
+
+  g_thread_pool_set_sort_function (stealing_pool,
+                                   test_thread_sort_compare_func,
+                                   NULL);
+
+  for (i = 0; i < STEALING_PRODUCERS; i++)
+    producers[i] = g_thread_new ("producer", test_thread_stealing_producer, stealing_pool);
+  for (i = 0; i < STEALING_PRODUCERS; i++)
+    g_thread_join (producers[i]);
+
+  g_thread_pool_free (stealing_pool, FALSE, TRUE);
+  stealing_pool = NULL;
+
+  /* Each producer pushes 1000 tasks that push another one */
+  g_assert_cmpint (stealing_counter, ==,
+                   STEALING_PRODUCERS * (STEALING_TASKS + STEALING_TASKS / 10));
+}
+
+/* Run with --benchmark [THREADS] to compare the throughput of a classic
+ * exclusive pool with a work-stealing one, with several threads
+ * pushing small tasks at the same time.
+ */
+static void
+benchmark_entry_func (gpointer data, gpointer user_data)
+{
+  g_atomic_int_inc ((volatile gint *) user_data);
+}
+
+static gpointer
+benchmark_producer (gpointer data)
+{
+  GThreadPool *pool = data;
+  guint i;
+
+  for (i = 0; i < 200000; i++)
+    g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+
+  return NULL;
+}
+
+static gdouble
+benchmark_pool (gboolean stealing,
+                guint    n_threads,
+                guint    n_producers)
+{
+  GThread **producers;
+  GThreadPool *pool;
+  volatile gint counter = 0;
+  GTimer *timer;
+  gdouble elapsed;
+  guint i;
+
+  if (stealing)
+    pool = g_thread_pool_new_work_stealing (benchmark_entry_func, (gpointer) &counter,
+                                            n_threads, NULL);
+  else
+    pool = g_thread_pool_new (benchmark_entry_func, (gpointer) &counter,
+                              n_threads, TRUE, NULL);
+
+  producers = g_new (GThread *, n_producers);
+  timer = g_timer_new ();
+
+  for (i = 0; i < n_producers; i++)
+    producers[i] = g_thread_new ("producer", benchmark_producer, pool);
+  for (i = 0; i < n_producers; i++)
+    g_thread_join (producers[i]);
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  g_assert_cmpint (counter, ==, n_producers * 200000);
+
+  g_timer_destroy (timer);
+  g_free (producers);
+
+  return n_producers * 200000 / elapsed;
+}
+
+static void
+benchmark_pools (guint n_threads)
+{
+  guint n_producers;
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  g_print ("%-10s %10s %16s %16s\n",
+           "producers", "threads", "classic tasks/s", "stealing tasks/s");
+
+  for (n_producers = 1; n_producers <= 16; n_producers *= 2)
+    g_print ("%-10u %10u %16.0f %16.0f\n", n_producers, n_threads,
+             benchmark_pool (FALSE, n_threads, n_producers),
+             benchmark_pool (TRUE, n_threads, n_producers));
+}
+
 static void
 test_thread_idle_time_entry_func (gpointer data, gpointer user_data)
 {
@@ -406,6 +549,9 @@ test_check_start_and_stop (gpointer user_data)
     case 7:
       test_thread_idle_time ();
       break;
+    case 8:
+      test_thread_work_stealing ();
+      break;
     default:
       DEBUG_MSG (("***** END OF TESTS *****"));
       g_main_loop_quit (main_loop);
@@ -452,6 +598,12 @@ test_check_start_and_stop (gpointer user_data)
 int
 main (int argc, char *argv[])
 {
+  if (argc > 1 && g_str_equal (argv[1], "--benchmark"))
+    {
+      benchmark_pools (argc > 2 ? atoi (argv[2]) : 0);
+      return 0;
+    }
+
   DEBUG_MSG (("Starting... (in one second)"));
   g_timeout_add (1000, test_check_start_and_stop, NULL);
 